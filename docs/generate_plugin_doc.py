@@ -12,6 +12,7 @@ SHAPE_ORDERING = [
     'obj',
     'ply',
     'serialized',
+    'mmesh',
     'cube'
     'sphere',
     'disk',
@@ -66,6 +67,7 @@ SENSOR_ORDERING = [
 
 TEXTURE_ORDERING = [
     'bitmap',
+    'tiledbitmap',
     'checkerboard',
     'mesh_attribute',
     'volume'
@@ -91,6 +93,7 @@ SAMPLER_ORDERING = [
 INTEGRATOR_ORDERING = [
     'direct',
     'path',
+    'guided_path',
     'aov',
     'volpath',
     'volpathmis',
@@ -128,7 +131,8 @@ PHASE_ORDERING = [
 
 VOLUME_ORDERING = [
     'constvolume',
-    'gridvolume'
+    'gridvolume',
+    'sparsegridvolume'
 ]
 
 
@@ -12,7 +12,9 @@
 #include <mitsuba/core/warp.h>
 #include <mitsuba/core/util.h>
 #include <drjit/dynamic.h>
+#include <nanothread/nanothread.h>
 #include <array>
+#include <memory>
 
 NAMESPACE_BEGIN(mitsuba)
 
@@ -434,25 +436,37 @@ public:
 
             // Integrate linear interpolant
             const ScalarFloat *in = data + offset0;
+            std::unique_ptr<double[]> row_sum(new double[n_patches.y()]);
 
-            double sum = 0.0;
-            for (uint32_t y = 0; y < n_patches.y(); ++y) {
+            parallel_rows(n_patches, [&](uint32_t y) {
+                const ScalarFloat *row = in + y * size.x();
+                double sum = 0.0;
                 for (uint32_t x = 0; x < n_patches.x(); ++x) {
-                    ScalarFloat avg = .25f * (in[0] + in[1] + in[size.x()] +
-                                              in[size.x() + 1]);
+                    ScalarFloat avg = .25f * (row[x] + row[x + 1] + row[x + size.x()] +
+                                              row[x + size.x() + 1]);
                     sum += (double) avg;
                     *(l1p + m_levels[1].index(ScalarVector2u(x, y)) + offset1) = avg;
-                    ++in;
                 }
-                ++in;
-            }
+                row_sum[y] = sum;
+            });
+
+            double sum = 0.0;
+            for (uint32_t y = 0; y < n_patches.y(); ++y)
+                sum += row_sum[y];
 
             // Copy and normalize fine resolution interpolant
             ScalarFloat scale = normalize ? (ScalarFloat) (dr::prod(n_patches) / sum) : 1.f;
-            for (uint32_t i = 0; i < m_levels[0].size; ++i)
-                l0p[offset0 + i] = data[offset0 + i] * scale;
-            for (uint32_t i = 0; i < m_levels[1].size; ++i)
-                l1p[offset1 + i] *= scale;
+            parallel_rows(size, [&](uint32_t y) {
+                uint32_t i = offset0 + y * size.x();
+                for (uint32_t x = 0; x < size.x(); ++x)
+                    l0p[i + x] = data[i + x] * scale;
+            });
+            ScalarVector2u size1(m_levels[1].width, m_levels[1].size / m_levels[1].width);
+            parallel_rows(size1, [&](uint32_t y) {
+                uint32_t i = offset1 + y * size1.x();
+                for (uint32_t x = 0; x < size1.x(); ++x)
+                    l1p[i + x] *= scale;
+            });
 
             // Build a MIP hierarchy
             level_size = n_patches;
@@ -467,13 +481,13 @@ public:
                 ScalarFloat *l1p_ = l1.data.data();
 
                 // Downsample
-                for (uint32_t y = 0; y < level_size.y(); ++y) {
+                parallel_rows(level_size, [&](uint32_t y) {
                     for (uint32_t x = 0; x < level_size.x(); ++x) {
                         ScalarFloat *d1 = l1p_ + l1.index(ScalarVector2u(x, y)) + offset1;
                         const ScalarFloat *d0 = l0p_ + l0.index(ScalarVector2u(x*2, y*2)) + offset0;
                         *d1 = d0[0] + d0[1] + d0[2] + d0[3];
                     }
-                }
+                });
             }
         }
 
@@ -731,6 +745,33 @@ public:
     }
 
 protected:
+    /**
+     * \brief Invoke \c func for every row <tt>y < res.y()</tt> of an image
+     * of resolution \c res, processing blocks of rows in parallel
+     *
+     * Blocks start at even rows, so that they never share the 2x2 patches
+     * of a \ref Level. Small images are processed on the calling thread.
+     */
+    template <typename Func>
+    static void parallel_rows(const ScalarVector2u &res, Func &&func) {
+        uint32_t grain = dr::maximum(16384u / dr::maximum(res.x(), 1u), 2u);
+        grain += grain & 1u;
+
+        if (res.y() <= grain) {
+            for (uint32_t y = 0; y < res.y(); ++y)
+                func(y);
+            return;
+        }
+
+        dr::parallel_for(
+            dr::blocked_range<uint32_t>(0, res.y(), grain),
+            [&](const dr::blocked_range<uint32_t> &range) {
+                for (uint32_t y = range.begin(); y != range.end(); ++y)
+                    func(y);
+            }
+        );
+    }
+
     struct Level {
         uint32_t size;
         uint32_t width;
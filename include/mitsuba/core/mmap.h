@@ -58,6 +58,15 @@ public:
      */
     static ref<MemoryMappedFile> create_temporary(size_t size);
 
+    /**
+     * \brief Map the specified file into memory with copy-on-write semantics
+     *
+     * The mapped memory region can be modified, but changes remain private
+     * to the mapping and are never written back to the file. Pages are only
+     * copied once they are first written to.
+     */
+    static ref<MemoryMappedFile> map_private(const fs::path &filename);
+
     MI_DECLARE_CLASS()
 protected:
     /// Internal constructor
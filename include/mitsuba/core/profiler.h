@@ -1,6 +1,9 @@
 #pragma once
 
 #include <mitsuba/core/object.h>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #if defined(MI_ENABLE_ITTNOTIFY)
 #  include <ittnotify.h>
@@ -84,8 +87,35 @@ extern MI_EXPORT_LIB __itt_string_handle *
     mitsuba_itt_phase[int(ProfilerPhase::ProfilerPhaseCount)];
 #endif
 
+#if defined(MI_ENABLE_PROFILER)
+/* The profiler's signal handler reads \ref profiler_flags. Global-dynamic TLS
+   accesses (the default in shared libraries) may go through __tls_get_addr(),
+   which can allocate and is not async-signal-safe. The initial-exec model
+   uses a fixed offset from the thread pointer instead. */
+#if defined(__GNUC__)
+#  define MI_PROFILER_TLS_MODEL __attribute__((tls_model("initial-exec")))
+#else
+#  define MI_PROFILER_TLS_MODEL
+#endif
+
+/**
+ * Bit mask of the profiler phases that are currently active on the calling
+ * thread. Because of the partial order of \ref ProfilerPhase, this mask
+ * uniquely identifies the chain of nested phases (i.e. the phase stack).
+ */
+extern MI_EXPORT_LIB thread_local uint64_t profiler_flags MI_PROFILER_TLS_MODEL;
+#endif
+
 struct ScopedPhase {
     ScopedPhase(ProfilerPhase phase) {
+#if defined(MI_ENABLE_PROFILER)
+        /* Only the outermost occurrence of a phase toggles the flag, which
+           makes recursive invocations (e.g. nested BSDFs) harmless */
+        uint64_t flag = uint64_t(1) << int(phase);
+        m_flag = (profiler_flags & flag) ? 0 : flag;
+        profiler_flags |= m_flag;
+#endif
+
         /// Interface with various external visual profilers
 #if defined(MI_ENABLE_ITTNOTIFY)
         __itt_task_begin(mitsuba_itt_domain, __itt_null, __itt_null,
@@ -99,6 +129,10 @@ struct ScopedPhase {
     }
 
     ~ScopedPhase() {
+#if defined(MI_ENABLE_PROFILER)
+        profiler_flags &= ~m_flag;
+#endif
+
 #if defined(MI_ENABLE_ITTNOTIFY)
         __itt_task_end(mitsuba_itt_domain);
 #endif
@@ -110,10 +144,50 @@ struct ScopedPhase {
 
     ScopedPhase(const ScopedPhase &) = delete;
     ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+#if defined(MI_ENABLE_PROFILER)
+private:
+    uint64_t m_flag;
+#endif
 };
 
+/**
+ * \brief Low-overhead sampling profiler
+ *
+ * When Mitsuba is compiled with the CMake option ``MI_PROFILER_SAMPLING``,
+ * a timer signal periodically interrupts running threads and records the
+ * set of \ref ProfilerPhase entries that are active at that moment. The
+ * resulting histogram can be summarized per phase (inclusive and exclusive
+ * time) and per call chain.
+ *
+ * Only CPU time of scalar variants is meaningful, since JIT variants merely
+ * trace the marked functions. In builds without profiler support, all
+ * functions below are no-ops and the report is empty.
+ */
 class MI_EXPORT_LIB Profiler {
 public:
+    /// Was Mitsuba compiled with support for the sampling profiler?
+    static bool enabled();
+
+    /// Discard all samples that have been collected so far
+    static void reset();
+
+    /**
+     * \brief Return the per-phase time breakdown
+     *
+     * Each entry contains the phase name, the inclusive time (phase appears
+     * anywhere in the phase stack), and the exclusive time (phase is the
+     * innermost active phase), both in seconds of CPU time. Phases without
+     * samples are omitted.
+     */
+    static std::vector<std::tuple<std::string, double, double>> phase_breakdown();
+
+    /// Return a human-readable report with per-phase and per-call-chain statistics
+    static std::string report();
+
+    /// Print \ref report() via the logger (if any samples were collected)
+    static void print_report();
+
     static void static_initialization();
     static void static_shutdown();
 };
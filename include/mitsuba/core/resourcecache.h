@@ -0,0 +1,106 @@
+#pragma once
+
+#include <mitsuba/core/filesystem.h>
+#include <mitsuba/core/object.h>
+#include <functional>
+#include <utility>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**
+ * \brief Process-wide cache that deduplicates resources loaded from files
+ *
+ * Scenes frequently reference the same file from many objects (e.g. a texture
+ * used by dozens of materials, or a mesh placed many times). Plugins can
+ * load such resources through this cache, so that the file is only decoded
+ * once. Resources are identified by a key combining the resolved path of the
+ * file, its modification time, and the options that affect loading (see
+ * \ref key()). Cached resources are shared between all requesting objects
+ * and must hence be treated as read-only.
+ *
+ * When several threads request the same resource at the same time (e.g.
+ * during the parallel instantiation of a scene), only one of them loads it,
+ * while the others wait for the result. Requests made from within a loader
+ * (e.g. by a task that the thread pool scheduled during its nested parallel
+ * work) never wait and load an uncached copy instead.
+ *
+ * Resources are only kept while referenced elsewhere: the scene loaders
+ * call \ref prune() once they finish, and so does the destructor of
+ * \ref Scene, which releases the resources that were solely held by the
+ * cache. Long-running processes that load resources outside of scenes
+ * should call \ref clear() once they no longer need them. The Python
+ * bindings clear the cache at exit, before the JIT compiler shuts down.
+ */
+class MI_EXPORT_LIB ResourceCache {
+public:
+    /// Cache statistics
+    struct Statistics {
+        /// Number of requests served from the cache
+        size_t hits;
+
+        /// Number of requests that had to load the resource
+        size_t misses;
+
+        /// Total size of the resources served from the cache in bytes
+        size_t bytes_saved;
+
+        /// Number of resources currently held by the cache
+        size_t entries;
+
+        /// Total size of the resources currently held by the cache in bytes
+        size_t resident_bytes;
+    };
+
+    /// Loads a resource on a cache miss and returns it along with its size in bytes
+    using Loader = std::function<std::pair<ref<Object>, size_t>()>;
+
+    /**
+     * \brief Compute the key of a resource loaded from a file
+     *
+     * \param path
+     *    Resolved path of the file
+     *
+     * \param options
+     *    Description of all options that affect the loaded resource
+     */
+    static std::string key(const fs::path &path, const std::string &options = "");
+
+    /**
+     * \brief Look up a resource, loading it on a miss
+     *
+     * Exceptions raised by \c load are propagated to all threads waiting
+     * for the resource, which is not cached in this case.
+     */
+    static ref<Object> get(const std::string &key, const Loader &load);
+
+    /// Is the cache enabled? Otherwise, every request loads its resource.
+    static bool enabled();
+
+    /// Enable or disable the cache (Default: enabled)
+    static void set_enabled(bool value);
+
+    /// Release all resources that are not referenced outside of the cache
+    static void prune();
+
+    /// Release all resources held by the cache
+    static void clear();
+
+    /// Return the current cache statistics
+    static Statistics statistics();
+
+    /// Reset the hit/miss counters
+    static void reset_statistics();
+
+    /// Return a human-readable summary of the cache statistics
+    static std::string to_string();
+
+    /// Calls \ref prune() when going out of scope (e.g. at the end of a scene load)
+    struct ScopedPrune {
+        ScopedPrune() = default;
+        ~ScopedPrune() { ResourceCache::prune(); }
+        ScopedPrune(const ScopedPrune &) = delete;
+        ScopedPrune &operator=(const ScopedPrune &) = delete;
+    };
+};
+
+NAMESPACE_END(mitsuba)
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <mitsuba/core/fstream.h>
+#include <mitsuba/core/vector.h>
+#include <memory>
+#include <mutex>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**
+ * \brief Image stored on disk as a grid of square tiles, which are loaded on
+ * demand through the global \ref TileCache
+ *
+ * This makes it possible to render scenes referencing far more texture data
+ * than fits into memory: only the tiles that are actually accessed are
+ * loaded, and the least recently used ones are evicted once the memory budget
+ * of the cache is exceeded.
+ *
+ * Tiled images use a simple binary file format (extension <tt>.mtc</tt>)
+ * storing single precision samples, see \ref write() for its specification.
+ * Any \ref Bitmap can be converted into this format.
+ */
+class MI_EXPORT_LIB TiledImage : public Object {
+public:
+    using Float = float;
+    MI_IMPORT_CORE_TYPES()
+
+    /// Shared pointer to the samples of a tile (kept alive while referenced)
+    using Tile = std::shared_ptr<const float[]>;
+
+    /// Open a tiled image file. This only reads the header of the file.
+    TiledImage(const fs::path &path);
+
+    /// Release all tiles of this image held by the cache
+    ~TiledImage();
+
+    /**
+     * \brief Write a bitmap as a tiled image file
+     *
+     * The bitmap is converted to single precision samples (its pixel format
+     * and gamma are left unchanged). The file starts with the following header:
+     *
+     * - Bytes 1-3: ASCII bytes 'M', 'T', and 'C'
+     * - Byte 4: File format version number (currently 2)
+     * - Bytes 5-8: Image width (uint32)
+     * - Bytes 9-12: Image height (uint32)
+     * - Bytes 13-16: Number of channels (uint32)
+     * - Bytes 17-20: Tile size (uint32)
+     * - Bytes 21-28: Size of the source file, or zero (uint64)
+     * - Bytes 29-36: Modification time of the source file, or zero (uint64)
+     * - Bytes 37-40: Flags describing the conversion of the source (uint32)
+     * - Per channel: mean of all samples (float32)
+     *
+     * followed by all tiles in scanline order. Every tile stores
+     * <tt>tile_size * tile_size * channels</tt> samples in scanline order,
+     * including tiles that extend beyond the image boundary (their excess
+     * samples are zero).
+     *
+     * Files of version 1 lack the modification time and flags, which are
+     * reported as zero when reading them.
+     *
+     * \param source_size
+     *    Size of the file from which the bitmap was loaded, which can be used
+     *    to detect stale tiled images (see \ref source_size()).
+     *
+     * \param source_time
+     *    Modification time of the source file (see \ref fs::last_write_time())
+     *
+     * \param source_flags
+     *    Application-defined flags describing how the source was converted
+     *    (e.g. whether gamma correction was undone)
+     */
+    static void write(const Bitmap *bitmap, const fs::path &path,
+                      uint32_t tile_size = 64, uint64_t source_size = 0,
+                      uint64_t source_time = 0, uint32_t source_flags = 0);
+
+    /// Return the resolution of the image in pixels
+    const Vector2u &size() const { return m_size; }
+
+    /// Return the number of channels
+    uint32_t channel_count() const { return m_channel_count; }
+
+    /// Return the number of pixels along each side of a tile
+    uint32_t tile_size() const { return m_tile_size; }
+
+    /// Return the number of tiles along each axis
+    const Vector2u &tile_count() const { return m_tile_count; }
+
+    /// Return the size of the source file recorded when the image was written
+    uint64_t source_size() const { return m_source_size; }
+
+    /// Return the modification time of the source file recorded when the image was written
+    uint64_t source_time() const { return m_source_time; }
+
+    /// Return the conversion flags recorded when the image was written
+    uint32_t source_flags() const { return m_source_flags; }
+
+    /// Return the mean of a channel over the whole image
+    float mean(uint32_t channel) const { return m_mean[channel]; }
+
+    /// Return the path of the underlying file
+    const fs::path &path() const { return m_path; }
+
+    /**
+     * \brief Return the samples of a tile, loading them through the cache
+     *
+     * This function can safely be called from multiple threads.
+     */
+    Tile tile(uint32_t x, uint32_t y) const;
+
+    /// Read the samples of a tile from disk, bypassing the cache
+    Tile read_tile(uint32_t index) const;
+
+    /// Return a unique identifier of this image (used by the cache)
+    uint64_t id() const { return m_id; }
+
+    /// Return a human-readable summary
+    std::string to_string() const override;
+
+    MI_DECLARE_CLASS()
+
+protected:
+    fs::path m_path;
+    Vector2u m_size;
+    Vector2u m_tile_count;
+    uint32_t m_channel_count;
+    uint32_t m_tile_size;
+    uint64_t m_source_size;
+    uint64_t m_source_time;
+    uint32_t m_source_flags;
+    uint64_t m_data_offset;
+    std::vector<float> m_mean;
+    uint64_t m_id;
+
+    mutable ref<FileStream> m_stream;
+    mutable std::mutex m_mutex;
+};
+
+/**
+ * \brief Global least-recently-used cache of the tiles of \ref TiledImage
+ * instances
+ *
+ * The cache is shared by all tiled images and bounded by a memory budget.
+ * It is split into independently locked shards so that concurrent lookups
+ * from many rendering threads rarely contend.
+ */
+class MI_EXPORT_LIB TileCache {
+public:
+    using Tile = TiledImage::Tile;
+
+    /// Cache statistics
+    struct Statistics {
+        /// Number of lookups served from memory
+        size_t hits;
+
+        /// Number of lookups that had to load a tile from disk
+        size_t misses;
+
+        /// Number of tiles evicted to stay within the memory budget
+        size_t evictions;
+
+        /// Memory currently used by tiles in bytes
+        size_t resident_bytes;
+    };
+
+    /// Return the memory budget of the cache in bytes
+    static size_t budget();
+
+    /**
+     * \brief Set the memory budget of the cache in bytes (Default: 2 GiB)
+     *
+     * Tiles are evicted immediately if the new budget is smaller than the
+     * memory currently in use.
+     */
+    static void set_budget(size_t bytes);
+
+    /// Look up a tile of an image, loading it on a miss
+    static Tile lookup(const TiledImage *image, uint32_t index);
+
+    /// Remove all tiles of an image from the cache
+    static void release(const TiledImage *image);
+
+    /// Remove all tiles from the cache
+    static void clear();
+
+    /// Return the current cache statistics
+    static Statistics statistics();
+
+    /// Reset the hit/miss/eviction counters
+    static void reset_statistics();
+
+    /// Return a human-readable summary of the cache statistics
+    static std::string to_string();
+};
+
+NAMESPACE_END(mitsuba)
@@ -365,6 +365,20 @@ static const char *__doc_SbtRecord_header = R"doc()doc";
 
 static const char *__doc_drjit_operator_lshift = R"doc(Prints the canonical representation of a PCG32 object.)doc";
 
+static const char *__doc_mitsuba_AccelQuality =
+R"doc(Quality profile of acceleration data structures (scene parameter
+``accel_quality``)
+
+Lower profiles trade traversal performance for faster construction,
+which pays off when only few rays are traced (e.g. for interactive
+previews).)doc";
+
+static const char *__doc_mitsuba_AccelQuality_High = R"doc(Best traversal performance (default))doc";
+
+static const char *__doc_mitsuba_AccelQuality_Low = R"doc(Fastest build: cheap heuristics and shallow trees)doc";
+
+static const char *__doc_mitsuba_AccelQuality_Medium = R"doc(Compromise between build and traversal performance)doc";
+
 static const char *__doc_mitsuba_AdjointIntegrator =
 R"doc(Abstract adjoint integrator that performs Monte Carlo sampling
 starting from the emitters.
@@ -1031,6 +1045,13 @@ static const char *__doc_mitsuba_BSDF_set_id = R"doc(Set a string identifier)doc
 
 static const char *__doc_mitsuba_BSDF_to_string = R"doc(Return a human-readable representation of the BSDF)doc";
 
+static const char *__doc_mitsuba_BSDF_update_differentials_flag =
+R"doc(Set the BSDFFlags::NeedsDifferentials flag if one of the textures
+referenced by this BSDF (including those of nested BSDFs) requires
+texture-space differentials.
+
+This is invoked by shapes when the BSDF is attached to them.)doc";
+
 static const char *__doc_mitsuba_Bitmap =
 R"doc(General-purpose bitmap class with read and write support for several
 common file formats.
@@ -2433,6 +2454,8 @@ static const char *__doc_mitsuba_Emitter_m_flags = R"doc(Combined flags for all
 
 static const char *__doc_mitsuba_Emitter_m_sampling_weight = R"doc(Sampling weight)doc";
 
+static const char *__doc_mitsuba_Emitter_m_scene_index = R"doc(Index in the list of emitters of the scene)doc";
+
 static const char *__doc_mitsuba_Emitter_operator_delete = R"doc()doc";
 
 static const char *__doc_mitsuba_Emitter_operator_delete_2 = R"doc()doc";
@@ -2445,8 +2468,13 @@ static const char *__doc_mitsuba_Emitter_parameters_changed = R"doc()doc";
 
 static const char *__doc_mitsuba_Emitter_sampling_weight = R"doc(The emitter's sampling weight.)doc";
 
+static const char *__doc_mitsuba_Emitter_scene_index = R"doc(Index of the emitter in the list of emitters of its scene)doc";
+
 static const char *__doc_mitsuba_Emitter_set_dirty = R"doc(Modify the emitter's "dirty" flag)doc";
 
+static const char *__doc_mitsuba_Emitter_set_scene_index =
+R"doc(Set the index of the emitter in the list of emitters of its scene)doc";
+
 static const char *__doc_mitsuba_Emitter_traverse = R"doc()doc";
 
 static const char *__doc_mitsuba_Endpoint =
@@ -2979,6 +3007,12 @@ static const char *__doc_mitsuba_Film_m_size = R"doc()doc";
 
 static const char *__doc_mitsuba_Film_m_srf = R"doc()doc";
 
+static const char *__doc_mitsuba_Film_output_path =
+R"doc(Return the path of the file written by write() when it is given
+``path``
+
+Films may e.g. replace the extension by the one of their file format.)doc";
+
 static const char *__doc_mitsuba_Film_parameters_changed = R"doc()doc";
 
 static const char *__doc_mitsuba_Film_prepare =
@@ -4037,6 +4071,119 @@ time. If not, the application is terminated via ``abort()``.)doc";
 
 static const char *__doc_mitsuba_Jit_static_shutdown = R"doc(Release all memory used by JIT-compiled routines)doc";
 
+static const char *__doc_mitsuba_LightTree =
+R"doc(Bounding volume hierarchy over the emitters of a scene that selects
+emitters in proportion to their estimated contribution at a reference
+point
+
+Every node of the tree stores conservative bounds of the emitters
+below it: an axis-aligned bounding box, a cone bounding their surface
+normals (axis and half-angle :math:`\theta_o`), the half-angle
+:math:`\theta_e` of the emission profile around those normals, and
+their total emitted power. When selecting an emitter for a reference
+point, the tree is traversed from the root while choosing each child
+with a probability proportional to an importance estimate derived from
+these bounds, following "Importance Sampling of Many Lights with
+Adaptive Tree Splitting" by Conty Estevez and Kulla (2018) in the
+formulation of PBRT v4. The same estimate is evaluated when computing
+the probability of a given emitter, hence both directions remain
+consistent for multiple importance sampling.
+
+The importance of a node is zero only if none of its emitters can
+illuminate the reference point, so emitter sampling remains unbiased.
+Bounds that cannot be determined exactly (e.g. the normals of curved
+analytic shapes) fall back to the full sphere of directions.
+
+Emitters at infinity (environment maps, directional lights) cannot be
+bounded spatially. They are kept outside of the tree and are selected
+with a fixed probability, in proportion to their sampling weights.)doc";
+
+static const char *__doc_mitsuba_LightTree_LightBounds = R"doc(Bounds of a set of emitters (see the class description))doc";
+
+static const char *__doc_mitsuba_LightTree_LightBounds_cost =
+R"doc(Cost of a set of emitters for the surface area orientation heuristic)doc";
+
+static const char *__doc_mitsuba_LightTree_LightBounds_merge = R"doc(Merge two bounds)doc";
+
+static const char *__doc_mitsuba_LightTree_LightTree =
+R"doc(Build a light tree over a list of emitters
+
+The index of an emitter in this list is used to refer to it in the
+remainder of the interface. It must match the
+Emitter::scene_index() of the emitter.)doc";
+
+static const char *__doc_mitsuba_LightTree_build =
+R"doc(Recursively build the subtree over ``lights[start, end)`` and store it
+in node ``index``)doc";
+
+static const char *__doc_mitsuba_LightTree_depth = R"doc(Return the maximum depth of the tree)doc";
+
+static const char *__doc_mitsuba_LightTree_emitter_count =
+R"doc(Return the number of emitters in the tree (excluding those at infinity))doc";
+
+static const char *__doc_mitsuba_LightTree_estimate_bounds = R"doc(Estimate the bounds of every emitter that is not at infinity)doc";
+
+static const char *__doc_mitsuba_LightTree_importance = R"doc(Importance estimate of a node at a reference point)doc";
+
+static const char *__doc_mitsuba_LightTree_m_depth = R"doc()doc";
+
+static const char *__doc_mitsuba_LightTree_m_emitter_count = R"doc()doc";
+
+static const char *__doc_mitsuba_LightTree_m_emitter_leaf =
+R"doc(Per emitter: index of its leaf node, or an invalid index (infinite
+emitters))doc";
+
+static const char *__doc_mitsuba_LightTree_m_infinite_distr = R"doc(Distribution over the infinite emitters)doc";
+
+static const char *__doc_mitsuba_LightTree_m_infinite_index = R"doc(Index of every infinite emitter in the list of emitters)doc";
+
+static const char *__doc_mitsuba_LightTree_m_infinite_pmf =
+R"doc(Per emitter: probability of choosing an infinite emitter (zero
+otherwise))doc";
+
+static const char *__doc_mitsuba_LightTree_m_infinite_prob =
+R"doc(Probability of choosing an infinite emitter instead of the tree)doc";
+
+static const char *__doc_mitsuba_LightTree_m_node_child =
+R"doc(Per node: index of the first child (the second one follows directly),
+or the emitter index with the highest bit set for leaves)doc";
+
+static const char *__doc_mitsuba_LightTree_m_node_count = R"doc()doc";
+
+static const char *__doc_mitsuba_LightTree_m_node_parent = R"doc(Per node: index of the parent node)doc";
+
+static const char *__doc_mitsuba_LightTree_m_nodes = R"doc(Per node: 3 x 4 floats with the bounds (see importance()))doc";
+
+static const char *__doc_mitsuba_LightTree_mesh_normal_cone =
+R"doc(Compute a cone bounding the normals of a mesh
+
+Returns the axis and the cosine of the half-angle of the cone, which
+is -1 if the normals cannot be bounded by a cone of at most 90
+degrees.)doc";
+
+static const char *__doc_mitsuba_LightTree_node_count = R"doc(Return the number of nodes of the tree)doc";
+
+static const char *__doc_mitsuba_LightTree_pdf_emitter =
+R"doc(Return the probability of choosing an emitter with sample_emitter())doc";
+
+static const char *__doc_mitsuba_LightTree_sample_emitter =
+R"doc(Select an emitter in proportion to its estimated contribution at a
+reference point
+
+Parameter ``ref``:
+    The reference point. Its normal (if nonzero) is accounted for when
+    estimating the contribution of emitters.
+
+Parameter ``sample``:
+    A uniformly distributed sample on ``[0, 1]``.
+
+Returns:
+    The index of the chosen emitter, the reused sample, and the
+    probability of choosing this emitter. The latter is zero if no
+    emitter can contribute to the reference point.)doc";
+
+static const char *__doc_mitsuba_LightTree_to_string = R"doc(Return a human-readable summary of this light tree)doc";
+
 static const char *__doc_mitsuba_LogLevel = R"doc(Available Log message types)doc";
 
 static const char *__doc_mitsuba_LogLevel_Debug = R"doc(Trace message, for extremely verbose debugging)doc";
@@ -4316,6 +4463,9 @@ static const char *__doc_mitsuba_Medium_Medium_2 = R"doc()doc";
 
 static const char *__doc_mitsuba_Medium_class = R"doc()doc";
 
+static const char *__doc_mitsuba_Medium_eval_majorant_grid =
+R"doc(Look up the majorant supergrid at the given world-space position)doc";
+
 static const char *__doc_mitsuba_Medium_get_majorant = R"doc(Returns the medium's majorant used for delta tracking)doc";
 
 static const char *__doc_mitsuba_Medium_get_scattering_coefficients =
@@ -4336,10 +4486,20 @@ static const char *__doc_mitsuba_Medium_m_id = R"doc(Identifier (if available))d
 
 static const char *__doc_mitsuba_Medium_m_is_homogeneous = R"doc()doc";
 
+static const char *__doc_mitsuba_Medium_m_majorant_bbox = R"doc(World-space region covered by the majorant supergrid)doc";
+
+static const char *__doc_mitsuba_Medium_m_majorant_grid =
+R"doc(Coarse grid of local majorants ("supergrid"), empty if unused)doc";
+
+static const char *__doc_mitsuba_Medium_m_majorant_resolution = R"doc(Resolution of the majorant supergrid (zero if unused))doc";
+
 static const char *__doc_mitsuba_Medium_m_phase_function = R"doc()doc";
 
 static const char *__doc_mitsuba_Medium_m_sample_emitters = R"doc()doc";
 
+static const char *__doc_mitsuba_Medium_majorant_resolution =
+R"doc(Returns the resolution of the majorant supergrid (zero if unused))doc";
+
 static const char *__doc_mitsuba_Medium_operator_delete = R"doc()doc";
 
 static const char *__doc_mitsuba_Medium_operator_delete_2 = R"doc()doc";
@@ -4368,11 +4528,25 @@ Parameter ``channel``:
     The channel according to which we will sample the free-flight
     distance. This argument is only used when rendering in RGB modes.
 
+When the medium provides a majorant supergrid (see
+update_majorant_grid()), the distance is sampled with respect to the
+piecewise constant majorant along the ray, which is found by
+traversing the grid cells using a 3D DDA. The ``combined_extinction``
+field of the returned interaction then holds the local majorant at the
+sampled position.
+
 Returns:
     This method returns a MediumInteraction. The MediumInteraction
     will always be valid, except if the ray missed the Medium's
     bounding box.)doc";
 
+static const char *__doc_mitsuba_Medium_sample_majorant_grid =
+R"doc(Sample a free-flight distance with respect to the piecewise
+constant majorant of the supergrid
+
+Returns the sampled distance (infinity if it lies beyond ``maxt``) and
+the majorant of the cell containing it.)doc";
+
 static const char *__doc_mitsuba_Medium_set_id = R"doc(Set a string identifier)doc";
 
 static const char *__doc_mitsuba_Medium_to_string = R"doc(Return a human-readable representation of the Medium)doc";
@@ -4394,6 +4568,14 @@ Returns:
 
 static const char *__doc_mitsuba_Medium_traverse = R"doc()doc";
 
+static const char *__doc_mitsuba_Medium_update_majorant_grid =
+R"doc((Re-)build the majorant supergrid from the given volume
+
+Each cell of the grid (which spans the bounding box of ``volume`` and
+has resolution m_majorant_resolution) stores an upper bound of
+``scale * volume`` within the cell. Does nothing when the resolution
+is zero.)doc";
+
 static const char *__doc_mitsuba_Medium_use_emitter_sampling = R"doc(Returns whether this specific medium instance uses emitter sampling)doc";
 
 static const char *__doc_mitsuba_MemoryMappedFile =
@@ -4433,6 +4615,13 @@ static const char *__doc_mitsuba_MemoryMappedFile_data_2 = R"doc(Return a pointe
 
 static const char *__doc_mitsuba_MemoryMappedFile_filename = R"doc(Return the associated filename)doc";
 
+static const char *__doc_mitsuba_MemoryMappedFile_map_private =
+R"doc(Map the specified file into memory with copy-on-write semantics
+
+The mapped memory region can be modified, but changes remain private
+to the mapping and are never written back to the file. Pages are only
+copied once they are first written to.)doc";
+
 static const char *__doc_mitsuba_MemoryMappedFile_resize =
 R"doc(Resize the memory-mapped file
 
@@ -4545,6 +4734,8 @@ static const char *__doc_mitsuba_Mesh_4 = R"doc()doc";
 
 static const char *__doc_mitsuba_Mesh_5 = R"doc()doc";
 
+static const char *__doc_mitsuba_Mesh_CachedGeometry = R"doc(Geometry shared between meshes through the ResourceCache)doc";
+
 static const char *__doc_mitsuba_Mesh_Mesh = R"doc(Create a new mesh with the given vertex and face data structures)doc";
 
 static const char *__doc_mitsuba_Mesh_Mesh_2 = R"doc()doc";
@@ -4617,6 +4808,12 @@ static const char *__doc_mitsuba_Mesh_differential_motion = R"doc()doc";
 
 static const char *__doc_mitsuba_Mesh_embree_geometry = R"doc(Return the Embree version of this shape)doc";
 
+static const char *__doc_mitsuba_Mesh_embree_update_geometry =
+R"doc(Update the Embree geometry after the vertex positions changed
+
+The vertex buffer is swapped and the BVH of the mesh is refitted.
+Other changes (e.g. of the faces) require a new geometry.)doc";
+
 static const char *__doc_mitsuba_Mesh_ensure_pmf_built = R"doc()doc";
 
 static const char *__doc_mitsuba_Mesh_eval_attribute = R"doc()doc";
@@ -4657,6 +4854,26 @@ static const char *__doc_mitsuba_Mesh_interpolate_attribute = R"doc()doc";
 
 static const char *__doc_mitsuba_Mesh_invert_silhouette_sample = R"doc()doc";
 
+static const char *__doc_mitsuba_Mesh_load_cached =
+R"doc(Load the geometry of the mesh through the ResourceCache
+
+Meshes loaded from the same file with the same options share their
+buffers, which avoids parsing the file again when it is instantiated
+several times (e.g. with different ``to_world`` transformations).
+
+On a cache miss, ``load`` is invoked to read the file. It must fill in
+the buffers, attributes, and bounding box of the mesh in world space
+(i.e. transformed by ``m_to_world``) and return whether the vertex
+normals were computed from the geometry rather than read from the
+file. On a hit, the cached buffers are reused and transformed when the
+``to_world`` transformation of this mesh differs from the cached one.
+
+Parameter ``path``:
+    Resolved path of the mesh file
+
+Parameter ``options``:
+    Description of the loader options that affect the geometry)doc";
+
 static const char *__doc_mitsuba_Mesh_m_E2E = R"doc(Directed edges data structures to support neighbor queries)doc";
 
 static const char *__doc_mitsuba_Mesh_m_E2E_outdated = R"doc()doc";
@@ -4815,6 +5032,23 @@ static const char *__doc_mitsuba_Mesh_vertex_texcoords_buffer = R"doc(Return ver
 
 static const char *__doc_mitsuba_Mesh_vertex_texcoords_buffer_2 = R"doc(Const variant of vertex_texcoords_buffer.)doc";
 
+static const char *__doc_mitsuba_Mesh_write_mmesh =
+R"doc(Write the mesh to an uncompressed binary file that the ``mmesh``
+plugin maps directly into memory when loading it
+
+This can be used to convert meshes loaded from other formats (e.g.
+``.serialized``, PLY or OBJ files).
+
+Parameter ``filename``:
+    Target file path on disk)doc";
+
+static const char *__doc_mitsuba_Mesh_write_mmesh_2 =
+R"doc(Write the mesh encoded in the format of the ``mmesh`` plugin to a
+stream
+
+Parameter ``stream``:
+    Target stream that will receive the encoded output)doc";
+
 static const char *__doc_mitsuba_Mesh_write_ply =
 R"doc(Write the mesh to a binary PLY file
 
@@ -5753,7 +5987,18 @@ fields that deviate from the standard zero-initialization convention.
 In this particular class, the ``t`` field should be set to an infinite
 value to mark invalid intersection records.)doc";
 
-static const char *__doc_mitsuba_Profiler = R"doc()doc";
+static const char *__doc_mitsuba_Profiler =
+R"doc(Low-overhead sampling profiler
+
+When Mitsuba is compiled with the CMake option ``MI_PROFILER_SAMPLING``,
+a timer signal periodically interrupts running threads and records the
+set of ProfilerPhase entries that are active at that moment. The
+resulting histogram can be summarized per phase (inclusive and
+exclusive time) and per call chain.
+
+Only CPU time of scalar variants is meaningful, since JIT variants
+merely trace the marked functions. In builds without profiler support,
+all functions below are no-ops and the report is empty.)doc";
 
 static const char *__doc_mitsuba_ProfilerPhase =
 R"doc(List of 'phases' that are handled by the profiler. Note that a partial
@@ -5814,6 +6059,22 @@ static const char *__doc_mitsuba_ProfilerPhase_TextureEvaluate = R"doc()doc";
 
 static const char *__doc_mitsuba_ProfilerPhase_TextureSample = R"doc()doc";
 
+static const char *__doc_mitsuba_Profiler_enabled = R"doc(Was Mitsuba compiled with support for the sampling profiler?)doc";
+
+static const char *__doc_mitsuba_Profiler_phase_breakdown =
+R"doc(Return the per-phase time breakdown
+
+Each entry contains the phase name, the inclusive time (phase appears
+anywhere in the phase stack), and the exclusive time (phase is the
+innermost active phase), both in seconds of CPU time. Phases without
+samples are omitted.)doc";
+
+static const char *__doc_mitsuba_Profiler_print_report = R"doc(Print report() via the logger (if any samples were collected))doc";
+
+static const char *__doc_mitsuba_Profiler_report = R"doc(Return a human-readable report with per-phase and per-call-chain statistics)doc";
+
+static const char *__doc_mitsuba_Profiler_reset = R"doc(Discard all samples that have been collected so far)doc";
+
 static const char *__doc_mitsuba_Profiler_static_initialization = R"doc()doc";
 
 static const char *__doc_mitsuba_Profiler_static_shutdown = R"doc()doc";
@@ -6474,6 +6735,75 @@ static const char *__doc_mitsuba_Resampler_target_resolution = R"doc(Return the
 
 static const char *__doc_mitsuba_Resampler_to_string = R"doc(Return a human-readable summary)doc";
 
+static const char *__doc_mitsuba_ResourceCache =
+R"doc(Process-wide cache that deduplicates resources loaded from files
+
+Scenes frequently reference the same file from many objects (e.g. a
+texture used by dozens of materials, or a mesh placed many times).
+Plugins can load such resources through this cache, so that the file
+is only decoded once. Resources are identified by a key combining the
+resolved path of the file, its modification time, and the options that
+affect loading (see key()). Cached resources are shared between all
+requesting objects and must hence be treated as read-only.
+
+When several threads request the same resource at the same time (e.g.
+during the parallel instantiation of a scene), only one of them loads
+it, while the others wait for the result.
+
+Resources are only kept while referenced elsewhere: the scene loaders
+call prune() once they finish, and so does the destructor of Scene,
+which releases the resources that were solely held by the cache. Long-
+running processes that load resources outside of scenes should call
+clear() once they no longer need them. The Python bindings clear the
+cache at exit, before the JIT compiler shuts down.)doc";
+
+static const char *__doc_mitsuba_ResourceCache_ScopedPrune =
+R"doc(Calls prune() when going out of scope (e.g. at the end of a scene load))doc";
+
+static const char *__doc_mitsuba_ResourceCache_Statistics = R"doc(Cache statistics)doc";
+
+static const char *__doc_mitsuba_ResourceCache_Statistics_bytes_saved = R"doc(Total size of the resources served from the cache in bytes)doc";
+
+static const char *__doc_mitsuba_ResourceCache_Statistics_entries = R"doc(Number of resources currently held by the cache)doc";
+
+static const char *__doc_mitsuba_ResourceCache_Statistics_hits = R"doc(Number of requests served from the cache)doc";
+
+static const char *__doc_mitsuba_ResourceCache_Statistics_misses = R"doc(Number of requests that had to load the resource)doc";
+
+static const char *__doc_mitsuba_ResourceCache_Statistics_resident_bytes =
+R"doc(Total size of the resources currently held by the cache in bytes)doc";
+
+static const char *__doc_mitsuba_ResourceCache_clear = R"doc(Release all resources held by the cache)doc";
+
+static const char *__doc_mitsuba_ResourceCache_enabled =
+R"doc(Is the cache enabled? Otherwise, every request loads its resource.)doc";
+
+static const char *__doc_mitsuba_ResourceCache_get =
+R"doc(Look up a resource, loading it on a miss
+
+Exceptions raised by ``load`` are propagated to all threads waiting
+for the resource, which is not cached in this case.)doc";
+
+static const char *__doc_mitsuba_ResourceCache_key =
+R"doc(Compute the key of a resource loaded from a file
+
+Parameter ``path``:
+    Resolved path of the file
+
+Parameter ``options``:
+    Description of all options that affect the loaded resource)doc";
+
+static const char *__doc_mitsuba_ResourceCache_prune =
+R"doc(Release all resources that are not referenced outside of the cache)doc";
+
+static const char *__doc_mitsuba_ResourceCache_reset_statistics = R"doc(Reset the hit/miss counters)doc";
+
+static const char *__doc_mitsuba_ResourceCache_set_enabled = R"doc(Enable or disable the cache (Default: enabled))doc";
+
+static const char *__doc_mitsuba_ResourceCache_statistics = R"doc(Return the current cache statistics)doc";
+
+static const char *__doc_mitsuba_ResourceCache_to_string = R"doc(Return a human-readable summary of the cache statistics)doc";
+
 static const char *__doc_mitsuba_SGGXPhaseFunctionParams =
 R"doc(The parameters of the SGGX phase function stored as a pair of 3D
 vectors [[S_xx, S_yy, S_zz], [S_xy, S_xz, S_yz]])doc";
@@ -6649,9 +6979,34 @@ Must be a multiple of the total sample count per pixel. If set to
 
 static const char *__doc_mitsuba_SamplingIntegrator_render = R"doc(//! @{ \name Integrator interface implementation)doc";
 
+static const char *__doc_mitsuba_SamplingIntegrator_adaptive = R"doc(Is adaptive sampling enabled for the current render job?)doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_adaptive_aov = R"doc(Write the per-pixel sample count to an additional film channel?)doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_adaptive_min_spp = R"doc(Number of samples per pixel before the error is estimated the first time)doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_adaptive_step = R"doc(Number of samples per adaptive sampling round)doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_adaptive_threshold = R"doc(Relative error threshold of adaptive sampling (disabled when zero))doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_progressive = R"doc(Render in full-frame passes with an increasing number of samples?)doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_progressive_interval = R"doc(Minimum time between two progressive rendering snapshots (in seconds))doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_progressive_snapshot = R"doc(Filename of progressive rendering snapshots (disabled when empty))doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_m_sample_counter = R"doc(Total number of samples taken during the current render job)doc";
+
 static const char *__doc_mitsuba_SamplingIntegrator_render_block = R"doc()doc";
 
-static const char *__doc_mitsuba_SamplingIntegrator_render_sample = R"doc()doc";
+static const char *__doc_mitsuba_SamplingIntegrator_render_block_adaptive = R"doc(Variant of render_block() that implements adaptive sampling)doc";
+
+static const char *__doc_mitsuba_SamplingIntegrator_render_sample =
+R"doc(Render a single sample (or a wavefront of samples)
+
+Returns the image-plane position of the sample. When ``splat`` is
+``False``, the sample is only written to ``aovs``, and the caller is
+responsible for adding it to the image block at that position.)doc";
 
 static const char *__doc_mitsuba_SamplingIntegrator_sample =
 R"doc(Sample the incident radiance along a ray.
@@ -6805,6 +7160,9 @@ Parameter ``ss``:
 Returns:
     The corresponding boundary sample space point)doc";
 
+static const char *__doc_mitsuba_Scene_light_tree =
+R"doc(Return the light tree used to choose emitters for direct illumination (if any))doc";
+
 static const char *__doc_mitsuba_Scene_m_accel = R"doc(Acceleration data structure (IAS) (type depends on implementation))doc";
 
 static const char *__doc_mitsuba_Scene_m_accel_handle = R"doc(Handle to the IAS used to ensure its lifetime in jit variants)doc";
@@ -6817,6 +7175,8 @@ static const char *__doc_mitsuba_Scene_m_emitter_distr = R"doc()doc";
 
 static const char *__doc_mitsuba_Scene_m_emitter_pmf = R"doc()doc";
 
+static const char *__doc_mitsuba_Scene_m_emitter_sampling = R"doc()doc";
+
 static const char *__doc_mitsuba_Scene_m_emitters = R"doc()doc";
 
 static const char *__doc_mitsuba_Scene_m_emitters_dr = R"doc()doc";
@@ -6825,6 +7185,8 @@ static const char *__doc_mitsuba_Scene_m_environment = R"doc()doc";
 
 static const char *__doc_mitsuba_Scene_m_integrator = R"doc()doc";
 
+static const char *__doc_mitsuba_Scene_m_light_tree = R"doc()doc";
+
 static const char *__doc_mitsuba_Scene_m_sensors = R"doc()doc";
 
 static const char *__doc_mitsuba_Scene_m_sensors_dr = R"doc()doc";
@@ -7118,6 +7480,11 @@ between the reference point and the sampled emitter position. However,
 approximations are acceptable as long as these are reflected in the
 returned Monte Carlo sampling weight.
 
+When the scene uses a light tree (see light_tree()), the emitter is
+chosen in proportion to an estimate of its contribution at ``ref``.
+Otherwise, it is chosen in proportion to the emitters' sampling
+weights.
+
 Parameter ``ref``:
     A 3D reference location within the scene, which may influence the
     sampling process.
@@ -7398,6 +7765,107 @@ static const char *__doc_mitsuba_Shape_5 = R"doc()doc";
 
 static const char *__doc_mitsuba_Shape_6 = R"doc()doc";
 
+static const char *__doc_mitsuba_ShapeBVH =
+R"doc(Wide bounding volume hierarchy for the native CPU ray tracing backend
+
+This class is an alternative to ShapeKDTree that can be selected via
+the scene parameter ``accel_type="bvh"``. It is substantially faster
+and more memory-efficient to build, which makes it preferable for
+scenes that are frequently rebuilt.
+
+Construction first creates a binary BVH using the surface area
+heuristic (SAH) evaluated over a fixed number of centroid bins. Large
+subtrees are binned, partitioned and built in parallel. The binary
+hierarchy is then collapsed into nodes with MI_BVH_WIDTH children by
+repeatedly opening the child with the largest surface area.
+
+Each node stores the bounding boxes of its children in a
+structure-of-arrays layout, so that a ray is tested against all of
+them using a single SIMD slab test (AVX/AVX-512 on hosts supporting
+them).
+
+The following parameters of the enclosing scene control the build:
+
+- ``bvh_max_prims``: maximum number of primitives per leaf (default:
+8)
+- ``bvh_bins``: number of SAH bins per axis (default: 16)
+- ``bvh_traversal_cost``: SAH cost of a node traversal, relative to a
+primitive intersection (default: 1))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BVHNode =
+R"doc(Node of the wide BVH
+
+Stores the bounds of its children in a structure-of-arrays layout.
+Unused slots have an empty (inverted) bounding box that never
+intersects a ray.)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BVHNode_bbox_max = R"doc()doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BVHNode_bbox_min = R"doc(Lower and upper bounds of the children, per axis)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BVHNode_child = R"doc(Index of the child node (inner nodes) or offset into the index list (leaves))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BVHNode_prim_count = R"doc(Number of primitives of a leaf child (zero for inner nodes and unused slots))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BuildContext = R"doc(Helper data structure used during BVH construction)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_BuildNode = R"doc(Node of the intermediate binary BVH)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_ShapeBVH = R"doc(Create an empty BVH and take build-related parameters from ``props``.)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_add_shape = R"doc(Register a new shape with the BVH (to be called before build()))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_bbox = R"doc(Return the bounding box of the entire BVH)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_bbox_2 = R"doc(Return the bounding box of the i-th primitive)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_bbox_3 = R"doc(Return the (clipped) bounding box of the i-th primitive)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_build = R"doc(Build the BVH)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_build_recursive = R"doc(Recursively build the subtree of the binary BVH for the primitives [start, end))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_class = R"doc()doc";
+
+static const char *__doc_mitsuba_ShapeBVH_clear = R"doc(Clear the BVH (build-related parameters remain))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_collapse = R"doc(Convert the subtree of the binary BVH below ``node`` into wide nodes)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_find_shape =
+R"doc(Map an abstract primitive index to a specific shape managed by the
+ShapeBVH.
+
+The function returns the shape index and updates the *idx* parameter
+to point to the primitive index (e.g. triangle ID) within the shape.)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_intersect_prim = R"doc(Check whether a primitive is intersected by the given ray.)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_node_count = R"doc(Return the number of nodes of the wide BVH)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_partition = R"doc(Split the primitives [start, end) at the given bin (returns the split position))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_primitive_count = R"doc(Return the number of registered primitives)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_ray_intersect_naive = R"doc(Brute force intersection routine for debugging purposes)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_ready = R"doc(Return whether or not the BVH has been built)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_refit =
+R"doc(Update the bounds of all nodes after the primitives have moved
+
+The topology of the BVH is kept as is, hence this is much cheaper than
+a rebuild. Traversal performance degrades when the primitives move far
+from where they were at build time, and the shapes must not change
+their number of primitives.)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_shape = R"doc(Return the i-th shape (const version))doc";
+
+static const char *__doc_mitsuba_ShapeBVH_shape_2 = R"doc(Return the i-th shape)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_shape_count = R"doc(Return the number of registered shapes)doc";
+
+static const char *__doc_mitsuba_ShapeBVH_to_string = R"doc(Return a human-readable string representation of the scene contents.)doc";
+
 static const char *__doc_mitsuba_ShapeGroup = R"doc()doc";
 
 static const char *__doc_mitsuba_ShapeGroup_2 = R"doc()doc";
@@ -7482,7 +7950,10 @@ static const char *__doc_mitsuba_ShapeKDTree_5 = R"doc()doc";
 
 static const char *__doc_mitsuba_ShapeKDTree_ShapeKDTree =
 R"doc(Create an empty kd-tree and take build-related parameters from
-``props``.)doc";
+``props``.
+
+The ``accel_quality`` profile selects default builder parameters,
+which can be further adjusted by the individual ``kd_*`` parameters.)doc";
 
 static const char *__doc_mitsuba_ShapeKDTree_add_shape = R"doc(Register a new shape with the kd-tree (to be called before build()))doc";
 
@@ -7650,6 +8121,14 @@ the same value as primitive_count().)doc";
 
 static const char *__doc_mitsuba_Shape_embree_geometry = R"doc(Return the Embree version of this shape)doc";
 
+static const char *__doc_mitsuba_Shape_embree_update_geometry =
+R"doc(Update an Embree geometry previously created by embree_geometry()
+after a parameter change
+
+Returns ``False`` if the geometry cannot be updated in place, in which
+case the caller creates a new one. This is what the default
+implementation does.)doc";
+
 static const char *__doc_mitsuba_Shape_emitter = R"doc(Return the area emitter associated with this shape (if any))doc";
 
 static const char *__doc_mitsuba_Shape_emitter_2 = R"doc(Return the area emitter associated with this shape (if any))doc";
@@ -8233,6 +8712,122 @@ offsetting, during a ray intersection, the ray could potentially find
 an intersection point at its origin due to numerical instabilities in
 the intersection routines.)doc";
 
+static const char *__doc_mitsuba_SparseVolumeGrid =
+R"doc(Sparse two-level storage of 3D volume grids
+
+The voxels of the grid are partitioned into cubic bricks of
+<tt>brick_size^3</tt> voxels. A dense top-level index with one entry per
+brick ("tile") refers to a pool that only stores the bricks containing at
+least one value whose magnitude exceeds a threshold. All other tiles refer
+to brick 0, which is reserved and always stores zeros. This allows lookups
+to resolve any voxel with two gathers and without branching, while volumes
+that are mostly empty (e.g. smoke and explosion simulations) only pay for
+the regions that actually contain data.
+
+Within the pool, the data of brick ``b`` is ordered so that the following
+C-style indexing operation makes sense:
+<tt>bricks[((b * brick_size + z) * brick_size + y) * brick_size + x) * channels + chan]</tt>
+
+Sparse grids can be converted from a dense VolumeGrid or loaded from
+the sparse volume file format (see the documentation of the
+sparsegridvolume plugin for its specification).)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_SparseVolumeGrid =
+R"doc(Load a SparseVolumeGrid from a given filename
+
+Both the sparse format and the dense Mitsuba volume format (".vol") are
+supported. Dense files are converted using a threshold of zero.)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_SparseVolumeGrid_2 = R"doc(Load a SparseVolumeGrid (sparse format only) from a stream)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_SparseVolumeGrid_3 =
+R"doc(Convert a dense volume grid into sparse storage
+
+Parameter ``grid``:
+    The dense volume grid
+
+Parameter ``threshold``:
+    Bricks whose values all have a magnitude of at most ``threshold``
+    are discarded and will evaluate to zero.
+
+Parameter ``brick_size``:
+    Number of voxels along each side of a brick)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_bbox = R"doc(Return the bounding box stored in the volume file)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_bbox_transform =
+R"doc(Estimates the transformation from a unit axis-aligned bounding box to
+the given one.)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_brick_count =
+R"doc(Return the number of stored bricks (including the reserved empty one))doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_brick_max = R"doc(Return the maximum over all channels of every stored brick)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_brick_size = R"doc(Return the number of voxels along each side of a brick)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_bricks = R"doc(Return a pointer to the brick pool)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_buffer_size =
+R"doc(Return the memory used by the tile index and brick pool in bytes)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_build =
+R"doc(Convert a dense volume grid (see the corresponding constructor))doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_channel_count = R"doc(Return the number of channels)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_class = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_bbox = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_brick_max = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_brick_size = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_bricks = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_channel_count = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_max = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_max_per_channel = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_size = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_tile_count = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_m_tiles = R"doc()doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_max = R"doc(Return the precomputed maximum over the volume grid)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_max_per_channel =
+R"doc(Return the precomputed maximum over the volume grid per channel
+
+Pointer allocation/deallocation must be performed by the caller.)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_read = R"doc(Read a sparse volume file from a stream)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_size = R"doc(Return the resolution of the voxel grid)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_tile_count =
+R"doc(Return the number of tiles (i.e. potential bricks) along each axis)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_tile_max =
+R"doc(Return the maximum over all channels of the brick referenced by each
+tile)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_tiles = R"doc(Return the top-level index mapping every tile to a brick)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_to_dense = R"doc(Expand the sparse grid back into a dense volume grid)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_to_string = R"doc(Return a human-readable summary of this sparse volume grid)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_update_max = R"doc(Compute the per-brick and global maxima)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_write = R"doc(Write the sparse grid to a binary file)doc";
+
+static const char *__doc_mitsuba_SparseVolumeGrid_write_2 = R"doc(Write the sparse grid to a stream)doc";
+
 static const char *__doc_mitsuba_Spectrum =
 R"doc(//! @{ \name Data types for spectral quantities with sampled
 wavelengths)doc";
@@ -8301,11 +8896,16 @@ static const char *__doc_mitsuba_Spiral_max_block_size = R"doc(Return the maximu
 static const char *__doc_mitsuba_Spiral_next_block =
 R"doc(Return the offset, size, and unique identifier of the next block.
 
-A size of zero indicates that the spiral traversal is done.)doc";
+A size of zero indicates that the spiral traversal is done. This
+function is lock-free and may be called concurrently from many
+threads.)doc";
 
 static const char *__doc_mitsuba_Spiral_reset =
 R"doc(Reset the spiral to its initial state. Does not affect the number of
-passes.)doc";
+passes.
+
+This function must not be called while other threads are concurrently
+invoking next_block().)doc";
 
 static const char *__doc_mitsuba_Stream =
 R"doc(Abstract seekable stream class
@@ -9032,6 +9632,13 @@ threads))doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildContext_BuildContext = R"doc()doc";
 
+static const char *__doc_mitsuba_TShapeKDTree_BuildContext_acquire_classification =
+R"doc(Fetch a classification buffer that is not used by any other thread
+
+The thread-local classification storage cannot be used by nodes that
+are processed in parallel: while waiting for the worker threads, the
+calling thread may run unrelated parts of the build.)doc";
+
 static const char *__doc_mitsuba_TShapeKDTree_BuildContext_bad_refines = R"doc()doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildContext_derived = R"doc()doc";
@@ -9058,6 +9665,8 @@ static const char *__doc_mitsuba_TShapeKDTree_BuildContext_prim_buckets = R"doc(
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildContext_pruned = R"doc()doc";
 
+static const char *__doc_mitsuba_TShapeKDTree_BuildContext_release_classification = R"doc(Return a buffer obtained via acquire_classification())doc";
+
 static const char *__doc_mitsuba_TShapeKDTree_BuildContext_retracted_splits = R"doc()doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildContext_temp_storage = R"doc()doc";
@@ -9074,13 +9683,39 @@ parallel construction.
 At the top of the tree, it uses min-max-binning and parallel
 reductions to create sufficient parallelism. When the number of
 elements is sufficiently small, it switches to a more accurate O(N log
-N) builder which uses normal recursion on the stack (i.e. it does not
-spawn further parallel pieces of work).)doc";
+N) builder which uses normal recursion on the stack. Only its largest
+nodes (with at least MI_KD_PARALLEL_EVENTS edge events) are still
+processed using parallel sorting, classification and partitioning
+steps, and build their subtrees concurrently.)doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildTask_BuildTask = R"doc()doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildTask_build_nlogn = R"doc(Recursively run the O(N log N builder))doc";
 
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_build_nlogn_detached =
+R"doc(Run the O(N log N) builder on an event list that was created by
+another thread
+
+The event list is copied into storage provided by the allocator of the
+current thread, which allows the recursion to proceed in the usual
+way.)doc";
+
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_classify =
+R"doc(Determine on which side of a split plane an edge event places its
+primitive
+
+Returns PrimClassification::Both if the event does not decide the
+classification.)doc";
+
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_clip_events =
+R"doc(Append the edge events of a primitive clipped to the given bounding
+box
+
+Returns false (and appends nothing) when the clipped primitive is
+degenerate.)doc";
+
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_copy_events = R"doc(Copy an edge event list (in parallel, if it is sufficiently large))doc";
+
 static const char *__doc_mitsuba_TShapeKDTree_BuildTask_execute = R"doc(Run one iteration of min-max binning and spawn recursive tasks)doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_BuildTask_m_bad_refines = R"doc(Number of "bad refines" so far)doc";
@@ -9107,6 +9742,22 @@ static const char *__doc_mitsuba_TShapeKDTree_BuildTask_make_leaf_2 =
 R"doc(Create a leaf node using the given edge event list (called by the O(N
 log N) builder))doc";
 
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_merge_events =
+R"doc(Merge two sorted edge event lists (in parallel, if they are
+sufficiently large)
+
+Has the same semantics as std::merge: on ties, events from the first
+list are placed first.)doc";
+
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_partition_events =
+R"doc(Stable parallel partition of an edge event list
+
+The function side returns a bit mask specifying whether an event
+should be appended to the left (1) and/or right (2) output list.
+Returns the end of both output lists.)doc";
+
+static const char *__doc_mitsuba_TShapeKDTree_BuildTask_sort_events = R"doc(Sort an edge event list (in parallel, if it is sufficiently large))doc";
+
 static const char *__doc_mitsuba_TShapeKDTree_BuildTask_transition_to_nlogn =
 R"doc(Create an initial sorted edge event list and start the O(N log N)
 builder)doc";
@@ -9121,7 +9772,11 @@ R"doc(Compact storage for primitive classification
 When classifying primitives with respect to a split plane, a data
 structure is needed to hold the tertiary result of this operation.
 This class implements a compact storage (2 bits per entry) in the
-spirit of the std::vector<bool> specialization.)doc";
+spirit of the std::vector<bool> specialization.
+
+Entries sharing a byte can be written by different threads using
+set_concurrent(). The relaxed loads and stores of get() and set()
+compile to plain memory accesses.)doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_ClassificationStorage_get = R"doc()doc";
 
@@ -9133,6 +9788,8 @@ static const char *__doc_mitsuba_TShapeKDTree_ClassificationStorage_resize = R"d
 
 static const char *__doc_mitsuba_TShapeKDTree_ClassificationStorage_set = R"doc()doc";
 
+static const char *__doc_mitsuba_TShapeKDTree_ClassificationStorage_set_concurrent = R"doc(Thread-safe version of set())doc";
+
 static const char *__doc_mitsuba_TShapeKDTree_ClassificationStorage_size = R"doc(Return the size (in bytes))doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_EdgeEvent =
@@ -9351,12 +10008,17 @@ static const char *__doc_mitsuba_TShapeKDTree_ready = R"doc()doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_retract_bad_splits = R"doc(Return whether or not bad splits can be "retracted".)doc";
 
+static const char *__doc_mitsuba_TShapeKDTree_sah_cost =
+R"doc(Return the expected cost of a ray query according to the surface area
+heuristic, or zero if the tree wasn't built (e.g. when it was loaded
+from a cache file))doc";
+
 static const char *__doc_mitsuba_TShapeKDTree_set_clip_primitives = R"doc(Set whether primitive clipping is used during tree construction)doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_set_exact_primitive_threshold =
 R"doc(Specify the number of primitives, at which the builder will switch
 from (approximate) Min-Max binning to the accurate O(n log n)
-optimization method.)doc";
+optimization method. A value of zero disables the latter.)doc";
 
 static const char *__doc_mitsuba_TShapeKDTree_set_log_level = R"doc(Return the log level of kd-tree status messages)doc";
 
@@ -9512,6 +10174,11 @@ default implementation throws an exception.
 Even if the operation is provided, it may only return an
 approximation.)doc";
 
+static const char *__doc_mitsuba_Texture_needs_differentials =
+R"doc(Does this texture require texture-space differentials
+(SurfaceInteraction::duv_dx and SurfaceInteraction::duv_dy), e.g. to
+perform filtered lookups?)doc";
+
 static const char *__doc_mitsuba_Texture_pdf_position = R"doc(Returns the probability per unit area of sample_position())doc";
 
 static const char *__doc_mitsuba_Texture_pdf_spectrum =
@@ -9735,6 +10402,155 @@ static const char *__doc_mitsuba_Thread_wait_for_tasks = R"doc(Wait for previous
 
 static const char *__doc_mitsuba_Thread_yield = R"doc(Yield to another processor)doc";
 
+static const char *__doc_mitsuba_TileCache =
+R"doc(Global least-recently-used cache of the tiles of TiledImage instances
+
+The cache is shared by all tiled images and bounded by a memory budget.
+It is split into independently locked shards so that concurrent lookups
+from many rendering threads rarely contend.)doc";
+
+static const char *__doc_mitsuba_TileCache_Statistics = R"doc(Cache statistics)doc";
+
+static const char *__doc_mitsuba_TileCache_Statistics_evictions = R"doc(Number of tiles evicted to stay within the memory budget)doc";
+
+static const char *__doc_mitsuba_TileCache_Statistics_hits = R"doc(Number of lookups served from memory)doc";
+
+static const char *__doc_mitsuba_TileCache_Statistics_misses = R"doc(Number of lookups that had to load a tile from disk)doc";
+
+static const char *__doc_mitsuba_TileCache_Statistics_resident_bytes = R"doc(Memory currently used by tiles in bytes)doc";
+
+static const char *__doc_mitsuba_TileCache_budget = R"doc(Return the memory budget of the cache in bytes)doc";
+
+static const char *__doc_mitsuba_TileCache_clear = R"doc(Remove all tiles from the cache)doc";
+
+static const char *__doc_mitsuba_TileCache_lookup = R"doc(Look up a tile of an image, loading it on a miss)doc";
+
+static const char *__doc_mitsuba_TileCache_release = R"doc(Remove all tiles of an image from the cache)doc";
+
+static const char *__doc_mitsuba_TileCache_reset_statistics = R"doc(Reset the hit/miss/eviction counters)doc";
+
+static const char *__doc_mitsuba_TileCache_set_budget =
+R"doc(Set the memory budget of the cache in bytes (Default: 2 GiB)
+
+Tiles are evicted immediately if the new budget is smaller than the
+memory currently in use.)doc";
+
+static const char *__doc_mitsuba_TileCache_statistics = R"doc(Return the current cache statistics)doc";
+
+static const char *__doc_mitsuba_TileCache_to_string = R"doc(Return a human-readable summary of the cache statistics)doc";
+
+static const char *__doc_mitsuba_TiledImage =
+R"doc(Image stored on disk as a grid of square tiles, which are loaded on
+demand through the global TileCache
+
+This makes it possible to render scenes referencing far more texture data
+than fits into memory: only the tiles that are actually accessed are
+loaded, and the least recently used ones are evicted once the memory budget
+of the cache is exceeded.
+
+Tiled images use a simple binary file format (extension <tt>.mtc</tt>)
+storing single precision samples, see write() for its specification.
+Any Bitmap can be converted into this format.)doc";
+
+static const char *__doc_mitsuba_TiledImage_TiledImage =
+R"doc(Open a tiled image file. This only reads the header of the file.)doc";
+
+static const char *__doc_mitsuba_TiledImage_channel_count = R"doc(Return the number of channels)doc";
+
+static const char *__doc_mitsuba_TiledImage_class = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_id = R"doc(Return a unique identifier of this image (used by the cache))doc";
+
+static const char *__doc_mitsuba_TiledImage_m_channel_count = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_data_offset = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_id = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_mean = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_mutex = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_path = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_size = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_source_flags = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_source_size = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_source_time = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_stream = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_tile_count = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_m_tile_size = R"doc()doc";
+
+static const char *__doc_mitsuba_TiledImage_mean = R"doc(Return the mean of a channel over the whole image)doc";
+
+static const char *__doc_mitsuba_TiledImage_path = R"doc(Return the path of the underlying file)doc";
+
+static const char *__doc_mitsuba_TiledImage_read_tile = R"doc(Read the samples of a tile from disk, bypassing the cache)doc";
+
+static const char *__doc_mitsuba_TiledImage_size = R"doc(Return the resolution of the image in pixels)doc";
+
+static const char *__doc_mitsuba_TiledImage_source_flags = R"doc(Return the conversion flags recorded when the image was written)doc";
+
+static const char *__doc_mitsuba_TiledImage_source_size =
+R"doc(Return the size of the source file recorded when the image was written)doc";
+
+static const char *__doc_mitsuba_TiledImage_source_time =
+R"doc(Return the modification time of the source file recorded when the
+image was written)doc";
+
+static const char *__doc_mitsuba_TiledImage_tile =
+R"doc(Return the samples of a tile, loading them through the cache
+
+This function can safely be called from multiple threads.)doc";
+
+static const char *__doc_mitsuba_TiledImage_tile_count = R"doc(Return the number of tiles along each axis)doc";
+
+static const char *__doc_mitsuba_TiledImage_tile_size = R"doc(Return the number of pixels along each side of a tile)doc";
+
+static const char *__doc_mitsuba_TiledImage_to_string = R"doc(Return a human-readable summary)doc";
+
+static const char *__doc_mitsuba_TiledImage_write =
+R"doc(Write a bitmap as a tiled image file
+
+The bitmap is converted to single precision samples (its pixel format
+and gamma are left unchanged). The file starts with the following
+header:
+
+- Bytes 1-3: ASCII bytes 'M', 'T', and 'C'
+- Byte 4: File format version number (currently 2)
+- Bytes 5-8: Image width (uint32)
+- Bytes 9-12: Image height (uint32)
+- Bytes 13-16: Number of channels (uint32)
+- Bytes 17-20: Tile size (uint32)
+- Bytes 21-28: Size of the source file, or zero (uint64)
+- Bytes 29-36: Modification time of the source file, or zero (uint64)
+- Bytes 37-40: Flags describing the conversion of the source (uint32)
+- Per channel: mean of all samples (float32)
+
+followed by all tiles in scanline order. Every tile stores <tt>tile_size
+* tile_size * channels</tt> samples in scanline order, including tiles
+that extend beyond the image boundary (their excess samples are zero).
+
+Files of version 1 lack the modification time and flags, which are
+reported as zero when reading them.
+
+Parameter ``source_size``:
+    Size of the file from which the bitmap was loaded, which can be
+    used to detect stale tiled images (see source_size()).
+
+Parameter ``source_time``:
+    Modification time of the source file (see fs::last_write_time())
+
+Parameter ``source_flags``:
+    Application-defined flags describing how the source was converted
+    (e.g. whether gamma correction was undone))doc";
+
 static const char *__doc_mitsuba_Timer = R"doc()doc";
 
 static const char *__doc_mitsuba_Timer_Timer = R"doc()doc";
@@ -9978,6 +10794,8 @@ Parameter ``stream``:
 
 static const char *__doc_mitsuba_VolumeGrid_VolumeGrid_3 = R"doc()doc";
 
+static const char *__doc_mitsuba_VolumeGrid_bbox = R"doc(Return the bounding box stored in the volume file)doc";
+
 static const char *__doc_mitsuba_VolumeGrid_bbox_transform =
 R"doc(Estimates the transformation from a unit axis-aligned bounding box to
 the given one.)doc";
@@ -9994,6 +10812,8 @@ static const char *__doc_mitsuba_VolumeGrid_data = R"doc(Return a pointer to the
 
 static const char *__doc_mitsuba_VolumeGrid_data_2 = R"doc(Return a pointer to the underlying volume storage)doc";
 
+static const char *__doc_mitsuba_VolumeGrid_finish_read = R"doc(Update the maximum and log statistics after loading the voxel data)doc";
+
 static const char *__doc_mitsuba_VolumeGrid_m_bbox = R"doc()doc";
 
 static const char *__doc_mitsuba_VolumeGrid_m_channel_count = R"doc()doc";
@@ -10013,7 +10833,11 @@ R"doc(Return the precomputed maximum over the volume grid per channel
 
 Pointer allocation/deallocation must be performed by the caller.)doc";
 
-static const char *__doc_mitsuba_VolumeGrid_read = R"doc()doc";
+static const char *__doc_mitsuba_VolumeGrid_read = R"doc(Read a volume file (header and payload) from a stream)doc";
+
+static const char *__doc_mitsuba_VolumeGrid_read_header = R"doc(Read the header of a volume file, leaving the stream at the payload)doc";
+
+static const char *__doc_mitsuba_VolumeGrid_set_bbox = R"doc(Set the bounding box that will be stored in the volume file)doc";
 
 static const char *__doc_mitsuba_VolumeGrid_set_max = R"doc(Set the precomputed maximum over the volume grid)doc";
 
@@ -10084,6 +10908,20 @@ static const char *__doc_mitsuba_Volume_m_to_local = R"doc(Used to bring points
 
 static const char *__doc_mitsuba_Volume_max = R"doc(Returns the maximum value of the volume over all dimensions.)doc";
 
+static const char *__doc_mitsuba_Volume_max_per_cell =
+R"doc(Compute conservative upper bounds of the volume over the cells of a
+regular grid
+
+The grid subdivides the bounding box bbox() of the volume into
+``resolution.x() * resolution.y() * resolution.z()`` cells. For each
+cell, the function returns a value that bounds the volume (over all
+channels) at any position within that cell. The output is stored in
+row-major order, i.e. ``out[(z * res.y() + y) * res.x() + x]``.
+
+The default implementation assigns max() to every cell.
+
+Pointer allocation/deallocation must be performed by the caller.)doc";
+
 static const char *__doc_mitsuba_Volume_max_per_channel =
 R"doc(In the case of a multi-channel volume, this function returns the
 maximum value for each channel.
@@ -10515,6 +11353,11 @@ static const char *__doc_mitsuba_filesystem_is_regular_file =
 R"doc(Checks if ``p`` points to a regular file, as opposed to a directory or
 symlink.)doc";
 
+static const char *__doc_mitsuba_filesystem_last_write_time =
+R"doc(Returns the time of the last modification of the file at ``p`` in
+nanoseconds since the epoch. The resolution depends on the underlying
+file system.)doc";
+
 static const char *__doc_mitsuba_filesystem_path =
 R"doc(Represents a path to a filesystem resource. On construction, the path
 is parsed and stored in a system-agnostic representation. The path can
@@ -11313,6 +12156,10 @@ static const char *__doc_mitsuba_orthographic_projection =
 R"doc(Helper function to create a orthographic projection transformation
 matrix)doc";
 
+static const char *__doc_mitsuba_parse_accel_quality =
+R"doc(Parse an acceleration data structure quality profile ("low",
+"medium" or "high"))doc";
+
 static const char *__doc_mitsuba_parse_fov = R"doc(Helper function to parse the field of view field of a camera)doc";
 
 static const char *__doc_mitsuba_pdf_rgb_spectrum =
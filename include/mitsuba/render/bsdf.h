@@ -561,6 +561,15 @@ public:
         return has_flag(m_flags, BSDFFlags::NeedsDifferentials);
     }
 
+    /**
+     * \brief Set the \ref BSDFFlags::NeedsDifferentials flag if one of the
+     * textures referenced by this BSDF (including those of nested BSDFs)
+     * requires texture-space differentials.
+     *
+     * This is invoked by shapes when the BSDF is attached to them.
+     */
+    void update_differentials_flag();
+
     /// Number of components this BSDF is comprised of.
     size_t component_count(Mask /*active*/ = true) const {
         return m_components.size();
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include <nanothread/nanothread.h>
+#include <mitsuba/core/bbox.h>
+#include <mitsuba/core/fwd.h>
+#include <mitsuba/core/logger.h>
+#include <mitsuba/core/math.h>
+#include <mitsuba/core/object.h>
+#include <mitsuba/core/ray.h>
+#include <mitsuba/core/thread.h>
+#include <mitsuba/core/vector.h>
+#include <mitsuba/render/interaction.h>
+#include <mitsuba/render/mesh.h>
+
+/// Branching factor of the BVH (the bounds of all children are tested at once)
+#define MI_BVH_WIDTH 8u
+
+/// Depth limit of the intermediate binary BVH (also bounds the traversal stack)
+#define MI_BVH_MAXDEPTH 64u
+
+/// Subtrees with at least this many primitives are built in parallel
+#define MI_BVH_PARALLEL_PRIMS 4096u
+
+/// Grain size for parallelization
+#define MI_BVH_GRAIN_SIZE 10240u
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**
+ * \brief Wide bounding volume hierarchy for the native CPU ray tracing
+ * backend
+ *
+ * This class is an alternative to \ref ShapeKDTree that can be selected via
+ * the scene parameter <tt>accel_type="bvh"</tt>. It is substantially faster
+ * and more memory-efficient to build, which makes it preferable for scenes
+ * that are frequently rebuilt.
+ *
+ * Construction first creates a binary BVH using the surface area heuristic
+ * (SAH) evaluated over a fixed number of centroid bins. Large subtrees are
+ * binned, partitioned and built in parallel. The binary hierarchy is then
+ * collapsed into nodes with \ref MI_BVH_WIDTH children by repeatedly opening
+ * the child with the largest surface area.
+ *
+ * Each node stores the bounding boxes of its children in a
+ * structure-of-arrays layout, so that a ray is tested against all of them
+ * using a single SIMD slab test (AVX/AVX-512 on hosts supporting them).
+ *
+ * The following parameters of the enclosing scene control the build:
+ *
+ * - \c bvh_max_prims: maximum number of primitives per leaf (default: 8)
+ * - \c bvh_bins: number of SAH bins per axis (default: 16)
+ * - \c bvh_traversal_cost: SAH cost of a node traversal, relative to a
+ *   primitive intersection (default: 1)
+ */
+template <typename Float, typename Spectrum>
+class MI_EXPORT_LIB ShapeBVH : public Object {
+public:
+    MI_IMPORT_TYPES(Shape, Mesh)
+
+    using ScalarRay3f = Ray<ScalarPoint3f, Spectrum>;
+    using Size        = uint32_t;
+    using Index       = uint32_t;
+    using FloatP      = dr::Packet<ScalarFloat, MI_BVH_WIDTH>;
+    using MaskP       = dr::mask_t<FloatP>;
+
+    /**
+     * \brief Node of the wide BVH
+     *
+     * Stores the bounds of its children in a structure-of-arrays layout.
+     * Unused slots have an empty (inverted) bounding box that never
+     * intersects a ray.
+     */
+    struct alignas(64) BVHNode {
+        /// Lower and upper bounds of the children, per axis
+        ScalarFloat bbox_min[3][MI_BVH_WIDTH];
+        ScalarFloat bbox_max[3][MI_BVH_WIDTH];
+
+        /// Index of the child node (inner nodes) or offset into the index list (leaves)
+        Index child[MI_BVH_WIDTH];
+
+        /// Number of primitives of a leaf child (zero for inner nodes and unused slots)
+        Size prim_count[MI_BVH_WIDTH];
+    };
+
+    /// Create an empty BVH and take build-related parameters from \c props.
+    ShapeBVH(const Properties &props);
+
+    /// Clear the BVH (build-related parameters remain)
+    void clear();
+
+    /// Register a new shape with the BVH (to be called before \ref build())
+    void add_shape(Shape *shape);
+
+    /// Build the BVH
+    void build();
+
+    /**
+     * \brief Update the bounds of all nodes after the primitives have moved
+     *
+     * The topology of the BVH is kept as is, hence this is much cheaper than
+     * a rebuild. Traversal performance degrades when the primitives move far
+     * from where they were at build time, and the shapes must not change
+     * their number of primitives.
+     */
+    void refit();
+
+    /// Return whether or not the BVH has been built
+    bool ready() const { return (bool) m_nodes; }
+
+    /// Return the bounding box of the entire BVH
+    const ScalarBoundingBox3f &bbox() const { return m_bbox; }
+
+    /// Return the number of registered shapes
+    Size shape_count() const { return Size(m_shapes.size()); }
+
+    /// Return the number of registered primitives
+    Size primitive_count() const { return m_primitive_map.back(); }
+
+    /// Return the number of nodes of the wide BVH
+    Size node_count() const { return m_node_count; }
+
+    /// Return the i-th shape (const version)
+    const Shape *shape(size_t i) const { Assert(i < m_shapes.size()); return m_shapes[i]; }
+
+    /// Return the i-th shape
+    Shape *shape(size_t i) { Assert(i < m_shapes.size()); return m_shapes[i]; }
+
+    /// Return the bounding box of the i-th primitive
+    MI_INLINE ScalarBoundingBox3f bbox(Index i) const {
+        Index shape_index = find_shape(i);
+        return m_shapes[shape_index]->bbox(i);
+    }
+
+    /// Return the (clipped) bounding box of the i-th primitive
+    MI_INLINE ScalarBoundingBox3f bbox(Index i, const ScalarBoundingBox3f &clip) const {
+        Index shape_index = find_shape(i);
+        return m_shapes[shape_index]->bbox(i, clip);
+    }
+
+    template <bool ShadowRay>
+    MI_INLINE PreliminaryIntersection3f ray_intersect_preliminary(const Ray3f &ray,
+                                                                   Mask active) const {
+        DRJIT_MARK_USED(active);
+        if constexpr (!dr::is_array_v<Float>)
+            return ray_intersect_scalar<ShadowRay>(ray);
+        else
+            Throw("BVH should only be used in scalar mode");
+    }
+
+    template <bool ShadowRay>
+    MI_INLINE PreliminaryIntersection<ScalarFloat, Shape>
+    ray_intersect_scalar(ScalarRay3f ray) const {
+        /// Ray traversal stack entry
+        struct BVHStackEntry {
+            // Ray distance to the entry point of the node
+            ScalarFloat tnear;
+            // Index of the node
+            Index node;
+        };
+
+        // Resulting intersection struct
+        PreliminaryIntersection<ScalarFloat, Shape> pi;
+
+        if (unlikely(m_node_count == 0))
+            return pi;
+
+        // Allocate the node stack
+        BVHStackEntry stack[MI_BVH_MAXDEPTH * (MI_BVH_WIDTH - 1) + 1];
+        int32_t stack_index = 0;
+
+        /* Replace zero direction components to keep the slab test free of
+           NaNs (the resulting bounds are still conservative) */
+        ScalarVector3f d = ray.d;
+        for (size_t i = 0; i < 3; ++i) {
+            if (d[i] == 0.f)
+                d[i] = ScalarFloat(1e-20f);
+        }
+        ScalarVector3f d_rcp = dr::rcp(d);
+
+        /* Select the near/far bounds based on the direction sign, and
+           enlarge the far distance slightly for watertight traversal (see
+           "Robust BVH Ray Traversal" by T. Ize) */
+        bool neg[3] = { d_rcp.x() < 0.f, d_rcp.y() < 0.f, d_rcp.z() < 0.f };
+        const ScalarFloat eps = dr::Epsilon<ScalarFloat>,
+                          far_scale = 1.f + 2.f * (3.f * eps) / (1.f - 3.f * eps);
+
+        FloatP o_x(ray.o.x()), o_y(ray.o.y()), o_z(ray.o.z()),
+               r_x(d_rcp.x()), r_y(d_rcp.y()), r_z(d_rcp.z());
+
+        stack[stack_index++] = { ScalarFloat(0), 0 };
+
+        while (stack_index > 0) {
+            BVHStackEntry entry = stack[--stack_index];
+            if (entry.tnear > ray.maxt)
+                continue;
+
+            const BVHNode &node = m_nodes[entry.node];
+
+            /* Test the ray against the bounds of all children at once */
+            const ScalarFloat
+                *near_x = neg[0] ? node.bbox_max[0] : node.bbox_min[0],
+                *near_y = neg[1] ? node.bbox_max[1] : node.bbox_min[1],
+                *near_z = neg[2] ? node.bbox_max[2] : node.bbox_min[2],
+                *far_x  = neg[0] ? node.bbox_min[0] : node.bbox_max[0],
+                *far_y  = neg[1] ? node.bbox_min[1] : node.bbox_max[1],
+                *far_z  = neg[2] ? node.bbox_min[2] : node.bbox_max[2];
+
+            FloatP t_near = dr::maximum(
+                dr::maximum((dr::load<FloatP>(near_x) - o_x) * r_x,
+                            (dr::load<FloatP>(near_y) - o_y) * r_y),
+                dr::maximum((dr::load<FloatP>(near_z) - o_z) * r_z,
+                            FloatP(0.f)));
+
+            FloatP t_far = dr::minimum(
+                dr::minimum((dr::load<FloatP>(far_x) - o_x) * r_x,
+                            (dr::load<FloatP>(far_y) - o_y) * r_y),
+                dr::minimum((dr::load<FloatP>(far_z) - o_z) * r_z,
+                            FloatP(ray.maxt / far_scale))) * far_scale;
+
+            MaskP hit = t_near <= t_far;
+            if (dr::none(hit))
+                continue;
+
+            /* Intersect leaves right away and collect inner nodes */
+            BVHStackEntry inner[MI_BVH_WIDTH];
+            uint32_t inner_count = 0;
+
+            for (uint32_t i = 0; i < MI_BVH_WIDTH; ++i) {
+                if (!hit.entry(i))
+                    continue;
+
+                ScalarFloat t_child = t_near.entry(i);
+                Size prim_count = node.prim_count[i];
+
+                if (prim_count == 0) {
+                    inner[inner_count++] = { t_child, node.child[i] };
+                    continue;
+                } else if (t_child > ray.maxt) {
+                    continue;
+                }
+
+                Index prim_start = node.child[i],
+                      prim_end   = prim_start + prim_count;
+
+                for (Index j = prim_start; j < prim_end; j++) {
+                    PreliminaryIntersection<ScalarFloat, Shape> prim_pi =
+                        intersect_prim<ShadowRay>(m_indices[j], ray);
+
+                    if (unlikely(prim_pi.is_valid())) {
+                        if constexpr (ShadowRay)
+                            return prim_pi;
+
+                        Assert(prim_pi.t >= 0.f && prim_pi.t <= ray.maxt);
+                        pi = prim_pi;
+                        ray.maxt = pi.t;
+                    }
+                }
+            }
+
+            /* Push inner nodes so that the closest one is visited first */
+            for (uint32_t i = 1; i < inner_count; ++i) {
+                BVHStackEntry value = inner[i];
+                uint32_t j = i;
+                for (; j > 0 && inner[j - 1].tnear < value.tnear; --j)
+                    inner[j] = inner[j - 1];
+                inner[j] = value;
+            }
+
+            for (uint32_t i = 0; i < inner_count; ++i)
+                stack[stack_index++] = inner[i];
+        }
+
+        return pi;
+    }
+
+    /// Brute force intersection routine for debugging purposes
+    template <bool ShadowRay>
+    MI_INLINE PreliminaryIntersection3f
+    ray_intersect_naive(Ray3f ray, Mask active) const {
+        if constexpr (!dr::is_array_v<Float>) {
+            PreliminaryIntersection3f pi = dr::zeros<PreliminaryIntersection3f>();
+
+            for (Size i = 0; i < primitive_count(); ++i) {
+                PreliminaryIntersection3f prim_pi = intersect_prim<ShadowRay>(i, ray);
+
+                if (prim_pi.is_valid()) {
+                    pi = prim_pi;
+                    ray.maxt = prim_pi.t;
+                }
+
+                if (ShadowRay && dr::all(pi.is_valid() || !active))
+                    break;
+            }
+
+            return pi;
+        } else {
+            Throw("BVH should only be used in scalar mode");
+        }
+    }
+
+    /// Return a human-readable string representation of the scene contents.
+    virtual std::string to_string() const override;
+
+    MI_DECLARE_CLASS()
+protected:
+    /// Node of the intermediate binary BVH
+    struct BuildNode {
+        ScalarBoundingBox3f bbox;
+        /// Index of the left child (the right child directly follows it)
+        Index left = 0;
+        /// Offset into the index list (leaves only)
+        Index prim_offset = 0;
+        /// Number of primitives (zero for inner nodes)
+        Size prim_count = 0;
+    };
+
+    /// Helper data structure used during BVH construction
+    struct BuildContext {
+        std::unique_ptr<BuildNode[]> nodes;
+        std::atomic<Index> node_count { 0 };
+        std::unique_ptr<ScalarBoundingBox3f[]> prim_bbox;
+        std::unique_ptr<Index[]> temp_indices;
+        std::atomic<size_t> leaf_count { 0 };
+        ThreadEnvironment env;
+    };
+
+    /// Recursively build the subtree of the binary BVH for the primitives [start, end)
+    void build_recursive(BuildContext &ctx, Index node, Index start, Index end,
+                         Size depth);
+
+    /// Split the primitives [start, end) at the given bin (returns the split position)
+    Index partition(BuildContext &ctx, Index start, Index end, int axis,
+                    Size split_bin, const ScalarBoundingBox3f &centroid_bbox);
+
+    /// Convert the subtree of the binary BVH below \c node into wide nodes
+    Index collapse(const BuildContext &ctx, Index node,
+                   std::vector<BVHNode> &nodes) const;
+
+    /**
+     * \brief Map an abstract primitive index to a specific shape managed by
+     * the \ref ShapeBVH.
+     *
+     * The function returns the shape index and updates the \a idx parameter to
+     * point to the primitive index (e.g. triangle ID) within the shape.
+     */
+    MI_INLINE Index find_shape(Index &i) const {
+        Assert(i < primitive_count());
+
+        Index shape_index = math::find_interval<Index>(
+            Size(m_primitive_map.size()),
+            [&](Index k) DRJIT_INLINE_LAMBDA {
+                return m_primitive_map[k] <= i;
+            }
+        );
+
+        Assert(shape_index < shape_count() &&
+               m_primitive_map.size() == shape_count() + 1);
+
+        Assert(i >= m_primitive_map[shape_index]);
+        Assert(i <  m_primitive_map[shape_index + 1]);
+        i -= m_primitive_map[shape_index];
+
+        return shape_index;
+    }
+
+    /// Check whether a primitive is intersected by the given ray.
+    template <bool ShadowRay = false>
+    MI_INLINE PreliminaryIntersection<ScalarFloat, Shape>
+    intersect_prim(Index prim_index, const ScalarRay3f &ray) const {
+        Index shape_index  = find_shape(prim_index);
+        const Shape *shape = this->shape(shape_index);
+        const Mesh *mesh = (const Mesh *) shape;
+
+        PreliminaryIntersection<ScalarFloat, Shape> pi;
+
+        if constexpr (ShadowRay) {
+            bool hit;
+            if (shape->is_mesh())
+                hit = mesh->ray_intersect_triangle_scalar(prim_index, ray).first != dr::Infinity<ScalarFloat>;
+            else
+                hit = shape->ray_test_scalar(ray);
+            pi.t = dr::select(hit, 0.f , pi.t);
+        } else {
+            uint32_t inst_index = (uint32_t) -1;
+            if (shape->is_mesh())
+                std::tie(pi.t, pi.prim_uv) = mesh->ray_intersect_triangle_scalar(prim_index, ray);
+            else
+                std::tie(pi.t, pi.prim_uv, inst_index, prim_index) =
+                    shape->ray_intersect_preliminary_scalar(ray);
+            pi.prim_index = prim_index;
+
+            bool hit_inst  = (inst_index != (uint32_t) -1);
+            pi.shape       = hit_inst ? (const Shape *) (size_t) shape_index : shape; // shape_index for LLVM + BVH
+            pi.instance    = hit_inst ? shape : nullptr;
+            pi.shape_index = hit_inst ? inst_index : shape_index;
+        }
+
+        return pi;
+    }
+
+protected:
+    std::vector<ref<Shape>> m_shapes;
+    std::vector<Size> m_primitive_map;
+
+    std::unique_ptr<BVHNode[]> m_nodes;
+    std::unique_ptr<Index[]> m_indices;
+    Size m_node_count = 0;
+    Size m_index_count = 0;
+    ScalarBoundingBox3f m_bbox;
+
+    Size m_max_prims = 8;
+    Size m_bin_count = 16;
+    ScalarFloat m_traversal_cost = 1.f;
+};
+
+MI_EXTERN_CLASS(ShapeBVH)
+NAMESPACE_END(mitsuba)
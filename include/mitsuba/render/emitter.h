@@ -67,6 +67,12 @@ public:
     /// The emitter's sampling weight.
     ScalarFloat sampling_weight() const { return m_sampling_weight; }
 
+    /// Index of the emitter in the list of emitters of its scene
+    uint32_t scene_index() const { return m_scene_index; }
+
+    /// Set the index of the emitter in the list of emitters of its scene
+    void set_scene_index(uint32_t index) { m_scene_index = index; }
+
     /// Flags for all components combined.
     uint32_t flags(dr::mask_t<Float> /*active*/ = true) const { return m_flags; }
 
@@ -92,6 +98,9 @@ protected:
     /// Sampling weight
     ScalarFloat m_sampling_weight;
 
+    /// Index in the list of emitters of the scene
+    uint32_t m_scene_index = 0;
+
     /// True if the emitters's parameters have changed
     bool m_dirty = false;
 };
@@ -117,6 +126,7 @@ DRJIT_CALL_TEMPLATE_BEGIN(mitsuba::Emitter)
     DRJIT_CALL_GETTER(shape)
     DRJIT_CALL_GETTER(medium)
     DRJIT_CALL_GETTER(sampling_weight)
+    DRJIT_CALL_GETTER(scene_index)
 DRJIT_CALL_END(mitsuba::Emitter)
 
 //! @}
@@ -78,6 +78,14 @@ public:
     /// Write the developed contents of the film to a file on disk
     virtual void write(const fs::path &path) const = 0;
 
+    /**
+     * \brief Return the path of the file written by \ref write() when
+     * it is given \c path
+     *
+     * Films may e.g. replace the extension by the one of their file format.
+     */
+    virtual fs::path output_path(const fs::path &path) const { return path; }
+
     /// dr::schedule() variables that represent the internal film storage
     virtual void schedule_storage() = 0;
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <mitsuba/core/fwd.h>
 #include <mitsuba/core/object.h>
 #include <mitsuba/core/properties.h>
@@ -354,6 +356,32 @@ protected:
  *
  * The \ref render() method then repeatedly invokes this estimator to compute
  * all pixels of the image.
+ *
+ * In scalar variants, the following parameters enable adaptive sampling.
+ * Each pixel then first receives \c adaptive_min_spp samples, followed by
+ * rounds of \c adaptive_step samples until the relative standard error of
+ * the pixel's luminance estimate drops below \c adaptive_threshold or the
+ * sample budget (the sampler's sample count) is exhausted. The integrator's
+ * \c timeout parameter bounds the overall render time.
+ *
+ * - adaptive_threshold: target relative error (default: 0, i.e. disabled)
+ * - adaptive_min_spp: number of initial samples per pixel (default: 16)
+ * - adaptive_step: number of samples per subsequent round (default: 8)
+ * - adaptive_aov: add an \c spp channel to the film that records the
+ *   number of samples taken in each pixel (default: false)
+ *
+ * Scalar variants furthermore support progressive rendering, where the image
+ * is rendered in passes over the entire frame with a doubling number of
+ * samples per pixel (1, 1, 2, 4, ...). When the render is stopped early
+ * (e.g. due to a \c timeout), the result is then a uniformly converged image
+ * instead of an image with missing blocks.
+ *
+ * - progressive: enable progressive rendering (default: false)
+ * - progressive_snapshot: filename of an OpenEXR snapshot of the developed
+ *   film that is written in the background whenever a pass finishes
+ *   (default: none)
+ * - progressive_interval: minimum time between two snapshots in seconds
+ *   (default: 0)
  */
 template <typename Float, typename Spectrum>
 class MI_EXPORT_LIB SamplingIntegrator : public Integrator<Float, Spectrum> {
@@ -439,14 +467,35 @@ protected:
                               uint32_t block_id,
                               uint32_t block_size) const;
 
-    void render_sample(const Scene *scene,
-                       const Sensor *sensor,
-                       Sampler *sampler,
-                       ImageBlock *block,
-                       Float *aovs,
-                       const Vector2f &pos,
-                       ScalarFloat diff_scale_factor,
-                       Mask active = true) const;
+    /// Variant of \ref render_block() that implements adaptive sampling
+    void render_block_adaptive(const Scene *scene,
+                               const Sensor *sensor,
+                               Sampler *sampler,
+                               ImageBlock *block,
+                               Float *aovs,
+                               uint32_t sample_count,
+                               uint32_t seed,
+                               uint32_t block_size) const;
+
+    /**
+     * \brief Render a single sample (or a wavefront of samples)
+     *
+     * Returns the image-plane position of the sample. When \c splat is
+     * \c false, the sample is only written to \c aovs, and the caller is
+     * responsible for adding it to the image block at that position.
+     */
+    Vector2f render_sample(const Scene *scene,
+                           const Sensor *sensor,
+                           Sampler *sampler,
+                           ImageBlock *block,
+                           Float *aovs,
+                           const Vector2f &pos,
+                           ScalarFloat diff_scale_factor,
+                           Mask active = true,
+                           bool splat = true) const;
+
+    /// Is adaptive sampling enabled for the current render job?
+    bool adaptive() const { return m_adaptive_threshold > 0.f; }
 
 protected:
 
@@ -460,6 +509,30 @@ protected:
      * If set to (uint32_t) -1, all the work is done in a single pass (default).
      */
     uint32_t m_samples_per_pass;
+
+    /// Relative error threshold of adaptive sampling (disabled when zero)
+    float m_adaptive_threshold;
+
+    /// Number of samples per pixel before the error is estimated the first time
+    uint32_t m_adaptive_min_spp;
+
+    /// Number of samples per adaptive sampling round
+    uint32_t m_adaptive_step;
+
+    /// Write the per-pixel sample count to an additional film channel?
+    bool m_adaptive_aov;
+
+    /// Total number of samples taken during the current render job
+    mutable std::atomic<uint64_t> m_sample_counter { 0 };
+
+    /// Render in full-frame passes with an increasing number of samples?
+    bool m_progressive;
+
+    /// Filename of progressive rendering snapshots (disabled when empty)
+    fs::path m_progressive_snapshot;
+
+    /// Minimum time between two progressive rendering snapshots (in seconds)
+    float m_progressive_interval;
 };
 
 /** \brief Abstract integrator that performs *recursive* Monte Carlo sampling
@@ -2,12 +2,14 @@
 
 #include <unordered_set>
 #include <atomic>
+#include <ctime>
 
 #include <nanothread/nanothread.h>
 #include <mitsuba/core/bbox.h>
 #include <mitsuba/core/fwd.h>
 #include <mitsuba/core/logger.h>
 #include <mitsuba/core/math.h>
+#include <mitsuba/core/mmap.h>
 #include <mitsuba/core/object.h>
 #include <mitsuba/core/ray.h>
 #include <mitsuba/core/timer.h>
@@ -25,6 +27,12 @@
 /// Grain size for parallelization
 #define MI_KD_GRAIN_SIZE 10240u
 
+/**
+ * Nodes of the O(N log N) builder with at least this many edge events are
+ * classified, partitioned, and recursed into in parallel
+ */
+#define MI_KD_PARALLEL_EVENTS 131072u
+
 /**
  * Temporary scratch space that is used to cache intersection information
  * (# of floats)
@@ -452,12 +460,19 @@ public:
     /**
      * \brief Specify the number of primitives, at which the builder will
      * switch from (approximate) Min-Max binning to the accurate O(n log n)
-     * optimization method.
+     * optimization method. A value of zero disables the latter.
      */
     void set_exact_primitive_threshold(Size value) {
         m_exact_prim_threshold = value;
     }
 
+    /**
+     * \brief Return the expected cost of a ray query according to the
+     * surface area heuristic, or zero if the tree wasn't built (e.g. when it
+     * was loaded from a cache file)
+     */
+    Scalar sah_cost() const { return m_sah_cost; }
+
     /// Return the log level of kd-tree status messages
     LogLevel log_level() const { return m_log_level; }
 
@@ -625,35 +640,54 @@ protected:
      * is needed to hold the tertiary result of this operation. This class
      * implements a compact storage (2 bits per entry) in the spirit of the
      * std::vector<bool> specialization.
+     *
+     * Entries sharing a byte can be written by different threads using \ref
+     * set_concurrent(). The relaxed loads and stores of \ref get() and \ref
+     * set() compile to plain memory accesses.
      */
     class ClassificationStorage {
     public:
         void resize(Size count) {
             if (count != m_count) {
-                m_buffer.reset(new uint8_t[(count + 3) / 4]);
+                m_buffer.reset(new std::atomic<uint8_t>[(count + 3) / 4]);
                 m_count = count;
             }
         }
 
         void set(Index index, PrimClassification value) {
             Assert(index < m_count);
-            uint8_t *ptr = m_buffer.get() + (index >> 2);
+            std::atomic<uint8_t> *ptr = m_buffer.get() + (index >> 2);
             uint8_t shift = (index & 3) << 1;
-            *ptr = (*ptr & ~(3 << shift)) | ((uint8_t) value << shift);
+            uint8_t old_value = ptr->load(std::memory_order_relaxed);
+            ptr->store((uint8_t) ((old_value & ~(3 << shift)) | ((uint8_t) value << shift)),
+                       std::memory_order_relaxed);
+        }
+
+        /// Thread-safe version of \ref set()
+        void set_concurrent(Index index, PrimClassification value) {
+            Assert(index < m_count);
+            std::atomic<uint8_t> *ptr = m_buffer.get() + (index >> 2);
+            uint8_t shift = (index & 3) << 1;
+            uint8_t old_value = ptr->load(std::memory_order_relaxed), new_value;
+            do {
+                new_value = (uint8_t) ((old_value & ~(3 << shift)) |
+                                       ((uint8_t) value << shift));
+            } while (!ptr->compare_exchange_weak(old_value, new_value,
+                                                 std::memory_order_relaxed));
         }
 
         PrimClassification get(Index index) const {
             Assert(index < m_count);
-            uint8_t *ptr = m_buffer.get() + (index >> 2);
+            const std::atomic<uint8_t> *ptr = m_buffer.get() + (index >> 2);
             uint8_t shift = (index & 3) << 1;
-            return PrimClassification((*ptr >> shift) & 3);
+            return PrimClassification((ptr->load(std::memory_order_relaxed) >> shift) & 3);
         }
 
         /// Return the size (in bytes)
         size_t size() const { return (m_count + 3) / 4; }
 
     private:
-        std::unique_ptr<uint8_t[]> m_buffer;
+        std::unique_ptr<std::atomic<uint8_t>[]> m_buffer;
         Size m_count = 0;
     };
 
@@ -679,6 +713,16 @@ protected:
         }
     };
 
+    /// Build phases whose duration is recorded when statistics are requested
+    enum BuildPhase {
+        PhaseBinning = 0,   /// Min-max binning and partitioning
+        PhaseEvents,        /// Creation and sorting of the initial edge event lists
+        PhaseSweep,         /// Split plane search of the O(N log N) builder
+        PhaseClassify,      /// Primitive classification of the O(N log N) builder
+        PhasePartition,     /// Edge event partitioning of the O(N log N) builder
+        PhaseCount
+    };
+
     /// Helper data structure used during tree construction (shared by all threads)
     struct BuildContext {
         const Derived &derived;
@@ -691,6 +735,13 @@ protected:
         std::atomic<size_t> pruned {0};
         std::atomic<size_t> temp_storage {0};
         std::atomic<size_t> work_units {0};
+        std::atomic<size_t> parallel_nodes {0};
+        /* Accumulated time per build phase (in nanoseconds) */
+        bool timing = false;
+        std::atomic<uint64_t> phase_time[PhaseCount] { };
+        /* Classification buffers of nodes that are classified in parallel */
+        std::mutex classification_mutex;
+        std::vector<std::unique_ptr<ClassificationStorage>> classification_pool;
         double exp_traversal_steps = 0;
         double exp_leaves_visited = 0;
         double exp_primitives_queried = 0;
@@ -700,6 +751,60 @@ protected:
         Size prim_buckets[16] { };
 
         BuildContext(const Derived &derived) : derived(derived) { }
+
+        /**
+         * \brief Fetch a classification buffer that is not used by any other
+         * thread
+         *
+         * The thread-local classification storage cannot be used by nodes
+         * that are processed in parallel: while waiting for the worker
+         * threads, the calling thread may run unrelated parts of the build.
+         */
+        std::unique_ptr<ClassificationStorage> acquire_classification() {
+            std::lock_guard<std::mutex> lock(classification_mutex);
+            if (!classification_pool.empty()) {
+                std::unique_ptr<ClassificationStorage> result =
+                    std::move(classification_pool.back());
+                classification_pool.pop_back();
+                return result;
+            }
+            std::unique_ptr<ClassificationStorage> result(new ClassificationStorage());
+            result->resize(derived.primitive_count());
+            temp_storage += result->size();
+            return result;
+        }
+
+        /// Return a buffer obtained via \ref acquire_classification()
+        void release_classification(std::unique_ptr<ClassificationStorage> &&storage) {
+            std::lock_guard<std::mutex> lock(classification_mutex);
+            classification_pool.push_back(std::move(storage));
+        }
+    };
+
+    /// Adds the lifetime of this object to a build phase (if timing is enabled)
+    struct ScopedBuildPhase {
+        ScopedBuildPhase(BuildContext &ctx, BuildPhase phase)
+            : ctx(ctx), phase(phase) {
+            if (ctx.timing)
+                start = std::chrono::steady_clock::now();
+        }
+
+        ~ScopedBuildPhase() { finish(); }
+
+        /// Stop timing before the end of the scope
+        void finish() {
+            if (ctx.timing && !finished) {
+                auto duration = std::chrono::steady_clock::now() - start;
+                ctx.phase_time[phase] += (uint64_t)
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+            }
+            finished = true;
+        }
+
+        BuildContext &ctx;
+        BuildPhase phase;
+        bool finished = false;
+        std::chrono::steady_clock::time_point start;
     };
 
     /// Data type for split candidates suggested by the tree cost model
@@ -1076,8 +1181,10 @@ protected:
      * At the top of the tree, it uses min-max-binning and parallel reductions
      * to create sufficient parallelism. When the number of elements is
      * sufficiently small, it switches to a more accurate O(N log N) builder
-     * which uses normal recursion on the stack (i.e. it does not spawn further
-     * parallel pieces of work).
+     * which uses normal recursion on the stack. Only its largest nodes (with
+     * at least \ref MI_KD_PARALLEL_EVENTS edge events) are still processed
+     * using parallel sorting, classification and partitioning steps, and
+     * build their subtrees concurrently.
      */
     class BuildTask {
     public:
@@ -1144,6 +1251,8 @@ protected:
             /*                              Binning                                 */
             /* ==================================================================== */
 
+            ScopedBuildPhase binning_phase(m_ctx, PhaseBinning);
+
             /* Accumulate all shapes into bins */
             MinMaxBins bins(derived.min_max_bins(), m_tight_bbox);
             std::mutex bins_mutex;
@@ -1191,6 +1300,8 @@ protected:
             /* Release index list */
             IndexVector().swap(m_indices);
 
+            binning_phase.finish();
+
             /* ==================================================================== */
             /*                              Recursion                               */
             /* ==================================================================== */
@@ -1246,6 +1357,238 @@ protected:
             }
         }
 
+        /// Sort an edge event list (in parallel, if it is sufficiently large)
+        static void sort_events(EdgeEvent *start, EdgeEvent *end) {
+            size_t size = (size_t) (end - start);
+            if (size < MI_KD_PARALLEL_EVENTS) {
+                std::sort(start, end);
+                return;
+            }
+
+            /* Sort blocks independently, then merge pairs of adjacent
+               blocks using a scratch buffer */
+            size_t block_count = 1;
+            while (block_count < Thread::thread_count() &&
+                   size / (2 * block_count) >= MI_KD_GRAIN_SIZE)
+                block_count *= 2;
+
+            auto block_bound = [&](size_t i) { return size * i / block_count; };
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, block_count, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i)
+                        std::sort(start + block_bound(i), start + block_bound(i + 1));
+                }
+            );
+
+            std::unique_ptr<EdgeEvent[]> scratch(new EdgeEvent[size]);
+            EdgeEvent *src = start, *dst = scratch.get();
+
+            for (size_t width = 1; width < block_count; width *= 2) {
+                for (size_t i = 0; i < block_count; i += 2 * width) {
+                    size_t b0 = block_bound(i),
+                           b1 = block_bound(std::min(i + width, block_count)),
+                           b2 = block_bound(std::min(i + 2 * width, block_count));
+                    merge_events(src + b0, src + b1, src + b1, src + b2, dst + b0);
+                }
+                std::swap(src, dst);
+            }
+
+            if (src != start)
+                copy_events(src, src + size, start);
+        }
+
+        /**
+         * \brief Merge two sorted edge event lists (in parallel, if they are
+         * sufficiently large)
+         *
+         * Has the same semantics as \c std::merge: on ties, events from the
+         * first list are placed first.
+         */
+        static EdgeEvent *merge_events(const EdgeEvent *a_start, const EdgeEvent *a_end,
+                                       const EdgeEvent *b_start, const EdgeEvent *b_end,
+                                       EdgeEvent *out) {
+            size_t a_size = (size_t) (a_end - a_start),
+                   b_size = (size_t) (b_end - b_start);
+
+            if (a_size + b_size < MI_KD_PARALLEL_EVENTS || a_size == 0)
+                return std::merge(a_start, a_end, b_start, b_end, out);
+
+            /* Split the first list into pieces and find the matching
+               ranges of the second list using binary search */
+            size_t piece_count =
+                std::min((a_size + b_size) / MI_KD_GRAIN_SIZE, a_size);
+
+            auto a_bound = [&](size_t i) { return a_start + a_size * i / piece_count; };
+            auto b_bound = [&](size_t i) {
+                return i == piece_count ? b_end
+                                        : std::lower_bound(b_start, b_end, *a_bound(i));
+            };
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, piece_count, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        const EdgeEvent *a0 = a_bound(i), *a1 = a_bound(i + 1),
+                                        *b0 = i == 0 ? b_start : b_bound(i),
+                                        *b1 = b_bound(i + 1);
+                        std::merge(a0, a1, b0, b1,
+                                   out + (a0 - a_start) + (b0 - b_start));
+                    }
+                }
+            );
+
+            return out + a_size + b_size;
+        }
+
+        /// Copy an edge event list (in parallel, if it is sufficiently large)
+        static void copy_events(const EdgeEvent *start, const EdgeEvent *end,
+                                EdgeEvent *out) {
+            size_t size = (size_t) (end - start);
+            if (size < MI_KD_PARALLEL_EVENTS) {
+                std::copy(start, end, out);
+                return;
+            }
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, size, MI_KD_GRAIN_SIZE),
+                [&](const dr::blocked_range<size_t> &range) {
+                    std::copy(start + range.begin(), start + range.end(),
+                              out + range.begin());
+                }
+            );
+        }
+
+        /**
+         * \brief Stable parallel partition of an edge event list
+         *
+         * The function \c side returns a bit mask specifying whether an event
+         * should be appended to the left (1) and/or right (2) output list.
+         * Returns the end of both output lists.
+         */
+        template <typename Func>
+        static std::pair<EdgeEvent *, EdgeEvent *>
+        partition_events(const EdgeEvent *start, const EdgeEvent *end,
+                         EdgeEvent *left, EdgeEvent *right, Func side) {
+            size_t size = (size_t) (end - start),
+                   block_count = (size + MI_KD_GRAIN_SIZE - 1) / MI_KD_GRAIN_SIZE;
+
+            /* First pass: count the number of events per block and side */
+            std::unique_ptr<size_t[]> left_offset(new size_t[block_count + 1]),
+                                      right_offset(new size_t[block_count + 1]);
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, block_count, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        const EdgeEvent *block_end =
+                            start + std::min(size, (i + 1) * MI_KD_GRAIN_SIZE);
+                        size_t left_count = 0, right_count = 0;
+                        for (auto it = start + i * MI_KD_GRAIN_SIZE; it != block_end; ++it) {
+                            uint32_t mask = side(*it);
+                            left_count += mask & 1;
+                            right_count += mask >> 1;
+                        }
+                        left_offset[i + 1] = left_count;
+                        right_offset[i + 1] = right_count;
+                    }
+                }
+            );
+
+            left_offset[0] = right_offset[0] = 0;
+            for (size_t i = 0; i < block_count; ++i) {
+                left_offset[i + 1] += left_offset[i];
+                right_offset[i + 1] += right_offset[i];
+            }
+
+            /* Second pass: write the events to their final position */
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, block_count, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        const EdgeEvent *block_end =
+                            start + std::min(size, (i + 1) * MI_KD_GRAIN_SIZE);
+                        EdgeEvent *left_out = left + left_offset[i],
+                                  *right_out = right + right_offset[i];
+                        for (auto it = start + i * MI_KD_GRAIN_SIZE; it != block_end; ++it) {
+                            uint32_t mask = side(*it);
+                            if (mask & 1)
+                                *left_out++ = *it;
+                            if (mask & 2)
+                                *right_out++ = *it;
+                        }
+                    }
+                }
+            );
+
+            return { left + left_offset[block_count],
+                     right + right_offset[block_count] };
+        }
+
+        /**
+         * \brief Determine on which side of a split plane an edge event
+         * places its primitive
+         *
+         * Returns \c PrimClassification::Both if the event does not decide
+         * the classification.
+         */
+        static PrimClassification classify(const EdgeEvent &event,
+                                           const SplitCandidate &best) {
+            switch (event.type) {
+                case EdgeEvent::Type::EdgeEnd:
+                    /* Fully on the left side (the primitive's interval ends
+                       before (or on) the split plane) */
+                    return event.pos <= best.split ? PrimClassification::Left
+                                                   : PrimClassification::Both;
+
+                case EdgeEvent::Type::EdgeStart:
+                    /* Fully on the right side (the primitive's interval
+                       starts after (or on) the split plane) */
+                    return event.pos >= best.split ? PrimClassification::Right
+                                                   : PrimClassification::Both;
+
+                default:
+                    /* If the planar primitive is not on the split plane,
+                       the classification is easy. Otherwise, place it on
+                       the side with the lower cost */
+                    if (event.pos < best.split ||
+                        (event.pos == best.split && best.planar_left))
+                        return PrimClassification::Left;
+                    else
+                        return PrimClassification::Right;
+            }
+        }
+
+        /**
+         * \brief Append the edge events of a primitive clipped to the given
+         * bounding box
+         *
+         * Returns \c false (and appends nothing) when the clipped primitive
+         * is degenerate.
+         */
+        bool clip_events(Index prim_index, const BoundingBox &bbox,
+                         EdgeEvent *&out) const {
+            BoundingBox clipped = m_ctx.derived.bbox(prim_index, bbox);
+            Assert(bbox.contains(clipped) || !clipped.valid());
+
+            if (!clipped.valid() || !(clipped.surface_area() > 0))
+                return false;
+
+            for (Index axis = 0; axis < Dimension; ++axis) {
+                Scalar min = clipped.min[axis], max = clipped.max[axis];
+
+                if (min != max) {
+                    *out++ = EdgeEvent(EdgeEvent::Type::EdgeStart, axis, min, prim_index);
+                    *out++ = EdgeEvent(EdgeEvent::Type::EdgeEnd, axis, max, prim_index);
+                } else {
+                    *out++ = EdgeEvent(EdgeEvent::Type::EdgePlanar, axis, min, prim_index);
+                }
+            }
+
+            return true;
+        }
+
         /// Recursively run the O(N log N builder)
         Scalar build_nlogn(Index node, Size prim_count,
                            EdgeEvent *events_start, EdgeEvent *events_end,
@@ -1275,6 +1618,8 @@ protected:
                tree construction heuristic. To do this in O(n), the search is
                implemented as a sweep over the edge events */
 
+            ScopedBuildPhase sweep_phase(m_ctx, PhaseSweep);
+
             /* Initially, the split plane is placed left of the scene
                and thus all geometry is on its right side */
             Size left_count[Dimension], right_count[Dimension];
@@ -1372,6 +1717,8 @@ protected:
                 Assert((i == 0) || ((events_by_dimension[i]-1)->axis == i - 1));
             }
 
+            sweep_phase.finish();
+
             /* Allow a few bad refines in sequence before giving up */
             if (best.cost >= leaf_cost) {
                 if ((best.cost > 4 * leaf_cost && prim_count < 16)
@@ -1388,48 +1735,83 @@ protected:
             /*                      Primitive Classification                        */
             /* ==================================================================== */
 
-            auto &classification = m_local.classification_storage;
+            /* Large nodes are classified, partitioned, and recursed into
+               in parallel. They use a separate classification buffer, since
+               this thread may run other parts of the build while waiting */
+            bool parallel = (size_t) (events_end - events_start) >= MI_KD_PARALLEL_EVENTS;
+            std::unique_ptr<ClassificationStorage> parallel_classification;
+            if (parallel) {
+                parallel_classification = m_ctx.acquire_classification();
+                m_ctx.parallel_nodes++;
+            }
+
+            auto &classification = parallel ? *parallel_classification
+                                            : m_local.classification_storage;
 
-            /* Initially mark all prims as being located on both sides */
-            for (auto event = events_by_dimension[best.axis];
-                 event != events_by_dimension[best.axis + 1]; ++event)
-                classification.set(event->index, PrimClassification::Both);
+            ScopedBuildPhase classify_phase(m_ctx, PhaseClassify);
+
+            EdgeEvent *axis_events_start = events_by_dimension[best.axis],
+                      *axis_events_end   = events_by_dimension[best.axis + 1];
 
             Size prims_left = 0, prims_right = 0;
-            for (auto event = events_by_dimension[best.axis];
-                 event != events_by_dimension[best.axis + 1]; ++event) {
+            if (parallel) {
+                size_t axis_event_count = (size_t) (axis_events_end - axis_events_start);
+                std::atomic<Size> prims_left_atomic { 0 }, prims_right_atomic { 0 };
+
+                /* Initially mark all prims as being located on both sides */
+                dr::parallel_for(
+                    dr::blocked_range<size_t>(0, axis_event_count, MI_KD_GRAIN_SIZE),
+                    [&](const dr::blocked_range<size_t> &range) {
+                        for (size_t i = range.begin(); i != range.end(); ++i)
+                            classification.set_concurrent(axis_events_start[i].index,
+                                                          PrimClassification::Both);
+                    }
+                );
+
+                dr::parallel_for(
+                    dr::blocked_range<size_t>(0, axis_event_count, MI_KD_GRAIN_SIZE),
+                    [&](const dr::blocked_range<size_t> &range) {
+                        Size left = 0, right = 0;
+                        for (size_t i = range.begin(); i != range.end(); ++i) {
+                            const EdgeEvent &event = axis_events_start[i];
+                            PrimClassification value = classify(event, best);
+                            if (value == PrimClassification::Both)
+                                continue;
+                            classification.set_concurrent(event.index, value);
+                            if (value == PrimClassification::Left)
+                                left++;
+                            else
+                                right++;
+                        }
+                        prims_left_atomic += left;
+                        prims_right_atomic += right;
+                    }
+                );
+
+                prims_left = prims_left_atomic;
+                prims_right = prims_right_atomic;
+            } else {
+                /* Initially mark all prims as being located on both sides */
+                for (auto event = axis_events_start; event != axis_events_end; ++event)
+                    classification.set(event->index, PrimClassification::Both);
+
+                for (auto event = axis_events_start; event != axis_events_end; ++event) {
+                    PrimClassification value = classify(*event, best);
+                    if (value == PrimClassification::Both)
+                        continue;
 
-                if (event->type == EdgeEvent::Type::EdgeEnd &&
-                    event->pos <= best.split) {
-                    /* Fully on the left side (the primitive's interval ends
-                       before (or on) the split plane) */
-                    Assert(classification.get(event->index) == PrimClassification::Both);
-                    classification.set(event->index, PrimClassification::Left);
-                    prims_left++;
-                } else if (event->type == EdgeEvent::Type::EdgeStart &&
-                           event->pos >= best.split) {
-                    /* Fully on the right side (the primitive's interval
-                       starts after (or on) the split plane) */
-                    Assert(classification.get(event->index) == PrimClassification::Both);
-                    classification.set(event->index, PrimClassification::Right);
-                    prims_right++;
-                } else if (event->type == EdgeEvent::Type::EdgePlanar) {
-                    /* If the planar primitive is not on the split plane,
-                       the classification is easy. Otherwise, place it on
-                       the side with the lower cost */
                     Assert(classification.get(event->index) == PrimClassification::Both);
-                    if (event->pos < best.split ||
-                        (event->pos == best.split && best.planar_left)) {
-                        classification.set(event->index, PrimClassification::Left);
+                    classification.set(event->index, value);
+
+                    if (value == PrimClassification::Left)
                         prims_left++;
-                    } else if (event->pos > best.split ||
-                               (event->pos == best.split && !best.planar_left)) {
-                        classification.set(event->index, PrimClassification::Right);
+                    else
                         prims_right++;
-                    }
                 }
             }
 
+            classify_phase.finish();
+
             Size prims_both = prim_count - prims_left - prims_right;
 
             /* Some sanity checks */
@@ -1440,6 +1822,8 @@ protected:
             /*                            Partitioning                              */
             /* ==================================================================== */
 
+            ScopedBuildPhase partition_phase(m_ctx, PhasePartition);
+
             BoundingBox left_bbox = bbox, right_bbox = bbox;
             left_bbox.max[best.axis] = best.split;
             right_bbox.min[best.axis] = best.split;
@@ -1469,26 +1853,46 @@ protected:
 
             if (prims_both == 0 || !derived.clip_primitives()) {
                 /* Fast path: no clipping needed. */
-                for (auto it = events_start; it != events_end; ++it) {
-                    auto event = *it;
-
-                    /* Fetch the classification of the current event */
-                    switch (classification.get(event.index)) {
-                        case PrimClassification::Left:
-                            *left_events_end++ = event;
-                            break;
-
-                        case PrimClassification::Right:
-                            *right_events_end++ = event;
-                            break;
-
-                        case PrimClassification::Both:
-                            *left_events_end++ = event;
-                            *right_events_end++ = event;
-                            break;
-
-                        default:
-                            Assert(false);
+                if (parallel) {
+                    /* One of the output lists aliases the input, which
+                       rules out a parallel partition in place. Work on a
+                       copy that is stored after the other output list. */
+                    auto &temp_alloc = left_child ? right_alloc : left_alloc;
+                    size_t event_count = (size_t) (events_end - events_start);
+                    EdgeEvent *temp_events_start =
+                        temp_alloc.template allocate<EdgeEvent>(event_count);
+                    copy_events(events_start, events_end, temp_events_start);
+
+                    std::tie(left_events_end, right_events_end) = partition_events(
+                        temp_events_start, temp_events_start + event_count,
+                        left_events_start, right_events_start,
+                        [&](const EdgeEvent &event) {
+                            return (uint32_t) classification.get(event.index);
+                        });
+
+                    temp_alloc.release(temp_events_start);
+                } else {
+                    for (auto it = events_start; it != events_end; ++it) {
+                        auto event = *it;
+
+                        /* Fetch the classification of the current event */
+                        switch (classification.get(event.index)) {
+                            case PrimClassification::Left:
+                                *left_events_end++ = event;
+                                break;
+
+                            case PrimClassification::Right:
+                                *right_events_end++ = event;
+                                break;
+
+                            case PrimClassification::Both:
+                                *left_events_end++ = event;
+                                *right_events_end++ = event;
+                                break;
+
+                            default:
+                                Assert(false);
+                        }
                     }
                 }
 
@@ -1514,78 +1918,110 @@ protected:
                 new_right_events_start = new_right_events_end =
                     right_alloc.template allocate<EdgeEvent>(prims_both * 2 * Dimension);
 
-                for (auto it = events_start; it != events_end; ++it) {
-                    auto event = *it;
-
-                    /* Fetch the classification of the current event */
-                    switch (classification.get(event.index)) {
-                        case PrimClassification::Left:
-                            *temp_left_events_end++ = event;
-                            break;
-
-                        case PrimClassification::Right:
-                            *temp_right_events_end++ = event;
-                            break;
-
-                        case PrimClassification::Ignore:
-                            break;
-
-                        case PrimClassification::Both: {
-                                BoundingBox clippedLeft  = derived.bbox(event.index, left_bbox);
-                                BoundingBox clippedRight = derived.bbox(event.index, right_bbox);
-
-                                Assert(left_bbox.contains(clippedLeft) || !clippedLeft.valid());
-                                Assert(right_bbox.contains(clippedRight) || !clippedRight.valid());
-
-                                if (clippedLeft.valid() &&
-                                    clippedLeft.surface_area() > 0) {
-                                    for (Index axis = 0; axis < Dimension; ++axis) {
-                                        Scalar min = clippedLeft.min[axis],
-                                               max = clippedLeft.max[axis];
-
-                                        if (min != max) {
-                                            *new_left_events_end++ = EdgeEvent(
-                                                EdgeEvent::Type::EdgeStart, axis, min, event.index);
-                                            *new_left_events_end++ = EdgeEvent(
-                                                EdgeEvent::Type::EdgeEnd, axis, max, event.index);
-                                        } else {
-                                            *new_left_events_end++ = EdgeEvent(
-                                                EdgeEvent::Type::EdgePlanar, axis, min, event.index);
-                                        }
-                                    }
-                                } else {
-                                    pruned_left++;
+                if (parallel) {
+                    /* The input is only read here, hence no copy is needed */
+                    std::tie(temp_left_events_end, temp_right_events_end) = partition_events(
+                        events_start, events_end,
+                        temp_left_events_start, temp_right_events_start,
+                        [&](const EdgeEvent &event) -> uint32_t {
+                            PrimClassification value = classification.get(event.index);
+                            return value == PrimClassification::Both ? 0u : (uint32_t) value;
+                        });
+
+                    /* Each straddling primitive has exactly one start or
+                       planar event along the first axis: clip it there */
+                    EdgeEvent *first_axis_start = events_by_dimension[0],
+                              *first_axis_end   = events_by_dimension[1];
+                    size_t first_axis_count = (size_t) (first_axis_end - first_axis_start),
+                           block_count = (first_axis_count + MI_KD_GRAIN_SIZE - 1) / MI_KD_GRAIN_SIZE;
+
+                    struct ClippedBlock {
+                        std::vector<EdgeEvent> left, right;
+                        Size pruned_left = 0, pruned_right = 0;
+                    };
+                    std::vector<ClippedBlock> blocks(block_count);
+
+                    dr::parallel_for(
+                        dr::blocked_range<size_t>(0, block_count, 1),
+                        [&](const dr::blocked_range<size_t> &range) {
+                            for (size_t i = range.begin(); i != range.end(); ++i) {
+                                ClippedBlock &block = blocks[i];
+                                const EdgeEvent *block_end = first_axis_start +
+                                    std::min(first_axis_count, (i + 1) * MI_KD_GRAIN_SIZE);
+
+                                for (auto it = first_axis_start + i * MI_KD_GRAIN_SIZE;
+                                     it != block_end; ++it) {
+                                    if (it->type == EdgeEvent::Type::EdgeEnd ||
+                                        classification.get(it->index) != PrimClassification::Both)
+                                        continue;
+
+                                    EdgeEvent clipped[2 * Dimension], *clipped_end = clipped;
+                                    if (clip_events(it->index, left_bbox, clipped_end))
+                                        block.left.insert(block.left.end(), clipped, clipped_end);
+                                    else
+                                        block.pruned_left++;
+
+                                    clipped_end = clipped;
+                                    if (clip_events(it->index, right_bbox, clipped_end))
+                                        block.right.insert(block.right.end(), clipped, clipped_end);
+                                    else
+                                        block.pruned_right++;
                                 }
+                            }
+                        }
+                    );
+
+                    std::vector<EdgeEvent *> left_out(block_count), right_out(block_count);
+                    for (size_t i = 0; i < block_count; ++i) {
+                        left_out[i] = new_left_events_end;
+                        right_out[i] = new_right_events_end;
+                        new_left_events_end += blocks[i].left.size();
+                        new_right_events_end += blocks[i].right.size();
+                        pruned_left += blocks[i].pruned_left;
+                        pruned_right += blocks[i].pruned_right;
+                    }
 
-                                if (clippedRight.valid() &&
-                                    clippedRight.surface_area() > 0) {
-                                    for (Index axis = 0; axis < Dimension; ++axis) {
-                                        Scalar min = clippedRight.min[axis],
-                                               max = clippedRight.max[axis];
-
-                                        if (min != max) {
-                                            *new_right_events_end++ = EdgeEvent(
-                                                EdgeEvent::Type::EdgeStart, axis, min, event.index);
-                                            *new_right_events_end++ = EdgeEvent(
-                                                EdgeEvent::Type::EdgeEnd, axis, max, event.index);
-                                        } else {
-                                            *new_right_events_end++ = EdgeEvent(
-                                                EdgeEvent::Type::EdgePlanar, axis, min, event.index);
-                                        }
-                                    }
-                                } else {
+                    dr::parallel_for(
+                        dr::blocked_range<size_t>(0, block_count, 1),
+                        [&](const dr::blocked_range<size_t> &range) {
+                            for (size_t i = range.begin(); i != range.end(); ++i) {
+                                std::copy(blocks[i].left.begin(), blocks[i].left.end(), left_out[i]);
+                                std::copy(blocks[i].right.begin(), blocks[i].right.end(), right_out[i]);
+                            }
+                        }
+                    );
+                } else {
+                    for (auto it = events_start; it != events_end; ++it) {
+                        auto event = *it;
+
+                        /* Fetch the classification of the current event */
+                        switch (classification.get(event.index)) {
+                            case PrimClassification::Left:
+                                *temp_left_events_end++ = event;
+                                break;
+
+                            case PrimClassification::Right:
+                                *temp_right_events_end++ = event;
+                                break;
+
+                            case PrimClassification::Ignore:
+                                break;
+
+                            case PrimClassification::Both:
+                                if (!clip_events(event.index, left_bbox, new_left_events_end))
+                                    pruned_left++;
+                                if (!clip_events(event.index, right_bbox, new_right_events_end))
                                     pruned_right++;
-                                }
 
                                 /* Set classification to 'EIgnore' to ensure that
                                    clipping occurs only once */
                                 classification.set(
                                     event.index, PrimClassification::Ignore);
-                            }
-                            break;
+                                break;
 
-                        default:
-                            Assert(false);
+                            default:
+                                Assert(false);
+                        }
                     }
                 }
 
@@ -1597,16 +2033,16 @@ protected:
                 m_ctx.pruned += pruned_left + pruned_right;
 
                 /* Sort the events due to primitives which overlap the split plane */
-                std::sort(new_left_events_start, new_left_events_end);
-                std::sort(new_right_events_start, new_right_events_end);
+                sort_events(new_left_events_start, new_left_events_end);
+                sort_events(new_right_events_start, new_right_events_end);
 
                 /* Merge the left list */
-                left_events_end = std::merge(temp_left_events_start,
+                left_events_end = merge_events(temp_left_events_start,
                     temp_left_events_end, new_left_events_start,
                     new_left_events_end, left_events_start);
 
                 /* Merge the right list */
-                right_events_end = std::merge(temp_right_events_start,
+                right_events_end = merge_events(temp_right_events_start,
                     temp_right_events_end, new_right_events_start,
                     new_right_events_end, right_events_start);
 
@@ -1617,6 +2053,9 @@ protected:
                 right_alloc.release(temp_right_events_start);
             }
 
+            if (parallel)
+                m_ctx.release_classification(std::move(parallel_classification));
+
             /* Shrink the edge event storage now that we know exactly how
                many events are on each side */
             left_alloc.shrink_allocation(left_events_start,
@@ -1624,6 +2063,8 @@ protected:
             right_alloc.shrink_allocation(right_events_start,
                                          right_events_end - right_events_start);
 
+            partition_phase.finish();
+
             /* ==================================================================== */
             /*                              Recursion                               */
             /* ==================================================================== */
@@ -1636,15 +2077,36 @@ protected:
                       "to store overly large offset to left child node (%i)",
                       left_offset);
 
-            Scalar left_cost =
-                build_nlogn(children, best.left_count - pruned_left,
-                            left_events_start, left_events_end, left_bbox,
-                            depth + 1, bad_refines, true);
+            Scalar left_cost = 0, right_cost = 0;
 
-            Scalar right_cost =
-                build_nlogn(children + 1, best.right_count - pruned_right,
-                            right_events_start, right_events_end, right_bbox,
-                            depth + 1, bad_refines, false);
+            if (parallel) {
+                /* Build the left subtree on another thread. It works on a
+                   copy of its event list, since the ordered chunk
+                   allocators cannot be shared between threads. */
+                Task *left_dr_task = dr::do_async([&]() {
+                    left_cost = build_nlogn_detached(
+                        children, best.left_count - pruned_left,
+                        left_events_start, left_events_end, left_bbox,
+                        depth + 1, bad_refines);
+                });
+
+                right_cost =
+                    build_nlogn(children + 1, best.right_count - pruned_right,
+                                right_events_start, right_events_end, right_bbox,
+                                depth + 1, bad_refines, false);
+
+                task_wait_and_release(left_dr_task);
+            } else {
+                left_cost =
+                    build_nlogn(children, best.left_count - pruned_left,
+                                left_events_start, left_events_end, left_bbox,
+                                depth + 1, bad_refines, true);
+
+                right_cost =
+                    build_nlogn(children + 1, best.right_count - pruned_right,
+                                right_events_start, right_events_end, right_bbox,
+                                depth + 1, bad_refines, false);
+            }
 
             /* Release the index lists not needed by the children anymore */
             if (left_child)
@@ -1680,10 +2142,43 @@ protected:
             return final_cost;
         }
 
+        /**
+         * \brief Run the O(N log N) builder on an event list that was
+         * created by another thread
+         *
+         * The event list is copied into storage provided by the allocator of
+         * the current thread, which allows the recursion to proceed in the
+         * usual way.
+         */
+        Scalar build_nlogn_detached(Index node, Size prim_count,
+                                    const EdgeEvent *events_start,
+                                    const EdgeEvent *events_end,
+                                    const BoundingBox &bbox, Size depth,
+                                    Size bad_refines) {
+            ScopedSetThreadEnvironment env(m_ctx.env);
+            size_t event_count = (size_t) (events_end - events_start);
+
+            EdgeEvent *copy_start =
+                m_local.left_alloc.template allocate<EdgeEvent>(event_count);
+            copy_events(events_start, events_end, copy_start);
+
+            m_local.classification_storage.resize(m_ctx.derived.primitive_count());
+            m_local.ctx = &m_ctx;
+
+            Scalar cost = build_nlogn(node, prim_count, copy_start,
+                                      copy_start + event_count, bbox, depth,
+                                      bad_refines);
+
+            m_local.left_alloc.release(copy_start);
+
+            return cost;
+        }
+
         /// Create an initial sorted edge event list and start the O(N log N) builder
         Scalar transition_to_nlogn() {
             const auto &derived = m_ctx.derived;
-            // m_local = &m_ctx.local; // TODO remove this
+
+            ScopedBuildPhase events_phase(m_ctx, PhaseEvents);
 
             Size prim_count = Size(m_indices.size()), final_prim_count = prim_count;
 
@@ -1695,38 +2190,57 @@ protected:
                 m_local.left_alloc.template allocate<EdgeEvent>(initial_size),
                 *events_end = events_start + initial_size;
 
-            for (Size i = 0; i<prim_count; ++i) {
-                Index prim_index = m_indices[i];
-                BoundingBox prim_bbox = derived.bbox(prim_index, m_bbox);
-                bool valid = prim_bbox.valid() && prim_bbox.surface_area() > 0;
-
-                if (unlikely(!valid)) {
-                    --final_prim_count;
-                    m_ctx.pruned++;
-                }
-
-                for (Index axis = 0; axis < Dimension; ++axis) {
-                    Scalar min = prim_bbox.min[axis], max = prim_bbox.max[axis];
-                    Index offset = (Index) (axis * prim_count + i) * 2;
-
-                    if (unlikely(!valid)) {
-                        events_start[offset  ].set_invalid();
-                        events_start[offset+1].set_invalid();
-                    } else if (min == max) {
-                        events_start[offset  ] = EdgeEvent(EdgeEvent::Type::EdgePlanar, axis, min, prim_index);
-                        events_start[offset+1].set_invalid();
-                    } else {
-                        events_start[offset  ] = EdgeEvent(EdgeEvent::Type::EdgeStart, axis, min, prim_index);
-                        events_start[offset+1] = EdgeEvent(EdgeEvent::Type::EdgeEnd,   axis, max, prim_index);
+            /* Create the events of a range of primitives, returns the number
+               of degenerate primitives */
+            auto create_events = [&](Size range_start, Size range_end) {
+                Size pruned = 0;
+                for (Size i = range_start; i < range_end; ++i) {
+                    Index prim_index = m_indices[i];
+                    BoundingBox prim_bbox = derived.bbox(prim_index, m_bbox);
+                    bool valid = prim_bbox.valid() && prim_bbox.surface_area() > 0;
+
+                    if (unlikely(!valid))
+                        pruned++;
+
+                    for (Index axis = 0; axis < Dimension; ++axis) {
+                        Scalar min = prim_bbox.min[axis], max = prim_bbox.max[axis];
+                        Index offset = (Index) (axis * prim_count + i) * 2;
+
+                        if (unlikely(!valid)) {
+                            events_start[offset  ].set_invalid();
+                            events_start[offset+1].set_invalid();
+                        } else if (min == max) {
+                            events_start[offset  ] = EdgeEvent(EdgeEvent::Type::EdgePlanar, axis, min, prim_index);
+                            events_start[offset+1].set_invalid();
+                        } else {
+                            events_start[offset  ] = EdgeEvent(EdgeEvent::Type::EdgeStart, axis, min, prim_index);
+                            events_start[offset+1] = EdgeEvent(EdgeEvent::Type::EdgeEnd,   axis, max, prim_index);
+                        }
                     }
                 }
+                return pruned;
+            };
+
+            if (initial_size >= MI_KD_PARALLEL_EVENTS) {
+                std::atomic<Size> pruned { 0 };
+                dr::parallel_for(
+                    dr::blocked_range<Size>(0u, prim_count, MI_KD_GRAIN_SIZE),
+                    [&](const dr::blocked_range<Size> &range) {
+                        pruned += create_events(range.begin(), range.end());
+                    }
+                );
+                final_prim_count -= pruned;
+            } else {
+                final_prim_count -= create_events(0, prim_count);
             }
 
+            m_ctx.pruned += prim_count - final_prim_count;
+
             /* Release index list */
             IndexVector().swap(m_indices);
 
             /* Sort the events list and remove invalid ones from the end */
-            std::sort(events_start, events_end);
+            sort_events(events_start, events_end);
             while (events_start != events_end && !(events_end-1)->valid())
                 --events_end;
 
@@ -1735,6 +2249,8 @@ protected:
             m_local.classification_storage.resize(derived.primitive_count());
             m_local.ctx = &m_ctx;
 
+            events_phase.finish();
+
             Scalar cost = build_nlogn(m_node, final_prim_count, events_start,
                                       events_end, m_bbox, m_depth, 0);
 
@@ -1832,7 +2348,8 @@ protected:
             Throw("The number of min-max bins must be > 2");
         if (m_stop_primitives <= 0)
             Throw("The stopping primitive count must be greater than zero");
-        if (m_exact_prim_threshold <= m_stop_primitives)
+        if (m_exact_prim_threshold != 0 &&
+            m_exact_prim_threshold <= m_stop_primitives)
             Throw("The exact primitive threshold must be bigger than the "
                   "stopping primitive count");
 
@@ -1862,6 +2379,10 @@ protected:
         /* ==================================================================== */
 
         BuildContext ctx(derived());
+        ctx.timing = Thread::thread()->logger()->log_level() <= m_log_level;
+
+        Timer timer;
+        std::clock_t cpu_start = std::clock();
 
         ctx.node_storage.reserve(prim_count);
         ctx.index_storage.reserve(prim_count);
@@ -1890,6 +2411,10 @@ protected:
                                        m_bbox, 0, 0, &final_cost);
             task.execute();
         }
+        m_sah_cost = final_cost;
+
+        size_t build_time = timer.value();
+        double cpu_time = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
 
         Log(m_log_level, "Structural kd-tree statistics:");
 
@@ -1991,6 +2516,28 @@ protected:
             Log(m_log_level, "   Final cost                  : %.2f",
                 final_cost);
             Log(m_log_level, "");
+
+            /* Phase times are accumulated over all threads. Waiting threads
+               help out with other work, hence the times of nested phases
+               may overlap. */
+            const char *phase_names[PhaseCount] = {
+                "Min-max binning", "Edge event creation",
+                "Split plane search", "Classification", "Partitioning"
+            };
+
+            Log(m_log_level, "kd-tree construction performance:");
+            Log(m_log_level, "   Build time                  : %s",
+                util::time_string((float) build_time));
+            Log(m_log_level, "   Thread utilization          : %.1f%% (%i threads)",
+                100.0 * cpu_time /
+                    (std::max(build_time, (size_t) 1) * 1e-3 * Thread::thread_count()),
+                Thread::thread_count());
+            Log(m_log_level, "   Parallel O(n log n) nodes   : %i",
+                ctx.parallel_nodes);
+            for (int i = 0; i < PhaseCount; ++i)
+                Log(m_log_level, "   %-28s: %s (aggregate)", phase_names[i],
+                    util::time_string((float) (ctx.phase_time[i] * 1e-6)));
+            Log(m_log_level, "");
         }
     }
 
@@ -2008,6 +2555,7 @@ protected:
     Size m_max_bad_refines = 0;
     Size m_exact_prim_threshold = 65536;
     Size m_min_max_bins = 128;
+    Scalar m_sah_cost = 0;
     LogLevel m_log_level = Debug;
     BoundingBox m_bbox;
 };
@@ -2147,19 +2695,53 @@ public:
     using Base::m_indices;
     using Base::m_index_count;
     using Base::m_node_count;
+    using Base::m_cost_model;
+    using Base::m_clip_primitives;
+    using Base::m_retract_bad_splits;
+    using Base::m_max_depth;
+    using Base::m_stop_primitives;
+    using Base::m_max_bad_refines;
+    using Base::m_exact_prim_threshold;
+    using Base::m_min_max_bins;
+    using Base::m_sah_cost;
 
-    /// Create an empty kd-tree and take build-related parameters from \c props.
+    /**
+     * \brief Create an empty kd-tree and take build-related parameters from
+     * \c props.
+     *
+     * The \c accel_quality profile selects default builder parameters, which
+     * can be further adjusted by the individual \c kd_* parameters.
+     */
     ShapeKDTree(const Properties &props);
 
+    /// Release the kd-tree (and the mapping of the cache file, if any)
+    ~ShapeKDTree();
+
     /// Clear the kd-tree (build-related parameters remain)
     void clear();
 
     /// Register a new shape with the kd-tree (to be called before \ref build())
     void add_shape(Shape *shape);
 
-    /// Build the kd-tree
+    /**
+     * \brief Build the kd-tree
+     *
+     * When a cache directory was specified (\c kd_cache_dir), the tree is
+     * first looked up in a cache file keyed by a hash of the shape data and
+     * the builder parameters. On a hit, the nodes and indices are directly
+     * mapped into memory without any further processing. Otherwise, the
+     * tree is built from scratch and then written to the cache.
+     *
+     * When \c kd_triangle_records is set, the primitives of every leaf are
+     * subsequently copied into blocks of four precomputed triangles (see
+     * \ref intersect_leaf_records()), which trades memory for a faster
+     * scalar traversal. The records are not part of the cache file.
+     */
     void build();
 
+    /// Compute the key identifying this kd-tree in the on-disk cache
+    uint64_t cache_key() const;
+
     /// Return the number of registered shapes
     Size shape_count() const { return Size(m_shapes.size()); }
 
@@ -2259,21 +2841,26 @@ public:
                 maxt = t_plane;
                 continue;
             } else if (node->primitive_count() > 0) { // Arrived at a leaf node
-                Index prim_start = node->primitive_offset();
-                Index prim_end = prim_start + node->primitive_count();
-                for (Index i = prim_start; i < prim_end; i++) {
-                    Index prim_index = m_indices[i];
+                if (m_records) {
+                    if (intersect_leaf_records<ShadowRay>(node, ray, pi) && ShadowRay)
+                        return pi;
+                } else {
+                    Index prim_start = node->primitive_offset();
+                    Index prim_end = prim_start + node->primitive_count();
+                    for (Index i = prim_start; i < prim_end; i++) {
+                        Index prim_index = m_indices[i];
 
-                    PreliminaryIntersection<ScalarFloat, Shape> prim_pi =
-                        intersect_prim<ShadowRay>(prim_index, ray);
+                        PreliminaryIntersection<ScalarFloat, Shape> prim_pi =
+                            intersect_prim<ShadowRay>(prim_index, ray);
 
-                    if (unlikely(prim_pi.is_valid())) {
-                        if constexpr (ShadowRay)
-                            return prim_pi;
+                        if (unlikely(prim_pi.is_valid())) {
+                            if constexpr (ShadowRay)
+                                return prim_pi;
 
-                        Assert(prim_pi.t >= 0.f && prim_pi.t <= ray.maxt);
-                        pi = prim_pi;
-                        ray.maxt = pi.t;
+                            Assert(prim_pi.t >= 0.f && prim_pi.t <= ray.maxt);
+                            pi = prim_pi;
+                            ray.maxt = pi.t;
+                        }
                     }
                 }
             }
@@ -2292,16 +2879,47 @@ public:
         return pi;
     }
 
-#if 0
-    template <bool ShadowRay>
-    MI_INLINE PreliminaryIntersection3f ray_intersect_packet(Ray3f ray,
-                                                              Mask active) const {
+    /// Result of a packet query: per-lane hit information (\c t is infinite on a miss)
+    template <size_t Width> struct PacketIntersection {
+        using FloatP  = dr::Packet<ScalarFloat, Width>;
+        using UInt32P = dr::uint32_array_t<FloatP>;
+
+        FloatP t = dr::Infinity<FloatP>;
+        Point<FloatP, 2> prim_uv = 0.f;
+        UInt32P prim_index = (uint32_t) -1,
+                shape_index = (uint32_t) -1,
+                inst_index = (uint32_t) -1;
+
+        dr::mask_t<FloatP> is_valid() const { return t != dr::Infinity<FloatP>; }
+    };
+
+    /**
+     * \brief Trace a packet of rays through the kd-tree
+     *
+     * Interior nodes are visited once for the whole packet using per-lane
+     * activity masks. When all active lanes agree on the child to visit (the
+     * common case for coherent rays), the traversal proceeds without touching
+     * the stack. Leaf triangles are fetched once and intersected against all
+     * active lanes using SIMD arithmetic; other shape types fall back to
+     * per-lane scalar tests.
+     *
+     * The output fields follow the conventions of \ref ray_intersect_scalar(),
+     * with \c inst_index set for hits inside of instanced shape groups.
+     */
+    template <bool ShadowRay, size_t Width>
+    MI_INLINE PacketIntersection<Width>
+    ray_intersect_packet(Ray<Point<dr::Packet<ScalarFloat, Width>, 3>, Spectrum> ray,
+                         dr::mask_t<dr::Packet<ScalarFloat, Width>> active) const {
+        using FloatP    = dr::Packet<ScalarFloat, Width>;
+        using MaskP     = dr::mask_t<FloatP>;
+        using Vector3fP = Vector<FloatP, 3>;
+
         /// Ray traversal stack entry
         struct KDStackEntry {
             // Ray distance associated with the node entry and exit point
-            Float mint, maxt;
+            FloatP mint, maxt;
             // Is the corresponding SIMD lane enabled?
-            Mask active;
+            MaskP active;
             // Pointer to the far child
             const KDNode *node;
         };
@@ -2311,94 +2929,90 @@ public:
         int32_t stack_index = 0;
 
         // Resulting intersection struct
-        PreliminaryIntersection3f pi = dr::zeros<PreliminaryIntersection3f>();
-
-        const KDNode *node = m_nodes.get();
+        PacketIntersection<Width> pi;
 
-        /* Intersect against the scene bounding box */
+        // Intersect against the scene bounding box
         auto bbox_result = m_bbox.ray_intersect(ray);
-        Float mint = dr::maximum(ray.mint, std::get<1>(bbox_result));
-        Float maxt = dr::minimum(ray.maxt, std::get<2>(bbox_result));
 
+        FloatP mint = dr::maximum(ScalarFloat(0), std::get<1>(bbox_result)),
+               maxt = dr::minimum(ray.maxt, std::get<2>(bbox_result));
+
+        Vector3fP d_rcp = dr::rcp(ray.d);
+
+        const KDNode *node = m_nodes.get();
         while (true) {
-            active = active && (maxt >= mint);
-            if (ShadowRay)
-                active = active && !pi.is_valid();
+            active &= maxt >= mint;
+            if constexpr (ShadowRay)
+                active &= !pi.is_valid();
 
             if (likely(dr::any(active))) {
                 if (likely(!node->leaf())) { // Inner node
-                    const dr::scalar_t<Float> split = node->split();
-                    const uint32_t axis = node->axis();
-
-                    // Compute parametric distance along the rays to the split plane
-                    Float t_plane          = (split - ray.o[axis]) * ray.d_rcp[axis];
-                    Mask left_first        = (ray.o[axis] < split) ||
-                                              (dr::eq(ray.o[axis], split) && ray.d[axis] >= 0.f),
-                         start_after       = t_plane < mint,
-                         end_before        = t_plane > maxt || t_plane < 0.f || !dr::isfinite(t_plane),
-                         single_node       = start_after || end_before,
-                         visit_left        = dr::eq(end_before, left_first),
-                         visit_only_left   = single_node &&  visit_left,
-                         visit_only_right  = single_node && !visit_left;
-
-                    bool all_visit_only_left  = dr::all(visit_only_left || !active),
-                         all_visit_only_right = dr::all(visit_only_right || !active),
-                         all_visit_same_node  = all_visit_only_left || all_visit_only_right;
-
-                    /* If we only need to visit one node, just pick the correct one and continue */
-                    if (all_visit_same_node) {
-                        node = node->left() + (all_visit_only_left ? 0 : 1);
+                    const ScalarFloat split = node->split();
+                    const uint32_t axis     = node->axis();
+
+                    /* Compute parametric distance along the rays to the split plane */
+                    FloatP t_plane = (split - ray.o[axis]) * d_rcp[axis];
+
+                    MaskP left_first  = (ray.o[axis] < split) ||
+                                        (ray.o[axis] == split && ray.d[axis] >= 0.f),
+                          start_after = t_plane < mint,
+                          end_before  = t_plane > maxt || t_plane < 0.f ||
+                                        !dr::isfinite(t_plane),
+                          single_node = start_after || end_before,
+                          visit_left  = end_before == left_first,
+                          only_left   = single_node && visit_left,
+                          only_right  = single_node && !visit_left;
+
+                    /* Coherent fast path: all lanes visit the same child */
+                    bool all_left  = dr::all(only_left || !active),
+                         all_right = dr::all(only_right || !active);
+
+                    if (all_left || all_right) {
+                        node = node->left() + (all_left ? 0 : 1);
                         continue;
                     }
 
-                    size_t left_votes  = count(left_first && active),
-                           right_votes = count(!left_first && active);
+                    /* Visit both child nodes, in the order preferred by the majority */
+                    bool go_left = dr::count(left_first && active) >=
+                                   dr::count(!left_first && active);
 
-                    bool go_left = left_votes >= right_votes;
+                    MaskP go_left_p     = go_left,
+                          correct_order = left_first == go_left_p,
+                          visit_both    = !single_node,
+                          visit_cur     = visit_both || (visit_left == go_left_p),
+                          visit_next    = visit_both || (visit_left != go_left_p),
+                          near_first    = correct_order && visit_both,
+                          far_first     = !correct_order && visit_both;
 
-                    Mask go_left_bcast = Mask(go_left),
-                         correct_order = dr::eq(left_first, go_left_bcast),
-                         visit_both    = !single_node,
-                         visit_cur     = visit_both || eq (visit_left, go_left_bcast),
-                         visit_next    = visit_both || dr::neq(visit_left, go_left_bcast);
-
-                    /* Visit both child nodes in the right order */
                     Index node_offset = go_left ? 0 : 1;
                     const KDNode *left   = node->left(),
                                  *n_cur  = left + node_offset,
                                  *n_next = left + (1 - node_offset);
 
                     /* Postpone visit to 'n_next' */
-                    Mask sel0 =  correct_order && visit_both,
-                         sel1 = !correct_order && visit_both;
-                    KDStackEntry& entry = stack[stack_index++];
-                    entry.mint = dr::select(sel0, t_plane, mint);
-                    entry.maxt = dr::select(sel1, t_plane, maxt);
+                    KDStackEntry &entry = stack[stack_index++];
+                    entry.mint   = dr::select(near_first, t_plane, mint);
+                    entry.maxt   = dr::select(far_first, t_plane, maxt);
                     entry.active = active && visit_next;
-                    entry.node = n_next;
+                    entry.node   = n_next;
 
                     /* Visit 'n_cur' now */
-                    mint = dr::select(sel1, t_plane, mint);
-                    maxt = dr::select(sel0, t_plane, maxt);
+                    mint   = dr::select(far_first, t_plane, mint);
+                    maxt   = dr::select(near_first, t_plane, maxt);
                     active = active && visit_cur;
-                    node = n_cur;
+                    node   = n_cur;
                     continue;
                 } else if (node->primitive_count() > 0) { // Arrived at a leaf node
                     Index prim_start = node->primitive_offset();
                     Index prim_end = prim_start + node->primitive_count();
                     for (Index i = prim_start; i < prim_end; i++) {
-                        Index prim_index = m_indices[i];
+                        intersect_prim_packet<ShadowRay>(m_indices[i], ray,
+                                                         active, pi);
 
-                        PreliminaryIntersection3f prim_pi =
-                            intersect_prim<ShadowRay>(prim_index, ray, active);
-
-                        dr::masked(pi, prim_pi.is_valid()) = prim_pi;
-
-                        if constexpr (!ShadowRay) {
-                            Assert(dr::all(!prim_pi.is_valid() ||
-                                       (prim_pi.t >= ray.mint &&
-                                        prim_pi.t <= ray.maxt)));
-                            dr::masked(ray.maxt, prim_pi.is_valid()) = prim_pi.t;
+                        if constexpr (ShadowRay) {
+                            active &= !pi.is_valid();
+                            if (dr::none(active))
+                                break;
                         }
                     }
                 }
@@ -2406,11 +3020,11 @@ public:
 
             if (likely(stack_index > 0)) {
                 --stack_index;
-                KDStackEntry& entry = stack[stack_index];
-                mint = entry.mint;
-                maxt = dr::minimum(entry.maxt, ray.maxt);
+                KDStackEntry &entry = stack[stack_index];
+                mint   = entry.mint;
+                maxt   = dr::minimum(entry.maxt, ray.maxt);
                 active = entry.active;
-                node = entry.node;
+                node   = entry.node;
             } else {
                 break;
             }
@@ -2418,7 +3032,6 @@ public:
 
         return pi;
     }
-#endif
 
     /// Brute force intersection routine for debugging purposes
     template <bool ShadowRay>
@@ -2519,9 +3132,222 @@ protected:
         return pi;
     }
 
+    /**
+     * \brief Intersect a packet of rays against a single primitive and update
+     * the closest hit information of the active lanes.
+     */
+    template <bool ShadowRay, size_t Width>
+    MI_INLINE void
+    intersect_prim_packet(Index prim_index,
+                          Ray<Point<dr::Packet<ScalarFloat, Width>, 3>, Spectrum> &ray,
+                          const dr::mask_t<dr::Packet<ScalarFloat, Width>> &active,
+                          PacketIntersection<Width> &pi) const {
+        using FloatP   = dr::Packet<ScalarFloat, Width>;
+        using MaskP    = dr::mask_t<FloatP>;
+        using UInt32P  = dr::uint32_array_t<FloatP>;
+
+        Index global_index = prim_index,
+              shape_index  = find_shape(prim_index);
+        const Shape *shape = this->shape(shape_index);
+
+        if (likely(shape->is_mesh())) {
+            auto [t, uv] = ((const Mesh *) shape)->template
+                ray_intersect_triangle_broadcast<FloatP>(prim_index, ray, active);
+
+            MaskP hit = active && t != dr::Infinity<FloatP>;
+            if (dr::none(hit))
+                return;
+
+            dr::masked(pi.t, hit)           = ShadowRay ? FloatP(0.f) : t;
+            dr::masked(pi.prim_uv, hit)     = uv;
+            dr::masked(pi.prim_index, hit)  = UInt32P(prim_index);
+            dr::masked(pi.shape_index, hit) = UInt32P(shape_index);
+            dr::masked(pi.inst_index, hit)  = UInt32P((uint32_t) -1);
+
+            if constexpr (!ShadowRay)
+                dr::masked(ray.maxt, hit) = t;
+        } else {
+            /* Other shapes (including instances) only provide scalar
+               intersection routines here, process the lanes one by one */
+            for (size_t j = 0; j < Width; ++j) {
+                if (!active.entry(j))
+                    continue;
+
+                ScalarRay3f ray_j(
+                    ScalarPoint3f(ray.o.x().entry(j), ray.o.y().entry(j), ray.o.z().entry(j)),
+                    ScalarVector3f(ray.d.x().entry(j), ray.d.y().entry(j), ray.d.z().entry(j)),
+                    ray.maxt.entry(j), ray.time.entry(j), wavelength_t<Spectrum>());
+
+                auto prim_pi = intersect_prim<ShadowRay>(global_index, ray_j);
+                if (!prim_pi.is_valid())
+                    continue;
+
+                bool hit_inst = prim_pi.instance != nullptr;
+                pi.t.entry(j)           = prim_pi.t;
+                pi.prim_uv.x().entry(j) = prim_pi.prim_uv.x();
+                pi.prim_uv.y().entry(j) = prim_pi.prim_uv.y();
+                pi.prim_index.entry(j)  = prim_pi.prim_index;
+                pi.shape_index.entry(j) = prim_pi.shape_index;
+                pi.inst_index.entry(j)  = hit_inst ? shape_index : (uint32_t) -1;
+
+                if constexpr (!ShadowRay)
+                    ray.maxt.entry(j) = prim_pi.t;
+            }
+        }
+    }
+
+    /**
+     * \brief Intersect a ray against the triangle records of a leaf node
+     *
+     * The four triangles of a record are tested at once using SIMD
+     * arithmetic, and the shape and primitive indices of the closest hit are
+     * read from the record without calling \ref find_shape(). Other
+     * primitives stored in the records fall back to \ref intersect_prim().
+     *
+     * Updates \c pi and \c ray.maxt, and returns whether a hit was found.
+     */
+    template <bool ShadowRay>
+    MI_INLINE bool
+    intersect_leaf_records(const KDNode *node, ScalarRay3f &ray,
+                           PreliminaryIntersection<ScalarFloat, Shape> &pi) const {
+        using FloatP   = dr::Packet<ScalarFloat, 4>;
+        using MaskP    = dr::mask_t<FloatP>;
+        using Vector3P = Vector<FloatP, 3>;
+
+        const TriangleRecord *record = m_records.get() + m_record_offset[node - m_nodes.get()],
+                             *end    = record + (node->primitive_count() + 3) / 4;
+
+        auto load = [](const ScalarFloat (&v)[3][4]) DRJIT_INLINE_LAMBDA {
+            return Vector3P(dr::load<FloatP>(v[0]), dr::load<FloatP>(v[1]),
+                            dr::load<FloatP>(v[2]));
+        };
+
+        Vector3P o(ray.o.x(), ray.o.y(), ray.o.z()),
+                 d(ray.d.x(), ray.d.y(), ray.d.z());
+        bool found = false;
+
+        for (; record != end; ++record) {
+            /* Moeller-Trumbore test (see \ref Mesh::moeller_trumbore()) with
+               precomputed edges. Unused lanes and other primitive types have
+               zero edges, whose NaN barycentric coordinates fail all tests. */
+            Vector3P p0 = load(record->p0), e1 = load(record->e1),
+                     e2 = load(record->e2);
+
+            Vector3P pvec = dr::cross(d, e2);
+            FloatP inv_det = dr::rcp(dr::dot(e1, pvec));
+
+            Vector3P tvec = o - p0;
+            FloatP u = dr::dot(tvec, pvec) * inv_det;
+            MaskP hit = u >= 0.f && u <= 1.f;
+
+            Vector3P qvec = dr::cross(tvec, e1);
+            FloatP v = dr::dot(d, qvec) * inv_det;
+            hit &= v >= 0.f && u + v <= 1.f;
+
+            FloatP t = dr::dot(e2, qvec) * inv_det;
+            hit &= t >= 0.f && t <= ray.maxt;
+
+            if (unlikely(dr::any(hit))) {
+                if constexpr (ShadowRay) {
+                    pi.t = 0.f;
+                    return true;
+                }
+
+                t = dr::select(hit, t, dr::Infinity<FloatP>);
+                size_t j = 0;
+                for (size_t k = 1; k < 4; ++k)
+                    j = t.entry(k) < t.entry(j) ? k : j;
+
+                Index shape_index = record->shape_index[j];
+                pi.t           = t.entry(j);
+                pi.prim_uv     = ScalarPoint2f(u.entry(j), v.entry(j));
+                pi.prim_index  = record->prim_index[j];
+                pi.shape_index = shape_index;
+                pi.shape       = this->shape(shape_index);
+                pi.instance    = nullptr;
+                ray.maxt       = pi.t;
+                found          = true;
+            }
+
+            for (size_t j = 0; j < 4; ++j) {
+                if (likely(record->shape_index[j] != RecordGeneric))
+                    continue;
+
+                PreliminaryIntersection<ScalarFloat, Shape> prim_pi =
+                    intersect_prim<ShadowRay>(record->prim_index[j], ray);
+
+                if (unlikely(prim_pi.is_valid())) {
+                    if constexpr (ShadowRay) {
+                        pi = prim_pi;
+                        return true;
+                    }
+
+                    Assert(prim_pi.t >= 0.f && prim_pi.t <= ray.maxt);
+                    pi = prim_pi;
+                    ray.maxt = pi.t;
+                    found = true;
+                }
+            }
+        }
+
+        return found;
+    }
+
+protected:
+    /**
+     * \brief Four primitives of a kd-tree leaf in a structure-of-arrays layout
+     *
+     * Triangles store their first vertex and the two edges leaving it, along
+     * with their shape index and the primitive index within that shape.
+     */
+    struct alignas(4 * sizeof(ScalarFloat)) TriangleRecord {
+        ScalarFloat p0[3][4], e1[3][4], e2[3][4];
+        /// Shape index, or \ref RecordGeneric / \ref RecordEmpty
+        Index shape_index[4];
+        /// Primitive index within the shape (global index for \ref RecordGeneric)
+        Index prim_index[4];
+    };
+
+    /// Marks a lane holding a non-triangle primitive (intersected via \ref intersect_prim())
+    static constexpr Index RecordGeneric = (Index) -2;
+
+    /// Marks an unused lane
+    static constexpr Index RecordEmpty = (Index) -1;
+
+    /// Build the triangle records of all leaf nodes (see \c kd_triangle_records)
+    void build_triangle_records();
+
+protected:
+    /// Try to map a previously built kd-tree from the cache directory
+    bool cache_load(const fs::path &filename, uint64_t key);
+
+    /// Write the current kd-tree to the cache directory
+    void cache_write(const fs::path &filename, uint64_t key) const;
+
 protected:
     std::vector<ref<Shape>> m_shapes;
     std::vector<Size> m_primitive_map;
+
+    /// Directory containing cached kd-trees (caching is disabled when empty)
+    fs::path m_cache_dir;
+
+    /// Memory-mapped cache file that \c m_nodes and \c m_indices point into
+    ref<MemoryMappedFile> m_cache_file;
+
+    /// Quality profile selecting the default builder parameters
+    AccelQuality m_accel_quality;
+
+    /// Should the leaf primitives be stored as triangle records?
+    bool m_triangle_records = false;
+
+    /// Triangle records of all leaf nodes (only when \c m_triangle_records is set)
+    std::unique_ptr<TriangleRecord[]> m_records;
+
+    /// Offset of the first triangle record of each leaf node (indexed by node)
+    std::vector<Index> m_record_offset;
+
+    /// Number of triangle records
+    Size m_record_count = 0;
 };
 
 MI_EXTERN_CLASS(ShapeKDTree)
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <mitsuba/core/bbox.h>
+#include <mitsuba/core/distr_1d.h>
+#include <mitsuba/render/fwd.h>
+#include <mitsuba/render/interaction.h>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**
+ * \brief Bounding volume hierarchy over the emitters of a scene that selects
+ * emitters in proportion to their estimated contribution at a reference point
+ *
+ * Every node of the tree stores conservative bounds of the emitters below it:
+ * an axis-aligned bounding box, a cone bounding their surface normals
+ * (axis and half-angle \f$\theta_o\f$), the half-angle \f$\theta_e\f$ of the
+ * emission profile around those normals, and their total emitted power. When
+ * selecting an emitter for a reference point, the tree is traversed from the
+ * root while choosing each child with a probability proportional to an
+ * importance estimate derived from these bounds, following "Importance
+ * Sampling of Many Lights with Adaptive Tree Splitting" by Conty Estevez and
+ * Kulla (2018) in the formulation of PBRT v4. The same
+ * estimate is evaluated when computing the probability of a given emitter,
+ * hence both directions remain consistent for multiple importance sampling.
+ *
+ * The importance of a node is zero only if none of its emitters can
+ * illuminate the reference point, so emitter sampling remains unbiased.
+ * Bounds that cannot be determined exactly (e.g. the normals of curved
+ * analytic shapes) fall back to the full sphere of directions.
+ *
+ * Emitters at infinity (environment maps, directional lights) cannot be
+ * bounded spatially. They are kept outside of the tree and are selected with
+ * a fixed probability, in proportion to their sampling weights.
+ */
+MI_VARIANT
+class MI_EXPORT_LIB LightTree : public Object {
+public:
+    MI_IMPORT_TYPES(Emitter, EmitterPtr, Mesh)
+    using FloatStorage  = DynamicBuffer<Float>;
+    using UInt32Storage = DynamicBuffer<UInt32>;
+
+    /**
+     * \brief Build a light tree over a list of emitters
+     *
+     * The index of an emitter in this list is used to refer to it in the
+     * remainder of the interface. It must match the \ref
+     * Emitter::scene_index() of the emitter.
+     */
+    LightTree(const std::vector<ref<Emitter>> &emitters);
+
+    /**
+     * \brief Select an emitter in proportion to its estimated contribution at
+     * a reference point
+     *
+     * \param ref
+     *    The reference point. Its normal (if nonzero) is accounted for when
+     *    estimating the contribution of emitters.
+     *
+     * \param sample
+     *    A uniformly distributed sample on <tt>[0, 1]</tt>.
+     *
+     * \return
+     *    The index of the chosen emitter, the reused sample, and the
+     *    probability of choosing this emitter. The latter is zero if no
+     *    emitter can contribute to the reference point.
+     */
+    std::tuple<UInt32, Float, Float> sample_emitter(const Interaction3f &ref,
+                                                    Float sample,
+                                                    Mask active = true) const;
+
+    /// Return the probability of choosing an emitter with \ref sample_emitter()
+    Float pdf_emitter(const Interaction3f &ref, UInt32 index,
+                      Mask active = true) const;
+
+    /// Return the number of emitters in the tree (excluding those at infinity)
+    size_t emitter_count() const { return m_emitter_count; }
+
+    /// Return the number of nodes of the tree
+    size_t node_count() const { return m_node_count; }
+
+    /// Return the maximum depth of the tree
+    uint32_t depth() const { return m_depth; }
+
+    /// Return a human-readable summary of this light tree
+    std::string to_string() const override;
+
+    MI_DECLARE_CLASS()
+
+protected:
+    /// Bounds of a set of emitters (see the class description)
+    struct LightBounds {
+        ScalarBoundingBox3f bbox;
+        ScalarVector3f axis { 0.f, 0.f, 1.f };
+        ScalarFloat cos_theta_o = 1.f;
+        ScalarFloat cos_theta_e = 1.f;
+        ScalarFloat power = 0.f;
+
+        /// Merge two bounds
+        static LightBounds merge(const LightBounds &a, const LightBounds &b);
+
+        /// Cost of a set of emitters for the surface area orientation heuristic
+        ScalarFloat cost(const ScalarBoundingBox3f &parent, uint32_t axis) const;
+    };
+
+    /// Estimate the bounds of every emitter that is not at infinity
+    std::vector<LightBounds> estimate_bounds(const std::vector<ref<Emitter>> &emitters,
+                                             const std::vector<uint32_t> &finite) const;
+
+    /**
+     * \brief Compute a cone bounding the normals of a mesh
+     *
+     * Returns the axis and the cosine of the half-angle of the cone, which is
+     * -1 if the normals cannot be bounded by a cone of at most 90 degrees.
+     */
+    std::pair<ScalarVector3f, ScalarFloat> mesh_normal_cone(const Mesh *mesh) const;
+
+    /**
+     * \brief Recursively build the subtree over <tt>lights[start, end)</tt>
+     * and store it in node \c index
+     */
+    void build(std::vector<std::pair<uint32_t, LightBounds>> &lights,
+               uint32_t start, uint32_t end, uint32_t index, uint32_t depth,
+               std::vector<LightBounds> &bounds, std::vector<uint32_t> &child,
+               std::vector<uint32_t> &parent);
+
+    /// Importance estimate of a node at a reference point
+    Float importance(const UInt32 &node, const Point3f &p, const Normal3f &n,
+                     Mask active) const;
+
+protected:
+    /// Per node: 3 x 4 floats with the bounds (see \ref importance())
+    FloatStorage m_nodes;
+
+    /**
+     * Per node: index of the first child (the second one follows directly),
+     * or the emitter index with the highest bit set for leaves
+     */
+    UInt32Storage m_node_child;
+
+    /// Per node: index of the parent node
+    UInt32Storage m_node_parent;
+
+    /// Per emitter: index of its leaf node, or an invalid index (infinite emitters)
+    UInt32Storage m_emitter_leaf;
+
+    /// Per emitter: probability of choosing an infinite emitter (zero otherwise)
+    FloatStorage m_infinite_pmf;
+
+    /// Index of every infinite emitter in the list of emitters
+    UInt32Storage m_infinite_index;
+
+    /// Distribution over the infinite emitters
+    DiscreteDistribution<Float> m_infinite_distr;
+
+    /// Probability of choosing an infinite emitter instead of the tree
+    ScalarFloat m_infinite_prob;
+
+    size_t m_emitter_count;
+    size_t m_node_count;
+    uint32_t m_depth;
+};
+
+MI_EXTERN_CLASS(LightTree)
+NAMESPACE_END(mitsuba)
@@ -11,7 +11,7 @@ NAMESPACE_BEGIN(mitsuba)
 template <typename Float, typename Spectrum>
 class MI_EXPORT_LIB Medium : public Object {
 public:
-    MI_IMPORT_TYPES(PhaseFunction, Sampler, Scene, Texture);
+    MI_IMPORT_TYPES(PhaseFunction, Sampler, Scene, Texture, Volume);
 
     /// Destructor
     ~Medium();
@@ -46,6 +46,13 @@ public:
      * free-flight distance. This argument is only used when rendering in RGB
      * modes.
      *
+     * When the medium provides a majorant supergrid (see \ref
+     * update_majorant_grid()), the distance is sampled with respect to the
+     * piecewise constant majorant along the ray, which is found by traversing
+     * the grid cells using a 3D DDA. The \c combined_extinction field of the
+     * returned interaction then holds the local majorant at the sampled
+     * position.
+     *
      * \return         This method returns a MediumInteraction.
      *                 The MediumInteraction will always be valid,
      *                 except if the ray missed the Medium's bounding box.
@@ -89,6 +96,11 @@ public:
         return m_has_spectral_extinction;
     }
 
+    /// Returns the resolution of the majorant supergrid (zero if unused)
+    MI_INLINE ScalarVector3i majorant_resolution() const {
+        return m_majorant_resolution;
+    }
+
     void traverse(TraversalCallback *callback) override;
 
     /// Return a string identifier
@@ -106,10 +118,41 @@ protected:
     Medium();
     Medium(const Properties &props);
 
+    /**
+     * \brief (Re-)build the majorant supergrid from the given volume
+     *
+     * Each cell of the grid (which spans the bounding box of \c volume and
+     * has resolution \ref m_majorant_resolution) stores an upper bound of
+     * <tt>scale * volume</tt> within the cell. Does nothing when the
+     * resolution is zero.
+     */
+    void update_majorant_grid(const Volume *volume, ScalarFloat scale);
+
+    /// Look up the majorant supergrid at the given world-space position
+    Float eval_majorant_grid(const Point3f &p, Mask active) const;
+
+    /**
+     * \brief Sample a free-flight distance with respect to the piecewise
+     * constant majorant of the supergrid
+     *
+     * Returns the sampled distance (infinity if it lies beyond \c maxt) and
+     * the majorant of the cell containing it.
+     */
+    std::pair<Float, Float> sample_majorant_grid(const Ray3f &ray, Float sample,
+                                                 Float mint, Float maxt,
+                                                 Mask active) const;
+
 protected:
     ref<PhaseFunction> m_phase_function;
     bool m_sample_emitters, m_is_homogeneous, m_has_spectral_extinction;
 
+    /// Coarse grid of local majorants ("supergrid"), empty if unused
+    DynamicBuffer<Float> m_majorant_grid;
+    /// Resolution of the majorant supergrid (zero if unused)
+    ScalarVector3i m_majorant_resolution { 0, 0, 0 };
+    /// World-space region covered by the majorant supergrid
+    ScalarBoundingBox3f m_majorant_bbox;
+
     /// Identifier (if available)
     std::string m_id;
 };
@@ -7,6 +7,7 @@
 #include <mitsuba/core/transform.h>
 #include <mitsuba/core/distr_1d.h>
 #include <mitsuba/core/properties.h>
+#include <functional>
 #include <unordered_map>
 #include <mutex>
 #include <drjit/dynamic.h>
@@ -195,6 +196,26 @@ public:
      */
     void write_ply(Stream *stream) const;
 
+    /**
+     * Write the mesh to an uncompressed binary file that the \c mmesh
+     * plugin maps directly into memory when loading it
+     *
+     * This can be used to convert meshes loaded from other formats (e.g.
+     * <tt>.serialized</tt>, PLY or OBJ files).
+     *
+     * \param filename
+     *    Target file path on disk
+     */
+    void write_mmesh(const std::string &filename) const;
+
+    /**
+     * Write the mesh encoded in the format of the \c mmesh plugin to a stream
+     *
+     * \param stream
+     *    Target stream that will receive the encoded output
+     */
+    void write_mmesh(Stream *stream) const;
+
     /// Merge two meshes into one
     ref<Mesh> merge(const Mesh *other) const;
 
@@ -353,6 +374,44 @@ public:
         return ray_intersect_triangle_impl<ScalarFloat>(index, ray, true);
     }
 
+    /**
+     * \brief Intersect a packet of rays against a single triangle
+     *
+     * In contrast to \ref ray_intersect_triangle_packet(), the triangle index
+     * is uniform across the packet. Its vertices are therefore only fetched
+     * once and broadcast to all lanes, which is the situation encountered when
+     * a ray packet traverses a kd-tree leaf.
+     */
+    template <typename FloatP, typename Ray3P>
+    MI_INLINE std::pair<FloatP, Point<FloatP, 2>>
+    ray_intersect_triangle_broadcast(ScalarUInt32 index, const Ray3P &ray,
+                                     dr::mask_t<FloatP> active = true) const {
+        using Faces = dr::Array<ScalarUInt32, 3>;
+        using Point3P = Point<FloatP, 3>;
+
+        Faces fi;
+        ScalarPoint3f p0, p1, p2;
+#if defined(MI_ENABLE_LLVM) && !defined(MI_ENABLE_EMBREE)
+        // Ensure we don't rely on drjit-core when called from an LLVM kernel
+        if constexpr (dr::is_llvm_v<Float>) {
+            fi = dr::gather<Faces>(m_faces_ptr, index);
+            p0 = dr::gather<InputPoint3f>(m_vertex_positions_ptr, fi[0]),
+            p1 = dr::gather<InputPoint3f>(m_vertex_positions_ptr, fi[1]),
+            p2 = dr::gather<InputPoint3f>(m_vertex_positions_ptr, fi[2]);
+        } else
+#endif
+        {
+            fi = face_indices(index);
+            p0 = vertex_position(fi[0]),
+            p1 = vertex_position(fi[1]),
+            p2 = vertex_position(fi[2]);
+        }
+
+        auto [t, uv, hit] = moeller_trumbore(ray, Point3P(p0), Point3P(p1),
+                                             Point3P(p2), active);
+        return { dr::select(hit, t, dr::Infinity<FloatP>), uv };
+    }
+
 #define MI_DECLARE_RAY_INTERSECT_TRI_PACKET(N)                            \
     using FloatP##N   = dr::Packet<dr::scalar_t<Float>, N>;                \
     using MaskP##N    = dr::mask_t<FloatP##N>;                             \
@@ -374,6 +433,15 @@ public:
 #if defined(MI_ENABLE_EMBREE)
     /// Return the Embree version of this shape
     RTCGeometry embree_geometry(RTCDevice device) override;
+
+    /**
+     * \brief Update the Embree geometry after the vertex positions changed
+     *
+     * The vertex buffer is swapped and the BVH of the mesh is refitted. Other
+     * changes (e.g. of the faces or of the vertex count) require a new
+     * geometry.
+     */
+    bool embree_update_geometry(RTCGeometry geom) override;
 #endif
 
 #if defined(MI_ENABLE_CUDA)
@@ -428,6 +496,29 @@ protected:
      */
     void build_parameterization();
 
+    /**
+     * \brief Load the geometry of the mesh through the \ref ResourceCache
+     *
+     * Meshes loaded from the same file with the same options share their
+     * buffers, which avoids parsing the file again when it is instantiated
+     * several times (e.g. with different \c to_world transformations).
+     *
+     * On a cache miss, \c load is invoked to read the file. It must fill in
+     * the buffers, attributes, and bounding box of the mesh in world space
+     * (i.e. transformed by \c m_to_world) and return whether the vertex
+     * normals were computed from the geometry rather than read from the file.
+     * On a hit, the cached buffers are reused and transformed when the
+     * \c to_world transformation of this mesh differs from the cached one.
+     *
+     * \param path
+     *    Resolved path of the mesh file
+     *
+     * \param options
+     *    Description of the loader options that affect the geometry
+     */
+    void load_cached(const fs::path &path, const std::string &options,
+                     const std::function<bool()> &load);
+
     // Ensures that the sampling table are ready.
     DRJIT_INLINE void ensure_pmf_built() const {
         if (unlikely(m_area_pmf.empty()))
@@ -497,6 +588,9 @@ protected:
         }
     };
 
+    /// Geometry shared between meshes through the \ref ResourceCache
+    struct CachedGeometry;
+
     template <uint32_t Size, bool Raw>
     auto interpolate_attribute(MeshAttributeType type,
                                const FloatStorage &buf,
@@ -577,6 +671,11 @@ protected:
     mutable void* m_vertex_buffer_ptr = nullptr;
 #endif
 
+#if defined(MI_ENABLE_EMBREE)
+    /// Did the faces or the vertex count change since the Embree geometry was created?
+    bool m_embree_topology_dirty = false;
+#endif
+
     /// Flag that can be set by the user to disable loading/computation of vertex normals
     bool m_face_normals = false;
     bool m_flip_normals = false;
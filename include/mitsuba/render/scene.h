@@ -3,6 +3,7 @@
 #include <mitsuba/core/distr_1d.h>
 #include <mitsuba/core/spectrum.h>
 #include <mitsuba/render/emitter.h>
+#include <mitsuba/render/lighttree.h>
 #include <mitsuba/render/shapegroup.h>
 #include <mitsuba/render/fwd.h>
 #include <mitsuba/render/sensor.h>
@@ -38,7 +39,7 @@ class MI_EXPORT_LIB Scene : public Object {
 public:
     MI_IMPORT_TYPES(BSDF, Emitter, EmitterPtr, SensorPtr, Film, Sampler, Shape,
                     ShapePtr, ShapeGroup, Sensor, Integrator, Medium, MediumPtr,
-                    Mesh)
+                    Mesh, LightTree)
 
     /// Instantiate a scene from a \ref Properties object
     Scene(const Properties &props);
@@ -355,6 +356,10 @@ public:
      * the sampled emitter position. However, approximations are acceptable as
      * long as these are reflected in the returned Monte Carlo sampling weight.
      *
+     * When the scene uses a light tree (see \ref light_tree()), the emitter
+     * is chosen in proportion to an estimate of its contribution at \c ref.
+     * Otherwise, it is chosen in proportion to the emitters' sampling weights.
+     *
      * \param ref
      *    A 3D reference location within the scene, which may influence the
      *    sampling process.
@@ -514,6 +519,9 @@ public:
     /// Return the environment emitter (if any)
     const Emitter *environment() const { return m_environment.get(); }
 
+    /// Return the light tree used to choose emitters for direct illumination (if any)
+    const LightTree *light_tree() const { return m_light_tree.get(); }
+
     /// Return the list of shapes
     std::vector<ref<Shape>> &shapes() { return m_shapes; }
     /// Return the list of shapes
@@ -599,6 +607,7 @@ protected:
     MI_INLINE Mask ray_test_gpu(const Ray3f &ray, Mask active) const;
 
     using ShapeKDTree = mitsuba::ShapeKDTree<Float, Spectrum>;
+    using ShapeBVH = mitsuba::ShapeBVH<Float, Spectrum>;
 
     /// Updates the discrete distribution used to select an emitter
     void update_emitter_sampling_distribution();
@@ -630,6 +639,8 @@ protected:
 
     ScalarFloat m_emitter_pmf;
     std::unique_ptr<DiscreteDistribution<Float>> m_emitter_distr = nullptr;
+    std::string m_emitter_sampling;
+    ref<LightTree> m_light_tree;
 
     std::vector<ref<Shape>> m_silhouette_shapes;
     DynamicBuffer<ShapePtr> m_silhouette_shapes_dr;
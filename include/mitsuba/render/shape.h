@@ -40,6 +40,25 @@ enum class ShapeType : uint32_t {
 };
 MI_DECLARE_ENUM_OPERATORS(ShapeType)
 
+/**
+ * \brief Quality profile of acceleration data structures (scene parameter
+ * \c accel_quality)
+ *
+ * Lower profiles trade traversal performance for faster construction, which
+ * pays off when only few rays are traced (e.g. for interactive previews).
+ */
+enum class AccelQuality : uint32_t {
+    /// Fastest build: cheap heuristics and shallow trees
+    Low = 0u,
+    /// Compromise between build and traversal performance
+    Medium = 1u,
+    /// Best traversal performance (default)
+    High = 2u
+};
+
+/// Parse an acceleration data structure quality profile ("low", "medium" or "high")
+extern MI_EXPORT_LIB AccelQuality parse_accel_quality(const std::string &name);
+
 /**
  * \brief This list of flags is used to control the behavior of discontinuity
  * related routines.
@@ -838,6 +857,16 @@ public:
 #if defined(MI_ENABLE_EMBREE)
     /// Return the Embree version of this shape
     virtual RTCGeometry embree_geometry(RTCDevice device);
+
+    /**
+     * \brief Update an Embree geometry previously created by \ref
+     * embree_geometry() after a parameter change
+     *
+     * Returns \c false if the geometry cannot be updated in place, in which
+     * case the caller creates a new one. This is what the default
+     * implementation does.
+     */
+    virtual bool embree_update_geometry(RTCGeometry geom);
 #endif
 
 #if defined(MI_ENABLE_CUDA)
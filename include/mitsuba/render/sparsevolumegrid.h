@@ -0,0 +1,150 @@
+#pragma once
+
+#include <mitsuba/core/bbox.h>
+#include <mitsuba/core/transform.h>
+#include <mitsuba/render/fwd.h>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**
+ * \brief Sparse two-level storage of 3D volume grids
+ *
+ * The voxels of the grid are partitioned into cubic bricks of
+ * <tt>brick_size^3</tt> voxels. A dense top-level index with one entry per
+ * brick ("tile") refers to a pool that only stores the bricks containing at
+ * least one value whose magnitude exceeds a threshold. All other tiles refer
+ * to brick 0, which is reserved and always stores zeros. This allows lookups
+ * to resolve any voxel with two gathers and without branching, while volumes
+ * that are mostly empty (e.g. smoke and explosion simulations) only pay for
+ * the regions that actually contain data.
+ *
+ * Within the pool, the data of brick \c b is ordered so that the following
+ * C-style indexing operation makes sense:
+ * <tt>bricks[((b * brick_size + z) * brick_size + y) * brick_size + x) * channels + chan]</tt>
+ *
+ * Sparse grids can be converted from a dense \ref VolumeGrid or loaded from
+ * the sparse volume file format (see the documentation of the
+ * sparsegridvolume plugin for its specification).
+ */
+MI_VARIANT
+class MI_EXPORT_LIB SparseVolumeGrid : public Object {
+public:
+    MI_IMPORT_TYPES(VolumeGrid)
+
+    /**
+     * \brief Load a SparseVolumeGrid from a given filename
+     *
+     * Both the sparse format and the dense Mitsuba volume format (".vol") are
+     * supported. Dense files are converted using a threshold of zero.
+     */
+    SparseVolumeGrid(const fs::path &path);
+
+    /// Load a SparseVolumeGrid (sparse format only) from a stream
+    SparseVolumeGrid(Stream *stream);
+
+    /**
+     * \brief Convert a dense volume grid into sparse storage
+     *
+     * \param grid
+     *    The dense volume grid
+     *
+     * \param threshold
+     *    Bricks whose values all have a magnitude of at most \c threshold
+     *    are discarded and will evaluate to zero.
+     *
+     * \param brick_size
+     *    Number of voxels along each side of a brick
+     */
+    SparseVolumeGrid(const VolumeGrid *grid, ScalarFloat threshold = 0.f,
+                     uint32_t brick_size = 8);
+
+    /// Return the resolution of the voxel grid
+    ScalarVector3u size() const { return m_size; }
+
+    /// Return the number of channels
+    size_t channel_count() const { return m_channel_count; }
+
+    /// Return the number of voxels along each side of a brick
+    uint32_t brick_size() const { return m_brick_size; }
+
+    /// Return the number of tiles (i.e. potential bricks) along each axis
+    ScalarVector3u tile_count() const { return m_tile_count; }
+
+    /// Return the number of stored bricks (including the reserved empty one)
+    size_t brick_count() const { return m_brick_max.size(); }
+
+    /// Return the bounding box stored in the volume file
+    const ScalarBoundingBox3f &bbox() const { return m_bbox; }
+
+    /// Estimates the transformation from a unit axis-aligned bounding box to the given one.
+    ScalarTransform4f bbox_transform() const {
+        auto scale_transf = ScalarTransform4f::scale(dr::rcp(m_bbox.extents()));
+        auto translation  = ScalarTransform4f::translate(-m_bbox.min);
+        return scale_transf * translation;
+    }
+
+    /// Return the top-level index mapping every tile to a brick
+    const uint32_t *tiles() const { return m_tiles.get(); }
+
+    /// Return a pointer to the brick pool
+    const ScalarFloat *bricks() const { return m_bricks.get(); }
+
+    /// Return the maximum over all channels of every stored brick
+    const ScalarFloat *brick_max() const { return m_brick_max.data(); }
+
+    /// Return the maximum over all channels of the brick referenced by each tile
+    std::vector<ScalarFloat> tile_max() const;
+
+    /// Return the precomputed maximum over the volume grid
+    ScalarFloat max() const { return m_max; }
+
+    /**
+     * \brief Return the precomputed maximum over the volume grid per channel
+     *
+     * Pointer allocation/deallocation must be performed by the caller.
+     */
+    void max_per_channel(ScalarFloat *out) const;
+
+    /// Return the memory used by the tile index and brick pool in bytes
+    size_t buffer_size() const;
+
+    /// Expand the sparse grid back into a dense volume grid
+    ref<VolumeGrid> to_dense() const;
+
+    /// Write the sparse grid to a binary file
+    void write(const fs::path &path) const;
+
+    /// Write the sparse grid to a stream
+    void write(Stream *stream) const;
+
+    /// Return a human-readable summary of this sparse volume grid
+    std::string to_string() const override;
+
+    MI_DECLARE_CLASS()
+
+protected:
+    /// Convert a dense volume grid (see the corresponding constructor)
+    void build(const VolumeGrid *grid, ScalarFloat threshold, uint32_t brick_size);
+
+    /// Read a sparse volume file from a stream
+    void read(Stream *stream);
+
+    /// Compute the per-brick and global maxima
+    void update_max();
+
+protected:
+    std::unique_ptr<uint32_t[]> m_tiles;
+    std::unique_ptr<ScalarFloat[]> m_bricks;
+    std::vector<ScalarFloat> m_brick_max;
+
+    ScalarVector3u m_size;
+    ScalarVector3u m_tile_count;
+    uint32_t m_brick_size;
+    uint32_t m_channel_count;
+    ScalarBoundingBox3f m_bbox;
+    ScalarFloat m_max;
+    std::vector<ScalarFloat> m_max_per_channel;
+};
+
+MI_EXTERN_CLASS(SparseVolumeGrid)
+NAMESPACE_END(mitsuba)
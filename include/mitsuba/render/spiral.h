@@ -4,7 +4,8 @@
 #include <mitsuba/core/spectrum.h>
 #include <mitsuba/render/film.h>
 #include <mitsuba/render/imageblock.h>
-#include <mutex>
+#include <atomic>
+#include <vector>
 
 #if !defined(MI_BLOCK_SIZE)
 #  define MI_BLOCK_SIZE 32
@@ -15,6 +16,11 @@ NAMESPACE_BEGIN(mitsuba)
 /**
  * \brief Generates a spiral of blocks to be rendered.
  *
+ * The spiral traversal order is computed once at construction time, which
+ * allows \ref next_block() to hand out blocks using a single atomic counter
+ * instead of a lock. This matters when many worker threads request small
+ * blocks at a high rate.
+ *
  * \author Adam Arbree
  * Aug 25, 2005
  * RayTracer.java
@@ -40,13 +46,20 @@ public:
     /// Return the total number of blocks
     uint32_t block_count() { return m_block_count; }
 
-    /// Reset the spiral to its initial state. Does not affect the number of passes.
+    /**
+     * \brief Reset the spiral to its initial state. Does not affect the number
+     * of passes.
+     *
+     * This function must not be called while other threads are concurrently
+     * invoking \ref next_block().
+     */
     void reset();
 
     /**
      * \brief Return the offset, size, and unique identifier of the next block.
      *
-     * A size of zero indicates that the spiral traversal is done.
+     * A size of zero indicates that the spiral traversal is done. This
+     * function is lock-free and may be called concurrently from many threads.
      */
     std::tuple<Vector2i, Vector2u, uint32_t> next_block();
 
@@ -54,18 +67,14 @@ public:
 protected:
     enum class Direction { Right, Down, Left, Up };
 
-    std::mutex m_mutex;       //< Protects the state for thread safety
-    Vector2u m_size;          //< Size of the 2D image (in pixels)
-    Vector2u m_offset;        //< Offset to the crop region on the sensor (pixels)
-    Vector2u m_blocks;        //< Number of blocks in each direction
-    Point2i  m_position;      //< Relative position of the current block
-    Direction direction;      //< Current spiral direction
-    uint32_t m_block_counter; //< Number of blocks generated so far
-    uint32_t m_block_count;   //< Number of blocks to be generated in pass
-    uint32_t m_passes_left;   //< Remaining spiral passes to be generated
-    uint32_t m_block_size;    //< Size of the (square) blocks (in pixels)
-    uint32_t m_steps_left;    //< Steps before next change of direction
-    uint32_t m_spiral_size;   //< Current spiral size in blocks
+    std::vector<uint32_t> m_order;          //< Linear block indices in spiral order
+    std::atomic<uint32_t> m_block_counter;  //< Number of blocks generated so far (all passes)
+    Vector2u m_size;                        //< Size of the 2D image (in pixels)
+    Vector2u m_offset;                      //< Offset to the crop region on the sensor (pixels)
+    Vector2u m_blocks;                      //< Number of blocks in each direction
+    uint32_t m_block_count;                 //< Number of blocks to be generated in pass
+    uint32_t m_passes;                      //< Total number of spiral passes to be generated
+    uint32_t m_block_size;                  //< Size of the (square) blocks (in pixels)
 };
 
 NAMESPACE_END(mitsuba)
@@ -216,6 +216,13 @@ public:
     /// Does this texture evaluation depend on the UV coordinates
     virtual bool is_spatially_varying() const { return false; }
 
+    /**
+     * \brief Does this texture require texture-space differentials
+     * (\ref SurfaceInteraction::duv_dx and \ref SurfaceInteraction::duv_dy),
+     * e.g. to perform filtered lookups?
+     */
+    virtual bool needs_differentials() const { return false; }
+
     /// Convenience function returning the standard D65 illuminant
     static ref<Texture> D65(ScalarFloat scale = 1.f);
 
@@ -63,6 +63,23 @@ public:
      */
     virtual void max_per_channel(ScalarFloat *out) const;
 
+    /**
+     * \brief Compute conservative upper bounds of the volume over the cells
+     * of a regular grid
+     *
+     * The grid subdivides the bounding box \ref bbox() of the volume into
+     * <tt>resolution.x() * resolution.y() * resolution.z()</tt> cells. For
+     * each cell, the function returns a value that bounds the volume (over
+     * all channels) at any position within that cell. The output is stored
+     * in row-major order, i.e. <tt>out[(z * res.y() + y) * res.x() + x]</tt>.
+     *
+     * The default implementation assigns \ref max() to every cell.
+     *
+     * Pointer allocation/deallocation must be performed by the caller.
+     */
+    virtual void max_per_cell(const ScalarVector3i &resolution,
+                              ScalarFloat *out) const;
+
     /// Returns the bounding box of the volume
     ScalarBoundingBox3f bbox() const { return m_bbox; }
 
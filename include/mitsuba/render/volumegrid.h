@@ -59,6 +59,12 @@ public:
     /// Return the number of channels
     size_t channel_count() const { return m_channel_count; }
 
+    /// Return the bounding box stored in the volume file
+    const ScalarBoundingBox3f &bbox() const { return m_bbox; }
+
+    /// Set the bounding box that will be stored in the volume file
+    void set_bbox(const ScalarBoundingBox3f &bbox) { m_bbox = bbox; }
+
     /// Return the precomputed maximum over the volume grid
     ScalarFloat max() const { return m_max; }
 
@@ -110,8 +116,15 @@ public:
     MI_DECLARE_CLASS()
 
 protected:
+    /// Read a volume file (header and payload) from a stream
     void read(Stream *stream);
 
+    /// Read the header of a volume file, leaving the stream at the payload
+    void read_header(Stream *stream);
+
+    /// Update the maximum and log statistics after loading the voxel data
+    void finish_read(size_t time_ms);
+
 protected:
     std::unique_ptr<ScalarFloat[]> m_data;
 
@@ -0,0 +1,395 @@
+#!/usr/bin/env python3
+'''
+Performance benchmarks of Mitsuba's acceleration data structures and loaders
+
+The test suite only checks the behavior of these components. This script
+measures their speed and is meant to be run on demand, e.g. before and after
+a change::
+
+    python resources/benchmark.py                  # Run all benchmarks
+    python resources/benchmark.py packet_traversal # Run selected benchmarks
+    python resources/benchmark.py --list           # List the benchmarks
+
+Every benchmark prints one line per measurement. Pass ``--log-level info`` to
+also see the statistics that Mitsuba reports while building (e.g. the SAH
+cost of kd-trees, or the memory used by their triangle records).
+'''
+
+import argparse
+import os
+import sys
+import tempfile
+import time
+
+import drjit as dr
+import mitsuba as mi
+import numpy as np
+
+BENCHMARKS = {}
+
+def benchmark(variant, native=False):
+    '''
+    Register a benchmark, which runs in the given variant. Benchmarks of the
+    native acceleration data structures set ``native``, and are skipped when
+    Mitsuba uses Embree.
+    '''
+    def decorator(func):
+        BENCHMARKS[func.__name__] = (variant, native, func)
+        return func
+    return decorator
+
+
+class Timer:
+    '''Context manager that measures the wall-clock time of its body'''
+    def __enter__(self):
+        self.start = time.perf_counter()
+        return self
+
+    def __exit__(self, *args):
+        self.value = time.perf_counter() - self.start
+
+
+def create_triangle_soup(n_triangles, seed=0):
+    '''Randomly placed and oriented small triangles inside the unit cube'''
+    rng = np.random.default_rng(seed)
+    size = 2.0 / n_triangles ** (1.0 / 3.0)
+    centers = rng.random((n_triangles, 1, 3), dtype=np.float32)
+    offsets = (rng.random((n_triangles, 3, 3), dtype=np.float32) - 0.5) * size
+
+    m = mi.Mesh('soup', 3 * n_triangles, n_triangles)
+    params = mi.traverse(m)
+    params['vertex_positions'] = mi.TensorXf((centers + offsets).ravel()).array
+    params['faces'] = mi.TensorXf(
+        np.arange(3 * n_triangles, dtype=np.float32)).array
+    params.update()
+    return m
+
+
+# ------------------------------------------------------------------------------
+
+
+@benchmark('llvm_ad_rgb', native=True)
+def packet_traversal():
+    '''Single-ray versus packet traversal of the native kd-tree'''
+    for packet in [False, True]:
+        props = mi.Properties('scene')
+        props['_unnamed_0'] = create_triangle_soup(1000000)
+        props['kd_packet_traversal'] = packet
+        scene = mi.Scene(props)
+
+        n = 1024
+        idx = dr.arange(mi.UInt32, n * n)
+        u = (mi.Float(idx % n) + .5) / n
+        v = (mi.Float(idx // n) + .5) / n
+        sampler = mi.load_dict({'type': 'independent'})
+        sampler.seed(0, n * n)
+
+        # Coherent primary rays, and incoherent rays bouncing off their hits
+        primary = mi.Ray3f(mi.Point3f(u, v, -1), mi.Vector3f(0, 0, 1))
+        si = scene.ray_intersect(primary)
+        d = si.to_world(mi.warp.square_to_cosine_hemisphere(sampler.next_2d()))
+        o = dr.select(si.is_valid(), si.p, 0.5)
+        diffuse = mi.Ray3f(o + d * 1e-4, d)
+        dr.eval(primary, diffuse)
+
+        for kind, ray in [('primary', primary), ('diffuse', diffuse)]:
+            with Timer() as timer:
+                pi = scene.ray_intersect_preliminary(ray)
+                dr.eval(pi)
+                dr.sync_thread()
+            print('  packet=%s, %s rays: %.1f Mrays/s' %
+                  (packet, kind, n * n / timer.value * 1e-6))
+
+
+@benchmark('scalar_rgb', native=True)
+def kdtree_build():
+    '''Build time of the kd-tree and of the BVH on large triangle soups'''
+    for n_triangles in [1000000, 10000000]:
+        mesh = create_triangle_soup(n_triangles)
+        for accel_type in ['kdtree', 'bvh']:
+            props = mi.Properties('scene')
+            props['_unnamed_0'] = mesh
+            props['accel_type'] = accel_type
+            with Timer() as timer:
+                mi.Scene(props)
+            print('  %s, %i triangles: %.2f s' %
+                  (accel_type, n_triangles, timer.value))
+
+
+@benchmark('scalar_rgb')
+def volumegrid_load():
+    '''Load throughput of a 1024^3 volume grid from a path and from a stream'''
+    res = 1024
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        filename = os.path.join(tmp_dir, 'grid.vol')
+        data = np.zeros((res, res, res, 1), dtype=np.float32)
+        data[res // 2, res // 3, res // 4, 0] = 2.5
+        mi.VolumeGrid(data).write(filename)
+        del data
+
+        for source in ['path', 'stream']:
+            with Timer() as timer:
+                if source == 'path':
+                    grid = mi.VolumeGrid(filename)
+                else:
+                    stream = mi.FileStream(filename)
+                    grid = mi.VolumeGrid(stream)
+                    stream.close()
+            print('  %s: %.2f s (%.2f GiB/s)' %
+                  (source, timer.value, res**3 * 4 / timer.value / 2**30))
+            del grid
+
+
+@benchmark('scalar_rgb', native=True)
+def instance_refit():
+    '''Per-frame update time when moving n x n instances of a large mesh'''
+    T = mi.ScalarTransform4f
+    for n in [10, 100]:
+        scene = {
+            'type': 'scene',
+            'group': {
+                'type': 'shapegroup',
+                'shape': create_triangle_soup(100000)
+            },
+            'static': create_triangle_soup(1000000, seed=1)
+        }
+        for i in range(n * n):
+            scene[f'inst_{i}'] = {
+                'type': 'instance',
+                'group': { 'type': 'ref', 'id': 'group' },
+                'to_world': T().translate([i % n, i // n, 0])
+            }
+        scene = mi.load_dict(scene)
+        params = mi.traverse(scene)
+
+        frames = 10
+        with Timer() as timer:
+            for frame in range(frames):
+                for i in range(n * n):
+                    params[f'inst_{i}.to_world'] = \
+                        T().translate([i % n, i // n, 0.1 * frame])
+                params.update()
+        print('  %i instances: %.2f ms per frame' %
+              (n * n, timer.value / frames * 1000))
+
+
+@benchmark('scalar_rgb')
+def mmesh_load():
+    '''Load time of a 2M triangle grid from PLY and mmesh files'''
+    n = 1024
+    x, y = np.meshgrid(np.linspace(0, 1, n, dtype=np.float32),
+                       np.linspace(0, 1, n, dtype=np.float32))
+    positions = np.stack([x.ravel(), y.ravel(), np.zeros(n * n, np.float32)], axis=1)
+    i = np.arange(n * n, dtype=np.uint32).reshape(n, n)[:-1, :-1].ravel()
+    faces = np.concatenate([np.stack([i, i + 1, i + n], axis=1),
+                            np.stack([i + 1, i + n + 1, i + n], axis=1)])
+
+    m = mi.Mesh('grid', n * n, len(faces))
+    params = mi.traverse(m)
+    params['vertex_positions'] = positions.ravel()
+    params['faces'] = faces.ravel()
+    params.update()
+    m.recompute_vertex_normals()
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        for mesh_format in ['ply', 'mmesh']:
+            filename = os.path.join(tmp_dir, 'grid.' + mesh_format)
+            getattr(m, 'write_' + mesh_format)(filename)
+            with Timer() as timer:
+                mi.load_dict({ 'type': mesh_format, 'filename': filename })
+            print('  %s: %.1f ms' % (mesh_format, timer.value * 1000))
+
+
+@benchmark('scalar_rgb')
+def update_single_mesh():
+    '''Update time when one of n meshes deforms, compared to all of them'''
+    T = mi.ScalarTransform4f
+    for n in [10, 100, 1000]:
+        scene = { 'type': 'scene' }
+        for i in range(n):
+            scene[f'cube_{i}'] = {
+                'type': 'cube',
+                'to_world': T().translate([3 * i, 0, 0])
+            }
+        scene = mi.load_dict(scene)
+        params = mi.traverse(scene)
+
+        frames = 10
+        for deforming in [[0], range(n)]:
+            with Timer() as timer:
+                for frame in range(frames):
+                    for i in deforming:
+                        positions = params[f'cube_{i}.vertex_positions']
+                        positions[2] += 0.01
+                        params[f'cube_{i}.vertex_positions'] = positions
+                    params.update()
+            print('  %i meshes, %i deforming: %.2f ms per update' %
+                  (n, len(deforming), timer.value / frames * 1000))
+
+
+def random_rays(n_rays):
+    '''Rays that enter the unit cube from below'''
+    rng = mi.PCG32(size=n_rays)
+    o = mi.Point3f(rng.next_float32(), rng.next_float32(), -0.5)
+    d = dr.normalize(mi.Vector3f(rng.next_float32() - 0.5,
+                                 rng.next_float32() - 0.5, 1))
+    ray = mi.Ray3f(o, d)
+    dr.eval(ray)
+    return ray
+
+
+def trace_throughput(scene, ray):
+    '''Trace a wavefront of rays and return the throughput in Mrays/s'''
+    with Timer() as timer:
+        pi = scene.ray_intersect_preliminary(ray)
+        dr.eval(pi)
+        dr.sync_thread()
+    return dr.width(ray) / timer.value * 1e-6
+
+
+@benchmark('llvm_ad_rgb')
+def accel_quality():
+    '''Build time versus traversal speed of the accel_quality profiles'''
+    ray = random_rays(1024 * 1024)
+    for n_triangles in [1000000, 10000000]:
+        mesh = create_triangle_soup(n_triangles)
+        for quality in ['low', 'medium', 'high']:
+            props = mi.Properties('scene')
+            props['_unnamed_0'] = mesh
+            props['accel_quality'] = quality
+            with Timer() as timer:
+                scene = mi.Scene(props)
+            print('  quality=%s, %i triangles: build %.2f s, %.1f Mrays/s' %
+                  (quality, n_triangles, timer.value, trace_throughput(scene, ray)))
+
+
+@benchmark('scalar_rgb')
+def resource_cache():
+    '''Load time of 32 shapes sharing a 500K triangle PLY file'''
+    n = 512
+    x, y = np.meshgrid(np.linspace(0, 1, n, dtype=np.float32),
+                       np.linspace(0, 1, n, dtype=np.float32))
+    positions = np.stack([x.ravel(), y.ravel(), np.zeros(n * n, np.float32)], axis=1)
+    i = np.arange(n * n, dtype=np.uint32).reshape(n, n)[:-1, :-1].ravel()
+    faces = np.concatenate([np.stack([i, i + 1, i + n], axis=1),
+                            np.stack([i + 1, i + n + 1, i + n], axis=1)])
+
+    m = mi.Mesh('grid', n * n, len(faces))
+    params = mi.traverse(m)
+    params['vertex_positions'] = positions.ravel()
+    params['faces'] = faces.ravel()
+    params.update()
+
+    enabled = mi.ResourceCache.enabled()
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        filename = os.path.join(tmp_dir, 'grid.ply')
+        m.write_ply(filename)
+
+        scene = { 'type': 'scene' }
+        for k in range(32):
+            scene[f'grid_{k}'] = {
+                'type': 'ply', 'filename': filename,
+                'to_world': mi.ScalarTransform4f().translate([k, 0, 0])
+            }
+
+        try:
+            for value in [False, True]:
+                mi.ResourceCache.set_enabled(value)
+                mi.ResourceCache.clear()
+                mi.ResourceCache.reset_statistics()
+                with Timer() as timer:
+                    mi.load_dict(scene)
+                stats = mi.ResourceCache.statistics()
+                print('  cache=%s: %.1f ms (%i hits, %i misses)' %
+                      (value, timer.value * 1000, stats['hits'], stats['misses']))
+        finally:
+            mi.ResourceCache.set_enabled(enabled)
+
+
+@benchmark('scalar_spectral')
+def envmap_preprocess():
+    '''Load time of an 8192x4096 environment map with and without a cache'''
+    rng = np.random.default_rng(seed=0)
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        filename = os.path.join(tmp_dir, 'envmap.exr')
+        cache = os.path.join(tmp_dir, 'envmap.cache')
+        mi.Bitmap(rng.random((4096, 8192, 3), dtype=np.float32)).write(filename)
+
+        for label, props in [('no cache', {}),
+                             ('cache miss', { 'cache_file': cache }),
+                             ('cache hit', { 'cache_file': cache })]:
+            with Timer() as timer:
+                mi.load_dict({ 'type': 'envmap', 'filename': filename, **props })
+            print('  %s: %.1f ms' % (label, timer.value * 1000))
+
+
+@benchmark('llvm_ad_rgb', native=True)
+def triangle_records():
+    '''Memory versus speed of kd-tree leaves with triangle records'''
+    ray = random_rays(1024 * 1024)
+    for n_triangles in [100000, 1000000]:
+        mesh = create_triangle_soup(n_triangles)
+        sphere = mi.load_dict({
+            'type': 'sphere', 'center': [0.5, 0.5, 0.5], 'radius': 0.1 })
+
+        for records in [False, True]:
+            props = mi.Properties('scene')
+            props['_unnamed_0'] = mesh
+            props['_unnamed_1'] = sphere
+            props['kd_packet_traversal'] = False
+            props['kd_triangle_records'] = records
+            # The kd-tree reports its storage and that of the records
+            log_level = mi.log_level()
+            mi.set_log_level(mi.LogLevel.Info)
+            try:
+                scene = mi.Scene(props)
+            finally:
+                mi.set_log_level(log_level)
+            print('  records=%s, %i triangles: %.1f Mrays/s' %
+                  (records, n_triangles, trace_throughput(scene, ray)))
+
+
+# ------------------------------------------------------------------------------
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Run Mitsuba performance benchmarks.')
+    parser.add_argument('names', nargs='*',
+                        help='Benchmarks to run (default: all)')
+    parser.add_argument('--list', action='store_true',
+                        help='List the available benchmarks and exit')
+    parser.add_argument('--log-level', default='warn',
+                        choices=['debug', 'info', 'warn'],
+                        help='Log level of Mitsuba (default: warn)')
+    args = parser.parse_args()
+
+    if args.list:
+        for name, (variant, _, func) in BENCHMARKS.items():
+            print('%-24s %-14s %s' % (name, variant, func.__doc__))
+        return
+
+    for name in args.names:
+        if name not in BENCHMARKS:
+            parser.error('unknown benchmark "%s"' % name)
+
+    log_level = { 'debug': mi.LogLevel.Debug, 'info': mi.LogLevel.Info,
+                  'warn': mi.LogLevel.Warn }[args.log_level]
+
+    for name in args.names or BENCHMARKS:
+        variant, native, func = BENCHMARKS[name]
+        if variant not in mi.variants():
+            print('%s: skipped (variant "%s" is not enabled)' % (name, variant))
+            continue
+        mi.set_variant(variant)
+        if native and mi.MI_ENABLE_EMBREE:
+            print('%s: skipped (Embree is enabled)' % name)
+            continue
+        mi.set_log_level(log_level)
+        print('%s: %s' % (name, func.__doc__))
+        func()
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,15 @@
 #include <mitsuba/core/profiler.h>
 #include <mitsuba/core/logger.h>
 #include <mitsuba/core/util.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+
+#if defined(MI_ENABLE_PROFILER)
+#  include <signal.h>
+#  include <sys/time.h>
+#endif
 
 NAMESPACE_BEGIN(mitsuba)
 
@@ -10,14 +19,237 @@ __itt_string_handle *
     mitsuba_itt_phase[int(ProfilerPhase::ProfilerPhaseCount)] { };
 #endif
 
+#if defined(MI_ENABLE_PROFILER)
+static_assert(int(ProfilerPhase::ProfilerPhaseCount) <= 63,
+              "The profiler phase set must fit into a 64 bit mask!");
+
+thread_local uint64_t profiler_flags MI_PROFILER_TLS_MODEL = 0;
+
+/// Sampling interval of the profiler timer (microseconds)
+static constexpr long profiler_interval_us = 1000;
+
+/// Number of slots of the (lock-free, open addressing) sample histogram
+static constexpr uint32_t profiler_table_size = 1024;
+
+/// Marks an occupied histogram slot (phase masks never use the upper bit)
+static constexpr uint64_t profiler_slot_used = uint64_t(1) << 63;
+
+struct ProfilerSlot {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> count;
+};
+
+static ProfilerSlot profiler_table[profiler_table_size];
+static std::atomic<uint64_t> profiler_overflow { 0 };
+static bool profiler_running = false;
+static struct sigaction profiler_prev_action;
+
+/* Invoked asynchronously on a thread that consumed CPU time. Only
+   lock-free atomic operations are allowed in here. */
+static void profiler_callback(int, siginfo_t *, void *) {
+    uint64_t key  = profiler_flags | profiler_slot_used,
+             hash = key * 0x9E3779B97F4A7C15ull;
+
+    uint32_t index = (uint32_t) (hash >> 54) % profiler_table_size;
+
+    for (uint32_t i = 0; i < profiler_table_size; ++i) {
+        ProfilerSlot &slot = profiler_table[index];
+        uint64_t cur = slot.key.load(std::memory_order_relaxed);
+
+        if (cur == 0 &&
+            slot.key.compare_exchange_strong(cur, key, std::memory_order_relaxed))
+            cur = key;
+
+        if (cur == key) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        index = (index + 1) % profiler_table_size;
+    }
+
+    profiler_overflow.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// Collect a snapshot of all nonempty histogram entries (phase mask, count)
+static std::vector<std::pair<uint64_t, uint64_t>> profiler_samples() {
+    std::vector<std::pair<uint64_t, uint64_t>> result;
+    for (ProfilerSlot &slot : profiler_table) {
+        uint64_t key   = slot.key.load(std::memory_order_relaxed),
+                 count = slot.count.load(std::memory_order_relaxed);
+        if (key != 0 && count != 0)
+            result.emplace_back(key & ~profiler_slot_used, count);
+    }
+    return result;
+}
+
+static double profiler_seconds(uint64_t count) {
+    return (double) count * (double) profiler_interval_us * 1e-6;
+}
+#endif
+
+bool Profiler::enabled() {
+#if defined(MI_ENABLE_PROFILER)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Profiler::reset() {
+#if defined(MI_ENABLE_PROFILER)
+    for (ProfilerSlot &slot : profiler_table)
+        slot.count.store(0, std::memory_order_relaxed);
+    profiler_overflow.store(0, std::memory_order_relaxed);
+#endif
+}
+
+std::vector<std::tuple<std::string, double, double>> Profiler::phase_breakdown() {
+    std::vector<std::tuple<std::string, double, double>> result;
+
+#if defined(MI_ENABLE_PROFILER)
+    constexpr int phase_count = (int) ProfilerPhase::ProfilerPhaseCount;
+    uint64_t inclusive[phase_count] { }, exclusive[phase_count] { };
+
+    for (auto [mask, count] : profiler_samples()) {
+        if (mask == 0)
+            continue;
+
+        // Due to the partial order, the innermost phase is the highest bit
+        int innermost = 0;
+        for (int i = 0; i < phase_count; ++i) {
+            if (mask & (uint64_t(1) << i))
+                innermost = i;
+        }
+        exclusive[innermost] += count;
+
+        for (int i = 0; i < phase_count; ++i) {
+            if (mask & (uint64_t(1) << i))
+                inclusive[i] += count;
+        }
+    }
+
+    for (int i = 0; i < phase_count; ++i) {
+        if (inclusive[i] == 0)
+            continue;
+        result.emplace_back(profiler_phase_id[i],
+                            profiler_seconds(inclusive[i]),
+                            profiler_seconds(exclusive[i]));
+    }
+#endif
+
+    return result;
+}
+
+std::string Profiler::report() {
+    std::ostringstream oss;
+
+#if defined(MI_ENABLE_PROFILER)
+    auto samples = profiler_samples();
+
+    uint64_t total = profiler_overflow.load(std::memory_order_relaxed);
+    for (auto [mask, count] : samples)
+        total += count;
+
+    if (total == 0)
+        return "Profiler: no samples were collected.";
+
+    auto percent = [total](double seconds) {
+        return 100.0 * seconds / profiler_seconds(total);
+    };
+
+    oss << "Profiler: " << total << " samples ("
+        << util::time_string((float) (profiler_seconds(total) * 1000.0))
+        << " of CPU time)" << std::endl << std::endl
+        << "  Per-phase breakdown (inclusive / exclusive):" << std::endl;
+
+    for (auto [name, incl, excl] : phase_breakdown())
+        oss << tfm::format("    %-42s %6.2f%%  %6.2f%%", name, percent(incl),
+                           percent(excl)) << std::endl;
+
+    oss << std::endl << "  Per-call-chain breakdown:" << std::endl;
+
+    std::sort(samples.begin(), samples.end(),
+              [](const auto &a, const auto &b) { return a.second > b.second; });
+
+    for (auto [mask, count] : samples) {
+        std::string chain;
+        for (int i = 0; i < (int) ProfilerPhase::ProfilerPhaseCount; ++i) {
+            if (!(mask & (uint64_t(1) << i)))
+                continue;
+            if (!chain.empty())
+                chain += " > ";
+            chain += profiler_phase_id[i];
+        }
+        if (chain.empty())
+            chain = "(outside of profiled phases)";
+
+        oss << tfm::format("    %6.2f%%  %s",
+                           percent(profiler_seconds(count)), chain) << std::endl;
+    }
+
+    uint64_t overflow = profiler_overflow.load(std::memory_order_relaxed);
+    if (overflow)
+        oss << tfm::format("    %6.2f%%  (histogram overflow)",
+                           percent(profiler_seconds(overflow))) << std::endl;
+#else
+    oss << "Profiler: Mitsuba was compiled without sampling profiler support "
+           "(set MI_PROFILER_SAMPLING=ON in CMake).";
+#endif
+
+    return oss.str();
+}
+
+void Profiler::print_report() {
+#if defined(MI_ENABLE_PROFILER)
+    Log(Info, "%s", report());
+#endif
+}
+
 void Profiler::static_initialization() {
 #if defined(MI_ENABLE_ITTNOTIFY)
     mitsuba_itt_domain = __itt_domain_create("mitsuba");
     for (int i = 0; i < (int) ProfilerPhase::ProfilerPhaseCount; ++i)
         mitsuba_itt_phase[i] = __itt_string_handle_create(profiler_phase_id[i]);
 #endif
+
+#if defined(MI_ENABLE_PROFILER)
+    if (profiler_running)
+        return;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = profiler_callback;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &profiler_prev_action))
+        Throw("Profiler: could not install signal handler!");
+
+    /* ITIMER_PROF counts CPU time consumed by the process, so idle worker
+       threads do not contribute samples */
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = profiler_interval_us;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr))
+        Throw("Profiler: could not set up timer!");
+
+    profiler_running = true;
+#endif
 }
 
-void Profiler::static_shutdown() { }
+void Profiler::static_shutdown() {
+#if defined(MI_ENABLE_PROFILER)
+    if (!profiler_running)
+        return;
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &profiler_prev_action, nullptr);
+
+    profiler_running = false;
+#endif
+}
 
 NAMESPACE_END(mitsuba)
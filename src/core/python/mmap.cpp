@@ -24,6 +24,8 @@ MI_PY_EXPORT(MemoryMappedFile) {
         .def("filename", &MemoryMappedFile::filename, D(MemoryMappedFile, filename))
         .def("can_write", &MemoryMappedFile::can_write, D(MemoryMappedFile, can_write))
         .def_static("create_temporary", &MemoryMappedFile::create_temporary, D(MemoryMappedFile, create_temporary))
+        .def_static("map_private", &MemoryMappedFile::map_private, "filename"_a,
+            D(MemoryMappedFile, map_private))
         .def("__array__", [](MemoryMappedFile &m) {
             return nb::ndarray<nb::numpy, uint8_t>((uint8_t*) m.data(), { m.size() }, nb::handle());
         }, nb::rv_policy::reference_internal);
@@ -0,0 +1,16 @@
+#include <mitsuba/core/profiler.h>
+#include <mitsuba/python/python.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/vector.h>
+
+MI_PY_EXPORT(Profiler) {
+    nb::class_<Profiler>(m, "Profiler", D(Profiler))
+        .def_static("enabled", &Profiler::enabled, D(Profiler, enabled))
+        .def_static("reset", &Profiler::reset, D(Profiler, reset))
+        .def_static("phase_breakdown", &Profiler::phase_breakdown,
+                    D(Profiler, phase_breakdown))
+        .def_static("report", &Profiler::report, D(Profiler, report))
+        .def_static("print_report", &Profiler::print_report,
+                    D(Profiler, print_report));
+}
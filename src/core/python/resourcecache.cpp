@@ -0,0 +1,28 @@
+#include <mitsuba/core/resourcecache.h>
+#include <mitsuba/python/python.h>
+#include <nanobind/stl/string.h>
+
+MI_PY_EXPORT(ResourceCache) {
+    nb::class_<ResourceCache>(m, "ResourceCache", D(ResourceCache))
+        .def_static("key", &ResourceCache::key, "path"_a, "options"_a = "",
+                    D(ResourceCache, key))
+        .def_static("enabled", &ResourceCache::enabled, D(ResourceCache, enabled))
+        .def_static("set_enabled", &ResourceCache::set_enabled, "value"_a,
+                    D(ResourceCache, set_enabled))
+        .def_static("prune", &ResourceCache::prune, D(ResourceCache, prune))
+        .def_static("clear", &ResourceCache::clear, D(ResourceCache, clear))
+        .def_static("reset_statistics", &ResourceCache::reset_statistics,
+                    D(ResourceCache, reset_statistics))
+        .def_static("statistics", []() {
+            ResourceCache::Statistics stats = ResourceCache::statistics();
+            nb::dict result;
+            result["hits"] = stats.hits;
+            result["misses"] = stats.misses;
+            result["bytes_saved"] = stats.bytes_saved;
+            result["entries"] = stats.entries;
+            result["resident_bytes"] = stats.resident_bytes;
+            return result;
+        }, D(ResourceCache, statistics))
+        .def_static("to_string", &ResourceCache::to_string,
+                    D(ResourceCache, to_string));
+}
@@ -103,7 +103,9 @@ MI_PY_EXPORT(Thread) {
        .def_method(Thread, detach)
        .def_method(Thread, join)
        .def_static_method(Thread, sleep)
-       .def_static_method(Thread, wait_for_tasks);
+       .def_static_method(Thread, wait_for_tasks)
+       .def_static_method(Thread, thread_count)
+       .def_static_method(Thread, set_thread_count);
 
     nb::class_<ThreadEnvironment>(m, "ThreadEnvironment", D(ThreadEnvironment))
         .def(nb::init<>());
@@ -0,0 +1,41 @@
+#include <nanobind/nanobind.h> // Needs to be first, to get `ref<T>` caster
+#include <mitsuba/core/tilecache.h>
+#include <mitsuba/core/bitmap.h>
+#include <mitsuba/core/filesystem.h>
+#include <mitsuba/python/python.h>
+#include <nanobind/stl/string.h>
+
+MI_PY_EXPORT(TiledImage) {
+    MI_PY_CLASS(TiledImage, Object)
+        .def(nb::init<const fs::path &>(), "path"_a, D(TiledImage, TiledImage))
+        .def_static("write", &TiledImage::write, "bitmap"_a, "path"_a,
+                    "tile_size"_a = 64, "source_size"_a = 0, "source_time"_a = 0,
+                    "source_flags"_a = 0, D(TiledImage, write))
+        .def_method(TiledImage, size)
+        .def_method(TiledImage, channel_count)
+        .def_method(TiledImage, tile_size)
+        .def_method(TiledImage, tile_count)
+        .def_method(TiledImage, source_size)
+        .def_method(TiledImage, source_time)
+        .def_method(TiledImage, source_flags)
+        .def_method(TiledImage, mean, "channel"_a)
+        .def_method(TiledImage, path);
+
+    nb::class_<TileCache>(m, "TileCache", D(TileCache))
+        .def_static("budget", &TileCache::budget, D(TileCache, budget))
+        .def_static("set_budget", &TileCache::set_budget, "bytes"_a,
+                    D(TileCache, set_budget))
+        .def_static("clear", &TileCache::clear, D(TileCache, clear))
+        .def_static("reset_statistics", &TileCache::reset_statistics,
+                    D(TileCache, reset_statistics))
+        .def_static("statistics", []() {
+            TileCache::Statistics stats = TileCache::statistics();
+            nb::dict result;
+            result["hits"] = stats.hits;
+            result["misses"] = stats.misses;
+            result["evictions"] = stats.evictions;
+            result["resident_bytes"] = stats.resident_bytes;
+            return result;
+        }, D(TileCache, statistics))
+        .def_static("to_string", &TileCache::to_string, D(TileCache, to_string));
+}
@@ -4,6 +4,7 @@
 #include <mitsuba/core/xml.h>
 #include <mitsuba/core/plugin.h>
 #include <mitsuba/core/properties.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/core/spectrum.h>
 #include <mitsuba/core/transform.h>
 #include <mitsuba/python/python.h>
@@ -120,6 +121,8 @@ MI_PY_EXPORT(xml) {
             ref<FileResolver> fs_backup = Thread::thread()->file_resolver();
             Thread::thread()->set_file_resolver(new FileResolver(*fs_backup));
 
+            // Release cached resources not used by the scene once loading finished
+            ResourceCache::ScopedPrune prune;
             DictParseContext ctx;
             ctx.parallel = parallel;
             ctx.env = ThreadEnvironment();
@@ -0,0 +1,181 @@
+#include <mitsuba/core/resourcecache.h>
+#include <mitsuba/core/logger.h>
+#include <mitsuba/core/util.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+NAMESPACE_BEGIN(mitsuba)
+
+NAMESPACE_BEGIN(detail)
+
+struct ResourceCacheState {
+    using Value = std::pair<ref<Object>, size_t>;
+
+    std::mutex mutex;
+    /// Resources by key (including those that are still being loaded)
+    std::unordered_map<std::string, std::shared_future<Value>> map;
+    std::atomic<bool> enabled { true };
+    std::atomic<size_t> hits { 0 }, misses { 0 }, bytes_saved { 0 };
+};
+
+/* Intentionally leaked, since resources may still be released during static
+   destruction */
+static ResourceCacheState *resource_cache = new ResourceCacheState();
+
+/**
+ * Number of loaders that are active on the current thread. Loaders may run
+ * nested parallel work (e.g. the parallel OBJ parser), during which the
+ * thread pool can schedule an unrelated task on the loading thread. Such a
+ * task must never wait for a resource that is still being loaded, since
+ * this could be its own thread.
+ */
+static thread_local uint32_t active_loaders = 0;
+
+/// Marks the current thread as running a loader
+struct ScopedLoader {
+    ScopedLoader() { active_loaders++; }
+    ~ScopedLoader() { active_loaders--; }
+};
+
+/// Has the resource finished loading?
+static bool resource_ready(const std::shared_future<ResourceCacheState::Value> &future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+NAMESPACE_END(detail)
+
+std::string ResourceCache::key(const fs::path &path, const std::string &options) {
+    // Missing files are reported by the loader
+    uint64_t time = fs::exists(path) ? fs::last_write_time(path) : 0;
+    return tfm::format("%s|%llu|%s", fs::absolute(path).string(),
+                       (unsigned long long) time, options);
+}
+
+ref<Object> ResourceCache::get(const std::string &key, const Loader &load) {
+    using Value = detail::ResourceCacheState::Value;
+    detail::ResourceCacheState &cache = *detail::resource_cache;
+
+    if (!cache.enabled)
+        return load().first;
+
+    std::promise<Value> promise;
+    std::shared_future<Value> future;
+    bool loader = false;
+
+    {
+        std::lock_guard<std::mutex> guard(cache.mutex);
+        auto it = cache.map.find(key);
+        if (it != cache.map.end()) {
+            future = it->second;
+        } else {
+            future = promise.get_future().share();
+            cache.map.emplace(key, future);
+            loader = true;
+        }
+    }
+
+    if (!loader) {
+        if (detail::active_loaders > 0 && !detail::resource_ready(future)) {
+            /* Called from within a loader, which must not wait for another
+               one. Load an uncached copy instead. */
+            cache.misses++;
+            detail::ScopedLoader scoped_loader;
+            return load().first;
+        }
+
+        // Possibly wait for another thread that is loading the resource
+        const Value &value = future.get();
+        cache.hits++;
+        cache.bytes_saved += value.second;
+        return value.first;
+    }
+
+    cache.misses++;
+    detail::ScopedLoader scoped_loader;
+    try {
+        Value value = load();
+        promise.set_value(value);
+        return value.first;
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> guard(cache.mutex);
+            cache.map.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+bool ResourceCache::enabled() { return detail::resource_cache->enabled; }
+
+void ResourceCache::set_enabled(bool value) {
+    detail::resource_cache->enabled = value;
+    if (!value)
+        clear();
+}
+
+void ResourceCache::prune() {
+    detail::ResourceCacheState &cache = *detail::resource_cache;
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    for (auto it = cache.map.begin(); it != cache.map.end();) {
+        // The shared state of the future holds the only remaining reference
+        if (detail::resource_ready(it->second) &&
+            it->second.get().first->ref_count() == 1)
+            it = cache.map.erase(it);
+        else
+            ++it;
+    }
+}
+
+void ResourceCache::clear() {
+    detail::ResourceCacheState &cache = *detail::resource_cache;
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    // Keep resources that are still being loaded, their loaders expect them
+    for (auto it = cache.map.begin(); it != cache.map.end();) {
+        if (detail::resource_ready(it->second))
+            it = cache.map.erase(it);
+        else
+            ++it;
+    }
+}
+
+ResourceCache::Statistics ResourceCache::statistics() {
+    detail::ResourceCacheState &cache = *detail::resource_cache;
+    Statistics stats { cache.hits, cache.misses, cache.bytes_saved, 0, 0 };
+
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    for (auto &[key, future] : cache.map) {
+        if (!detail::resource_ready(future))
+            continue;
+        stats.entries++;
+        stats.resident_bytes += future.get().second;
+    }
+    return stats;
+}
+
+void ResourceCache::reset_statistics() {
+    detail::resource_cache->hits = 0;
+    detail::resource_cache->misses = 0;
+    detail::resource_cache->bytes_saved = 0;
+}
+
+std::string ResourceCache::to_string() {
+    Statistics stats = statistics();
+    size_t requests = stats.hits + stats.misses;
+    std::ostringstream oss;
+    oss << "ResourceCache[" << std::endl
+        << "  enabled = " << (enabled() ? "true" : "false") << "," << std::endl
+        << "  entries = " << stats.entries << "," << std::endl
+        << "  resident = " << util::mem_string(stats.resident_bytes) << "," << std::endl
+        << "  hits = " << stats.hits << "," << std::endl
+        << "  misses = " << stats.misses << "," << std::endl
+        << "  hit_rate = "
+        << (requests > 0 ? 100.0 * stats.hits / requests : 0.0) << "%," << std::endl
+        << "  bytes_saved = " << util::mem_string(stats.bytes_saved) << std::endl
+        << "]";
+    return oss.str();
+}
+
+NAMESPACE_END(mitsuba)
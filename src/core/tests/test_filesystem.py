@@ -155,3 +155,13 @@ def test12_truncate_and_file_size(variant_scalar_rgb, tmp_path):
     assert fs.file_size(p) == 42
     assert fs.remove(p)
     assert not fs.exists(p)
+
+
+def test13_last_write_time(variant_scalar_rgb, tmp_path):
+    import os
+    p = fs.path(str(tmp_path)) / 'test_file_for_mtime.txt'
+    open(str(p), 'a').close()
+    os.utime(str(p), ns=(1_000_000_000, 1_500_000_000))
+    assert fs.last_write_time(p) // 1_000_000_000 == 1
+    with pytest.raises(RuntimeError):
+        fs.last_write_time(fs.path(str(tmp_path)) / 'missing.txt')
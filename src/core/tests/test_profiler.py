@@ -0,0 +1,25 @@
+import pytest
+import mitsuba as mi
+
+
+def test01_report(variant_scalar_rgb):
+    mi.Profiler.reset()
+    assert isinstance(mi.Profiler.report(), str)
+
+    if not mi.Profiler.enabled():
+        assert len(mi.Profiler.phase_breakdown()) == 0
+        return
+
+    scene = mi.load_dict(mi.cornell_box())
+    mi.render(scene, spp=16)
+
+    breakdown = mi.Profiler.phase_breakdown()
+    names = [b[0] for b in breakdown]
+    assert "Integrator::render()" in names
+
+    for name, inclusive, exclusive in breakdown:
+        assert inclusive >= exclusive >= 0
+
+    assert "Per-call-chain breakdown" in mi.Profiler.report()
+    mi.Profiler.reset()
+    assert len(mi.Profiler.phase_breakdown()) == 0
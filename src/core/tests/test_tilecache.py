@@ -0,0 +1,70 @@
+import numpy as np
+import os
+
+import pytest
+import drjit as dr
+import mitsuba as mi
+
+
+def make_bitmap(width, height, channels):
+    rng = np.random.default_rng(seed=0)
+    data = rng.random((height, width, channels)).astype(np.float32)
+    fmt = mi.Bitmap.PixelFormat.Y if channels == 1 else mi.Bitmap.PixelFormat.RGB
+    return mi.Bitmap(data, fmt), data
+
+
+def test01_write_read(variant_scalar_rgb, tmpdir):
+    bitmap, data = make_bitmap(37, 21, 3)
+    path = os.path.join(str(tmpdir), "image.mtc")
+    mi.TiledImage.write(bitmap, path, tile_size=16, source_size=1234,
+                        source_time=5678, source_flags=1)
+
+    image = mi.TiledImage(path)
+    assert image.size() == [37, 21]
+    assert image.channel_count() == 3
+    assert image.tile_size() == 16
+    assert image.tile_count() == [3, 2]
+    assert image.source_size() == 1234
+    assert image.source_time() == 5678
+    assert image.source_flags() == 1
+    for c in range(3):
+        assert dr.allclose(image.mean(c), np.mean(data[..., c]), rtol=1e-4)
+
+
+def test02_statistics_and_eviction(variant_scalar_rgb, tmpdir):
+    bitmap, _ = make_bitmap(64, 64, 1)
+    path = os.path.join(str(tmpdir), "image.mtc")
+    mi.TiledImage.write(bitmap, path, tile_size=8)
+
+    budget = mi.TileCache.budget()
+    mi.TileCache.clear()
+    mi.TileCache.reset_statistics()
+
+    # Render a texture twice: the second pass is served from memory
+    texture = mi.load_dict({
+        'type': 'tiledbitmap',
+        'filename': path,
+        'filter_type': 'nearest'
+    })
+
+    si = dr.zeros(mi.SurfaceInteraction3f)
+    for i in range(2):
+        for y in range(8):
+            for x in range(8):
+                si.uv = [(x + .5) / 8, (y + .5) / 8]
+                texture.eval_1(si)
+
+    stats = mi.TileCache.statistics()
+    assert stats['misses'] == 64
+    assert stats['hits'] == 64
+    assert stats['evictions'] == 0
+    assert stats['resident_bytes'] == 64 * 8 * 8 * 4
+
+    # A tiny budget evicts all but the most recently used tiles
+    mi.TileCache.set_budget(1)
+    stats = mi.TileCache.statistics()
+    assert stats['evictions'] == 64
+    assert stats['resident_bytes'] == 0
+
+    mi.TileCache.set_budget(budget)
+    mi.TileCache.clear()
@@ -0,0 +1,309 @@
+#include <mitsuba/core/tilecache.h>
+#include <mitsuba/core/bitmap.h>
+#include <mitsuba/core/fstream.h>
+#include <mitsuba/core/hash.h>
+#include <mitsuba/core/logger.h>
+#include <mitsuba/core/util.h>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+
+NAMESPACE_BEGIN(mitsuba)
+
+NAMESPACE_BEGIN(detail)
+
+/// Number of independently locked parts of the tile cache
+static constexpr size_t tile_cache_shards = 64;
+
+struct TileCacheShard {
+    using Key = std::pair<uint64_t, uint32_t>;
+
+    struct KeyHasher {
+        size_t operator()(const Key &key) const { return hash(key); }
+    };
+
+    struct Entry {
+        Key key;
+        TileCache::Tile tile;
+        size_t bytes;
+    };
+
+    std::mutex mutex;
+    /// Entries sorted from most to least recently used
+    std::list<Entry> lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> map;
+    size_t bytes = 0;
+};
+
+struct TileCacheState {
+    TileCacheShard shards[tile_cache_shards];
+    std::atomic<size_t> budget { size_t(2) << 30 };
+    std::atomic<size_t> hits { 0 }, misses { 0 }, evictions { 0 },
+                        resident_bytes { 0 };
+};
+
+/* Intentionally leaked, since tiled images may still release their tiles
+   during static destruction */
+static TileCacheState *tile_cache = new TileCacheState();
+
+static TileCacheShard &tile_cache_shard(const TileCacheShard::Key &key) {
+    return tile_cache->shards[hash(key) % tile_cache_shards];
+}
+
+/// Evict least recently used tiles until the shard is within its budget
+static void tile_cache_evict(TileCacheShard &shard, size_t keep = 0) {
+    size_t budget = tile_cache->budget / tile_cache_shards;
+    while (shard.bytes > budget && shard.lru.size() > keep) {
+        TileCacheShard::Entry &entry = shard.lru.back();
+        shard.bytes -= entry.bytes;
+        tile_cache->resident_bytes -= entry.bytes;
+        tile_cache->evictions++;
+        shard.map.erase(entry.key);
+        shard.lru.pop_back();
+    }
+}
+
+static std::atomic<uint64_t> tiled_image_counter { 0 };
+
+NAMESPACE_END(detail)
+
+// -----------------------------------------------------------------------------
+
+TiledImage::TiledImage(const fs::path &path)
+    : m_path(path), m_id(detail::tiled_image_counter++) {
+    m_stream = new FileStream(path, FileStream::ERead);
+
+    char header[3];
+    m_stream->read(header, 3);
+    if (header[0] != 'M' || header[1] != 'T' || header[2] != 'C')
+        Throw("\"%s\": invalid tiled image file!", path);
+
+    uint8_t version;
+    m_stream->read(version);
+    if (version != 1 && version != 2)
+        Throw("\"%s\": invalid version, currently only versions 1 and 2 are "
+              "supported (found %d)", path, version);
+
+    uint32_t width, height;
+    m_stream->read(width);
+    m_stream->read(height);
+    m_stream->read(m_channel_count);
+    m_stream->read(m_tile_size);
+    m_stream->read(m_source_size);
+
+    m_source_time = 0;
+    m_source_flags = 0;
+    if (version >= 2) {
+        m_stream->read(m_source_time);
+        m_stream->read(m_source_flags);
+    }
+
+    if (width == 0 || height == 0 || m_channel_count == 0 || m_tile_size == 0)
+        Throw("\"%s\": invalid tiled image file (size %ux%u, %u channels, "
+              "tile size %u)!", path, width, height, m_channel_count,
+              m_tile_size);
+
+    m_mean.resize(m_channel_count);
+    m_stream->read_array(m_mean.data(), m_channel_count);
+
+    m_size = Vector2u(width, height);
+    m_tile_count = (m_size + (m_tile_size - 1)) / m_tile_size;
+    m_data_offset = m_stream->tell();
+
+    size_t tile_bytes = (size_t) m_tile_size * m_tile_size * m_channel_count *
+                        sizeof(float),
+           expected   = m_data_offset + dr::prod(m_tile_count) * tile_bytes;
+    if (m_stream->size() < expected)
+        Throw("\"%s\": tiled image file is truncated (expected %zu bytes, "
+              "found %zu)!", path, expected, m_stream->size());
+}
+
+TiledImage::~TiledImage() {
+    TileCache::release(this);
+}
+
+void TiledImage::write(const Bitmap *bitmap_, const fs::path &path,
+                       uint32_t tile_size, uint64_t source_size,
+                       uint64_t source_time, uint32_t source_flags) {
+    if (tile_size == 0)
+        Throw("TiledImage::write(): the tile size must be positive!");
+
+    const Bitmap *bitmap = bitmap_;
+    ref<Bitmap> converted;
+    if (bitmap->component_format() != Struct::Type::Float32) {
+        converted = bitmap->convert(bitmap->pixel_format(),
+                                    Struct::Type::Float32, bitmap->srgb_gamma());
+        bitmap = converted.get();
+    }
+
+    Vector2u size = bitmap->size(),
+             tile_count = (size + (tile_size - 1)) / tile_size;
+    uint32_t channels = (uint32_t) bitmap->channel_count();
+    const float *data = (const float *) bitmap->data();
+
+    std::vector<double> mean(channels, 0.0);
+    for (size_t i = 0; i < bitmap->pixel_count(); ++i)
+        for (uint32_t c = 0; c < channels; ++c)
+            mean[c] += data[i * channels + c];
+
+    ref<FileStream> stream = new FileStream(path, FileStream::ETruncReadWrite);
+    stream->write("MTC", 3);
+    stream->write(uint8_t(2)); // file format version
+    stream->write(size.x());
+    stream->write(size.y());
+    stream->write(channels);
+    stream->write(tile_size);
+    stream->write(source_size);
+    stream->write(source_time);
+    stream->write(source_flags);
+    for (uint32_t c = 0; c < channels; ++c)
+        stream->write(float(mean[c] / bitmap->pixel_count()));
+
+    std::vector<float> tile((size_t) tile_size * tile_size * channels);
+    for (uint32_t ty = 0; ty < tile_count.y(); ++ty) {
+        for (uint32_t tx = 0; tx < tile_count.x(); ++tx) {
+            std::fill(tile.begin(), tile.end(), 0.f);
+            uint32_t x0 = tx * tile_size, y0 = ty * tile_size,
+                     w = std::min(tile_size, size.x() - x0),
+                     h = std::min(tile_size, size.y() - y0);
+
+            for (uint32_t y = 0; y < h; ++y)
+                std::memcpy(tile.data() + (size_t) y * tile_size * channels,
+                            data + ((size_t) (y0 + y) * size.x() + x0) * channels,
+                            (size_t) w * channels * sizeof(float));
+
+            stream->write_array(tile.data(), tile.size());
+        }
+    }
+}
+
+TiledImage::Tile TiledImage::tile(uint32_t x, uint32_t y) const {
+    return TileCache::lookup(this, y * m_tile_count.x() + x);
+}
+
+TiledImage::Tile TiledImage::read_tile(uint32_t index) const {
+    size_t count = (size_t) m_tile_size * m_tile_size * m_channel_count;
+    std::shared_ptr<float[]> tile(new float[count]);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stream->seek(m_data_offset + index * count * sizeof(float));
+    m_stream->read_array(tile.get(), count);
+    return tile;
+}
+
+std::string TiledImage::to_string() const {
+    std::ostringstream oss;
+    oss << "TiledImage[" << std::endl
+        << "  path = \"" << m_path << "\"," << std::endl
+        << "  size = " << m_size << "," << std::endl
+        << "  channels = " << m_channel_count << "," << std::endl
+        << "  tile_size = " << m_tile_size << "," << std::endl
+        << "  tile_count = " << m_tile_count << std::endl
+        << "]";
+    return oss.str();
+}
+
+// -----------------------------------------------------------------------------
+
+size_t TileCache::budget() { return detail::tile_cache->budget; }
+
+void TileCache::set_budget(size_t bytes) {
+    detail::tile_cache->budget = bytes;
+    for (detail::TileCacheShard &shard : detail::tile_cache->shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        detail::tile_cache_evict(shard);
+    }
+}
+
+TileCache::Tile TileCache::lookup(const TiledImage *image, uint32_t index) {
+    detail::TileCacheShard::Key key(image->id(), index);
+    detail::TileCacheShard &shard = detail::tile_cache_shard(key);
+
+    {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        auto it = shard.map.find(key);
+        if (it != shard.map.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            detail::tile_cache->hits++;
+            return it->second->tile;
+        }
+    }
+
+    // Load the tile without holding the lock of the shard
+    detail::tile_cache->misses++;
+    Tile tile = image->read_tile(index);
+    size_t bytes = (size_t) image->tile_size() * image->tile_size() *
+                   image->channel_count() * sizeof(float);
+
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) // Another thread loaded it in the meantime
+        return it->second->tile;
+
+    shard.lru.push_front({ key, tile, bytes });
+    shard.map[key] = shard.lru.begin();
+    shard.bytes += bytes;
+    detail::tile_cache->resident_bytes += bytes;
+
+    // Always keep the tile that was just loaded
+    detail::tile_cache_evict(shard, 1);
+
+    return tile;
+}
+
+void TileCache::release(const TiledImage *image) {
+    for (detail::TileCacheShard &shard : detail::tile_cache->shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        for (auto it = shard.lru.begin(); it != shard.lru.end();) {
+            if (it->key.first == image->id()) {
+                shard.bytes -= it->bytes;
+                detail::tile_cache->resident_bytes -= it->bytes;
+                shard.map.erase(it->key);
+                it = shard.lru.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void TileCache::clear() {
+    for (detail::TileCacheShard &shard : detail::tile_cache->shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        detail::tile_cache->resident_bytes -= shard.bytes;
+        shard.bytes = 0;
+        shard.map.clear();
+        shard.lru.clear();
+    }
+}
+
+TileCache::Statistics TileCache::statistics() {
+    return { detail::tile_cache->hits, detail::tile_cache->misses,
+             detail::tile_cache->evictions, detail::tile_cache->resident_bytes };
+}
+
+void TileCache::reset_statistics() {
+    detail::tile_cache->hits = 0;
+    detail::tile_cache->misses = 0;
+    detail::tile_cache->evictions = 0;
+}
+
+std::string TileCache::to_string() {
+    Statistics stats = statistics();
+    size_t lookups = stats.hits + stats.misses;
+    std::ostringstream oss;
+    oss << "TileCache[" << std::endl
+        << "  budget = " << util::mem_string(budget()) << "," << std::endl
+        << "  resident = " << util::mem_string(stats.resident_bytes) << "," << std::endl
+        << "  hits = " << stats.hits << "," << std::endl
+        << "  misses = " << stats.misses << "," << std::endl
+        << "  hit_rate = "
+        << (lookups > 0 ? 100.0 * stats.hits / lookups : 0.0) << "%," << std::endl
+        << "  evictions = " << stats.evictions << std::endl
+        << "]";
+    return oss.str();
+}
+
+MI_IMPLEMENT_CLASS(TiledImage, Object)
+NAMESPACE_END(mitsuba)
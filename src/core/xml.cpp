@@ -14,6 +14,7 @@
 #include <mitsuba/core/object.h>
 #include <mitsuba/core/plugin.h>
 #include <mitsuba/core/profiler.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/core/spectrum.h>
 #include <mitsuba/core/string.h>
 #include <mitsuba/core/transform.h>
@@ -1344,6 +1345,8 @@ std::vector<ref<Object>> load_string(const std::string &string,
 
     try {
         pugi::xml_node root = doc.document_element();
+        // Release cached resources not used by the scene once loading finished
+        ResourceCache::ScopedPrune prune;
         detail::XMLParseContext ctx(variant, parallel);
         Properties props;
         size_t arg_counter = 0; // Unused
@@ -1386,6 +1389,7 @@ std::vector<ref<Object>> load_file(const fs::path &filename,
     Thread::thread()->set_file_resolver(fs.get());
 
     try {
+        ResourceCache::ScopedPrune prune;
         detail::XMLParseContext ctx(variant, parallel);
         auto scene_id = detail::init_xml_parse_context_from_file(ctx, filename, param, write_update);
 
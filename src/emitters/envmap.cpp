@@ -2,6 +2,7 @@
 #include <mitsuba/core/bsphere.h>
 #include <mitsuba/core/distr_2d.h>
 #include <mitsuba/core/fresolver.h>
+#include <mitsuba/core/mmap.h>
 #include <mitsuba/core/plugin.h>
 #include <mitsuba/render/emitter.h>
 #include <mitsuba/render/scene.h>
@@ -10,6 +11,7 @@
 #include <drjit/tensor.h>
 #include <mitsuba/render/fwd.h>
 #include <mitsuba/core/fstream.h>
+#include <nanothread/nanothread.h>
 
 NAMESPACE_BEGIN(mitsuba)
 
@@ -49,6 +51,13 @@ Environment emitter (:monosp:`envmap`)
      will be combined using multiple importance sampling (MIS)? This is
      extremely cheap to do and can slightly reduce variance. (Default: false)
 
+ * - cache_file
+   - |string|
+   - Optional path of a file caching the preprocessed environment map, i.e.
+     the converted pixel values and the luminance used for importance sampling.
+     It is created on the first load and reused as long as the contents of the
+     image referenced by :paramtype:`filename` do not change. (Default: none)
+
  * - data
    - |tensor|
    - Tensor array containing the radiance-valued data.
@@ -113,11 +122,15 @@ public:
         m_bsphere = BoundingSphere3f(ScalarPoint3f(0.f), 1.f);
 
         ref<Bitmap> bitmap;
+        fs::path file_path, cache_path;
+        uint64_t hash = 0;
 
         if (props.has_property("bitmap")) {
             // Creates a Bitmap texture directly from an existing Bitmap object
             if (props.has_property("filename"))
                 Throw("Cannot specify both \"bitmap\" and \"filename\".");
+            if (props.has_property("cache_file"))
+                Throw("The \"cache_file\" parameter requires \"filename\".");
             // Note: ref-counted, so we don't have to worry about lifetime
             ref<Object> other = props.object("bitmap");
             Bitmap *b = dynamic_cast<Bitmap *>(other.get());
@@ -126,108 +139,45 @@ public:
             bitmap = b;
         } else {
             FileResolver *fs = Thread::thread()->file_resolver();
-            fs::path file_path = fs->resolve(props.string("filename"));
+            file_path = fs->resolve(props.string("filename"));
             m_filename = file_path.filename().string();
-            bitmap = new Bitmap(file_path);
-        }
-
-        if (bitmap->width() < 2 || bitmap->height() < 3)
-            Throw("\"%s\": the environment map resolution must be at least "
-                  "2x3 pixels", (m_filename.empty() ? "<Bitmap>" : m_filename));
-
-        /* Convert to linear RGBA float bitmap, will undergo further
-           conversion into coefficients of a spectral upsampling model below */
-        Bitmap::PixelFormat pixel_format = Bitmap::PixelFormat::RGB;
-        if constexpr (is_spectral_v<Spectrum>)
-            pixel_format = Bitmap::PixelFormat::RGBA;
-        bitmap = bitmap->convert(pixel_format, struct_type_v<Float>, false);
-
-        /* Allocate a larger image including an extra column to
-           account for the periodic boundary */
-        ScalarVector2u res(bitmap->width() + 1, bitmap->height());
-        ref<Bitmap> bitmap_2 = new Bitmap(bitmap->pixel_format(),
-                                          bitmap->component_format(), res);
-
-        // Luminance image used for importance sampling
-        std::unique_ptr<ScalarFloat[]> luminance(new ScalarFloat[dr::prod(res)]);
-
-        ScalarFloat *in_ptr  = (ScalarFloat *) bitmap->data(),
-                    *out_ptr = (ScalarFloat *) bitmap_2->data(),
-                    *lum_ptr = (ScalarFloat *) luminance.get();
-
-        ScalarFloat theta_scale = 1.f / (bitmap->size().y() - 1) * dr::Pi<Float>;
-
-        /* "MIS Compensation: Optimizing Sampling Techniques in Multiple
-           Importance Sampling" Ondrej Karlik, Martin Sik, Petr Vivoda, Tomas
-           Skrivan, and Jaroslav Krivanek. SIGGRAPH Asia 2019 */
-        ScalarFloat luminance_offset = 0.f;
-        if (props.get<bool>("mis_compensation", false)) {
-            ScalarFloat min_lum = 0.f;
-            double lum_accum_d = 0.0;
-
-            for (size_t y = 0; y < bitmap->size().y(); ++y) {
-                for (size_t x = 0; x < bitmap->size().x(); ++x) {
-                    ScalarColor3f rgb = dr::load<ScalarVector3f>(in_ptr);
-                    ScalarFloat lum = mitsuba::luminance(rgb);
-                    min_lum = dr::minimum(min_lum, lum);
-                    lum_accum_d += (double) lum;
-                    in_ptr += 4;
-                }
+            if (props.has_property("cache_file")) {
+                cache_path = props.string("cache_file");
+                hash = file_hash(file_path);
             }
-            in_ptr = (ScalarFloat *) bitmap->data();
-
-            luminance_offset = ScalarFloat(lum_accum_d / dr::prod(bitmap->size()));
-
-            /* Be wary of constant environment maps: average and minimum
-               should be sufficiently different */
-            if (luminance_offset - min_lum <= 0.01f * luminance_offset)
-                luminance_offset = 0.f; // disable
         }
 
-        size_t pixel_width = is_spectral_v<Spectrum> ? 4 : 3;
-        for (size_t y = 0; y < bitmap->size().y(); ++y) {
-            ScalarFloat sin_theta = dr::sin(y * theta_scale);
-
-            for (size_t x = 0; x < bitmap->size().x(); ++x) {
-                ScalarColor3f rgb = dr::load<ScalarVector3f>(in_ptr);
-
-                ScalarFloat lum = mitsuba::luminance(rgb);
-
-                ScalarPixelData coeff;
-                if constexpr (is_monochromatic_v<Spectrum>) {
-                    coeff = ScalarPixelData(lum);
-                } else if constexpr (is_rgb_v<Spectrum>) {
-                    coeff = rgb;
-                } else {
-                    static_assert(is_spectral_v<Spectrum>);
-                    /* Evaluate the spectral upsampling model. This requires a
-                       reflectance value (colors in [0, 1]) which is accomplished here by
-                       scaling. We use a color where the highest component is 50%,
-                       which generally yields a fairly smooth spectrum. */
-                    ScalarFloat scale = dr::max(rgb) * 2.f;
-                    ScalarColor3f rgb_norm = rgb / dr::maximum(1e-8f, scale);
-                    coeff = dr::concat((ScalarColor3f) srgb_model_fetch(rgb_norm),
-                                       dr::Array<ScalarFloat, 1>(scale));
-                }
+        bool mis_compensation = props.get<bool>("mis_compensation", false);
+        uint32_t flags = cache_flags(mis_compensation);
+
+        ScalarVector2u res;
+        std::unique_ptr<ScalarFloat[]> pixels, luminance;
+        if (cache_path.empty() ||
+            !read_cache(cache_path, hash, flags, res, pixels, luminance)) {
+            if (!bitmap)
+                bitmap = new Bitmap(file_path);
+
+            if (bitmap->width() < 2 || bitmap->height() < 3)
+                Throw("\"%s\": the environment map resolution must be at least "
+                      "2x3 pixels", (m_filename.empty() ? "<Bitmap>" : m_filename));
+
+            /* Allocate a larger image including an extra column to
+               account for the periodic boundary */
+            res = ScalarVector2u(bitmap->width() + 1, bitmap->height());
+            pixels = std::unique_ptr<ScalarFloat[]>(
+                new ScalarFloat[dr::prod(res) * PixelWidth]);
+            luminance = std::unique_ptr<ScalarFloat[]>(
+                new ScalarFloat[dr::prod(res)]);
 
-                lum = dr::maximum(lum - luminance_offset, 0.f);
+            preprocess(bitmap, mis_compensation, pixels.get(), luminance.get());
 
-                *lum_ptr++ = lum * sin_theta;
-                dr::store(out_ptr, coeff);
-                in_ptr += pixel_width;
-                out_ptr += pixel_width;
-            }
-
-            // Last column of pixels mirrors first
-            ScalarFloat temp = *(lum_ptr - bitmap->size().x());
-            *lum_ptr++ = temp;
-            dr::store(out_ptr, dr::load<ScalarPixelData>(
-                                   out_ptr - bitmap->size().x() * pixel_width));
-            out_ptr += pixel_width;
+            if (!cache_path.empty())
+                write_cache(cache_path, hash, flags, res, pixels.get(),
+                            luminance.get());
         }
 
-        size_t shape[3] = { (size_t) res.y(), (size_t) res.x(), pixel_width };
-        m_data = TensorXf(bitmap_2->data(), 3, shape);
+        size_t shape[3] = { (size_t) res.y(), (size_t) res.x(), PixelWidth };
+        m_data = TensorXf(pixels.get(), 3, shape);
 
         m_scale = props.get<ScalarFloat>("scale", 1.f);
         m_warp = Warp(luminance.get(), res);
@@ -583,6 +533,246 @@ protected:
     Warp m_warp;
     ref<Texture> m_d65;
     Float m_scale;
+
+private:
+    /// Number of values stored per pixel
+    static constexpr size_t PixelWidth = is_spectral_v<Spectrum> ? 4 : 3;
+
+    /**
+     * \brief Convert the pixels of the environment map into the stored
+     * representation and compute the luminance used for importance sampling
+     *
+     * Both output images have an extra column mirroring the first one.
+     * Blocks of rows are processed in parallel.
+     */
+    void preprocess(const Bitmap *bitmap, bool mis_compensation,
+                    ScalarFloat *pixels, ScalarFloat *luminance) const {
+        /* Convert to linear RGBA float bitmap, will undergo further
+           conversion into coefficients of a spectral upsampling model below */
+        Bitmap::PixelFormat pixel_format = Bitmap::PixelFormat::RGB;
+        if constexpr (is_spectral_v<Spectrum>)
+            pixel_format = Bitmap::PixelFormat::RGBA;
+        ref<Bitmap> rgb_bitmap =
+            bitmap->convert(pixel_format, struct_type_v<ScalarFloat>, false);
+
+        const ScalarFloat *in = (const ScalarFloat *) rgb_bitmap->data();
+        ScalarVector2u size(rgb_bitmap->width(), rgb_bitmap->height());
+        uint32_t width = size.x() + 1;
+
+        // Rows per parallel work unit (at least ~16K pixels)
+        uint32_t grain = dr::maximum(16384u / size.x(), 1u);
+
+        /* "MIS Compensation: Optimizing Sampling Techniques in Multiple
+           Importance Sampling" Ondrej Karlik, Martin Sik, Petr Vivoda, Tomas
+           Skrivan, and Jaroslav Krivanek. SIGGRAPH Asia 2019 */
+        ScalarFloat luminance_offset = 0.f;
+        if (mis_compensation) {
+            // Per-row statistics, combined in a fixed order below
+            std::unique_ptr<ScalarFloat[]> row_min(new ScalarFloat[size.y()]);
+            std::unique_ptr<double[]> row_sum(new double[size.y()]);
+
+            dr::parallel_for(
+                dr::blocked_range<uint32_t>(0, size.y(), grain),
+                [&](const dr::blocked_range<uint32_t> &range) {
+                    for (uint32_t y = range.begin(); y != range.end(); ++y) {
+                        const ScalarFloat *ptr = in + (size_t) y * size.x() * PixelWidth;
+                        ScalarFloat min_lum = 0.f;
+                        double lum_accum_d = 0.0;
+                        for (uint32_t x = 0; x < size.x(); ++x) {
+                            ScalarColor3f rgb = dr::load<ScalarVector3f>(ptr);
+                            ScalarFloat lum = mitsuba::luminance(rgb);
+                            min_lum = dr::minimum(min_lum, lum);
+                            lum_accum_d += (double) lum;
+                            ptr += PixelWidth;
+                        }
+                        row_min[y] = min_lum;
+                        row_sum[y] = lum_accum_d;
+                    }
+                }
+            );
+
+            ScalarFloat min_lum = 0.f;
+            double lum_accum_d = 0.0;
+            for (uint32_t y = 0; y < size.y(); ++y) {
+                min_lum = dr::minimum(min_lum, row_min[y]);
+                lum_accum_d += row_sum[y];
+            }
+
+            luminance_offset = ScalarFloat(lum_accum_d / dr::prod(size));
+
+            /* Be wary of constant environment maps: average and minimum
+               should be sufficiently different */
+            if (luminance_offset - min_lum <= 0.01f * luminance_offset)
+                luminance_offset = 0.f; // disable
+        }
+
+        ScalarFloat theta_scale = 1.f / (size.y() - 1) * dr::Pi<Float>;
+
+        dr::parallel_for(
+            dr::blocked_range<uint32_t>(0, size.y(), grain),
+            [&](const dr::blocked_range<uint32_t> &range) {
+                for (uint32_t y = range.begin(); y != range.end(); ++y) {
+                    const ScalarFloat *in_ptr = in + (size_t) y * size.x() * PixelWidth;
+                    ScalarFloat *out_ptr = pixels + (size_t) y * width * PixelWidth,
+                                *lum_ptr = luminance + (size_t) y * width;
+                    ScalarFloat sin_theta = dr::sin(y * theta_scale);
+
+                    for (uint32_t x = 0; x < size.x(); ++x) {
+                        ScalarColor3f rgb = dr::load<ScalarVector3f>(in_ptr);
+
+                        ScalarFloat lum = mitsuba::luminance(rgb);
+
+                        ScalarPixelData coeff;
+                        if constexpr (is_monochromatic_v<Spectrum>) {
+                            coeff = ScalarPixelData(lum);
+                        } else if constexpr (is_rgb_v<Spectrum>) {
+                            coeff = rgb;
+                        } else {
+                            static_assert(is_spectral_v<Spectrum>);
+                            /* Evaluate the spectral upsampling model. This requires a
+                               reflectance value (colors in [0, 1]) which is accomplished here by
+                               scaling. We use a color where the highest component is 50%,
+                               which generally yields a fairly smooth spectrum. */
+                            ScalarFloat scale = dr::max(rgb) * 2.f;
+                            ScalarColor3f rgb_norm = rgb / dr::maximum(1e-8f, scale);
+                            coeff = dr::concat((ScalarColor3f) srgb_model_fetch(rgb_norm),
+                                               dr::Array<ScalarFloat, 1>(scale));
+                        }
+
+                        lum = dr::maximum(lum - luminance_offset, 0.f);
+
+                        *lum_ptr++ = lum * sin_theta;
+                        dr::store(out_ptr, coeff);
+                        in_ptr += PixelWidth;
+                        out_ptr += PixelWidth;
+                    }
+
+                    // Last column of pixels mirrors first
+                    *lum_ptr = *(lum_ptr - size.x());
+                    dr::store(out_ptr, dr::load<ScalarPixelData>(
+                                           out_ptr - size.x() * PixelWidth));
+                }
+            }
+        );
+    }
+
+    /// Version of the preprocessing cache file format
+    static constexpr uint8_t CacheVersion = 1;
+
+    /// Describes the variant-dependent contents of a preprocessing cache file
+    static uint32_t cache_flags(bool mis_compensation) {
+        return (mis_compensation ? 1u : 0u) |
+               (is_monochromatic_v<Spectrum> ? 2u : 0u) |
+               (is_spectral_v<Spectrum> ? 4u : 0u) |
+               ((uint32_t) sizeof(ScalarFloat) << 8);
+    }
+
+    /// Compute a 64-bit FNV-1a hash of the contents of a file (in 8-byte words)
+    static uint64_t file_hash(const fs::path &path) {
+        ref<MemoryMappedFile> mmap = new MemoryMappedFile(path);
+        const uint8_t *data = (const uint8_t *) mmap->data();
+        size_t size = mmap->size();
+
+        uint64_t hash = 0xcbf29ce484222325ull ^ (uint64_t) size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * 0x100000001b3ull;
+        }
+        for (; i < size; ++i)
+            hash = (hash ^ data[i]) * 0x100000001b3ull;
+        return hash;
+    }
+
+    /**
+     * \brief Try to load the preprocessed environment map from a cache file
+     *
+     * The cache file stores the following header
+     *
+     * - Bytes 1-3: ASCII bytes 'M', 'E', and 'C'
+     * - Byte 4: File format version number (currently 1)
+     * - Bytes 5-12: Hash of the source image file (uint64, see \ref file_hash())
+     * - Bytes 13-16: Variant-dependent flags (uint32, see \ref cache_flags())
+     * - Bytes 17-24: Resolution including the extra column (2x uint32)
+     *
+     * followed by the pixel data and the luminance image.
+     *
+     * Returns \c false when the file does not exist or is out of date.
+     */
+    bool read_cache(const fs::path &path, uint64_t hash, uint32_t flags,
+                    ScalarVector2u &res,
+                    std::unique_ptr<ScalarFloat[]> &pixels,
+                    std::unique_ptr<ScalarFloat[]> &luminance) const {
+        if (!fs::exists(path))
+            return false;
+
+        ref<FileStream> stream = new FileStream(path, FileStream::ERead);
+        char magic[4];
+        uint64_t source_hash = 0;
+        uint32_t file_flags = 0, width = 0, height = 0;
+
+        if (stream->size() >= 24) {
+            stream->read(magic, 4);
+            stream->read(source_hash);
+            stream->read(file_flags);
+            stream->read(width);
+            stream->read(height);
+        }
+
+        size_t pixel_count = (size_t) width * height;
+        if (stream->size() < 24 || memcmp(magic, "MEC", 3) != 0 ||
+            magic[3] != CacheVersion || source_hash != hash ||
+            file_flags != flags || width < 3 || height < 3 ||
+            stream->size() != 24 + pixel_count * (PixelWidth + 1) * sizeof(ScalarFloat)) {
+            Log(Info, "Environment map cache \"%s\" is out of date.", path);
+            return false;
+        }
+
+        res = ScalarVector2u(width, height);
+        pixels = std::unique_ptr<ScalarFloat[]>(new ScalarFloat[pixel_count * PixelWidth]);
+        luminance = std::unique_ptr<ScalarFloat[]>(new ScalarFloat[pixel_count]);
+        stream->read_array(pixels.get(), pixel_count * PixelWidth);
+        stream->read_array(luminance.get(), pixel_count);
+
+        Log(Debug, "Loaded environment map cache \"%s\"", path);
+        return true;
+    }
+
+    /// Write the preprocessed environment map to a cache file (see \ref read_cache())
+    void write_cache(const fs::path &path, uint64_t hash, uint32_t flags,
+                     const ScalarVector2u &res, const ScalarFloat *pixels,
+                     const ScalarFloat *luminance) const {
+        size_t pixel_count = dr::prod(res);
+
+        // Write to a temporary file first to never leave a partial cache file
+        fs::path temp_path(path.string() + ".tmp");
+        try {
+            {
+                ref<FileStream> stream =
+                    new FileStream(temp_path, FileStream::ETruncReadWrite);
+                stream->write("MEC", 3);
+                stream->write(CacheVersion);
+                stream->write(hash);
+                stream->write(flags);
+                stream->write(res.x());
+                stream->write(res.y());
+                stream->write_array(pixels, pixel_count * PixelWidth);
+                stream->write_array(luminance, pixel_count);
+            }
+            if (fs::exists(path))
+                fs::remove(path);
+            if (!fs::rename(temp_path, path))
+                Throw("unable to rename \"%s\"", temp_path);
+        } catch (const std::exception &e) {
+            Log(Warn, "Could not write environment map cache \"%s\": %s",
+                path, e.what());
+            return;
+        }
+
+        Log(Debug, "Created environment map cache \"%s\" (%s)", path,
+            util::mem_string(fs::file_size(path)));
+    }
 };
 
 MI_IMPLEMENT_CLASS_VARIANT(EnvironmentMapEmitter, Emitter)
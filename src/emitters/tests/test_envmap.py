@@ -135,3 +135,96 @@ def test04_parameters_changed(variants_all):
 
     params = mi.traverse(emitter)
     assert dr.allclose(params['data'], 1)
+
+
+def test05_preprocess_parallel(variants_all_rgb, np_rng):
+    import numpy as np
+
+    # Large enough to be split into several blocks of rows
+    img = np_rng.random((256, 512, 3)).astype(np.float32)
+    emitter = mi.load_dict({
+        "type" : "envmap",
+        "bitmap" : mi.Bitmap(img),
+        "mis_compensation" : True
+    })
+
+    data = np.array(mi.traverse(emitter)['data'])
+    assert data.shape == (256, 513, 3)
+    if mi.is_rgb:
+        assert np.allclose(data[:, :-1], img)
+    else:
+        lum = img @ np.array([0.212671, 0.715160, 0.072169], dtype=np.float32)
+        assert np.allclose(data[:, :-1, 0], lum, atol=1e-5)
+    assert np.all(data[:, -1] == data[:, 0])
+
+    # Sampling remains consistent with the density
+    rng = mi.PCG32(size=1024)
+    si = dr.zeros(mi.SurfaceInteraction3f)
+    ds, _ = emitter.sample_direction(si, mi.Point2f(rng.next_float32(),
+                                                    rng.next_float32()))
+    assert dr.allclose(ds.pdf, emitter.pdf_direction(si, ds), rtol=1e-3)
+
+
+def test06_preprocess_cache(variants_all, tmp_path, np_rng):
+    import numpy as np
+
+    fname = str(tmp_path / 'envmap.exr')
+    cache = str(tmp_path / 'envmap.cache')
+    mi.Bitmap(np_rng.random((32, 64, 3)).astype(np.float32)).write(fname)
+
+    def load():
+        emitter = mi.load_dict({
+            "type" : "envmap",
+            "filename" : fname,
+            "cache_file" : cache
+        })
+        return np.array(mi.traverse(emitter)['data'])
+
+    # The first load creates the cache file, the second one uses it
+    reference = load()
+    assert os.path.exists(cache)
+    mtime = os.stat(cache).st_mtime_ns
+    assert np.all(load() == reference)
+    assert os.stat(cache).st_mtime_ns == mtime
+
+    # The cache is recreated when the image changes
+    mi.Bitmap(np.ones((32, 64, 3), dtype=np.float32)).write(fname)
+    data = load()
+    assert not np.all(data == reference)
+    assert np.all(load() == data)
+
+    with pytest.raises(RuntimeError, match='requires'):
+        mi.load_dict({
+            "type" : "envmap",
+            "bitmap" : mi.Bitmap(np.ones((32, 64, 3), dtype=np.float32)),
+            "cache_file" : cache
+        })
+
+
+@pytest.mark.slow
+def test07_preprocess_large(variant_scalar_spectral, tmp_path, np_rng):
+    import numpy as np
+
+    fname = str(tmp_path / 'envmap.exr')
+    cache = str(tmp_path / 'envmap.cache')
+    mi.Bitmap(np_rng.random((4096, 8192, 3)).astype(np.float32)).write(fname)
+
+    # Creating and reading the cache must reproduce the uncached preprocessing
+    results = []
+    for props in [{}, { 'cache_file': cache }, { 'cache_file': cache }]:
+        emitter = mi.load_dict({ "type" : "envmap", "filename" : fname, **props })
+        si = dr.zeros(mi.SurfaceInteraction3f)
+        sampler = mi.load_dict({'type': 'independent'})
+        sampler.seed(0)
+        samples = []
+        for i in range(64):
+            ds, _ = emitter.sample_direction(si, sampler.next_2d())
+            samples.append((ds.d, ds.pdf))
+        results.append((np.array(mi.traverse(emitter)['data']), samples))
+    assert os.path.exists(cache)
+
+    data_ref, samples_ref = results[0]
+    for data, samples in results[1:]:
+        assert np.all(data == data_ref)
+        for (d, pdf), (d_ref, pdf_ref) in zip(samples, samples_ref):
+            assert dr.allclose(d, d_ref) and dr.allclose(pdf, pdf_ref)
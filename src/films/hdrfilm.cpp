@@ -7,7 +7,9 @@
 #include <mitsuba/render/fwd.h>
 #include <mitsuba/render/imageblock.h>
 
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 
 NAMESPACE_BEGIN(mitsuba)
 
@@ -258,10 +260,15 @@ public:
             channels[base_channels + i] = aovs[i];
 
         /* locked */ {
-            std::lock_guard<std::mutex> lock(m_mutex);
+            std::lock_guard<std::shared_mutex> lock(m_mutex);
             m_storage = new ImageBlock(m_crop_size, m_crop_offset,
                                        (uint32_t) channels.size());
             m_channels = channels;
+
+            if constexpr (!dr::is_jit_v<Float>) {
+                m_stripe_count = (m_crop_size.y() + StripeHeight - 1) / StripeHeight;
+                m_stripes.reset(new std::mutex[std::max(m_stripe_count, 1u)]);
+            }
         }
 
         std::sort(channels.begin(), channels.end());
@@ -292,8 +299,40 @@ public:
 
     void put_block(const ImageBlock *block) override {
         Assert(m_storage != nullptr);
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_storage->put_block(block);
+
+        if constexpr (dr::is_jit_v<Float>) {
+            std::lock_guard<std::shared_mutex> lock(m_mutex);
+            m_storage->put_block(block);
+        } else {
+            /* Blocks produced by different workers mostly touch disjoint
+               rows of the film. Instead of serializing all of them, only
+               lock the horizontal stripes that overlap the block (including
+               its border). Stripes are always acquired in increasing order,
+               which rules out deadlocks. */
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+            int y_begin = block->offset().y() - (int) block->border_size() -
+                          (int) m_storage->offset().y(),
+                y_end   = y_begin + (int) block->size().y() +
+                          2 * (int) block->border_size();
+
+            y_begin = std::max(y_begin, 0);
+            y_end   = std::min(y_end, (int) m_storage->size().y());
+
+            if (y_begin >= y_end)
+                return;
+
+            uint32_t s_begin = (uint32_t) y_begin / StripeHeight,
+                     s_end   = ((uint32_t) y_end - 1) / StripeHeight + 1;
+
+            for (uint32_t i = s_begin; i < s_end; ++i)
+                m_stripes[i].lock();
+
+            m_storage->put_block(block);
+
+            for (uint32_t i = s_begin; i < s_end; ++i)
+                m_stripes[i].unlock();
+        }
     }
 
     void clear() override {
@@ -306,7 +345,7 @@ public:
             Throw("No storage allocated, was prepare() called first?");
 
         if (raw) {
-            std::lock_guard<std::mutex> lock(m_mutex);
+            std::lock_guard<std::shared_mutex> lock(m_mutex);
             return m_storage->tensor();
         }
 
@@ -317,7 +356,7 @@ public:
             ScalarVector2i size;
 
             /* locked */ {
-                std::lock_guard<std::mutex> lock(m_mutex);
+                std::lock_guard<std::shared_mutex> lock(m_mutex);
                 data        = m_storage->tensor().array();
                 size        = m_storage->size();
                 source_ch   = (uint32_t) m_storage->channel_count();
@@ -421,7 +460,7 @@ public:
         if (!m_storage)
             Throw("No storage allocated, was prepare() called first?");
 
-        std::lock_guard<std::mutex> lock(m_mutex);
+        std::lock_guard<std::shared_mutex> lock(m_mutex);
         auto &&storage = dr::migrate(m_storage->tensor().array(), AllocType::Host);
 
         if constexpr (dr::is_jit_v<Float>)
@@ -543,7 +582,7 @@ public:
         return target;
     }
 
-    void write(const fs::path &path) const override {
+    fs::path output_path(const fs::path &path) const override {
         fs::path filename = path;
         std::string proper_extension;
         if (m_file_format == Bitmap::FileFormat::OpenEXR)
@@ -556,6 +595,11 @@ public:
         std::string extension = string::to_lower(filename.extension().string());
         if (extension != proper_extension)
             filename.replace_extension(proper_extension);
+        return filename;
+    }
+
+    void write(const fs::path &path) const override {
+        fs::path filename = output_path(path);
 
         #if !defined(_WIN32)
             Log(Info, "\U00002714  Developing \"%s\" ..", filename.string());
@@ -611,8 +655,18 @@ protected:
     Struct::Type m_component_format;
     bool m_compensate;
     ref<ImageBlock> m_storage;
-    mutable std::mutex m_mutex;
     std::vector<std::string> m_channels;
+
+    /* Exclusively held while the storage is (re)allocated or read back, and
+       shared by concurrent put_block() calls in scalar variants */
+    mutable std::shared_mutex m_mutex;
+
+    /// Height (in pixels) of the film regions protected by a common lock
+    static constexpr uint32_t StripeHeight = 8;
+
+    /// Per-stripe locks serializing overlapping put_block() calls
+    std::unique_ptr<std::mutex[]> m_stripes;
+    uint32_t m_stripe_count = 0;
 };
 
 MI_IMPLEMENT_CLASS_VARIANT(HDRFilm, Film)
@@ -420,13 +420,18 @@ public:
         return target;
     }
 
-    void write(const fs::path &path) const override {
+    fs::path output_path(const fs::path &path) const override {
         fs::path filename = path;
         std::string proper_extension = ".exr";
 
         std::string extension = string::to_lower(filename.extension().string());
         if (extension != proper_extension)
             filename.replace_extension(proper_extension);
+        return filename;
+    }
+
+    void write(const fs::path &path) const override {
+        fs::path filename = output_path(path);
 
         #if !defined(_WIN32)
             Log(Info, "\U00002714  Developing \"%s\" ..", filename.string());
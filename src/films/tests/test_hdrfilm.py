@@ -236,3 +236,43 @@ def test07_luminance_alpha_mono(variants_all):
     image = mi.TensorXf(film.bitmap())
 
     assert image.shape[2] == 2
+
+
+def test08_put_block_concurrent(variant_scalar_rgb):
+    from threading import Thread
+    import numpy as np
+
+    def make_film():
+        film = mi.load_dict({
+            'type': 'hdrfilm',
+            'width': 64,
+            'height': 48,
+            'filter': { 'type': 'gaussian' }
+        })
+        film.prepare([])
+        return film
+
+    # Blocks overlap due to the filter border, so neighboring rows of blocks
+    # compete for the same film stripes
+    def worker(film, y):
+        block = film.create_block(mi.ScalarVector2u(16, 16), False, True)
+        for x in range(0, 64, 16):
+            block.set_offset([x, y])
+            block.clear()
+            for i in range(16):
+                block.put(mi.Point2f(x + i + .5, y + i + .5), [1, 1, 1, 1])
+            film.put_block(block)
+
+    film_ref = make_film()
+    for y in range(0, 48, 16):
+        worker(film_ref, y)
+
+    film = make_film()
+    threads = [Thread(target=worker, args=(film, y)) for y in range(0, 48, 16)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    assert np.allclose(np.array(film.develop(raw=True)),
+                       np.array(film_ref.develop(raw=True)), atol=1e-6)
@@ -0,0 +1,1020 @@
+#include <mitsuba/core/atomic.h>
+#include <mitsuba/core/properties.h>
+#include <mitsuba/core/ray.h>
+#include <mitsuba/core/timer.h>
+#include <mitsuba/core/util.h>
+#include <mitsuba/core/warp.h>
+#include <mitsuba/render/bsdf.h>
+#include <mitsuba/render/emitter.h>
+#include <mitsuba/render/film.h>
+#include <mitsuba/render/integrator.h>
+#include <mitsuba/render/records.h>
+#include <mitsuba/render/sampler.h>
+#include <mitsuba/render/sensor.h>
+#include <nanothread/nanothread.h>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**!
+
+.. _integrator-guided_path:
+
+Guided path tracer (:monosp:`guided_path`)
+------------------------------------------
+
+.. pluginparameters::
+
+ * - max_depth
+   - |int|
+   - Specifies the longest path depth in the generated output image (where -1
+     corresponds to :math:`\infty`). A value of 1 will only render directly
+     visible light sources. 2 will lead to single-bounce (direct-only)
+     illumination, and so on. (Default: -1)
+
+ * - rr_depth
+   - |int|
+   - Specifies the path depth, at which the implementation will begin to use
+     the *russian roulette* path termination criterion. (Default: 5)
+
+ * - hide_emitters
+   - |bool|
+   - Hide directly visible emitters. (Default: no, i.e. |false|)
+
+ * - training_budget
+   - |float|
+   - Fraction of the sample budget that is spent on learning the guiding
+     distribution. (Default: 0.3)
+
+ * - bsdf_sampling_fraction
+   - |float|
+   - Probability of sampling directions from the BSDF instead of the guiding
+     distribution. (Default: 0.5)
+
+ * - spatial_threshold
+   - |int|
+   - Number of path vertices after which a cell of the spatial tree is
+     subdivided. The threshold grows with the square root of the number of
+     samples per pixel of the training iteration. (Default: 12000)
+
+ * - directional_threshold
+   - |float|
+   - Fraction of the incident energy above which a cell of a directional
+     quadtree is subdivided. (Default: 0.01)
+
+This integrator extends the :ref:`path tracer <integrator-path>` with *path
+guiding* based on the SD-tree of Müller et al. :cite:`Muller2017Guiding`. It
+learns an approximation of the incident radiance at every point of the scene
+and uses it to sample directions towards the regions that contribute the most
+light, which can drastically reduce noise in scenes where most of the light
+arrives indirectly, e.g. interiors lit through small openings.
+
+The incident radiance is represented by a binary tree over the bounding box of
+the scene (the *spatial* tree), whose leaves each hold a quadtree over the
+sphere of directions (the *directional* trees). The integrator first renders
+a sequence of training iterations with 1, 2, 4, ... samples per pixel. Each
+iteration records the radiance arriving at the vertices of its paths, and the
+trees are refined and rebuilt from these records before the next iteration
+starts. The final image is then rendered with the remaining samples, where
+each direction is sampled either from the BSDF or from the learned
+distribution (one-sample multiple importance sampling).
+
+The training iterations count towards the sample budget of the sensor's
+sampler but do not contribute to the final image.
+
+.. note:: This integrator does not handle participating media and is not
+   differentiable. Directions are only guided at vertices whose BSDF has smooth
+   components.
+
+.. tabs::
+    .. code-tab::  xml
+        :name: guided-path-integrator
+
+        <integrator type="guided_path">
+            <integer name="max_depth" value="8"/>
+        </integrator>
+
+    .. code-tab:: python
+
+        'type': 'guided_path',
+        'max_depth': 8
+
+ */
+
+template <typename Float, typename Spectrum>
+class GuidedPathIntegrator : public MonteCarloIntegrator<Float, Spectrum> {
+public:
+    MI_IMPORT_BASE(MonteCarloIntegrator, m_max_depth, m_rr_depth,
+                   m_hide_emitters, m_samples_per_pass, m_stop, should_stop)
+    MI_IMPORT_TYPES(Scene, Sensor, Sampler, Medium, Emitter, EmitterPtr, BSDF,
+                    BSDFPtr)
+
+    using FloatStorage  = DynamicBuffer<Float>;
+    using UInt32Storage = DynamicBuffer<UInt32>;
+
+    /// Maximum depth of the directional quadtrees
+    static constexpr uint32_t MaxQuadDepth = 20;
+
+    /// Maximum number of recorded vertices per path
+    static constexpr uint32_t MaxRecordDepth = 16;
+
+    GuidedPathIntegrator(const Properties &props) : Base(props) {
+        m_training_budget = props.get<ScalarFloat>("training_budget", .3f);
+        m_bsdf_fraction = props.get<ScalarFloat>("bsdf_sampling_fraction", .5f);
+        m_spatial_threshold = props.get<uint32_t>("spatial_threshold", 12000);
+        m_directional_threshold =
+            props.get<ScalarFloat>("directional_threshold", .01f);
+
+        if (m_training_budget < 0.f || m_training_budget >= 1.f)
+            Throw("\"training_budget\" must be in the range [0, 1)!");
+        if (m_bsdf_fraction < 0.f || m_bsdf_fraction > 1.f)
+            Throw("\"bsdf_sampling_fraction\" must be in the range [0, 1]!");
+        if (m_spatial_threshold == 0 || m_directional_threshold <= 0.f)
+            Throw("The subdivision thresholds must be positive!");
+
+        m_record_depth = std::min(m_max_depth, MaxRecordDepth);
+        m_training = false;
+    }
+
+    TensorXf render(Scene *scene,
+                    Sensor *sensor,
+                    uint32_t seed = 0,
+                    uint32_t spp = 0,
+                    bool develop = true,
+                    bool evaluate = true) override {
+        Sampler *sampler = sensor->sampler();
+        if (spp)
+            sampler->set_sample_count(spp);
+        spp = sampler->sample_count();
+
+        reset_guiding(scene->bbox());
+
+        uint32_t training_spp = std::min((uint32_t) (spp * m_training_budget),
+                                         spp - 1),
+                 trained_spp = 0, iteration = 0;
+
+        /* Limit the size of the wavefronts of JIT variants, since every path
+           stores its vertices while training */
+        uint32_t samples_per_pass = m_samples_per_pass;
+        if constexpr (dr::is_jit_v<Float>) {
+            Film *film = sensor->film();
+            ScalarVector2u film_size = film->crop_size();
+            if (film->sample_border())
+                film_size += 2 * film->rfilter()->border_size();
+            uint64_t records = (uint64_t) dr::prod(film_size) *
+                               std::max(m_record_depth, 1u);
+            uint64_t max_spp = std::max((uint64_t) 1, (uint64_t(1) << 25) / records);
+            m_samples_per_pass = std::min(
+                samples_per_pass, 1u << dr::log2i((uint32_t) std::min(
+                                      max_spp, (uint64_t) 0x80000000u)));
+        }
+
+        Timer timer;
+        m_training = true;
+        for (uint32_t pass_spp = 1; trained_spp + pass_spp <= training_spp;
+             pass_spp *= 2, ++iteration) {
+            Log(Info, "Path guiding: training iteration %u (%u sample%s per pixel)",
+                iteration + 1, pass_spp, pass_spp == 1 ? "" : "s");
+            Base::render(scene, sensor, seed + iteration + 1, pass_spp, false, true);
+            if (m_stop)
+                break;
+            update_guiding(iteration);
+            trained_spp += pass_spp;
+        }
+        m_training = false;
+        m_samples_per_pass = samples_per_pass;
+
+        TensorXf result;
+        if (!m_stop) {
+            Log(Info, "Path guiding: trained in %u iteration%s (%u spp, took %s), "
+                "%zu spatial cells, %zu directional nodes.", iteration,
+                iteration == 1 ? "" : "s", trained_spp,
+                util::time_string((float) timer.value()),
+                m_sampling.size(), quad_node_count());
+
+            result = Base::render(scene, sensor, seed, spp - trained_spp,
+                                  develop, evaluate);
+        }
+
+        sampler->set_sample_count(spp);
+        return result;
+    }
+
+    std::pair<Spectrum, Bool> sample(const Scene *scene,
+                                     Sampler *sampler,
+                                     const RayDifferential3f &ray_,
+                                     const Medium * /* medium */,
+                                     Float * /* aovs */,
+                                     Bool active) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::SamplingIntegratorSample, active);
+
+        if (unlikely(m_max_depth == 0))
+            return { 0.f, false };
+
+        // Storage for the path vertices that are recorded during training
+        const bool training = m_training && m_record_depth > 0;
+        const uint32_t record_depth = training ? m_record_depth : 0u;
+        size_t width = dr::width(ray_.o.x());
+        Records records;
+        UInt32 path_index = 0;
+        if (training) {
+            size_t slots = width * record_depth;
+            records.position       = dr::zeros<FloatStorage>(slots * 3);
+            records.direction      = dr::zeros<FloatStorage>(slots * 2);
+            records.pdf            = dr::zeros<FloatStorage>(slots);
+            records.radiance       = dr::zeros<FloatStorage>(slots * SpectrumChannels);
+            records.inv_throughput = dr::zeros<FloatStorage>(slots * SpectrumChannels);
+            records.result         = dr::zeros<FloatStorage>(width * SpectrumChannels);
+            if constexpr (dr::is_jit_v<Float>)
+                path_index = dr::arange<UInt32>((uint32_t) width);
+        }
+
+        // --------------------- Configure loop state ----------------------
+
+        Ray3f ray                     = Ray3f(ray_);
+        Spectrum throughput           = 1.f;
+        Spectrum result               = 0.f;
+        Float eta                     = 1.f;
+        UInt32 depth                  = 0;
+
+        // If m_hide_emitters == false, the environment emitter will be visible
+        Mask valid_ray = !m_hide_emitters && (scene->environment() != nullptr);
+
+        // Variables caching information from the previous bounce
+        Interaction3f prev_si         = dr::zeros<Interaction3f>();
+        Float         prev_bsdf_pdf   = 1.f;
+        Bool          prev_bsdf_delta = true;
+        BSDFContext   bsdf_ctx;
+
+        struct LoopState {
+            Ray3f ray;
+            Spectrum throughput;
+            Spectrum result;
+            Float eta;
+            UInt32 depth;
+            Mask valid_ray;
+            Interaction3f prev_si;
+            Float prev_bsdf_pdf;
+            Bool prev_bsdf_delta;
+            Bool active;
+            Sampler* sampler;
+
+            DRJIT_STRUCT(LoopState, ray, throughput, result, eta, depth, \
+                valid_ray, prev_si, prev_bsdf_pdf, prev_bsdf_delta,
+                active, sampler)
+        } ls = {
+            ray,
+            throughput,
+            result,
+            eta,
+            depth,
+            valid_ray,
+            prev_si,
+            prev_bsdf_pdf,
+            prev_bsdf_delta,
+            active,
+            sampler
+        };
+
+        dr::tie(ls) = dr::while_loop(dr::make_tuple(ls),
+            [](const LoopState& ls) { return ls.active; },
+            [this, scene, bsdf_ctx, record_depth, path_index,
+             &records](LoopState& ls) {
+
+            SurfaceInteraction3f si =
+                scene->ray_intersect(ls.ray,
+                                     /* ray_flags = */ +RayFlags::All,
+                                     /* coherent = */ ls.depth == 0u);
+
+            // ---------------------- Direct emission ----------------------
+
+            if (dr::any_or<true>(si.emitter(scene) != nullptr)) {
+                DirectionSample3f ds(scene, si, ls.prev_si);
+                Float em_pdf = 0.f;
+
+                if (dr::any_or<true>(!ls.prev_bsdf_delta))
+                    em_pdf = scene->pdf_emitter_direction(ls.prev_si, ds,
+                                                          !ls.prev_bsdf_delta);
+
+                // Compute MIS weight for emitter sample from previous bounce
+                Float mis_bsdf = mis_weight(ls.prev_bsdf_pdf, em_pdf);
+
+                // Accumulate, being careful with polarization (see spec_fma)
+                ls.result = spec_fma(
+                    ls.throughput,
+                    ds.emitter->eval(si, ls.prev_bsdf_pdf > 0.f) * mis_bsdf,
+                    ls.result);
+            }
+
+            // Continue tracing the path at this point?
+            Bool active_next = (ls.depth + 1 < m_max_depth) && si.is_valid();
+
+            if (dr::none_or<false>(active_next)) {
+                ls.active = active_next;
+                return; // early exit for scalar mode
+            }
+
+            BSDFPtr bsdf = si.bsdf(ls.ray);
+
+            // Guide the sampling of vertices with smooth BSDF components
+            Mask guided = active_next && has_flag(bsdf->flags(), BSDFFlags::Smooth);
+            UInt32 guide_root = 0;
+            if (dr::any_or<true>(guided))
+                guide_root = guide_lookup(si.p, guided);
+
+            // ---------------------- Emitter sampling ----------------------
+
+            // Perform emitter sampling?
+            Mask active_em = guided;
+
+            DirectionSample3f ds = dr::zeros<DirectionSample3f>();
+            Spectrum em_weight = dr::zeros<Spectrum>();
+            Vector3f wo = dr::zeros<Vector3f>();
+
+            if (dr::any_or<true>(active_em)) {
+                // Sample the emitter
+                std::tie(ds, em_weight) = scene->sample_emitter_direction(
+                    si, ls.sampler->next_2d(), true, active_em);
+                active_em &= (ds.pdf != 0.f);
+                wo = si.to_local(ds.d);
+            }
+
+            // ------ Evaluate BSDF * cos(theta) and sample direction -------
+
+            Float sample_1 = ls.sampler->next_1d();
+            Point2f sample_2 = ls.sampler->next_2d();
+            Float sample_guide = ls.sampler->next_1d();
+
+            auto [bsdf_val, bsdf_pdf, bsdf_sample, bsdf_weight]
+                = bsdf->eval_pdf_sample(bsdf_ctx, si, wo, sample_1, sample_2);
+
+            // --------------- Emitter sampling contribution ----------------
+
+            if (dr::any_or<true>(active_em)) {
+                bsdf_val = si.to_world_mueller(bsdf_val, -wo, si.wi);
+
+                // Density of the emitter direction under the mixture of both strategies
+                Float mixture_pdf = dr::lerp(
+                    guide_pdf(guide_root, ds.d, active_em), bsdf_pdf,
+                    m_bsdf_fraction);
+
+                // Compute the MIS weight
+                Float mis_em =
+                    dr::select(ds.delta, 1.f, mis_weight(ds.pdf, mixture_pdf));
+
+                // Accumulate, being careful with polarization (see spec_fma)
+                ls.result[active_em] = spec_fma(
+                    ls.throughput, bsdf_val * em_weight * mis_em, ls.result);
+            }
+
+            // ---------------- BSDF or guided direction sampling ----------------
+
+            bsdf_weight = si.to_world_mueller(bsdf_weight, -bsdf_sample.wo, si.wi);
+
+            Mask delta = has_flag(bsdf_sample.sampled_type, BSDFFlags::Delta),
+                 use_guide = guided && sample_guide >= m_bsdf_fraction;
+            Vector3f wo_world = si.to_world(bsdf_sample.wo);
+            Float pdf_guide = 0.f;
+
+            if (dr::any_or<true>(use_guide)) {
+                auto [d_guide, pdf_guide_2] =
+                    guide_sample(guide_root, sample_2, use_guide);
+                Vector3f wo_guide = si.to_local(d_guide);
+
+                auto [bsdf_val_2, bsdf_pdf_2] =
+                    bsdf->eval_pdf(bsdf_ctx, si, wo_guide, use_guide);
+                bsdf_val_2 = si.to_world_mueller(bsdf_val_2, -wo_guide, si.wi);
+
+                wo_world[use_guide] = d_guide;
+                bsdf_sample.wo[use_guide] = wo_guide;
+                bsdf_sample.pdf[use_guide] = bsdf_pdf_2;
+                bsdf_sample.eta[use_guide] = 1.f;
+                bsdf_sample.sampled_type[use_guide] = +BSDFFlags::Smooth;
+                bsdf_weight[use_guide] = bsdf_val_2;
+                pdf_guide[use_guide] = pdf_guide_2;
+                delta &= !use_guide;
+            }
+
+            // Directions of smooth components use one-sample MIS with both strategies
+            Mask mixture = guided && !delta,
+                 need_pdf = mixture && !use_guide;
+            if (dr::any_or<true>(need_pdf))
+                pdf_guide[need_pdf] = guide_pdf(guide_root, wo_world, need_pdf);
+
+            Float mixture_pdf = dr::select(
+                mixture, dr::lerp(pdf_guide, bsdf_sample.pdf, m_bsdf_fraction),
+                bsdf_sample.pdf);
+
+            /* 'bsdf_weight' stores f * cos / pdf for directions sampled from
+               the BSDF, and f * cos for guided directions */
+            Float weight_scale = 1.f;
+            dr::masked(weight_scale, mixture) =
+                dr::select(use_guide, 1.f, bsdf_sample.pdf) / mixture_pdf;
+            dr::masked(weight_scale, guided && delta) = 1.f / m_bsdf_fraction;
+            bsdf_weight *= dr::select(dr::isfinite(weight_scale), weight_scale, 0.f);
+
+            ls.ray = si.spawn_ray(wo_world);
+
+            // ------ Update loop variables based on current interaction ------
+
+            UInt32 vertex_depth = ls.depth;
+
+            ls.throughput *= bsdf_weight;
+            ls.eta *= bsdf_sample.eta;
+            ls.valid_ray |= ls.active && si.is_valid() &&
+                         !has_flag(bsdf_sample.sampled_type, BSDFFlags::Null);
+
+            // Information about the current vertex needed by the next iteration
+            ls.prev_si = si;
+            ls.prev_bsdf_pdf = mixture_pdf;
+            ls.prev_bsdf_delta = delta;
+
+            // -------------------- Stopping criterion ---------------------
+
+            dr::masked(ls.depth, si.is_valid()) += 1;
+
+            Float throughput_max = dr::max(unpolarized_spectrum(ls.throughput));
+
+            Float rr_prob = dr::minimum(throughput_max * dr::square(ls.eta), .95f);
+            Mask rr_active = ls.depth >= m_rr_depth,
+                 rr_continue = ls.sampler->next_1d() < rr_prob;
+
+            ls.throughput[rr_active] *= dr::rcp(rr_prob);
+
+            ls.active = active_next && (!rr_active || rr_continue) &&
+                     (throughput_max != 0.f);
+
+            // --------------------- Training records ----------------------
+
+            if (record_depth > 0) {
+                Mask store = mixture && vertex_depth < record_depth &&
+                             mixture_pdf > 0.f;
+                UInt32 slot = path_index * record_depth + vertex_depth;
+                UnpolarizedSpectrum radiance = unpolarized_spectrum(ls.result),
+                                    throughput = unpolarized_spectrum(ls.throughput);
+
+                for (uint32_t i = 0; i < 3; ++i)
+                    dr::scatter(records.position, si.p[i], slot * 3 + i, store);
+
+                Point2f direction = warp::uniform_sphere_to_square(wo_world);
+                for (uint32_t i = 0; i < 2; ++i)
+                    dr::scatter(records.direction, direction[i], slot * 2 + i, store);
+
+                dr::scatter(records.pdf, mixture_pdf, slot, store);
+
+                for (uint32_t i = 0; i < SpectrumChannels; ++i) {
+                    dr::scatter(records.radiance, radiance[i],
+                                slot * SpectrumChannels + i, store);
+                    dr::scatter(records.inv_throughput,
+                                dr::select(throughput[i] > 0.f,
+                                           dr::rcp(throughput[i]), 0.f),
+                                slot * SpectrumChannels + i, store);
+                }
+            }
+        });
+
+        if (training) {
+            UnpolarizedSpectrum radiance = unpolarized_spectrum(ls.result);
+            for (uint32_t i = 0; i < SpectrumChannels; ++i)
+                dr::scatter(records.result, radiance[i],
+                            path_index * SpectrumChannels + i);
+
+            /* Evaluate the wavefront together with the records, which are
+               then added to the SD-tree on the host */
+            if constexpr (dr::is_jit_v<Float>) {
+                ls.sampler->schedule_state();
+                dr::eval(ls.result, ls.valid_ray, records.position,
+                         records.direction, records.pdf, records.radiance,
+                         records.inv_throughput, records.result);
+            }
+
+            splat_records(records, width);
+        }
+
+        return {
+            /* spec  = */ dr::select(ls.valid_ray, ls.result, 0.f),
+            /* valid = */ ls.valid_ray
+        };
+    }
+
+    //! @}
+    // =============================================================
+
+    std::string to_string() const override {
+        return tfm::format("GuidedPathIntegrator[\n"
+            "  max_depth = %u,\n"
+            "  rr_depth = %u,\n"
+            "  training_budget = %f,\n"
+            "  bsdf_sampling_fraction = %f,\n"
+            "  spatial_threshold = %u,\n"
+            "  directional_threshold = %f\n"
+            "]", m_max_depth, m_rr_depth, m_training_budget, m_bsdf_fraction,
+            m_spatial_threshold, m_directional_threshold);
+    }
+
+    /// Compute a multiple importance sampling weight using the power heuristic
+    Float mis_weight(Float pdf_a, Float pdf_b) const {
+        pdf_a *= pdf_a;
+        pdf_b *= pdf_b;
+        Float w = pdf_a / (pdf_a + pdf_b);
+        return dr::detach<true>(dr::select(dr::isfinite(w), w, 0.f));
+    }
+
+    /**
+     * \brief Perform a Mueller matrix multiplication in polarized modes, and a
+     * fused multiply-add otherwise.
+     */
+    Spectrum spec_fma(const Spectrum &a, const Spectrum &b,
+                      const Spectrum &c) const {
+        if constexpr (is_polarized_v<Spectrum>)
+            return a * b + c;
+        else
+            return dr::fmadd(a, b, c);
+    }
+
+    MI_DECLARE_CLASS()
+
+protected:
+    // =============================================================
+    //! @{ \name SD-tree data structures (host)
+    // =============================================================
+
+    /**
+     * \brief Node of a quadtree over the equal-area cylindrical
+     * parameterization of the sphere (see \ref warp::square_to_uniform_sphere)
+     *
+     * Quadrant <tt>q</tt> covers the lower (0) or upper (1) half of both axes
+     * of the node, where <tt>q = x + 2 * y</tt>.
+     */
+    struct QuadNode {
+        /// Energy recorded in each quadrant
+        AtomicFloat<float> sum[4];
+
+        /// Index of the child node of each quadrant (0 for leaves)
+        uint32_t child[4] = { 0, 0, 0, 0 };
+
+        QuadNode() = default;
+        QuadNode(const QuadNode &node) { *this = node; }
+
+        QuadNode &operator=(const QuadNode &node) {
+            for (int i = 0; i < 4; ++i) {
+                sum[i] = (float) node.sum[i];
+                child[i] = node.child[i];
+            }
+            return *this;
+        }
+
+        float total() const { return sum[0] + sum[1] + sum[2] + sum[3]; }
+    };
+
+    /// Directional distribution of a cell of the spatial tree
+    struct DirectionalTree {
+        std::vector<QuadNode> nodes { QuadNode() };
+
+        /// Number of path vertices recorded in the cell
+        std::atomic<uint64_t> samples { 0 };
+
+        DirectionalTree() = default;
+        DirectionalTree(const DirectionalTree &tree) { *this = tree; }
+
+        DirectionalTree &operator=(const DirectionalTree &tree) {
+            nodes = tree.nodes;
+            samples = tree.samples.load();
+            return *this;
+        }
+    };
+
+    /// Node of the spatial binary tree, which splits cells at their center
+    struct SpatialNode {
+        /// Index of the first of two children (0 for leaves)
+        uint32_t child = 0;
+
+        /// Split axis of the node (or of its future children for leaves)
+        uint32_t axis = 0;
+
+        /// Index of the directional distribution of leaves
+        uint32_t tree = 0;
+    };
+
+    /// Path vertices of a wavefront recorded for training
+    struct Records {
+        FloatStorage position, direction, pdf, radiance, inv_throughput, result;
+    };
+
+    static constexpr uint32_t SpectrumChannels =
+        (uint32_t) dr::size_v<UnpolarizedSpectrum>;
+
+    //! @}
+    // =============================================================
+
+    // =============================================================
+    //! @{ \name Guiding distribution queries (device)
+    // =============================================================
+
+    /// Find the root node of the directional distribution at a position
+    UInt32 guide_lookup(const Point3f &p, Mask active) const {
+        Vector3f x = dr::clip((p - m_bbox_min) * m_bbox_scale, 0.f, 1.f);
+        UInt32 node = 0;
+
+        std::tie(x, node, active) = dr::while_loop(
+            std::make_tuple(x, node, active),
+            [](const Vector3f &, const UInt32 &, const Mask &active) {
+                return active;
+            },
+            [this](Vector3f &x, UInt32 &node, Mask &active) {
+                UInt32 child   = dr::gather<UInt32>(m_spatial_nodes, node * 2u),
+                       payload = dr::gather<UInt32>(m_spatial_nodes, node * 2u + 1u);
+                Mask leaf = child == 0u;
+
+                Float xa = dr::select(payload == 0u, x.x(),
+                                      dr::select(payload == 1u, x.y(), x.z()));
+                Mask upper = xa >= .5f;
+                xa = dr::select(upper, dr::fmadd(xa, 2.f, -1.f), xa * 2.f);
+
+                for (uint32_t i = 0; i < 3; ++i)
+                    dr::masked(x[i], !leaf && payload == i) = xa;
+
+                // Leaves store the root node of their directional distribution
+                node = dr::select(leaf, payload,
+                                  child + dr::select(upper, 1u, 0u));
+                active = !leaf;
+            });
+
+        return node;
+    }
+
+    /**
+     * \brief Sample a world space direction from the directional distribution
+     * with the given root node
+     *
+     * Returns the direction and its density with respect to solid angles.
+     */
+    std::pair<Vector3f, Float> guide_sample(UInt32 node, Point2f sample,
+                                            Mask active) const {
+        Point2f origin = 0.f;
+        Float scale = 1.f, pdf = 1.f;
+        sample = dr::minimum(sample, dr::OneMinusEpsilon<Float>);
+
+        std::tie(node, sample, origin, scale, pdf, active) = dr::while_loop(
+            std::make_tuple(node, sample, origin, scale, pdf, active),
+            [](const UInt32 &, const Point2f &, const Point2f &, const Float &,
+               const Float &, const Mask &active) { return active; },
+            [this](UInt32 &node, Point2f &sample, Point2f &origin,
+                   Float &scale, Float &pdf, Mask &active) {
+                Vector4f prob = dr::gather<Vector4f>(m_quad_probs, node);
+
+                // Choose the column, then the row of the quadrant
+                Float p_left = prob.x() + prob.z();
+                Mask right = sample.x() >= p_left;
+                Float p_column = dr::select(right, 1.f - p_left, p_left);
+                sample.x() = dr::select(right, sample.x() - p_left, sample.x()) / p_column;
+
+                Float p_top = dr::select(right, prob.y(), prob.x()) / p_column;
+                Mask bottom = sample.y() >= p_top;
+                sample.y() = dr::select(bottom, sample.y() - p_top, sample.y()) /
+                             dr::select(bottom, 1.f - p_top, p_top);
+
+                sample = dr::clip(sample, 0.f, dr::OneMinusEpsilon<Float>);
+
+                Float p_quadrant = dr::select(right,
+                    dr::select(bottom, prob.w(), prob.y()),
+                    dr::select(bottom, prob.z(), prob.x()));
+                pdf *= 4.f * p_quadrant;
+
+                scale *= .5f;
+                origin += Vector2f(dr::select(right, scale, 0.f),
+                                   dr::select(bottom, scale, 0.f));
+
+                UInt32 quadrant = dr::select(right, 1u, 0u) + dr::select(bottom, 2u, 0u);
+                node = dr::gather<UInt32>(m_quad_children, node * 4u + quadrant);
+                active = node != 0u;
+            });
+
+        Point2f x = dr::fmadd(sample, scale, origin);
+        return { warp::square_to_uniform_sphere(x), pdf * dr::InvFourPi<Float> };
+    }
+
+    /// Evaluate the density of a world space direction (w.r.t. solid angles)
+    Float guide_pdf(UInt32 node, const Vector3f &d, Mask active) const {
+        Point2f x = warp::uniform_sphere_to_square(d);
+        Float pdf = 1.f;
+
+        std::tie(node, x, pdf, active) = dr::while_loop(
+            std::make_tuple(node, x, pdf, active),
+            [](const UInt32 &, const Point2f &, const Float &,
+               const Mask &active) { return active; },
+            [this](UInt32 &node, Point2f &x, Float &pdf, Mask &active) {
+                Vector4f prob = dr::gather<Vector4f>(m_quad_probs, node);
+                Mask right = x.x() >= .5f, bottom = x.y() >= .5f;
+
+                x = dr::fmadd(x, 2.f, -Vector2f(dr::select(right, 1.f, 0.f),
+                                                dr::select(bottom, 1.f, 0.f)));
+
+                Float p_quadrant = dr::select(right,
+                    dr::select(bottom, prob.w(), prob.y()),
+                    dr::select(bottom, prob.z(), prob.x()));
+                pdf *= 4.f * p_quadrant;
+
+                UInt32 quadrant = dr::select(right, 1u, 0u) + dr::select(bottom, 2u, 0u);
+                node = dr::gather<UInt32>(m_quad_children, node * 4u + quadrant);
+                active = node != 0u;
+            });
+
+        return pdf * dr::InvFourPi<Float>;
+    }
+
+    //! @}
+    // =============================================================
+
+    // =============================================================
+    //! @{ \name Training (host)
+    // =============================================================
+
+    /// Start over with a uniform distribution over the bounding box of the scene
+    void reset_guiding(const ScalarBoundingBox3f &bbox) {
+        m_spatial.assign(1, SpatialNode());
+        m_sampling.assign(1, DirectionalTree());
+        m_building = m_sampling;
+
+        ScalarVector3f extents = bbox.extents();
+        extents = dr::maximum(extents, dr::max(extents) * 1e-4f + 1e-6f);
+        m_bbox_min = bbox.min;
+        m_bbox_scale = dr::rcp(extents);
+
+        upload_guiding();
+    }
+
+    /// Rebuild the guiding distribution after a training iteration
+    void update_guiding(uint32_t iteration) {
+        // The learned distribution replaces cells that received any energy
+        dr::parallel_for(
+            dr::blocked_range<size_t>(0, m_building.size(), 64),
+            [&](const dr::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    propagate(m_building[i], 0);
+                    if (m_building[i].nodes[0].total() > 0.f)
+                        m_sampling[i] = m_building[i];
+                }
+            }
+        );
+
+        /* Subdivide spatial cells that received many samples. The children
+           inherit the learned distribution of their parent. */
+        uint64_t threshold =
+            (uint64_t) (m_spatial_threshold * std::sqrt((double) (1ull << iteration)));
+        for (size_t i = 0; i < m_spatial.size(); ++i) {
+            SpatialNode node = m_spatial[i];
+            if (node.child != 0 || m_building[node.tree].samples <= threshold)
+                continue;
+
+            uint32_t tree = (uint32_t) m_sampling.size(),
+                     axis = (node.axis + 1) % 3;
+            m_building[node.tree].samples = m_building[node.tree].samples / 2;
+            m_sampling.push_back(m_sampling[node.tree]);
+            m_building.push_back(m_building[node.tree]);
+
+            m_spatial[i].child = (uint32_t) m_spatial.size();
+            m_spatial.push_back({ 0, axis, node.tree });
+            m_spatial.push_back({ 0, axis, tree });
+        }
+
+        // Adapt the subdivision of the directional trees to the learned distribution
+        dr::parallel_for(
+            dr::blocked_range<size_t>(0, m_building.size(), 64),
+            [&](const dr::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    refine(m_sampling[i], m_building[i]);
+            }
+        );
+
+        upload_guiding();
+
+        Log(Debug, "Path guiding: iteration %u produced %zu spatial cells and "
+            "%zu directional nodes.", iteration + 1, m_sampling.size(),
+            quad_node_count());
+    }
+
+    /// Accumulate the energy of the leaves in the interior nodes of a tree
+    static float propagate(DirectionalTree &tree, uint32_t index) {
+        float total = 0.f;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t child = tree.nodes[index].child[i];
+            if (child != 0)
+                tree.nodes[index].sum[i] = propagate(tree, child);
+            total += tree.nodes[index].sum[i];
+        }
+        return total;
+    }
+
+    /**
+     * \brief Initialize \c dst with an empty tree whose cells each hold
+     * roughly the same fraction of the energy of the learned tree \c src
+     */
+    void refine(const DirectionalTree &src, DirectionalTree &dst) const {
+        dst.nodes.assign(1, QuadNode());
+        dst.samples = 0;
+
+        float threshold = src.nodes[0].total() * (float) m_directional_threshold;
+        if (!(threshold > 0.f))
+            return;
+
+        struct Item { uint32_t src, dst, depth; float sum[4]; };
+        std::vector<Item> stack;
+        Item root { 0, 0, 1, { } };
+        for (int i = 0; i < 4; ++i)
+            root.sum[i] = src.nodes[0].sum[i];
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            Item item = stack.back();
+            stack.pop_back();
+
+            for (int i = 0; i < 4; ++i) {
+                if (!(item.sum[i] > threshold) || item.depth >= MaxQuadDepth)
+                    continue;
+
+                uint32_t child = (uint32_t) dst.nodes.size();
+                dst.nodes.emplace_back();
+                dst.nodes[item.dst].child[i] = child;
+
+                // Cells without counterpart in the learned tree split their energy evenly
+                uint32_t src_child = item.src != (uint32_t) -1
+                                         ? src.nodes[item.src].child[i] : 0;
+                Item next { src_child != 0 ? src_child : (uint32_t) -1, child,
+                            item.depth + 1, { } };
+                for (int j = 0; j < 4; ++j)
+                    next.sum[j] = src_child != 0
+                                      ? (float) src.nodes[src_child].sum[j]
+                                      : item.sum[i] * .25f;
+                stack.push_back(next);
+            }
+        }
+    }
+
+    /// Upload the sampling distribution into flat arrays used by the queries
+    void upload_guiding() {
+        std::vector<uint32_t> offsets(m_sampling.size());
+        size_t quad_count = 0;
+        for (size_t i = 0; i < m_sampling.size(); ++i) {
+            offsets[i] = (uint32_t) quad_count;
+            quad_count += m_sampling[i].nodes.size();
+        }
+
+        std::unique_ptr<uint32_t[]> children(new uint32_t[quad_count * 4]);
+        std::unique_ptr<ScalarFloat[]> probs(new ScalarFloat[quad_count * 4]);
+
+        for (size_t i = 0; i < m_sampling.size(); ++i) {
+            const std::vector<QuadNode> &nodes = m_sampling[i].nodes;
+            for (size_t j = 0; j < nodes.size(); ++j) {
+                size_t index = (offsets[i] + j) * 4;
+                float total = nodes[j].total();
+                for (int k = 0; k < 4; ++k) {
+                    children[index + k] =
+                        nodes[j].child[k] != 0 ? offsets[i] + nodes[j].child[k] : 0;
+                    probs[index + k] = total > 0.f
+                        ? (ScalarFloat) (nodes[j].sum[k] / total) : .25f;
+                }
+            }
+        }
+
+        std::unique_ptr<uint32_t[]> spatial(new uint32_t[m_spatial.size() * 2]);
+        for (size_t i = 0; i < m_spatial.size(); ++i) {
+            const SpatialNode &node = m_spatial[i];
+            spatial[2 * i] = node.child;
+            spatial[2 * i + 1] = node.child != 0 ? node.axis : offsets[node.tree];
+        }
+
+        m_spatial_nodes = dr::load<UInt32Storage>(spatial.get(), m_spatial.size() * 2);
+        m_quad_children = dr::load<UInt32Storage>(children.get(), quad_count * 4);
+        m_quad_probs    = dr::load<FloatStorage>(probs.get(), quad_count * 4);
+    }
+
+    /// Add the vertices recorded while rendering a wavefront to the SD-tree
+    void splat_records(const Records &records, size_t width) const {
+        auto &&position       = dr::migrate(dr::detach(records.position), AllocType::Host);
+        auto &&direction      = dr::migrate(dr::detach(records.direction), AllocType::Host);
+        auto &&pdf            = dr::migrate(dr::detach(records.pdf), AllocType::Host);
+        auto &&radiance       = dr::migrate(dr::detach(records.radiance), AllocType::Host);
+        auto &&inv_throughput = dr::migrate(dr::detach(records.inv_throughput), AllocType::Host);
+        auto &&result         = dr::migrate(dr::detach(records.result), AllocType::Host);
+
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+
+        const ScalarFloat *position_ptr       = (const ScalarFloat *) position.data(),
+                          *direction_ptr      = (const ScalarFloat *) direction.data(),
+                          *pdf_ptr            = (const ScalarFloat *) pdf.data(),
+                          *radiance_ptr       = (const ScalarFloat *) radiance.data(),
+                          *inv_throughput_ptr = (const ScalarFloat *) inv_throughput.data(),
+                          *result_ptr         = (const ScalarFloat *) result.data();
+
+        const uint32_t depth = m_record_depth, C = SpectrumChannels;
+
+        auto splat_paths = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i != end; ++i) {
+                for (uint32_t k = 0; k < depth; ++k) {
+                    size_t j = i * depth + k;
+                    if (!(pdf_ptr[j] > 0.f))
+                        continue;
+
+                    /* The radiance arriving along the sampled direction is
+                       what the path gathered after this vertex */
+                    ScalarFloat incident = 0.f;
+                    for (uint32_t c = 0; c < C; ++c)
+                        incident += (result_ptr[i * C + c] - radiance_ptr[j * C + c]) *
+                                    inv_throughput_ptr[j * C + c];
+                    incident = dr::maximum(incident / C, 0.f);
+
+                    record(ScalarPoint3f(position_ptr[j * 3], position_ptr[j * 3 + 1],
+                                         position_ptr[j * 3 + 2]),
+                           ScalarPoint2f(direction_ptr[j * 2], direction_ptr[j * 2 + 1]),
+                           incident / pdf_ptr[j]);
+                }
+            }
+        };
+
+        if constexpr (dr::is_jit_v<Float>) {
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, width, 4096),
+                [&](const dr::blocked_range<size_t> &range) {
+                    splat_paths(range.begin(), range.end());
+                }
+            );
+        } else {
+            splat_paths(0, width);
+        }
+    }
+
+    /// Add a single vertex to the directional tree of its spatial cell
+    void record(const ScalarPoint3f &p, ScalarPoint2f x, ScalarFloat value) const {
+        ScalarVector3f u = dr::clip((p - m_bbox_min) * m_bbox_scale, 0.f, 1.f);
+        uint32_t index = 0;
+        while (m_spatial[index].child != 0) {
+            const SpatialNode &node = m_spatial[index];
+            bool upper = u[node.axis] >= .5f;
+            u[node.axis] = upper ? u[node.axis] * 2.f - 1.f : u[node.axis] * 2.f;
+            index = node.child + (upper ? 1 : 0);
+        }
+
+        DirectionalTree &tree = m_building[m_spatial[index].tree];
+        tree.samples++;
+
+        if (!(value > 0.f) || !std::isfinite(value))
+            return;
+
+        uint32_t node = 0;
+        while (true) {
+            bool right = x.x() >= .5f, bottom = x.y() >= .5f;
+            uint32_t quadrant = (right ? 1 : 0) + (bottom ? 2 : 0);
+            x = dr::fmadd(x, 2.f, -ScalarVector2f(right ? 1.f : 0.f,
+                                                  bottom ? 1.f : 0.f));
+
+            uint32_t child = tree.nodes[node].child[quadrant];
+            if (child == 0) {
+                tree.nodes[node].sum[quadrant] += (float) value;
+                break;
+            }
+            node = child;
+        }
+    }
+
+    /// Total number of nodes of all directional trees
+    size_t quad_node_count() const {
+        size_t count = 0;
+        for (const DirectionalTree &tree : m_sampling)
+            count += tree.nodes.size();
+        return count;
+    }
+
+    //! @}
+    // =============================================================
+
+protected:
+    ScalarFloat m_training_budget;
+    ScalarFloat m_bsdf_fraction;
+    uint32_t m_spatial_threshold;
+    ScalarFloat m_directional_threshold;
+    uint32_t m_record_depth;
+
+    /// Record path vertices in \ref sample()?
+    bool m_training;
+
+    // Host representation of the SD-tree
+    std::vector<SpatialNode> m_spatial;
+    std::vector<DirectionalTree> m_sampling;
+    mutable std::vector<DirectionalTree> m_building;
+    ScalarPoint3f m_bbox_min;
+    ScalarVector3f m_bbox_scale;
+
+    /**
+     * Flattened sampling distribution: two entries per spatial node (child
+     * index or zero, then split axis or root quadtree node), and four child
+     * indices and quadrant probabilities per quadtree node.
+     */
+    UInt32Storage m_spatial_nodes;
+    UInt32Storage m_quad_children;
+    FloatStorage m_quad_probs;
+};
+
+MI_IMPLEMENT_CLASS_VARIANT(GuidedPathIntegrator, MonteCarloIntegrator)
+MI_EXPORT_PLUGIN(GuidedPathIntegrator, "Guided path tracer integrator");
+NAMESPACE_END(mitsuba)
@@ -0,0 +1,42 @@
+import pytest
+import drjit as dr
+import mitsuba as mi
+
+
+def make_scene(integrator, spp, res=32):
+    scene = mi.cornell_box()
+    scene['integrator'] = integrator
+    scene['sensor']['film']['width'] = res
+    scene['sensor']['film']['height'] = res
+    scene['sensor']['sampler'] = { 'type': 'independent', 'sample_count': spp }
+    return mi.load_dict(scene)
+
+
+def test01_matches_path(variants_all_rgb):
+    # The guided estimator must converge to the same image as the path tracer.
+    # A biased mixture pdf could still match the mean of the whole image, hence
+    # the comparison of every 2x2 pixel block.
+    import numpy as np
+    res, spp = 16, 1024
+    ref = mi.render(make_scene({ 'type': 'path', 'max_depth': 6 }, spp, res))
+    image = mi.render(make_scene({
+        'type': 'guided_path',
+        'max_depth': 6,
+        'training_budget': 0.25,
+        'spatial_threshold': 1000
+    }, spp, res))
+
+    def blocks(img):
+        return np.array(img).reshape(res // 2, 2, res // 2, 2, -1).mean(axis=(1, 3))
+
+    ref, image = blocks(ref), blocks(image)
+    assert np.all(np.abs(image - ref) <= 0.1 * ref + 0.02)
+    assert np.allclose(image.mean(), ref.mean(), rtol=0.02)
+
+
+def test02_parameters(variant_scalar_rgb):
+    with pytest.raises(RuntimeError, match='bsdf_sampling_fraction'):
+        mi.load_dict({ 'type': 'guided_path', 'bsdf_sampling_fraction': 2.0 })
+
+    with pytest.raises(RuntimeError, match='training_budget'):
+        mi.load_dict({ 'type': 'guided_path', 'training_budget': 1.0 })
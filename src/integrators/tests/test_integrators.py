@@ -23,3 +23,91 @@ def test01_trampoline_id(variants_vec_backends_once_rgb):
 
     params = mi.traverse(scene)
     assert 'my_integrator.depth' in params
+
+
+def test02_adaptive_sampling(variant_scalar_rgb):
+    def make_scene(emitter):
+        return mi.load_dict({
+            'type': 'scene',
+            'integrator': {
+                'type': 'path',
+                'adaptive_threshold': 0.05,
+                'adaptive_min_spp': 8,
+                'adaptive_step': 8,
+                'adaptive_aov': True
+            },
+            'sensor': {
+                'type': 'perspective',
+                'film': { 'type': 'hdrfilm', 'width': 16, 'height': 16 },
+                'sampler': { 'type': 'independent', 'sample_count': 64 }
+            },
+            'emitter': emitter,
+            'sphere': { 'type': 'sphere', 'center': [0, 0, 5] },
+            'light': {
+                'type': 'rectangle',
+                'to_world': mi.ScalarTransform4f.translate([0, 2, 5]),
+                'emitter': { 'type': 'area' }
+            }
+        })
+
+    # The integrator records the sample count of each pixel in the 'spp' AOV
+    scene = make_scene({ 'type': 'constant' })
+    image = mi.render(scene)
+    assert image.shape == (16, 16, 4)
+    spp = image[:, :, 3]
+    assert dr.all(spp >= 8) and dr.all(spp <= 64)
+
+    # Noisy pixels (lit by the area light) take more samples
+    assert dr.max(spp) > 8
+
+    # Pixels that only see the constant environment converge immediately
+    scene_bg = mi.load_dict({
+        'type': 'scene',
+        'integrator': {
+            'type': 'path',
+            'adaptive_threshold': 0.05,
+            'adaptive_aov': True
+        },
+        'sensor': {
+            'type': 'perspective',
+            'film': { 'type': 'hdrfilm', 'width': 8, 'height': 8 },
+            'sampler': { 'type': 'independent', 'sample_count': 64 }
+        },
+        'emitter': { 'type': 'constant' }
+    })
+    image = mi.render(scene_bg)
+    assert dr.allclose(image[:, :, 3], 16)
+
+
+def test03_progressive_rendering(variant_scalar_rgb, tmp_path):
+    snapshot = tmp_path / 'snapshot.exr'
+
+    def render(integrator):
+        scene = mi.load_dict({
+            'type': 'scene',
+            'integrator': integrator,
+            'sensor': {
+                'type': 'perspective',
+                'film': { 'type': 'hdrfilm', 'width': 32, 'height': 32 },
+                'sampler': { 'type': 'independent', 'sample_count': 16 }
+            },
+            'emitter': { 'type': 'constant' },
+            'sphere': { 'type': 'sphere', 'center': [0, 0, 5] }
+        })
+        return mi.render(scene)
+
+    reference = render({ 'type': 'path' })
+    image = render({
+        'type': 'path',
+        'progressive': True,
+        'progressive_snapshot': str(snapshot)
+    })
+    mi.Thread.wait_for_tasks()
+
+    # Passes with 1, 1, 2, 4, 8 samples converge to the same image
+    assert dr.allclose(dr.mean(image), dr.mean(reference), rtol=1e-2)
+
+    # Snapshots of the partially converged film were written in the meantime
+    assert snapshot.exists()
+    bitmap = mi.Bitmap(str(snapshot))
+    assert bitmap.width() == 32 and bitmap.height() == 32
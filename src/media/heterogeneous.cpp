@@ -46,6 +46,15 @@ Heterogeneous medium (:monosp:`heterogeneous`)
      render time. This can reduce render time up to 50% when rendering objects
      with subsurface scattering.
 
+ * - majorant_resolution
+   - |int|
+   - Resolution of the majorant supergrid along each axis. When nonzero, the
+     bounding box of the extinction volume is subdivided into a coarse grid
+     storing a local majorant per cell, which is traversed when sampling
+     free-flight distances. This drastically reduces the number of null
+     collisions in media that are mostly thin with a few dense regions.
+     (Default: 0, i.e. a single global majorant is used)
+
  * - (Nested plugin)
    - |phase|
    - A nested phase function that describes the directional scattering properties of
@@ -65,6 +74,11 @@ extinction coefficient should have units of inverse meters. For convenience,
 the scale parameter can be used to correct the units. For instance, when the scene is in
 meters and the coefficients are in inverse millimeters, set scale to 1000.
 
+Free-flight distances are sampled using delta tracking with respect to a majorant, i.e.
+an upper bound of the extinction coefficient. By default, the maximum of the entire
+volume is used. Setting ``majorant_resolution`` (e.g. to 16) instead builds a coarse grid
+of local majorants from the volume data, which is traversed with a 3D DDA.
+
 Both the albedo and the extinction coefficient can either be constant or textured,
 and both parameters are allowed to be spectrally varying.
 
@@ -149,7 +163,8 @@ template <typename Float, typename Spectrum>
 class HeterogeneousMedium final : public Medium<Float, Spectrum> {
 public:
     MI_IMPORT_BASE(Medium, m_is_homogeneous, m_has_spectral_extinction,
-                    m_phase_function)
+                    m_phase_function, m_majorant_resolution,
+                    update_majorant_grid, eval_majorant_grid)
     MI_IMPORT_TYPES(Scene, Sampler, Texture, Volume)
 
     HeterogeneousMedium(const Properties &props) : Base(props) {
@@ -160,7 +175,13 @@ public:
         m_scale = props.get<ScalarFloat>("scale", 1.0f);
         m_has_spectral_extinction = props.get<bool>("has_spectral_extinction", true);
 
+        int majorant_resolution = props.get<int>("majorant_resolution", 0);
+        if (majorant_resolution < 0)
+            Throw("The majorant supergrid resolution must be non-negative!");
+        m_majorant_resolution = ScalarVector3i(majorant_resolution);
+
         m_max_density = dr::opaque<Float>(m_scale * m_sigmat->max());
+        update_majorant_grid(m_sigmat.get(), m_scale);
     }
 
     void traverse(TraversalCallback *callback) override {
@@ -172,12 +193,15 @@ public:
 
     void parameters_changed(const std::vector<std::string> &/*keys*/ = {}) override {
         m_max_density = dr::opaque<Float>(m_scale * m_sigmat->max());
+        update_majorant_grid(m_sigmat.get(), m_scale);
     }
 
     UnpolarizedSpectrum
-    get_majorant(const MediumInteraction3f & /* mi */,
+    get_majorant(const MediumInteraction3f &mi,
                  Mask active) const override {
         MI_MASKED_FUNCTION(ProfilerPhase::MediumEvaluate, active);
+        if (m_majorant_resolution.x() > 0)
+            return eval_majorant_grid(mi.p, active);
         return m_max_density;
     }
 
@@ -191,7 +215,7 @@ public:
             sigmat *= m_phase_function->projected_area(mi, active);
 
         auto sigmas = sigmat * m_albedo->eval(mi, active);
-        auto sigman = m_max_density - sigmat;
+        auto sigman = get_majorant(mi, active) - sigmat;
         return { sigmas, sigman, sigmat };
     }
 
@@ -206,6 +230,7 @@ public:
             << "  albedo  = " << string::indent(m_albedo) << std::endl
             << "  sigma_t = " << string::indent(m_sigmat) << std::endl
             << "  scale   = " << string::indent(m_scale) << std::endl
+            << "  majorant_resolution = " << m_majorant_resolution << std::endl
             << "]";
         return oss.str();
     }
@@ -6,6 +6,7 @@
 #include <mitsuba/core/jit.h>
 #include <mitsuba/core/logger.h>
 #include <mitsuba/core/profiler.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/core/thread.h>
 #include <mitsuba/core/util.h>
 #include <mitsuba/core/vector.h>
@@ -14,6 +15,12 @@
 #include <mitsuba/render/records.h>
 #include <mitsuba/render/scene.h>
 
+#include <fstream>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
 #if !defined(_WIN32)
 #  include <signal.h>
 #else
@@ -65,6 +72,24 @@ Options:
     -o <filename>, --output <filename>
         Write the output image to the file "filename".
 
+    -b <filename>, --batch <filename>
+        Load the (single) scene once and render all jobs listed in the
+        specified file in sequence. Each line describes one job using
+        whitespace-separated <key>=<value> pairs:
+
+          sensor=<index>  spp=<count>  seed=<value>  output=<filename>
+
+        All other keys name a traversable scene parameter (as reported by
+        mi.traverse() in Python) that is overridden for this job, e.g.
+        "PerspectiveCamera.x_fov=45". Vectors, colors and transforms
+        (row-major) are specified as comma-separated values. Parameters
+        are restored before the next job. Lines starting with '#' are
+        ignored.
+
+    --batch-log <filename>
+        Write per-job timings of a batch render to the file "filename"
+        (one JSON object per line). Default: "<batch file>.log".
+
  === The following options are only relevant for JIT (CUDA/LLVM) modes ===
 
     -O [0-5]
@@ -136,6 +161,320 @@ void render(Object *scene_, size_t sensor_i, fs::path filename) {
     }
 
     film->write(filename);
+
+    // Per-phase time breakdown (only available with MI_PROFILER_SAMPLING)
+    Profiler::print_report();
+    Profiler::reset();
+}
+
+/**
+ * \brief Collects the traversable parameters of a scene graph
+ *
+ * Parameter names and the update order match those of the Python function
+ * \c mitsuba.traverse().
+ */
+struct ParameterTraversal : public TraversalCallback {
+    struct Parameter {
+        void *ptr;
+        const std::type_info *type;
+        Object *node;
+    };
+
+    using ParameterMap = std::map<std::string, Parameter>;
+    using Hierarchy = std::unordered_map<Object *, std::pair<Object *, uint32_t>>;
+
+    ParameterTraversal(ParameterMap &params, Hierarchy &hierarchy,
+                       std::unordered_set<std::string> &prefixes, Object *node,
+                       const std::string &name, uint32_t depth)
+        : params(params), hierarchy(hierarchy), prefixes(prefixes), node(node),
+          name(name), depth(depth) { }
+
+    std::string prefixed(const std::string &key) const {
+        return name.empty() ? key : name + "." + key;
+    }
+
+    void put_parameter_impl(const std::string &key, void *ptr, uint32_t,
+                            const std::type_info &type) override {
+        params[prefixed(key)] = { ptr, &type, node };
+    }
+
+    void put_object(const std::string &key, Object *obj, uint32_t) override {
+        if (!obj || hierarchy.find(obj) != hierarchy.end())
+            return;
+
+        std::string base = prefixed(key), child_name = base;
+        for (int ctr = 1; prefixes.find(child_name) != prefixes.end(); ++ctr)
+            child_name = base + "_" + std::to_string(ctr);
+        prefixes.insert(child_name);
+
+        hierarchy[obj] = { node, depth + 1 };
+        ParameterTraversal cb(params, hierarchy, prefixes, obj, child_name, depth + 1);
+        obj->traverse(&cb);
+    }
+
+    ParameterMap &params;
+    Hierarchy &hierarchy;
+    std::unordered_set<std::string> &prefixes;
+    Object *node;
+    std::string name;
+    uint32_t depth;
+};
+
+/**
+ * \brief Overwrite a scene parameter with the comma-separated values in
+ * \c value and return a function that restores its previous state
+ */
+template <typename Float, typename Spectrum>
+std::function<void()> set_parameter(const std::string &key,
+                                    const ParameterTraversal::Parameter &param,
+                                    const std::string &value) {
+    MI_IMPORT_CORE_TYPES()
+
+    std::vector<double> v;
+    for (const std::string &item : string::tokenize(value, ","))
+        v.push_back(std::stod(item));
+
+    auto expect = [&](size_t count) {
+        if (v.size() != count)
+            Throw("Batch job: parameter \"%s\" expects %i value(s), got \"%s\"!",
+                  key, count, value);
+    };
+
+    auto set = [](auto *ptr, const auto &new_value) -> std::function<void()> {
+        auto old_value = *ptr;
+        *ptr = new_value;
+        return [ptr, old_value]() { *ptr = old_value; };
+    };
+
+    const std::type_info &type = *param.type;
+    void *ptr = param.ptr;
+
+    if (type == typeid(ScalarFloat)) {
+        expect(1);
+        return set((ScalarFloat *) ptr, (ScalarFloat) v[0]);
+    } else if (type == typeid(Float)) {
+        expect(1);
+        return set((Float *) ptr, Float((ScalarFloat) v[0]));
+    } else if (type == typeid(int)) {
+        expect(1);
+        return set((int *) ptr, (int) v[0]);
+    } else if (type == typeid(uint32_t)) {
+        expect(1);
+        return set((uint32_t *) ptr, (uint32_t) v[0]);
+    } else if (type == typeid(bool)) {
+        expect(1);
+        return set((bool *) ptr, v[0] != 0.0);
+    } else if (type == typeid(ScalarColor3f) || type == typeid(ScalarPoint3f) ||
+               type == typeid(ScalarVector3f)) {
+        // These types share the same memory layout
+        expect(3);
+        return set((ScalarVector3f *) ptr,
+                   ScalarVector3f((ScalarFloat) v[0], (ScalarFloat) v[1], (ScalarFloat) v[2]));
+    } else if (type == typeid(Color3f)) {
+        expect(3);
+        return set((Color3f *) ptr, Color3f((ScalarFloat) v[0], (ScalarFloat) v[1],
+                                            (ScalarFloat) v[2]));
+    } else if (type == typeid(Point3f) || type == typeid(Vector3f)) {
+        expect(3);
+        return set((Vector3f *) ptr, Vector3f((ScalarFloat) v[0], (ScalarFloat) v[1],
+                                              (ScalarFloat) v[2]));
+    } else if (type == typeid(ScalarTransform4f) || type == typeid(Transform4f)) {
+        expect(16);
+        ScalarMatrix4f m;
+        for (size_t i = 0; i < 4; ++i)
+            for (size_t j = 0; j < 4; ++j)
+                m(i, j) = (ScalarFloat) v[i * 4 + j];
+        if (type == typeid(ScalarTransform4f))
+            return set((ScalarTransform4f *) ptr, ScalarTransform4f(m));
+        else
+            return set((Transform4f *) ptr, Transform4f(Matrix4f(m)));
+    }
+
+    Throw("Batch job: parameter \"%s\" has an unsupported type (%s)!", key,
+          type.name());
+}
+
+/// Notify modified objects (and their parents) bottom-up, like SceneParameters.update()
+inline void update_parameters(const ParameterTraversal::ParameterMap &params,
+                              const ParameterTraversal::Hierarchy &hierarchy,
+                              const std::vector<std::string> &keys) {
+    std::map<std::pair<uint32_t, Object *>, std::set<std::string>> nodes;
+
+    for (const std::string &key : keys) {
+        std::string node_key = key;
+        Object *node = params.at(key).node;
+
+        while (node) {
+            auto [parent, depth] = hierarchy.at(node);
+
+            std::string name = node_key;
+            if (parent) {
+                size_t pos = node_key.rfind('.');
+                name = node_key.substr(pos + 1);
+                node_key = node_key.substr(0, pos);
+            }
+
+            nodes[{ depth, node }].insert(name);
+            node = parent;
+        }
+    }
+
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+        it->first.second->parameters_changed(
+            std::vector<std::string>(it->second.begin(), it->second.end()));
+}
+
+/// Escape a string for inclusion in a JSON document
+static std::string json_string(const std::string &value) {
+    std::string result = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        if ((unsigned char) c < 0x20)
+            result += tfm::format("\\u%04x", (int) c);
+        else
+            result += c;
+    }
+    return result + "\"";
+}
+
+template <typename Float, typename Spectrum>
+void render_batch(Object *scene_, const fs::path &scene_path,
+                  const fs::path &batch_path, const fs::path &log_path) {
+    auto *scene = dynamic_cast<Scene<Float, Spectrum> *>(scene_);
+    if (!scene)
+        Throw("Root element of the input file must be a <scene> tag!");
+    if (scene->sensors().empty())
+        Throw("No sensor specified for scene: %s", scene);
+
+    auto integrator = scene->integrator();
+    if (!integrator)
+        Throw("No integrator specified for scene: %s", scene);
+
+    std::ifstream batch(batch_path.native());
+    if (!batch.good())
+        Throw("Could not open batch file \"%s\"!", batch_path.string());
+
+    std::ofstream log(log_path.native());
+    if (!log.good())
+        Throw("Could not create batch log file \"%s\"!", log_path.string());
+
+    ParameterTraversal::ParameterMap params;
+    ParameterTraversal::Hierarchy hierarchy;
+    std::unordered_set<std::string> prefixes;
+    hierarchy[scene] = { nullptr, 0 };
+    ParameterTraversal cb(params, hierarchy, prefixes, scene, "", 0);
+    scene->traverse(&cb);
+
+    std::string line;
+    size_t line_index = 0, job_index = 0;
+
+    while (std::getline(batch, line)) {
+        line_index++;
+        std::vector<std::string> tokens = string::tokenize(line, " \t\r");
+        if (tokens.empty() || tokens[0][0] == '#')
+            continue;
+
+        size_t sensor_i = 0;
+        uint32_t spp = 0, seed = 0;
+        std::string stem = scene_path.filename().string(),
+                    ext  = scene_path.extension().string();
+        stem = stem.substr(0, stem.size() - ext.size());
+        fs::path filename = scene_path.parent_path() /
+            fs::path(tfm::format("%s_%03i%s", stem, job_index, ext));
+        std::vector<std::pair<std::string, std::string>> overrides;
+
+        for (const std::string &token : tokens) {
+            size_t sep = token.find('=');
+            if (sep == std::string::npos)
+                Throw("Batch file \"%s\", line %i: expected <key>=<value> pairs!",
+                      batch_path.string(), line_index);
+            std::string key = token.substr(0, sep), value = token.substr(sep + 1);
+
+            if (key == "sensor")
+                sensor_i = (size_t) std::stoul(value);
+            else if (key == "spp")
+                spp = (uint32_t) std::stoul(value);
+            else if (key == "seed")
+                seed = (uint32_t) std::stoul(value);
+            else if (key == "output")
+                filename = value;
+            else if (params.find(key) != params.end())
+                overrides.emplace_back(key, value);
+            else
+                Throw("Batch file \"%s\", line %i: unknown scene parameter \"%s\"!",
+                      batch_path.string(), line_index, key);
+        }
+
+        if (sensor_i >= scene->sensors().size())
+            Throw("Batch file \"%s\", line %i: sensor index is out of bounds!",
+                  batch_path.string(), line_index);
+
+        // The film may adjust the file name (e.g. its extension)
+        auto film = scene->sensors()[sensor_i]->film();
+        filename = film->output_path(filename);
+
+        Log(Info, "Batch job %i: sensor=%i, spp=%i, seed=%i, output=\"%s\"",
+            job_index, sensor_i, spp, seed, filename.string());
+
+        Timer timer;
+
+        // Apply the parameter overrides of this job
+        std::vector<std::function<void()>> restore;
+        std::vector<std::string> keys;
+        for (auto &[key, value] : overrides) {
+            restore.push_back(set_parameter<Float, Spectrum>(key, params[key], value));
+            keys.push_back(key);
+        }
+        if (!keys.empty())
+            update_parameters(params, hierarchy, keys);
+        dr::eval();
+        size_t update_time = timer.reset();
+
+        /* critical section */ {
+            std::lock_guard<std::mutex> guard(develop_callback_mutex);
+            develop_callback = [&]() { film->write(filename); };
+        }
+
+        integrator->render(scene, (uint32_t) sensor_i, seed, spp,
+                           false /* develop */, true /* evaluate */);
+
+        /* critical section */ {
+            std::lock_guard<std::mutex> guard(develop_callback_mutex);
+            develop_callback = nullptr;
+        }
+        size_t render_time = timer.reset();
+
+        film->write(filename);
+        size_t write_time = timer.reset();
+
+        // Undo the overrides so that every job starts from the loaded scene
+        for (auto it = restore.rbegin(); it != restore.rend(); ++it)
+            (*it)();
+        if (!keys.empty())
+            update_parameters(params, hierarchy, keys);
+        dr::eval();
+
+        log << tfm::format("{\"job\": %i, \"line\": %i, \"sensor\": %i, "
+                           "\"spp\": %i, \"seed\": %i, \"output\": %s, "
+                           "\"update_ms\": %i, \"render_ms\": %i, "
+                           "\"write_ms\": %i}",
+                           job_index, line_index, sensor_i, spp, seed,
+                           json_string(filename.string()), update_time,
+                           render_time, write_time)
+            << std::endl;
+
+        Log(Info, "Batch job %i finished (render: %s, total: %s)", job_index,
+            util::time_string((float) render_time),
+            util::time_string((float) (update_time + render_time + write_time)));
+
+        Profiler::print_report();
+        Profiler::reset();
+        job_index++;
+    }
+
+    Log(Info, "Batch: rendered %i job(s), timings written to \"%s\"",
+        job_index, log_path.string());
 }
 
 #if !defined(_WIN32)
@@ -170,6 +509,8 @@ int main(int argc, char *argv[]) {
     auto arg_help      = parser.add(StringVec{ "-h", "--help" });
     auto arg_mode      = parser.add(StringVec{ "-m", "--mode" }, true);
     auto arg_paths     = parser.add(StringVec{ "-a" }, true);
+    auto arg_batch     = parser.add(StringVec{ "-b", "--batch" }, true);
+    auto arg_batch_log = parser.add(StringVec{ "--batch-log" }, true);
     auto arg_extra     = parser.add("", true);
 
     // Specialized flags for the JIT compiler
@@ -340,6 +681,16 @@ int main(int argc, char *argv[]) {
 #endif
         }
 
+        if (*arg_batch) {
+            if (!*arg_extra || arg_extra->next())
+                Throw("-b/--batch: expected exactly one scene file!");
+            if (*arg_output || *arg_sensor_i)
+                Throw("-b/--batch: the sensor and output filename must be "
+                      "specified in the batch file!");
+        } else if (*arg_batch_log) {
+            Throw("--batch-log requires -b/--batch!");
+        }
+
         while (arg_extra && *arg_extra) {
             fs::path filename(arg_extra->as_string());
             ref<FileResolver> fr2 = new FileResolver(*fr);
@@ -362,7 +713,15 @@ int main(int argc, char *argv[]) {
                 Throw("Root element of the input file is expanded into "
                       "multiple objects, only a single object is expected!");
 
-            MI_INVOKE_VARIANT(mode, render, parsed[0].get(), sensor_i, filename);
+            if (*arg_batch) {
+                fs::path batch_path(arg_batch->as_string()),
+                    log_path(*arg_batch_log ? arg_batch_log->as_string()
+                                            : batch_path.string() + ".log");
+                MI_INVOKE_VARIANT(mode, render_batch, parsed[0].get(), filename,
+                                  batch_path, log_path);
+            } else {
+                MI_INVOKE_VARIANT(mode, render, parsed[0].get(), sensor_i, filename);
+            }
             arg_extra = arg_extra->next();
         }
     } catch (const std::exception &e) {
@@ -398,6 +757,9 @@ int main(int argc, char *argv[]) {
 #endif
     }
 
+    // Release cached resources (e.g. mesh buffers) before the JIT shuts down
+    ResourceCache::clear();
+
     MI_INVOKE_VARIANT(mode, scene_static_accel_shutdown);
     color_management_static_shutdown();
     Profiler::static_shutdown();
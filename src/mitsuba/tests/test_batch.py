@@ -0,0 +1,75 @@
+import json
+import os
+import subprocess
+
+import numpy as np
+import pytest
+import mitsuba as mi
+
+
+def mitsuba_executable():
+    # The executable is placed next to the 'python' directory of the build
+    path = os.path.join(os.path.dirname(mi.__file__), '..', '..', 'mitsuba')
+    if not os.path.exists(path):
+        pytest.skip('mitsuba executable not found')
+    return os.path.abspath(path)
+
+
+SCENE = """
+<scene version="3.0.0">
+    <integrator type="direct"/>
+    <sensor type="perspective">
+        <film type="hdrfilm">
+            <integer name="width" value="4"/>
+            <integer name="height" value="4"/>
+        </film>
+    </sensor>
+    <emitter type="constant" id="light">
+        <rgb name="radiance" value="1"/>
+    </emitter>
+</scene>
+"""
+
+
+def run_batch(tmp_path, jobs):
+    scene_path = tmp_path / 'scene.xml'
+    scene_path.write_text(SCENE)
+    batch_path = tmp_path / 'jobs.txt'
+    batch_path.write_text(jobs)
+    return subprocess.run([mitsuba_executable(), '-m', 'scalar_rgb',
+                           '-b', str(batch_path), str(scene_path)],
+                          capture_output=True, text=True)
+
+
+def test01_batch_jobs(variant_scalar_rgb, tmp_path):
+    result = run_batch(tmp_path, f"""
+        # Comments and empty lines are ignored
+
+        spp=1 output={tmp_path / 'a'}
+        spp=1 seed=3 output={tmp_path / 'b.png'} light.radiance.value=2,2,2
+        spp=1 output={tmp_path / 'c.exr'}
+    """)
+    assert result.returncode == 0, result.stderr
+
+    # The log names the files written by the film (with its extension)
+    with open(tmp_path / 'jobs.txt.log') as f:
+        log = [json.loads(line) for line in f]
+    assert [entry['job'] for entry in log] == [0, 1, 2]
+    assert [entry['line'] for entry in log] == [4, 5, 6]
+    assert log[1]['seed'] == 3
+    outputs = [entry['output'] for entry in log]
+    assert outputs == [str(tmp_path / name) for name in ['a.exr', 'b.exr', 'c.exr']]
+
+    images = [np.array(mi.Bitmap(path))[..., :3] for path in outputs]
+    assert np.allclose(images[0], 1)
+    assert np.allclose(images[1], 2)
+
+    # The override of the second job is restored afterwards
+    assert np.allclose(images[2], 1)
+
+
+def test02_batch_invalid_parameter(variant_scalar_rgb, tmp_path):
+    result = run_batch(tmp_path, f"spp=1 output={tmp_path / 'a'} light.foo=1\n")
+    assert result.returncode != 0
+    assert 'unknown scene parameter "light.foo"' in result.stderr
+    assert not os.path.exists(tmp_path / 'a.exr')
@@ -6,6 +6,7 @@
 #include <mitsuba/core/util.h>
 #include <mitsuba/core/fresolver.h>
 #include <mitsuba/core/profiler.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/python/python.h>
 
 
@@ -31,9 +32,12 @@ MI_PY_DECLARE(DummyStream);
 MI_PY_DECLARE(FileStream);
 MI_PY_DECLARE(MemoryStream);
 MI_PY_DECLARE(ZStream);
+MI_PY_DECLARE(Profiler);
 MI_PY_DECLARE(ProgressReporter);
+MI_PY_DECLARE(ResourceCache);
 MI_PY_DECLARE(rfilter);
 MI_PY_DECLARE(Thread);
+MI_PY_DECLARE(TiledImage);
 MI_PY_DECLARE(Timer);
 MI_PY_DECLARE(misc);
 
@@ -156,8 +160,11 @@ NB_MODULE(mitsuba_ext, m) {
     MI_PY_IMPORT(FileStream);
     MI_PY_IMPORT(MemoryStream);
     MI_PY_IMPORT(ZStream);
+    MI_PY_IMPORT(Profiler);
     MI_PY_IMPORT(ProgressReporter);
+    MI_PY_IMPORT(ResourceCache);
     MI_PY_IMPORT(Thread);
+    MI_PY_IMPORT(TiledImage);
     MI_PY_IMPORT(Timer);
     MI_PY_IMPORT(misc);
 
@@ -182,6 +189,10 @@ NB_MODULE(mitsuba_ext, m) {
         Class::static_remove_functors();
         StructConverter::static_shutdown();
 
+        /* Release cached resources (e.g. mesh buffers stored in JIT arrays)
+           before the JIT compiler is shut down */
+        ResourceCache::clear();
+
         /* Potentially re-initialize the threading system:
          * 1) Deleting and re-initializing threading prevents a Nanobind leak
          * if the lifetime of the main thread was shared with Python.
@@ -209,6 +220,7 @@ NB_MODULE(mitsuba_ext, m) {
         Logger::static_shutdown();
         Thread::static_shutdown();
         Class::static_shutdown();
+        ResourceCache::clear();
         Jit::static_shutdown();
     };
 
@@ -95,6 +95,7 @@ MI_PY_DECLARE(Interaction);
 MI_PY_DECLARE(SurfaceInteraction);
 MI_PY_DECLARE(MediumInteraction);
 MI_PY_DECLARE(PreliminaryIntersection);
+MI_PY_DECLARE(LightTree);
 MI_PY_DECLARE(Medium);
 MI_PY_DECLARE(mueller);
 MI_PY_DECLARE(MicrofacetDistribution);
@@ -111,6 +112,7 @@ MI_PY_DECLARE(Sensor);
 MI_PY_DECLARE(SilhouetteSample);
 MI_PY_DECLARE(Shape);
 //MI_PY_DECLARE(ShapeKDTree);
+MI_PY_DECLARE(SparseVolumeGrid);
 MI_PY_DECLARE(srgb);
 MI_PY_DECLARE(Texture);
 MI_PY_DECLARE(Volume);
@@ -204,6 +206,7 @@ NB_MODULE(MI_VARIANT_NAME, m) {
     MI_PY_IMPORT(fresnel);
     MI_PY_IMPORT(ImageBlock);
     MI_PY_IMPORT(Integrator);
+    MI_PY_IMPORT(LightTree);
     MI_PY_IMPORT_SUBMODULE(mueller);
     MI_PY_IMPORT(MicrofacetDistribution);
     MI_PY_IMPORT(MicroflakeDistribution);
@@ -214,6 +217,7 @@ NB_MODULE(MI_VARIANT_NAME, m) {
     MI_PY_IMPORT(Sampler);
     MI_PY_IMPORT(Sensor);
 //    MI_PY_IMPORT(ShapeKDTree);
+    MI_PY_IMPORT(SparseVolumeGrid);
     MI_PY_IMPORT(srgb);
     MI_PY_IMPORT(Texture);
     MI_PY_IMPORT(Volume);
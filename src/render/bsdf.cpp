@@ -1,4 +1,5 @@
 #include <cstring>
+#include <unordered_set>
 
 #include <mitsuba/render/bsdf.h>
 #include <mitsuba/render/texture.h>
@@ -80,6 +81,32 @@ struct AttributeCallback : public TraversalCallback {
     F1 func_object;
 };
 
+template <typename Texture>
+struct DifferentialsCallback : public TraversalCallback {
+    void put_object(const std::string &, Object *obj, uint32_t) override {
+        if (!obj || found || !visited.insert(obj).second)
+            return;
+        Texture *texture = dynamic_cast<Texture *>(obj);
+        if (texture && texture->needs_differentials())
+            found = true;
+        else
+            obj->traverse(this);
+    };
+
+    void put_parameter_impl(const std::string &, void *, uint32_t,
+                            const std::type_info &) override { };
+
+    std::unordered_set<Object *> visited;
+    bool found = false;
+};
+
+MI_VARIANT void BSDF<Float, Spectrum>::update_differentials_flag() {
+    DifferentialsCallback<Texture> cb;
+    traverse((TraversalCallback *) &cb);
+    if (cb.found)
+        m_flags = m_flags | BSDFFlags::NeedsDifferentials;
+}
+
 MI_VARIANT typename BSDF<Float, Spectrum>::Mask
 BSDF<Float, Spectrum>::has_attribute(const std::string& name, Mask /*active*/) const {
     AttributeCallback<Texture, float> cb(name, [&](Texture *) { return 0.f; });
@@ -0,0 +1,505 @@
+#include <mitsuba/render/bvh.h>
+#include <mitsuba/render/mesh.h>
+#include <mitsuba/core/properties.h>
+#include <mitsuba/core/timer.h>
+#include <mitsuba/core/util.h>
+
+NAMESPACE_BEGIN(mitsuba)
+
+MI_VARIANT ShapeBVH<Float, Spectrum>::ShapeBVH(const Properties &props) {
+    /* BVH construction: Maximum number of primitives per leaf. Larger
+       subtrees are always split */
+    int max_prims = props.get<int>("bvh_max_prims", 8);
+    if (max_prims <= 0)
+        Throw("The maximum number of primitives per BVH leaf must be positive");
+    m_max_prims = (Size) max_prims;
+
+    /* BVH construction: Number of bins per axis used to evaluate the SAH. The
+       default depends on the quality profile. */
+    AccelQuality quality = parse_accel_quality(props.string("accel_quality", "high"));
+    int bin_count = props.get<int>("bvh_bins", quality == AccelQuality::Low ? 8 : 16);
+    if (bin_count < 2)
+        Throw("The number of BVH bins must be >= 2");
+    m_bin_count = (Size) bin_count;
+
+    /* BVH construction: Cost of a node traversal relative to the cost of
+       a primitive intersection */
+    m_traversal_cost = props.get<ScalarFloat>("bvh_traversal_cost", 1.f);
+
+    m_primitive_map.push_back(0);
+}
+
+MI_VARIANT void ShapeBVH<Float, Spectrum>::clear() {
+    m_shapes.clear();
+    m_primitive_map.clear();
+    m_primitive_map.push_back(0);
+    m_bbox.reset();
+    m_nodes.reset();
+    m_indices.reset();
+    m_node_count = 0;
+    m_index_count = 0;
+}
+
+MI_VARIANT void ShapeBVH<Float, Spectrum>::add_shape(Shape *shape) {
+    Assert(!ready());
+    m_primitive_map.push_back(m_primitive_map.back() +
+                              shape->primitive_count());
+    m_shapes.push_back(shape);
+    m_bbox.expand(shape->bbox());
+}
+
+MI_VARIANT void ShapeBVH<Float, Spectrum>::build() {
+    if (ready())
+        Throw("The BVH has already been built!");
+
+    Timer timer;
+    Size prim_count = primitive_count();
+
+    if (prim_count == 0) {
+        Log(Warn, "BVH contains no geometry!");
+        return;
+    }
+
+    Log(Info, "Building a SAH BVH (%i primitives) ..", prim_count);
+
+    /* ==================================================================== */
+    /*                     Build a binary BVH in parallel                   */
+    /* ==================================================================== */
+
+    BuildContext ctx;
+    ctx.nodes.reset(new BuildNode[2 * (size_t) prim_count - 1]);
+    ctx.prim_bbox.reset(new ScalarBoundingBox3f[prim_count]);
+    ctx.temp_indices.reset(new Index[prim_count]);
+    ctx.node_count = 1;
+    m_indices.reset(new Index[prim_count]);
+
+    dr::parallel_for(
+        dr::blocked_range<Size>(0u, prim_count, MI_BVH_GRAIN_SIZE),
+        [&](const dr::blocked_range<Size> &range) {
+            for (Size i = range.begin(); i != range.end(); ++i) {
+                ctx.prim_bbox[i] = bbox(i);
+                m_indices[i] = i;
+            }
+        }
+    );
+
+    build_recursive(ctx, 0, 0, prim_count, 0);
+
+    /* ==================================================================== */
+    /*                     Collapse it into a wide BVH                      */
+    /* ==================================================================== */
+
+    std::vector<BVHNode> nodes;
+    nodes.reserve(ctx.node_count / (MI_BVH_WIDTH - 1) + 1);
+    collapse(ctx, 0, nodes);
+
+    m_node_count = (Size) nodes.size();
+    m_index_count = prim_count;
+    m_nodes.reset(new BVHNode[m_node_count]);
+    std::copy(nodes.begin(), nodes.end(), m_nodes.get());
+    m_bbox = ctx.nodes[0].bbox;
+
+    Log(Debug, "BVH statistics: %i binary nodes, %i leaves, %i wide nodes",
+        (Size) ctx.node_count, (size_t) ctx.leaf_count, m_node_count);
+
+    Log(Info, "Finished. (%s of storage, took %s)",
+        util::mem_string(m_index_count * sizeof(Index) +
+                         m_node_count * sizeof(BVHNode)),
+        util::time_string((float) timer.value()));
+}
+
+MI_VARIANT void ShapeBVH<Float, Spectrum>::refit() {
+    if (!ready())
+        Throw("The BVH must be built before it can be refit!");
+
+    Size prim_count = primitive_count();
+    if (prim_count != m_index_count)
+        Throw("The number of primitives changed, the BVH must be rebuilt!");
+
+    std::unique_ptr<ScalarBoundingBox3f[]> prim_bbox(
+        new ScalarBoundingBox3f[prim_count]);
+
+    dr::parallel_for(
+        dr::blocked_range<Size>(0u, prim_count, MI_BVH_GRAIN_SIZE),
+        [&](const dr::blocked_range<Size> &range) {
+            for (Size i = range.begin(); i != range.end(); ++i)
+                prim_bbox[i] = bbox(i);
+        }
+    );
+
+    /* Children are always stored after their parent (see collapse()), hence
+       a reverse sweep over the nodes updates them bottom-up */
+    auto node_bbox = [](const BVHNode &node) {
+        ScalarBoundingBox3f result;
+        for (size_t axis = 0; axis < 3; ++axis) {
+            for (Size i = 0; i < MI_BVH_WIDTH; ++i) {
+                result.min[axis] = dr::minimum(result.min[axis], node.bbox_min[axis][i]);
+                result.max[axis] = dr::maximum(result.max[axis], node.bbox_max[axis][i]);
+            }
+        }
+        return result;
+    };
+
+    for (Size n = m_node_count; n-- > 0; ) {
+        BVHNode &node = m_nodes[n];
+        for (Size i = 0; i < MI_BVH_WIDTH; ++i) {
+            ScalarBoundingBox3f child_bbox;
+            if (node.prim_count[i] > 0) {
+                Index prim_start = node.child[i],
+                      prim_end   = prim_start + node.prim_count[i];
+                for (Index j = prim_start; j < prim_end; ++j)
+                    child_bbox.expand(prim_bbox[m_indices[j]]);
+            } else if (node.child[i] != 0) { // The root is never a child
+                child_bbox = node_bbox(m_nodes[node.child[i]]);
+            } else {
+                continue; // Unused slot
+            }
+
+            for (size_t axis = 0; axis < 3; ++axis) {
+                node.bbox_min[axis][i] = child_bbox.min[axis];
+                node.bbox_max[axis][i] = child_bbox.max[axis];
+            }
+        }
+    }
+
+    m_bbox = node_bbox(m_nodes[0]);
+}
+
+MI_VARIANT void ShapeBVH<Float, Spectrum>::build_recursive(BuildContext &ctx,
+                                                          Index node,
+                                                          Index start,
+                                                          Index end,
+                                                          Size depth) {
+    BuildNode &n = ctx.nodes[node];
+    Size count = end - start;
+
+    /* ==================================================================== */
+    /*           Bounds of the primitives and of their centroids            */
+    /* ==================================================================== */
+
+    ScalarBoundingBox3f bbox, centroid_bbox;
+    auto accumulate = [&](Index range_start, Index range_end,
+                          ScalarBoundingBox3f &bbox_out,
+                          ScalarBoundingBox3f &centroid_bbox_out) {
+        for (Index i = range_start; i != range_end; ++i) {
+            const ScalarBoundingBox3f &prim_bbox = ctx.prim_bbox[m_indices[i]];
+            bbox_out.expand(prim_bbox);
+            centroid_bbox_out.expand(prim_bbox.center());
+        }
+    };
+
+    if (count >= MI_BVH_GRAIN_SIZE) {
+        std::mutex bbox_mutex;
+        dr::parallel_for(
+            dr::blocked_range<Index>(start, end, MI_BVH_GRAIN_SIZE),
+            [&](const dr::blocked_range<Index> &range) {
+                ScalarBoundingBox3f bbox_local, centroid_bbox_local;
+                accumulate(range.begin(), range.end(), bbox_local,
+                           centroid_bbox_local);
+                std::lock_guard<std::mutex> lock(bbox_mutex);
+                bbox.expand(bbox_local);
+                centroid_bbox.expand(centroid_bbox_local);
+            }
+        );
+    } else {
+        accumulate(start, end, bbox, centroid_bbox);
+    }
+
+    n.bbox = bbox;
+
+    auto make_leaf = [&]() {
+        n.prim_offset = start;
+        n.prim_count = count;
+        ctx.leaf_count++;
+    };
+
+    if (count == 1 || depth + 1 >= MI_BVH_MAXDEPTH) {
+        make_leaf();
+        return;
+    }
+
+    /* ==================================================================== */
+    /*                       Binned SAH split search                        */
+    /* ==================================================================== */
+
+    struct Bin {
+        ScalarBoundingBox3f bbox;
+        Size count = 0;
+    };
+
+    ScalarVector3f extents = centroid_bbox.extents(), bin_scale;
+    for (size_t axis = 0; axis < 3; ++axis)
+        bin_scale[axis] = extents[axis] > 0.f ? m_bin_count / extents[axis] : 0.f;
+
+    auto bin_index = [&](const ScalarBoundingBox3f &prim_bbox, size_t axis) {
+        ScalarFloat value =
+            (prim_bbox.center()[axis] - centroid_bbox.min[axis]) * bin_scale[axis];
+        return std::min((Size) std::max(value, ScalarFloat(0)), m_bin_count - 1);
+    };
+
+    std::vector<Bin> bins(3 * m_bin_count);
+    auto bin_prims = [&](Index range_start, Index range_end, std::vector<Bin> &out) {
+        for (Index i = range_start; i != range_end; ++i) {
+            const ScalarBoundingBox3f &prim_bbox = ctx.prim_bbox[m_indices[i]];
+            for (size_t axis = 0; axis < 3; ++axis) {
+                Bin &bin = out[axis * m_bin_count + bin_index(prim_bbox, axis)];
+                bin.bbox.expand(prim_bbox);
+                bin.count++;
+            }
+        }
+    };
+
+    if (count >= MI_BVH_GRAIN_SIZE) {
+        std::mutex bins_mutex;
+        dr::parallel_for(
+            dr::blocked_range<Index>(start, end, MI_BVH_GRAIN_SIZE),
+            [&](const dr::blocked_range<Index> &range) {
+                std::vector<Bin> bins_local(3 * m_bin_count);
+                bin_prims(range.begin(), range.end(), bins_local);
+                std::lock_guard<std::mutex> lock(bins_mutex);
+                for (size_t i = 0; i < bins.size(); ++i) {
+                    bins[i].bbox.expand(bins_local[i].bbox);
+                    bins[i].count += bins_local[i].count;
+                }
+            }
+        );
+    } else {
+        bin_prims(start, end, bins);
+    }
+
+    /* Sweep over the bins of each axis. Costs are expressed relative to the
+       cost of intersecting a single primitive */
+    ScalarFloat best_cost = dr::Infinity<ScalarFloat>,
+                inv_area  = 1.f / bbox.surface_area();
+    int best_axis = -1;
+    Size best_bin = 0;
+
+    std::vector<ScalarFloat> right_cost(m_bin_count);
+    for (size_t axis = 0; axis < 3; ++axis) {
+        if (bin_scale[axis] == 0.f)
+            continue;
+
+        const Bin *axis_bins = bins.data() + axis * m_bin_count;
+
+        ScalarBoundingBox3f right_bbox;
+        Size right_count = 0;
+        for (Size i = m_bin_count - 1; i > 0; --i) {
+            right_bbox.expand(axis_bins[i].bbox);
+            right_count += axis_bins[i].count;
+            right_cost[i] = right_count > 0
+                ? right_bbox.surface_area() * right_count : 0.f;
+        }
+
+        ScalarBoundingBox3f left_bbox;
+        Size left_count = 0;
+        for (Size i = 1; i < m_bin_count; ++i) {
+            left_bbox.expand(axis_bins[i - 1].bbox);
+            left_count += axis_bins[i - 1].count;
+            if (left_count == 0 || left_count == count)
+                continue;
+
+            ScalarFloat cost = m_traversal_cost +
+                (left_bbox.surface_area() * left_count + right_cost[i]) * inv_area;
+
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = (int) axis;
+                best_bin = i;
+            }
+        }
+    }
+
+    if (count <= m_max_prims && (ScalarFloat) count <= best_cost) {
+        make_leaf();
+        return;
+    }
+
+    /* ==================================================================== */
+    /*                            Partitioning                              */
+    /* ==================================================================== */
+
+    Index mid;
+    if (best_axis >= 0)
+        mid = partition(ctx, start, end, best_axis, best_bin, centroid_bbox);
+    else
+        mid = start + count / 2; // All centroids coincide: split the range
+
+    if (mid == start || mid == end)
+        mid = start + count / 2;
+
+    /* ==================================================================== */
+    /*                              Recursion                               */
+    /* ==================================================================== */
+
+    Index left = ctx.node_count.fetch_add(2);
+    n.left = left;
+
+    if (count >= MI_BVH_PARALLEL_PRIMS) {
+        Task *left_task = dr::do_async([&, left, start, mid, depth]() {
+            ScopedSetThreadEnvironment env(ctx.env);
+            build_recursive(ctx, left, start, mid, depth + 1);
+        });
+        build_recursive(ctx, left + 1, mid, end, depth + 1);
+        task_wait_and_release(left_task);
+    } else {
+        build_recursive(ctx, left, start, mid, depth + 1);
+        build_recursive(ctx, left + 1, mid, end, depth + 1);
+    }
+}
+
+MI_VARIANT typename ShapeBVH<Float, Spectrum>::Index
+ShapeBVH<Float, Spectrum>::partition(BuildContext &ctx, Index start,
+                                     Index end, int axis, Size split_bin,
+                                     const ScalarBoundingBox3f &centroid_bbox) {
+    Size count = end - start;
+    ScalarFloat extent = centroid_bbox.extents()[axis],
+                scale  = m_bin_count / extent,
+                offset = centroid_bbox.min[axis];
+
+    auto is_left = [&](Index prim_index) {
+        ScalarFloat value =
+            (ctx.prim_bbox[prim_index].center()[axis] - offset) * scale;
+        return std::min((Size) std::max(value, ScalarFloat(0)),
+                        m_bin_count - 1) < split_bin;
+    };
+
+    if (count < MI_BVH_GRAIN_SIZE) {
+        return (Index) (std::partition(m_indices.get() + start,
+                                       m_indices.get() + end, is_left) -
+                        m_indices.get());
+    }
+
+    /* Parallel version: count the primitives on the left side of each
+       block, then scatter into the scratch buffer and copy back */
+    Size block_count = (count + MI_BVH_GRAIN_SIZE - 1) / MI_BVH_GRAIN_SIZE;
+    std::unique_ptr<Size[]> left_offset(new Size[block_count + 1]);
+
+    auto block_range = [&](Size block) {
+        return std::make_pair(start + block * MI_BVH_GRAIN_SIZE,
+                              std::min(end, start + (block + 1) * MI_BVH_GRAIN_SIZE));
+    };
+
+    dr::parallel_for(
+        dr::blocked_range<Size>(0u, block_count, 1u),
+        [&](const dr::blocked_range<Size> &range) {
+            for (Size block = range.begin(); block != range.end(); ++block) {
+                auto [block_start, block_end] = block_range(block);
+                Size left_count = 0;
+                for (Index i = block_start; i != block_end; ++i)
+                    left_count += is_left(m_indices[i]) ? 1 : 0;
+                left_offset[block + 1] = left_count;
+            }
+        }
+    );
+
+    left_offset[0] = 0;
+    for (Size block = 0; block < block_count; ++block)
+        left_offset[block + 1] += left_offset[block];
+
+    Size total_left = left_offset[block_count];
+    Index *temp = ctx.temp_indices.get();
+
+    dr::parallel_for(
+        dr::blocked_range<Size>(0u, block_count, 1u),
+        [&](const dr::blocked_range<Size> &range) {
+            for (Size block = range.begin(); block != range.end(); ++block) {
+                auto [block_start, block_end] = block_range(block);
+                Index left_out  = start + left_offset[block],
+                      right_out = start + total_left +
+                                  (block_start - start - left_offset[block]);
+                for (Index i = block_start; i != block_end; ++i) {
+                    Index prim_index = m_indices[i];
+                    if (is_left(prim_index))
+                        temp[left_out++] = prim_index;
+                    else
+                        temp[right_out++] = prim_index;
+                }
+            }
+        }
+    );
+
+    dr::parallel_for(
+        dr::blocked_range<Index>(start, end, MI_BVH_GRAIN_SIZE),
+        [&](const dr::blocked_range<Index> &range) {
+            std::copy(temp + range.begin(), temp + range.end(),
+                      m_indices.get() + range.begin());
+        }
+    );
+
+    return start + total_left;
+}
+
+MI_VARIANT typename ShapeBVH<Float, Spectrum>::Index
+ShapeBVH<Float, Spectrum>::collapse(const BuildContext &ctx, Index node,
+                                    std::vector<BVHNode> &nodes) const {
+    /* Gather up to MI_BVH_WIDTH children by repeatedly opening the inner
+       node with the largest surface area */
+    Index children[MI_BVH_WIDTH];
+    Size child_count = 1;
+    children[0] = node;
+
+    while (child_count < MI_BVH_WIDTH) {
+        int best = -1;
+        ScalarFloat best_area = -1.f;
+        for (Size i = 0; i < child_count; ++i) {
+            const BuildNode &child = ctx.nodes[children[i]];
+            if (child.prim_count == 0 && child.bbox.surface_area() > best_area) {
+                best = (int) i;
+                best_area = child.bbox.surface_area();
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        Index left = ctx.nodes[children[best]].left;
+        children[best] = left;
+        children[child_count++] = left + 1;
+    }
+
+    BVHNode result;
+    for (Size i = 0; i < MI_BVH_WIDTH; ++i) {
+        for (size_t axis = 0; axis < 3; ++axis) {
+            result.bbox_min[axis][i] =  dr::Infinity<ScalarFloat>;
+            result.bbox_max[axis][i] = -dr::Infinity<ScalarFloat>;
+        }
+        result.child[i] = 0;
+        result.prim_count[i] = 0;
+    }
+
+    Index index = (Index) nodes.size();
+    nodes.emplace_back();
+
+    for (Size i = 0; i < child_count; ++i) {
+        const BuildNode &child = ctx.nodes[children[i]];
+        for (size_t axis = 0; axis < 3; ++axis) {
+            result.bbox_min[axis][i] = child.bbox.min[axis];
+            result.bbox_max[axis][i] = child.bbox.max[axis];
+        }
+
+        if (child.prim_count > 0) {
+            result.child[i] = child.prim_offset;
+            result.prim_count[i] = child.prim_count;
+        } else {
+            result.child[i] = collapse(ctx, children[i], nodes);
+        }
+    }
+
+    nodes[index] = result;
+    return index;
+}
+
+MI_VARIANT std::string ShapeBVH<Float, Spectrum>::to_string() const {
+    std::ostringstream oss;
+    oss << "ShapeBVH[" << std::endl
+        << "  shapes = [" << std::endl;
+    for (auto shape : m_shapes)
+        oss << "    " << string::indent(shape, 4)
+            << "," << std::endl;
+    oss << "  ]" << std::endl << "]";
+    return oss.str();
+}
+
+MI_IMPLEMENT_CLASS_VARIANT(ShapeBVH, Object)
+MI_INSTANTIATE_CLASS(ShapeBVH)
+NAMESPACE_END(mitsuba)
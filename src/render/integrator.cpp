@@ -1,6 +1,8 @@
+#include <atomic>
 #include <mutex>
 
 #include <drjit/morton.h>
+#include <mitsuba/core/bitmap.h>
 #include <mitsuba/core/fwd.h>
 #include <mitsuba/core/profiler.h>
 #include <mitsuba/core/progress.h>
@@ -113,6 +115,43 @@ MI_VARIANT SamplingIntegrator<Float, Spectrum>::SamplingIntegrator(const Propert
                   "Please leave it undefined; Mitsuba will then automatically "
                   "choose the necessary number of passes.");
     }
+
+    // Adaptive sampling: target relative standard error of each pixel
+    m_adaptive_threshold = props.get<ScalarFloat>("adaptive_threshold", 0.f);
+    if (m_adaptive_threshold < 0.f)
+        Throw("\"adaptive_threshold\" must be nonnegative!");
+
+    m_adaptive_min_spp = props.get<uint32_t>("adaptive_min_spp", 16);
+    m_adaptive_step = props.get<uint32_t>("adaptive_step", 8);
+    if (m_adaptive_min_spp < 2 || m_adaptive_step == 0)
+        Throw("\"adaptive_min_spp\" must be at least 2 and \"adaptive_step\" "
+              "must be positive!");
+
+    m_adaptive_aov = props.get<bool>("adaptive_aov", false);
+
+    // Progressive rendering: full-frame passes with a doubling sample count
+    m_progressive = props.get<bool>("progressive", false);
+    if (props.has_property("progressive_snapshot")) {
+        m_progressive_snapshot = props.string("progressive_snapshot");
+        m_progressive_snapshot.replace_extension(".exr");
+    }
+    m_progressive_interval = props.get<ScalarFloat>("progressive_interval", 0.f);
+
+    if (m_progressive && adaptive())
+        Throw("Progressive rendering and adaptive sampling cannot be combined!");
+
+    if constexpr (dr::is_jit_v<Float>) {
+        if (adaptive()) {
+            Log(Warn, "Adaptive sampling is only supported in scalar variants "
+                      "and will be disabled.");
+            m_adaptive_threshold = 0.f;
+        }
+        if (m_progressive) {
+            Log(Warn, "Progressive rendering is only supported in scalar "
+                      "variants and will be disabled.");
+            m_progressive = false;
+        }
+    }
 }
 
 MI_VARIANT SamplingIntegrator<Float, Spectrum>::~SamplingIntegrator() { }
@@ -139,7 +178,7 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
         sampler->set_sample_count(spp);
     spp = sampler->sample_count();
 
-    uint32_t spp_per_pass = (m_samples_per_pass == (uint32_t) -1)
+    uint32_t spp_per_pass = (m_samples_per_pass == (uint32_t) -1 || adaptive())
                                     ? spp
                                     : std::min(m_samples_per_pass, spp);
 
@@ -149,8 +188,14 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
 
     uint32_t n_passes = spp / spp_per_pass;
 
+    if (adaptive() && has_flag(film->flags(), FilmFlags::Special))
+        Throw("Adaptive sampling requires a film that stores RGB values!");
+
     // Determine output channels and prepare the film with this information
-    size_t n_channels = film->prepare(aov_names());
+    std::vector<std::string> channels = aov_names();
+    if (adaptive() && m_adaptive_aov)
+        channels.push_back("spp");
+    size_t n_channels = film->prepare(channels);
 
     // Start the render timer (used for timeouts & log messages)
     m_render_timer.reset();
@@ -160,6 +205,20 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
         // Render on the CPU using a spiral pattern
         uint32_t n_threads = (uint32_t) Thread::thread_count();
 
+        // Number of samples per pixel taken in each pass over the image
+        std::vector<uint32_t> pass_spp;
+        if (m_progressive) {
+            for (uint32_t total = 0, count = 1; total < spp;) {
+                pass_spp.push_back(std::min(count, spp - total));
+                total += pass_spp.back();
+                if (pass_spp.size() > 1)
+                    count *= 2;
+            }
+        } else {
+            pass_spp.assign(n_passes, spp_per_pass);
+        }
+        n_passes = (uint32_t) pass_spp.size();
+
         Log(Info, "Starting render job (%ux%u, %u sample%s,%s %u thread%s)",
             film_size.x(), film_size.y(), spp, spp == 1 ? "" : "s",
             n_passes > 1 ? tfm::format(" %u passes,", n_passes) : "", n_threads,
@@ -168,6 +227,13 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
         if (m_timeout > 0.f)
             Log(Info, "Timeout specified: %.2f seconds.", m_timeout);
 
+        if (adaptive())
+            Log(Info, "Adaptive sampling: relative error threshold %.4f, "
+                "%u to %u samples per pixel.", m_adaptive_threshold,
+                std::min(m_adaptive_min_spp, spp), spp);
+
+        m_sample_counter = 0;
+
         // If no block size was specified, find size that is good for parallelization
         uint32_t block_size = m_block_size;
         if (block_size == 0) {
@@ -190,8 +256,8 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
             progress = new ProgressReporter("Rendering");
 
         // Total number of blocks to be handled, including multiple passes.
-        uint32_t total_blocks = spiral.block_count() * n_passes,
-                 blocks_done = 0;
+        uint32_t total_blocks = spiral.block_count() * n_passes;
+        std::atomic<uint32_t> blocks_done { 0 };
 
         // Grain size for parallelization
         uint32_t grain_size = std::max(total_blocks / (4 * n_threads), 1u);
@@ -199,6 +265,42 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
         // Avoid overlaps in RNG seeding RNG when a seed is manually specified
         seed *= dr::prod(film_size);
 
+        /* Progressive rendering: track the completion of passes and write
+           snapshots once all blocks of a pass (and of its predecessors) are
+           part of the film */
+        std::unique_ptr<std::atomic<uint32_t>[]> pass_blocks_done(
+            new std::atomic<uint32_t>[n_passes]());
+        std::mutex snapshot_mutex;
+        uint32_t passes_complete = 0;
+        Timer snapshot_timer;
+
+        auto pass_finished = [&]() {
+            std::lock_guard<std::mutex> guard(snapshot_mutex);
+            uint32_t prev = passes_complete, spp_done = 0;
+            while (passes_complete < n_passes &&
+                   pass_blocks_done[passes_complete].load() == spiral.block_count())
+                passes_complete++;
+
+            for (uint32_t i = 0; i < passes_complete; ++i)
+                spp_done += pass_spp[i];
+
+            // The final image is handled by the caller
+            if (passes_complete == prev || passes_complete == n_passes ||
+                m_progressive_snapshot.empty() ||
+                snapshot_timer.value() < m_progressive_interval * 1000.f)
+                return;
+
+            ref<Bitmap> bitmap = film->bitmap();
+            bitmap->write_async(m_progressive_snapshot, Bitmap::FileFormat::OpenEXR);
+            snapshot_timer.reset();
+
+            Log(Info, "Progressive rendering: writing snapshot \"%s\" "
+                "(%u/%u passes, %u spp, after %s)",
+                m_progressive_snapshot.filename().string(), passes_complete,
+                n_passes, spp_done,
+                util::time_string((float) m_render_timer.value(), true));
+        };
+
         ThreadEnvironment env;
         dr::parallel_for(
             dr::blocked_range<uint32_t>(0, total_blocks, grain_size),
@@ -226,21 +328,36 @@ SamplingIntegrator<Float, Spectrum>::render(Scene *scene,
                     block->set_size(size);
                     block->set_offset(offset);
 
+                    uint32_t pass = n_passes - 1 - block_id / spiral.block_count();
+
                     render_block(scene, sensor, sampler, block, aovs.get(),
-                                 spp_per_pass, seed, block_id, block_size);
+                                 pass_spp[pass], seed, block_id, block_size);
 
                     film->put_block(block);
 
-                    /* Critical section: update progress bar */
+                    if (m_progressive && !should_stop() &&
+                        pass_blocks_done[pass].fetch_add(1) + 1 == spiral.block_count())
+                        pass_finished();
+
+                    /* Update the progress bar. Workers that find it busy
+                       simply skip the refresh instead of waiting for it. */
+                    uint32_t done = blocks_done.fetch_add(1, std::memory_order_relaxed) + 1;
                     if (progress) {
-                        std::lock_guard<std::mutex> lock(mutex);
-                        blocks_done++;
-                        progress->update(blocks_done / (float) total_blocks);
+                        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+                        if (lock.owns_lock())
+                            progress->update(done / (float) total_blocks);
                     }
                 }
             }
         );
 
+        if (progress && !m_stop)
+            progress->update(blocks_done.load() / (float) total_blocks);
+
+        if (adaptive())
+            Log(Info, "Adaptive sampling: %.2f samples per pixel on average.",
+                m_sample_counter.load() / (double) dr::prod(film_size));
+
         if (develop)
             result = film->develop();
     } else {
@@ -388,6 +505,12 @@ MI_VARIANT void SamplingIntegrator<Float, Spectrum>::render_block(const Scene *s
         // Clear block (it's being reused)
         block->clear();
 
+        if (adaptive()) {
+            render_block_adaptive(scene, sensor, sampler, block, aovs,
+                                  sample_count, seed, block_size);
+            return;
+        }
+
         for (uint32_t i = 0; i < pixel_count && !should_stop(); ++i) {
             sampler->seed(seed + i);
 
@@ -417,6 +540,99 @@ MI_VARIANT void SamplingIntegrator<Float, Spectrum>::render_block(const Scene *s
 }
 
 MI_VARIANT void
+SamplingIntegrator<Float, Spectrum>::render_block_adaptive(const Scene *scene,
+                                                            const Sensor *sensor,
+                                                            Sampler *sampler,
+                                                            ImageBlock *block,
+                                                            Float *aovs,
+                                                            uint32_t sample_count,
+                                                            uint32_t seed,
+                                                            uint32_t block_size) const {
+    if constexpr (!dr::is_array_v<Float>) {
+        uint32_t pixel_count = block_size * block_size,
+                 channel_count = block->channel_count(),
+                 min_spp = std::min(m_adaptive_min_spp, sample_count);
+
+        Float diff_scale_factor = dr::rsqrt((Float) sample_count);
+
+        /* When the sample count is recorded in an AOV, samples are only
+           splatted once the final count of their pixel is known */
+        std::vector<Float> values;
+        std::vector<Vector2f> positions;
+        if (m_adaptive_aov) {
+            values.resize((size_t) sample_count * channel_count);
+            positions.resize(sample_count);
+        }
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < pixel_count && !should_stop(); ++i) {
+            sampler->seed(seed + i);
+
+            Point2u pos = dr::morton_decode<Point2u>(i);
+            if (dr::any(pos >= block->size()))
+                continue;
+
+            Point2f pos_f = Point2f(Point2i(pos) + block->offset());
+
+            // Running mean and variance of the luminance (Welford's algorithm)
+            double mean = 0.0, m2 = 0.0;
+            uint32_t n = 0, target = min_spp;
+
+            while (n < sample_count && !should_stop()) {
+                for (; n < target && !should_stop(); ++n) {
+                    Vector2f splat_pos =
+                        render_sample(scene, sensor, sampler, block, aovs, pos_f,
+                                      diff_scale_factor, true, !m_adaptive_aov);
+                    sampler->advance();
+
+                    if (m_adaptive_aov) {
+                        std::copy(aovs, aovs + channel_count,
+                                  values.begin() + (size_t) n * channel_count);
+                        positions[n] = splat_pos;
+                    }
+
+                    double lum = luminance(Color3f(aovs[0], aovs[1], aovs[2])),
+                           delta = lum - mean;
+                    mean += delta / (n + 1);
+                    m2 += delta * (lum - mean);
+                }
+
+                double variance = m2 / std::max(n - 1, 1u),
+                       rel_error = std::sqrt(variance / n) /
+                                   std::max(std::abs(mean), 1e-4);
+
+                if (rel_error <= m_adaptive_threshold)
+                    break;
+
+                target = std::min(n + m_adaptive_step, sample_count);
+            }
+
+            if (m_adaptive_aov) {
+                for (uint32_t j = 0; j < n; ++j) {
+                    Float *v = values.data() + (size_t) j * channel_count;
+                    v[channel_count - 1] = (Float) n;
+                    block->put(positions[j], v);
+                }
+            }
+
+            total += n;
+        }
+
+        m_sample_counter.fetch_add(total, std::memory_order_relaxed);
+    } else {
+        DRJIT_MARK_USED(scene);
+        DRJIT_MARK_USED(sensor);
+        DRJIT_MARK_USED(sampler);
+        DRJIT_MARK_USED(block);
+        DRJIT_MARK_USED(aovs);
+        DRJIT_MARK_USED(sample_count);
+        DRJIT_MARK_USED(seed);
+        DRJIT_MARK_USED(block_size);
+        Throw("Not implemented for JIT arrays.");
+    }
+}
+
+MI_VARIANT typename SamplingIntegrator<Float, Spectrum>::Vector2f
 SamplingIntegrator<Float, Spectrum>::render_sample(const Scene *scene,
                                                    const Sensor *sensor,
                                                    Sampler *sampler,
@@ -424,7 +640,8 @@ SamplingIntegrator<Float, Spectrum>::render_sample(const Scene *scene,
                                                    Float *aovs,
                                                    const Vector2f &pos,
                                                    ScalarFloat diff_scale_factor,
-                                                   Mask active) const {
+                                                   Mask active,
+                                                   bool splat) const {
     const Film *film = sensor->film();
     const bool has_alpha = has_flag(film->flags(), FilmFlags::Alpha);
     const bool box_filter = film->rfilter()->is_box_filter();
@@ -487,7 +704,11 @@ SamplingIntegrator<Float, Spectrum>::render_sample(const Scene *scene,
     }
 
     // With box filter, ignore random offset to prevent numerical instabilities
-    block->put(box_filter ? pos : sample_pos, aovs, active);
+    Vector2f splat_pos = box_filter ? pos : sample_pos;
+    if (splat)
+        block->put(splat_pos, aovs, active);
+
+    return splat_pos;
 }
 
 MI_VARIANT std::pair<Spectrum, typename SamplingIntegrator<Float, Spectrum>::Mask>
@@ -658,7 +879,7 @@ AdjointIntegrator<Float, Spectrum>::render(Scene *scene,
                         progress->update(samples_done / (ScalarFloat) total_samples);
                     }
                 }
-                total_samples += ctr;
+                samples_done += ctr;
 
                 // When all samples are done for this range, commit to the film
                 /* locked */ {
@@ -669,6 +890,9 @@ AdjointIntegrator<Float, Spectrum>::render(Scene *scene,
             }
         );
 
+        if (progress && !m_stop)
+            progress->update(samples_done / (ScalarFloat) total_samples);
+
         if (develop)
             result = film->develop();
     } else {
@@ -1,6 +1,9 @@
 #include <mitsuba/render/kdtree.h>
 #include <mitsuba/render/mesh.h>
 #include <mitsuba/core/properties.h>
+#include <mitsuba/core/filesystem.h>
+#include <mitsuba/core/mmap.h>
+#include <cstring>
 
 NAMESPACE_BEGIN(mitsuba)
 
@@ -8,6 +11,52 @@ template <typename B, typename I, typename C, typename D>
 thread_local typename TShapeKDTree<B, I, C, D>::LocalBuildContext
     TShapeKDTree<B, I, C, D>::BuildTask::m_local = {};
 
+/// Version of the kd-tree cache file format (bump when KDNode changes)
+static constexpr uint32_t kdtree_cache_version = 1;
+
+/// Header of a kd-tree cache file, followed by the node and index arrays
+struct KDTreeCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t node_size;
+    uint64_t key;
+    uint64_t node_count;
+    uint64_t index_count;
+    uint64_t node_offset;
+    uint64_t index_offset;
+    double bbox_min[3];
+    double bbox_max[3];
+};
+
+static const char kdtree_cache_magic[8] = "MI_KDTC";
+
+/// Incrementally hash a memory region (used to compute kd-tree cache keys)
+static uint64_t kdtree_cache_hash(uint64_t hash, const void *ptr, size_t size) {
+    auto mix = [&hash](uint64_t value) {
+        hash ^= value * 0x9E3779B97F4A7C15ull;
+        hash = ((hash << 31) | (hash >> 33)) * 0xBF58476D1CE4E5B9ull;
+    };
+
+    const uint8_t *data = (const uint8_t *) ptr;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t value;
+        memcpy(&value, data + i, sizeof(uint64_t));
+        mix(value);
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+    mix(tail);
+    mix((uint64_t) size);
+
+    return hash;
+}
+
+template <typename T> static uint64_t kdtree_cache_hash(uint64_t hash, const T &value) {
+    return kdtree_cache_hash(hash, &value, sizeof(T));
+}
+
 MI_VARIANT ShapeKDTree<Float, Spectrum>::ShapeKDTree(const Properties &props)
     : Base(SurfaceAreaHeuristic3f(
           /* kd-tree construction: Relative cost of a shape intersection
@@ -20,6 +69,18 @@ MI_VARIANT ShapeKDTree<Float, Spectrum>::ShapeKDTree(const Properties &props)
              empty space */
           props.get<ScalarFloat>("kd_empty_space_bonus", .9f))) {
 
+    /* kd-tree construction: Quality profile. The lower ones only use min-max
+       binning, and "low" additionally skips primitive clipping and builds a
+       shallower tree (see build()). */
+    m_accel_quality = parse_accel_quality(props.string("accel_quality", "high"));
+    if (m_accel_quality == AccelQuality::Medium) {
+        set_exact_primitive_threshold(4096);
+    } else if (m_accel_quality == AccelQuality::Low) {
+        set_exact_primitive_threshold(0);
+        set_min_max_bins(32);
+        set_clip_primitives(false);
+    }
+
     /* kd-tree construction: A kd-tree node containing this many or fewer
        primitives will not be split */
     if (props.has_property("kd_stop_prims"))
@@ -48,32 +109,362 @@ MI_VARIANT ShapeKDTree<Float, Spectrum>::ShapeKDTree(const Properties &props)
     if (props.has_property("kd_exact_primitive_threshold"))
         set_exact_primitive_threshold(props.get<int>("kd_exact_primitive_threshold"));
 
+    /* kd-tree construction: Directory used to cache built kd-trees across
+       runs. Caching is disabled unless this parameter is specified. */
+    if (props.has_property("kd_cache_dir"))
+        m_cache_dir = fs::absolute(props.string("kd_cache_dir"));
+
+    /* kd-tree traversal: Store the leaf primitives in blocks of four
+       precomputed triangles that are intersected using SIMD arithmetic.
+       Speeds up scalar ray tracing at the cost of additional memory. */
+    m_triangle_records = props.get<bool>("kd_triangle_records", false);
+
     m_primitive_map.push_back(0);
 }
 
+MI_VARIANT ShapeKDTree<Float, Spectrum>::~ShapeKDTree() {
+    // Storage that lives in the memory-mapped cache file must not be deleted
+    if (m_cache_file) {
+        m_nodes.release();
+        m_indices.release();
+    }
+}
+
 MI_VARIANT void ShapeKDTree<Float, Spectrum>::clear() {
     m_shapes.clear();
     m_primitive_map.clear();
     m_primitive_map.push_back(0);
     m_bbox.reset();
-    m_nodes.release();
-    m_indices.release();
+    if (m_cache_file) {
+        m_nodes.release();
+        m_indices.release();
+        m_cache_file = nullptr;
+    } else {
+        m_nodes.reset();
+        m_indices.reset();
+    }
     m_node_count = 0;
     m_index_count = 0;
+    m_sah_cost = 0;
+    m_records.reset();
+    m_record_offset.clear();
+    m_record_count = 0;
 }
 
 MI_VARIANT void ShapeKDTree<Float, Spectrum>::build() {
     Timer timer;
+    uint64_t key = 0;
+    fs::path cache_path;
+
+    // The native kd-tree is not used on the GPU, whose buffers aren't host-accessible
+    if constexpr (!dr::is_cuda_v<Float>) {
+        if (!m_cache_dir.empty()) {
+            key = cache_key();
+            cache_path = m_cache_dir / fs::path(tfm::format("kdtree_%016llx.bin",
+                                                            (unsigned long long) key));
+            if (cache_load(cache_path, key)) {
+                Log(Info, "Loaded a SAH kd-tree (%i primitives) from \"%s\" "
+                    "(%s of storage, took %s)", primitive_count(),
+                    cache_path.filename().string(),
+                    util::mem_string(m_index_count * sizeof(Index) +
+                                     m_node_count * sizeof(KDNode)),
+                    util::time_string((float) timer.value()));
+                if (m_triangle_records)
+                    build_triangle_records();
+                return;
+            }
+        }
+    }
+
     Log(Info, "Building a SAH kd-tree (%i primitives) ..",
         primitive_count());
 
-    Base::build();
+    /* The depth limit of this build. TShapeKDTree::build() replaces 0 by its
+       default of 8 + 1.3 * log2(N), and the "low" profile uses a shallower
+       default. The user-specified value is restored afterwards, so that
+       rebuilds choose the limit for their own primitive count. */
+    Size max_depth = m_max_depth;
+    if (m_accel_quality == AccelQuality::Low && max_depth == 0)
+        m_max_depth = (Size) (4 + dr::log2i(std::max(primitive_count(), 1u)));
+    try {
+        Base::build();
+    } catch (...) {
+        m_max_depth = max_depth;
+        throw;
+    }
+    m_max_depth = max_depth;
 
-    Log(Info, "Finished. (%s of storage, took %s)",
+    Log(Info, "Finished. (%s of storage, SAH cost %.2f, took %s)",
         util::mem_string(m_index_count * sizeof(Index) +
                         m_node_count * sizeof(KDNode)),
-        util::time_string((float) timer.value())
+        m_sah_cost, util::time_string((float) timer.value())
     );
+
+    if (!cache_path.empty())
+        cache_write(cache_path, key);
+
+    if (m_triangle_records)
+        build_triangle_records();
+}
+
+MI_VARIANT void ShapeKDTree<Float, Spectrum>::build_triangle_records() {
+    // The native kd-tree is not used on the GPU, whose buffers aren't host-accessible
+    if constexpr (!dr::is_cuda_v<Float>) {
+        using FloatStorage  = typename Mesh::FloatStorage;
+        using UInt32Storage = DynamicBuffer<UInt32>;
+
+        Timer timer;
+
+        // Host-accessible copies of the mesh buffers
+        std::vector<FloatStorage> positions(m_shapes.size());
+        std::vector<UInt32Storage> faces(m_shapes.size());
+        for (size_t i = 0; i < m_shapes.size(); ++i) {
+            if (!m_shapes[i]->is_mesh())
+                continue;
+            const Mesh *mesh = (const Mesh *) m_shapes[i].get();
+            positions[i] = mesh->vertex_positions_buffer();
+            faces[i] = mesh->faces_buffer();
+            if constexpr (dr::is_jit_v<Float>)
+                dr::eval(positions[i], faces[i]);
+        }
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+
+        // Assign the records of each leaf node
+        m_record_offset.assign(m_node_count, 0);
+        Size record_count = 0;
+        for (Size i = 0; i < m_node_count; ++i) {
+            const KDNode &node = m_nodes[i];
+            if (!node.leaf())
+                continue;
+            m_record_offset[i] = record_count;
+            record_count += (node.primitive_count() + 3) / 4;
+        }
+
+        m_record_count = record_count;
+        m_records.reset(new TriangleRecord[record_count]());
+
+        dr::parallel_for(
+            dr::blocked_range<Size>(0u, m_node_count, MI_KD_GRAIN_SIZE),
+            [&](const dr::blocked_range<Size> &range) {
+                for (Size i = range.begin(); i != range.end(); ++i) {
+                    const KDNode &node = m_nodes[i];
+                    if (!node.leaf())
+                        continue;
+
+                    TriangleRecord *records = m_records.get() + m_record_offset[i];
+                    Size prim_count = node.primitive_count(),
+                         lane_count = (prim_count + 3) / 4 * 4;
+
+                    for (Size j = 0; j < lane_count; ++j) {
+                        TriangleRecord &record = records[j / 4];
+                        Size lane = j % 4;
+
+                        if (j >= prim_count) {
+                            record.shape_index[lane] = RecordEmpty;
+                            record.prim_index[lane] = RecordEmpty;
+                            continue;
+                        }
+
+                        Index global_index = m_indices[node.primitive_offset() + j],
+                              prim_index   = global_index,
+                              shape_index  = find_shape(prim_index);
+
+                        if (!m_shapes[shape_index]->is_mesh()) {
+                            record.shape_index[lane] = RecordGeneric;
+                            record.prim_index[lane] = global_index;
+                            continue;
+                        }
+
+                        const uint32_t *fi = faces[shape_index].data() + 3 * prim_index;
+                        const auto *p = positions[shape_index].data();
+
+                        for (size_t k = 0; k < 3; ++k) {
+                            ScalarFloat p0 = (ScalarFloat) p[3 * fi[0] + k],
+                                        p1 = (ScalarFloat) p[3 * fi[1] + k],
+                                        p2 = (ScalarFloat) p[3 * fi[2] + k];
+                            record.p0[k][lane] = p0;
+                            record.e1[k][lane] = p1 - p0;
+                            record.e2[k][lane] = p2 - p0;
+                        }
+
+                        record.shape_index[lane] = shape_index;
+                        record.prim_index[lane] = prim_index;
+                    }
+                }
+            }
+        );
+
+        size_t record_bytes = (size_t) m_record_count * sizeof(TriangleRecord) +
+                              m_record_offset.size() * sizeof(Index),
+               index_bytes  = (size_t) m_index_count * sizeof(Index);
+
+        Log(Info, "Built %u triangle records (%s, %.1f bytes per primitive "
+            "vs. %.1f bytes of leaf indices, %.0f%% of the lanes in use, took %s)",
+            m_record_count, util::mem_string(record_bytes),
+            (double) record_bytes / std::max(m_index_count, 1u),
+            (double) index_bytes / std::max(m_index_count, 1u),
+            100.0 * m_index_count / std::max(4u * m_record_count, 1u),
+            util::time_string((float) timer.value()));
+    }
+}
+
+MI_VARIANT uint64_t ShapeKDTree<Float, Spectrum>::cache_key() const {
+    uint64_t key = kdtree_cache_version;
+
+    // Builder parameters (the depth limit is only chosen automatically if 0)
+    key = kdtree_cache_hash(key, m_cost_model.query_cost());
+    key = kdtree_cache_hash(key, m_cost_model.traversal_cost());
+    key = kdtree_cache_hash(key, m_cost_model.empty_space_bonus());
+    key = kdtree_cache_hash(key, m_clip_primitives);
+    key = kdtree_cache_hash(key, m_retract_bad_splits);
+    key = kdtree_cache_hash(key, m_max_depth);
+    key = kdtree_cache_hash(key, m_accel_quality);
+    key = kdtree_cache_hash(key, m_stop_primitives);
+    key = kdtree_cache_hash(key, m_max_bad_refines);
+    key = kdtree_cache_hash(key, m_exact_prim_threshold);
+    key = kdtree_cache_hash(key, m_min_max_bins);
+    key = kdtree_cache_hash(key, sizeof(ScalarFloat));
+    key = kdtree_cache_hash(key, m_bbox);
+
+    auto hash_buffer = [&](const auto &buf) {
+        using Buffer = std::decay_t<decltype(buf)>;
+        using Value = dr::scalar_t<Buffer>;
+        if constexpr (dr::is_jit_v<Buffer>) {
+            Buffer tmp = buf;
+            dr::eval(tmp);
+            dr::sync_thread();
+            key = kdtree_cache_hash(key, tmp.data(), dr::width(tmp) * sizeof(Value));
+        } else {
+            key = kdtree_cache_hash(key, buf.data(), dr::width(buf) * sizeof(Value));
+        }
+    };
+
+    for (const Shape *shape : m_shapes) {
+        std::string class_name = shape->class_()->name();
+        key = kdtree_cache_hash(key, class_name.data(), class_name.size());
+        key = kdtree_cache_hash(key, shape->primitive_count());
+
+        if (shape->is_mesh()) {
+            const Mesh *mesh = (const Mesh *) shape;
+            hash_buffer(mesh->vertex_positions_buffer());
+            hash_buffer(mesh->faces_buffer());
+        } else {
+            /* Other shapes are characterized by their parameters
+               (included in the string representation) and primitive bounds */
+            std::string desc = shape->to_string();
+            key = kdtree_cache_hash(key, desc.data(), desc.size());
+            for (uint32_t i = 0; i < shape->primitive_count(); ++i)
+                key = kdtree_cache_hash(key, shape->bbox(i));
+        }
+    }
+
+    return key;
+}
+
+MI_VARIANT bool ShapeKDTree<Float, Spectrum>::cache_load(const fs::path &filename,
+                                                         uint64_t key) {
+    if (!fs::exists(filename))
+        return false;
+
+    ref<MemoryMappedFile> mmap;
+    try {
+        mmap = new MemoryMappedFile(filename);
+    } catch (const std::exception &e) {
+        Log(Warn, "Could not open kd-tree cache file \"%s\": %s",
+            filename.string(), e.what());
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t *) mmap->data();
+    size_t size = mmap->size();
+
+    KDTreeCacheHeader header;
+    if (size < sizeof(KDTreeCacheHeader))
+        return false;
+    memcpy(&header, data, sizeof(KDTreeCacheHeader));
+
+    uint64_t node_bytes  = header.node_count * sizeof(KDNode),
+             index_bytes = header.index_count * sizeof(Index);
+
+    bool valid =
+        memcmp(header.magic, kdtree_cache_magic, sizeof(header.magic)) == 0 &&
+        header.version == kdtree_cache_version &&
+        header.node_size == sizeof(KDNode) && header.key == key &&
+        header.node_count > 0 && header.node_count <= 0xFFFFFFFFull &&
+        header.index_count <= 0xFFFFFFFFull &&
+        header.node_offset % alignof(KDNode) == 0 &&
+        header.index_offset % alignof(Index) == 0 &&
+        header.node_offset + node_bytes <= size &&
+        header.index_offset + index_bytes <= size;
+
+    if (!valid) {
+        Log(Warn, "Ignoring invalid or outdated kd-tree cache file \"%s\"",
+            filename.string());
+        return false;
+    }
+
+    for (size_t i = 0; i < 3; ++i) {
+        m_bbox.min[i] = (ScalarFloat) header.bbox_min[i];
+        m_bbox.max[i] = (ScalarFloat) header.bbox_max[i];
+    }
+
+    m_nodes.reset((KDNode *) (data + header.node_offset));
+    m_indices.reset((Index *) (data + header.index_offset));
+    m_node_count  = (Size) header.node_count;
+    m_index_count = (Size) header.index_count;
+    m_cache_file  = mmap;
+
+    return true;
+}
+
+MI_VARIANT void ShapeKDTree<Float, Spectrum>::cache_write(const fs::path &filename,
+                                                          uint64_t key) const {
+    KDTreeCacheHeader header;
+    memset(&header, 0, sizeof(KDTreeCacheHeader));
+    memcpy(header.magic, kdtree_cache_magic, sizeof(header.magic));
+    header.version      = kdtree_cache_version;
+    header.node_size    = sizeof(KDNode);
+    header.key          = key;
+    header.node_count   = m_node_count;
+    header.index_count  = m_index_count;
+    header.node_offset  = (sizeof(KDTreeCacheHeader) + 63) / 64 * 64;
+    header.index_offset = (header.node_offset + m_node_count * sizeof(KDNode) + 63) / 64 * 64;
+
+    for (size_t i = 0; i < 3; ++i) {
+        header.bbox_min[i] = (double) m_bbox.min[i];
+        header.bbox_max[i] = (double) m_bbox.max[i];
+    }
+
+    // Write to a temporary file first, so that concurrent readers never see a partial tree
+    fs::path tmp_path = filename.string() +
+                        tfm::format(".%llx.tmp", (unsigned long long) (uintptr_t) this);
+
+    try {
+        if (!fs::exists(m_cache_dir) && !fs::create_directory(m_cache_dir))
+            Throw("could not create directory \"%s\"", m_cache_dir.string());
+
+        {
+            ref<MemoryMappedFile> mmap = new MemoryMappedFile(
+                tmp_path, header.index_offset + m_index_count * sizeof(Index));
+            uint8_t *data = (uint8_t *) mmap->data();
+            memcpy(data, &header, sizeof(KDTreeCacheHeader));
+            memcpy(data + header.node_offset, m_nodes.get(),
+                   m_node_count * sizeof(KDNode));
+            memcpy(data + header.index_offset, m_indices.get(),
+                   m_index_count * sizeof(Index));
+        }
+
+        if (!fs::rename(tmp_path, filename)) {
+            fs::remove(tmp_path);
+            Throw("could not rename \"%s\"", tmp_path.string());
+        }
+
+        Log(Debug, "Wrote kd-tree cache file \"%s\"", filename.string());
+    } catch (const std::exception &e) {
+        Log(Warn, "Could not write kd-tree cache file \"%s\": %s",
+            filename.string(), e.what());
+    }
 }
 
 MI_VARIANT void ShapeKDTree<Float, Spectrum>::add_shape(Shape *shape) {
@@ -0,0 +1,646 @@
+#include <mitsuba/render/lighttree.h>
+#include <mitsuba/render/emitter.h>
+#include <mitsuba/render/mesh.h>
+#include <mitsuba/core/logger.h>
+#include <mitsuba/core/timer.h>
+#include <mitsuba/core/util.h>
+#include <algorithm>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/// Marks the leaf nodes in \c LightTree::m_node_child
+static constexpr uint32_t light_tree_leaf = 0x80000000u;
+
+/// Marks emitters that are not part of the tree in \c LightTree::m_emitter_leaf
+static constexpr uint32_t light_tree_invalid = 0xFFFFFFFFu;
+
+/// Number of buckets evaluated by the surface area orientation heuristic
+static constexpr uint32_t light_tree_buckets = 12;
+
+/// Number of samples used to estimate the power and normals of an emitter
+static constexpr uint32_t light_tree_samples = 64;
+
+/// Compute cos(max(0, a - b)) given the sines and cosines of two angles
+template <typename Value>
+static Value cos_sub_clamped(const Value &sin_a, const Value &cos_a,
+                             const Value &sin_b, const Value &cos_b) {
+    return dr::select(cos_a > cos_b, Value(1.f),
+                      dr::fmadd(cos_a, cos_b, sin_a * sin_b));
+}
+
+/// Compute sin(max(0, a - b)) given the sines and cosines of two angles
+template <typename Value>
+static Value sin_sub_clamped(const Value &sin_a, const Value &cos_a,
+                             const Value &sin_b, const Value &cos_b) {
+    return dr::select(cos_a > cos_b, Value(0.f),
+                      dr::fmsub(sin_a, cos_b, cos_a * sin_b));
+}
+
+MI_VARIANT LightTree<Float, Spectrum>::LightTree(const std::vector<ref<Emitter>> &emitters) {
+    Timer timer;
+
+    std::vector<uint32_t> finite, infinite;
+    for (uint32_t i = 0; i < (uint32_t) emitters.size(); ++i) {
+        if (has_flag(emitters[i]->flags(), EmitterFlags::Infinite))
+            infinite.push_back(i);
+        else
+            finite.push_back(i);
+    }
+
+    // Emitters with a sampling weight of zero are never chosen
+    std::vector<LightBounds> finite_bounds = estimate_bounds(emitters, finite);
+    std::vector<std::pair<uint32_t, LightBounds>> lights;
+    for (size_t i = 0; i < finite.size(); ++i) {
+        if (finite_bounds[i].power > 0.f)
+            lights.emplace_back(finite[i], finite_bounds[i]);
+    }
+    m_emitter_count = lights.size();
+
+    // Infinite emitters are chosen with a fixed probability
+    std::vector<ScalarFloat> infinite_weight, infinite_pmf(emitters.size(), 0.f);
+    ScalarFloat infinite_weight_sum = 0.f;
+    for (uint32_t i : infinite) {
+        infinite_weight.push_back(emitters[i]->sampling_weight());
+        infinite_weight_sum += infinite_weight.back();
+    }
+
+    m_infinite_prob = 0.f;
+    if (infinite_weight_sum > 0.f) {
+        m_infinite_prob = (ScalarFloat) infinite.size() /
+                          (ScalarFloat) (infinite.size() + (lights.empty() ? 0 : 1));
+        for (size_t i = 0; i < infinite.size(); ++i)
+            infinite_pmf[infinite[i]] =
+                m_infinite_prob * infinite_weight[i] / infinite_weight_sum;
+        m_infinite_distr = DiscreteDistribution<Float>(infinite_weight.data(),
+                                                       infinite_weight.size());
+    }
+
+    m_infinite_pmf = dr::load<FloatStorage>(infinite_pmf.data(), infinite_pmf.size());
+    m_infinite_index = dr::load<UInt32Storage>(infinite.data(), infinite.size());
+
+    // Build the tree over all other emitters
+    std::vector<LightBounds> bounds;
+    std::vector<uint32_t> child, parent;
+    m_depth = 0;
+    if (!lights.empty()) {
+        bounds.resize(1);
+        child.resize(1);
+        parent.resize(1, 0);
+        build(lights, 0, (uint32_t) lights.size(), 0, 1, bounds, child, parent);
+    }
+    m_node_count = bounds.size();
+
+    std::unique_ptr<ScalarFloat[]> nodes(new ScalarFloat[m_node_count * 12]);
+    std::vector<uint32_t> emitter_leaf(emitters.size(), light_tree_invalid);
+    for (size_t i = 0; i < m_node_count; ++i) {
+        const LightBounds &b = bounds[i];
+        ScalarFloat *ptr = nodes.get() + 12 * i;
+        for (uint32_t k = 0; k < 3; ++k) {
+            ptr[k]     = b.bbox.min[k];
+            ptr[4 + k] = b.bbox.max[k];
+            ptr[8 + k] = b.axis[k];
+        }
+        ptr[3]  = b.power;
+        ptr[7]  = b.cos_theta_o;
+        ptr[11] = b.cos_theta_e;
+
+        if (child[i] & light_tree_leaf)
+            emitter_leaf[child[i] & ~light_tree_leaf] = (uint32_t) i;
+    }
+
+    m_nodes        = dr::load<FloatStorage>(nodes.get(), m_node_count * 12);
+    m_node_child   = dr::load<UInt32Storage>(child.data(), m_node_count);
+    m_node_parent  = dr::load<UInt32Storage>(parent.data(), m_node_count);
+    m_emitter_leaf = dr::load<UInt32Storage>(emitter_leaf.data(), emitters.size());
+
+    Log(Debug, "Light tree built over %zu emitters (%zu nodes, depth %u, took %s)",
+        m_emitter_count, m_node_count, m_depth,
+        util::time_string((float) timer.value()));
+}
+
+MI_VARIANT std::vector<typename LightTree<Float, Spectrum>::LightBounds>
+LightTree<Float, Spectrum>::estimate_bounds(const std::vector<ref<Emitter>> &emitters,
+                                            const std::vector<uint32_t> &finite) const {
+    const uint32_t S = light_tree_samples;
+    size_t count = finite.size();
+    std::vector<LightBounds> result(count);
+    if (count == 0)
+        return result;
+
+    /* Estimate the emitted power and sample surface normals with a fixed set
+       of stratified samples. Since sample_ray() returns the emitted power
+       divided by the sampling density, its mean is an estimate of the power. */
+    auto sample = [](const EmitterPtr &emitter, const UInt32 &j) {
+        Point2f u2((Float(j % 8u) + .5f) / 8.f, (Float(j / 8u) + .5f) / 8.f),
+                u3(u2.y(), 1.f - u2.x());
+        Float u1 = (Float(j) + .5f) / (ScalarFloat) light_tree_samples;
+
+        auto [ray, weight] = emitter->sample_ray(0.f, u1, u2, u3);
+        auto [ps, ps_weight] = emitter->sample_position(0.f, u2);
+        DRJIT_MARK_USED(ray);
+        DRJIT_MARK_USED(ps_weight);
+
+        UnpolarizedSpectrum w = unpolarized_spectrum(weight);
+        Float power = 0.f;
+        for (size_t c = 0; c < dr::size_v<UnpolarizedSpectrum>; ++c)
+            power += w[c];
+        power /= (ScalarFloat) dr::size_v<UnpolarizedSpectrum>;
+        power = dr::select(dr::isfinite(power), power, 0.f);
+
+        return std::make_pair(dr::detach(power), dr::detach(Vector3f(ps.n)));
+    };
+
+    std::vector<ScalarFloat> power(count * S);
+    std::vector<ScalarVector3f> normal(count * S);
+
+    if constexpr (dr::is_jit_v<Float>) {
+        std::vector<const Emitter *> ptrs(count);
+        for (size_t i = 0; i < count; ++i)
+            ptrs[i] = emitters[finite[i]].get();
+        DynamicBuffer<EmitterPtr> ptrs_dr =
+            dr::load<DynamicBuffer<EmitterPtr>>(ptrs.data(), count);
+
+        UInt32 idx = dr::arange<UInt32>((uint32_t) (count * S));
+        EmitterPtr emitter = dr::gather<EmitterPtr>(ptrs_dr, idx / S);
+        auto [power_dr, normal_dr] = sample(emitter, idx % S);
+
+        auto &&power_h = dr::migrate(power_dr, AllocType::Host);
+        auto &&nx = dr::migrate(normal_dr.x(), AllocType::Host),
+             &&ny = dr::migrate(normal_dr.y(), AllocType::Host),
+             &&nz = dr::migrate(normal_dr.z(), AllocType::Host);
+        dr::sync_thread();
+
+        for (size_t i = 0; i < count * S; ++i) {
+            power[i] = power_h.data()[i];
+            normal[i] = ScalarVector3f(nx.data()[i], ny.data()[i], nz.data()[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            for (uint32_t j = 0; j < S; ++j) {
+                auto [p, n] = sample(emitters[finite[i]].get(), j);
+                power[i * S + j] = p;
+                normal[i * S + j] = n;
+            }
+        }
+    }
+
+    ScalarFloat max_power = 0.f;
+    for (size_t i = 0; i < count; ++i) {
+        const Emitter *emitter = emitters[finite[i]].get();
+        LightBounds &b = result[i];
+        b.bbox = emitter->bbox();
+
+        double power_sum = 0.0;
+        ScalarVector3f normal_sum(0.f);
+        for (uint32_t j = 0; j < S; ++j) {
+            power_sum += power[i * S + j];
+            normal_sum += normal[i * S + j];
+        }
+        b.power = ScalarFloat(power_sum / S);
+        max_power = dr::maximum(max_power, b.power);
+
+        // Emission is bounded by a cosine lobe around the normals
+        b.cos_theta_e = 0.f;
+        b.cos_theta_o = -1.f;
+
+        const Shape *shape = emitter->shape();
+        if (!has_flag(emitter->flags(), EmitterFlags::Surface) || !shape ||
+            dr::squared_norm(normal_sum) == 0.f)
+            continue; // Emits into the full sphere of directions
+
+        b.axis = dr::normalize(normal_sum);
+
+        if (shape->is_mesh()) {
+            // Bound all normals of the mesh, the samples only provide the orientation
+            auto [axis, cos_theta] = mesh_normal_cone((const Mesh *) shape);
+            if (cos_theta >= 0.f) {
+                b.axis = dr::dot(axis, b.axis) < 0.f ? -axis : axis;
+                b.cos_theta_o = cos_theta;
+            }
+        } else {
+            /* The normals of other shapes are bounded conservatively: planar
+               shapes get a degenerate cone, everything else the full sphere */
+            ScalarFloat cos_theta = 1.f;
+            for (uint32_t j = 0; j < S; ++j)
+                cos_theta = dr::minimum(cos_theta, dr::dot(b.axis, normal[i * S + j]));
+            if (cos_theta > 1.f - 1e-4f)
+                b.cos_theta_o = cos_theta;
+        }
+    }
+
+    /* An emitter whose power estimate is zero (e.g. due to a sparse emission
+       texture) must remain selectable, otherwise sampling would be biased */
+    for (size_t i = 0; i < count; ++i) {
+        LightBounds &b = result[i];
+        b.power = dr::maximum(b.power, max_power > 0.f ? 1e-4f * max_power : 1.f);
+        b.power *= emitters[finite[i]]->sampling_weight();
+    }
+
+    return result;
+}
+
+MI_VARIANT std::pair<typename LightTree<Float, Spectrum>::ScalarVector3f,
+                     typename LightTree<Float, Spectrum>::ScalarFloat>
+LightTree<Float, Spectrum>::mesh_normal_cone(const Mesh *mesh) const {
+    std::vector<ScalarVector3f> normals;
+
+    if (mesh->has_vertex_normals()) {
+        // Shading normals interpolate the vertex normals
+        auto &&vertex_normals = dr::migrate(mesh->vertex_normals_buffer(), AllocType::Host);
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+        const auto *ptr = vertex_normals.data();
+
+        normals.resize(mesh->vertex_count());
+        for (size_t i = 0; i < normals.size(); ++i)
+            normals[i] = ScalarVector3f(ptr[3 * i], ptr[3 * i + 1], ptr[3 * i + 2]);
+    } else {
+        auto &&vertex_positions = dr::migrate(mesh->vertex_positions_buffer(), AllocType::Host);
+        auto &&faces = dr::migrate(mesh->faces_buffer(), AllocType::Host);
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+        const auto *pos_p = vertex_positions.data();
+        const auto *idx_p = faces.data();
+
+        normals.resize(mesh->face_count());
+        for (size_t i = 0; i < normals.size(); ++i) {
+            ScalarPoint3f p[3];
+            for (uint32_t k = 0; k < 3; ++k) {
+                size_t v = idx_p[3 * i + k];
+                p[k] = ScalarPoint3f(pos_p[3 * v], pos_p[3 * v + 1], pos_p[3 * v + 2]);
+            }
+            normals[i] = dr::cross(p[1] - p[0], p[2] - p[0]);
+        }
+    }
+
+    ScalarVector3f sum(0.f);
+    for (ScalarVector3f &n : normals) {
+        ScalarFloat length = dr::norm(n);
+        n = length > 0.f ? n / length : ScalarVector3f(0.f);
+        sum += n;
+    }
+
+    if (dr::squared_norm(sum) == 0.f)
+        return { ScalarVector3f(0.f, 0.f, 1.f), -1.f };
+
+    ScalarVector3f axis = dr::normalize(sum);
+    ScalarFloat cos_theta = 1.f;
+    for (const ScalarVector3f &n : normals) {
+        if (dr::squared_norm(n) > 0.f)
+            cos_theta = dr::minimum(cos_theta, dr::dot(axis, n));
+    }
+
+    /* Interpolated normals only remain within the cone if it is convex,
+       i.e. if its half-angle does not exceed 90 degrees */
+    if (cos_theta < 0.f)
+        cos_theta = -1.f;
+
+    return { axis, cos_theta };
+}
+
+MI_VARIANT typename LightTree<Float, Spectrum>::LightBounds
+LightTree<Float, Spectrum>::LightBounds::merge(const LightBounds &a_, const LightBounds &b_) {
+    if (a_.power == 0.f)
+        return b_;
+    if (b_.power == 0.f)
+        return a_;
+
+    // Let 'a' refer to the wider cone of normals
+    bool swap = a_.cos_theta_o > b_.cos_theta_o;
+    const LightBounds &a = swap ? b_ : a_, &b = swap ? a_ : b_;
+
+    LightBounds result;
+    result.bbox = a.bbox;
+    result.bbox.expand(b.bbox);
+    result.power = a.power + b.power;
+    result.cos_theta_e = dr::minimum(a.cos_theta_e, b.cos_theta_e);
+
+    ScalarFloat theta_a = dr::safe_acos(a.cos_theta_o),
+                theta_b = dr::safe_acos(b.cos_theta_o),
+                theta_d = unit_angle(a.axis, b.axis),
+                pi      = dr::Pi<ScalarFloat>;
+
+    result.axis = a.axis;
+    result.cos_theta_o = -1.f;
+
+    if (dr::minimum(theta_d + theta_b, pi) <= theta_a) {
+        // The cone of 'a' already contains the one of 'b'
+        result.cos_theta_o = a.cos_theta_o;
+    } else {
+        ScalarFloat theta_o = .5f * (theta_a + theta_d + theta_b);
+        ScalarVector3f w_r = dr::cross(a.axis, b.axis);
+
+        if (theta_o < pi && dr::squared_norm(w_r) > 0.f) {
+            // Rotate the axis of 'a' towards 'b' by 'theta_o - theta_a'
+            auto [sin_r, cos_r] = dr::sincos(theta_o - theta_a);
+            w_r = dr::normalize(w_r);
+            result.axis = dr::normalize(
+                dr::fmadd(a.axis, cos_r, dr::cross(w_r, a.axis) * sin_r));
+            result.cos_theta_o = dr::cos(theta_o);
+        }
+    }
+
+    return result;
+}
+
+MI_VARIANT typename LightTree<Float, Spectrum>::ScalarFloat
+LightTree<Float, Spectrum>::LightBounds::cost(const ScalarBoundingBox3f &parent,
+                                              uint32_t axis) const {
+    ScalarFloat theta_o = dr::safe_acos(cos_theta_o),
+                theta_e = dr::safe_acos(cos_theta_e),
+                theta_w = dr::minimum(theta_o + theta_e, dr::Pi<ScalarFloat>),
+                sin_theta_o = dr::safe_sqrt(1.f - dr::square(cos_theta_o));
+
+    // Measure of the directions into which the emitters radiate
+    ScalarFloat m_omega =
+        dr::TwoPi<ScalarFloat> * (1.f - cos_theta_o) +
+        .5f * dr::Pi<ScalarFloat> *
+            (2.f * theta_w * sin_theta_o - dr::cos(theta_o - 2.f * theta_w) -
+             2.f * theta_o * sin_theta_o + cos_theta_o);
+
+    // Penalize thin splits along the long axes of the parent node
+    ScalarVector3f extents = parent.extents();
+    ScalarFloat k_r = dr::max(extents) / extents[axis];
+
+    return power * m_omega * k_r * bbox.surface_area();
+}
+
+MI_VARIANT void
+LightTree<Float, Spectrum>::build(std::vector<std::pair<uint32_t, LightBounds>> &lights,
+                                  uint32_t start, uint32_t end, uint32_t index,
+                                  uint32_t depth, std::vector<LightBounds> &bounds,
+                                  std::vector<uint32_t> &child,
+                                  std::vector<uint32_t> &parent) {
+    m_depth = std::max(m_depth, depth);
+
+    if (end - start == 1) {
+        bounds[index] = lights[start].second;
+        child[index] = lights[start].first | light_tree_leaf;
+        return;
+    }
+
+    LightBounds total;
+    ScalarBoundingBox3f centroids;
+    for (uint32_t i = start; i < end; ++i) {
+        total = LightBounds::merge(total, lights[i].second);
+        centroids.expand(lights[i].second.bbox.center());
+    }
+
+    auto bucket = [&](uint32_t axis, const LightBounds &b) {
+        ScalarFloat rel = (b.bbox.center()[axis] - centroids.min[axis]) /
+                          (centroids.max[axis] - centroids.min[axis]);
+        return std::min((uint32_t) (rel * light_tree_buckets),
+                        light_tree_buckets - 1);
+    };
+
+    // Find the split with the lowest surface area orientation heuristic cost
+    ScalarFloat best_cost = dr::Infinity<ScalarFloat>;
+    uint32_t best_axis = 3, best_bucket = 0;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        if (!(centroids.max[axis] > centroids.min[axis]))
+            continue;
+
+        LightBounds buckets[light_tree_buckets];
+        uint32_t counts[light_tree_buckets] = { };
+        for (uint32_t i = start; i < end; ++i) {
+            uint32_t k = bucket(axis, lights[i].second);
+            buckets[k] = LightBounds::merge(buckets[k], lights[i].second);
+            counts[k]++;
+        }
+
+        for (uint32_t k = 0; k + 1 < light_tree_buckets; ++k) {
+            LightBounds below, above;
+            uint32_t count_below = 0, count_above = 0;
+            for (uint32_t j = 0; j < light_tree_buckets; ++j) {
+                if (j <= k) {
+                    below = LightBounds::merge(below, buckets[j]);
+                    count_below += counts[j];
+                } else {
+                    above = LightBounds::merge(above, buckets[j]);
+                    count_above += counts[j];
+                }
+            }
+
+            if (count_below == 0 || count_above == 0)
+                continue;
+
+            ScalarFloat cost = below.cost(total.bbox, axis) +
+                               above.cost(total.bbox, axis);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_bucket = k;
+            }
+        }
+    }
+
+    uint32_t mid = start;
+    if (best_axis < 3) {
+        auto it = std::partition(
+            lights.begin() + start, lights.begin() + end,
+            [&](const std::pair<uint32_t, LightBounds> &l) {
+                return bucket(best_axis, l.second) <= best_bucket;
+            });
+        mid = (uint32_t) (it - lights.begin());
+    }
+
+    if (mid == start || mid == end) {
+        // Fall back to an equal split along the largest extent of the centroids
+        uint32_t axis = centroids.major_axis();
+        mid = (start + end) / 2;
+        std::nth_element(
+            lights.begin() + start, lights.begin() + mid, lights.begin() + end,
+            [axis](const std::pair<uint32_t, LightBounds> &a,
+                   const std::pair<uint32_t, LightBounds> &b) {
+                return a.second.bbox.center()[axis] < b.second.bbox.center()[axis];
+            });
+    }
+
+    // Children are stored next to each other
+    uint32_t first = (uint32_t) bounds.size();
+    bounds.resize(first + 2);
+    child.resize(first + 2);
+    parent.resize(first + 2, index);
+    child[index] = first;
+
+    build(lights, start, mid, first, depth + 1, bounds, child, parent);
+    build(lights, mid, end, first + 1, depth + 1, bounds, child, parent);
+    bounds[index] = LightBounds::merge(bounds[first], bounds[first + 1]);
+}
+
+MI_VARIANT Float LightTree<Float, Spectrum>::importance(const UInt32 &node,
+                                                        const Point3f &p,
+                                                        const Normal3f &n,
+                                                        Mask active) const {
+    Vector4f v0 = dr::gather<Vector4f>(m_nodes, node * 3u, active),
+             v1 = dr::gather<Vector4f>(m_nodes, node * 3u + 1u, active),
+             v2 = dr::gather<Vector4f>(m_nodes, node * 3u + 2u, active);
+
+    Point3f p_min(v0.x(), v0.y(), v0.z()),
+            p_max(v1.x(), v1.y(), v1.z());
+    Vector3f axis(v2.x(), v2.y(), v2.z());
+    Float power = v0.w(), cos_theta_o = v1.w(), cos_theta_e = v2.w();
+
+    // Direction from the center of the bounds to the reference point
+    Vector3f wi = p - .5f * (p_min + p_max);
+    Float dist2 = dr::squared_norm(wi),
+          radius2 = .25f * dr::squared_norm(p_max - p_min);
+    wi *= dr::select(dist2 > 0.f, dr::rsqrt(dist2), 0.f);
+
+    // Cone of directions subtended by the bounding sphere of the node
+    Mask inside = dr::all((p >= p_min) && (p <= p_max));
+    Float sin2_theta_b = radius2 / dist2;
+    Float cos_theta_b = dr::select(inside || sin2_theta_b >= 1.f, -1.f,
+                                   dr::safe_sqrt(1.f - sin2_theta_b)),
+          sin_theta_b = dr::safe_sqrt(1.f - dr::square(cos_theta_b));
+
+    // Smallest angle between the emission cone and the reference point
+    Float cos_theta_w = dr::dot(axis, wi),
+          sin_theta_w = dr::safe_sqrt(1.f - dr::square(cos_theta_w)),
+          sin_theta_o = dr::safe_sqrt(1.f - dr::square(cos_theta_o));
+
+    Float cos_theta_x = cos_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o),
+          sin_theta_x = sin_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o),
+          cos_theta_p = cos_sub_clamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+
+    // Clamp the distance to the size of the node to avoid singularities
+    Float result = power * cos_theta_p /
+                   dr::maximum(dist2, dr::maximum(radius2, dr::Epsilon<Float>));
+    active &= cos_theta_p > cos_theta_e;
+
+    // Account for the foreshortening at the reference point (if it has a normal)
+    Float cos_theta_i = dr::abs(dr::dot(wi, n)),
+          sin_theta_i = dr::safe_sqrt(1.f - dr::square(cos_theta_i));
+    Mask has_normal = dr::squared_norm(n) > 0.f;
+    dr::masked(result, has_normal) *=
+        cos_sub_clamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+
+    return dr::select(active, dr::maximum(result, 0.f), 0.f);
+}
+
+MI_VARIANT std::tuple<typename LightTree<Float, Spectrum>::UInt32, Float, Float>
+LightTree<Float, Spectrum>::sample_emitter(const Interaction3f &ref, Float sample,
+                                           Mask active) const {
+    MI_MASK_ARGUMENT(active);
+
+    UInt32 index = 0;
+    Float pmf = 0.f;
+
+    // Choose between the emitters at infinity and the tree
+    Mask infinite = active && (sample < m_infinite_prob);
+    if (m_infinite_prob > 0.f && dr::any_or<true>(infinite)) {
+        auto [k, reused, pmf_k] =
+            m_infinite_distr.sample_reuse_pmf(sample / m_infinite_prob, infinite);
+        dr::masked(index, infinite) = dr::gather<UInt32>(m_infinite_index, k, infinite);
+        dr::masked(sample, infinite) = reused;
+        dr::masked(pmf, infinite) = pmf_k * m_infinite_prob;
+    }
+
+    Mask tree = active && !infinite;
+    if (m_node_count == 0 || dr::none_or<false>(tree))
+        return { index, sample, pmf };
+
+    Point3f p = dr::detach(ref.p);
+    Normal3f n = dr::detach(ref.n);
+
+    UInt32 node = 0;
+    Float sample_tree = dr::minimum((sample - m_infinite_prob) / (1.f - m_infinite_prob),
+                                    dr::OneMinusEpsilon<Float>),
+          pmf_tree = 1.f - m_infinite_prob;
+    Mask loop_active = tree;
+
+    std::tie(node, sample_tree, pmf_tree, loop_active) = dr::while_loop(
+        std::make_tuple(node, sample_tree, pmf_tree, loop_active),
+        [](const UInt32 &, const Float &, const Float &, const Mask &active) {
+            return active;
+        },
+        [this, &p, &n](UInt32 &node, Float &sample, Float &pmf, Mask &active) {
+            UInt32 child = dr::gather<UInt32>(m_node_child, node, active);
+            active &= (child & light_tree_leaf) == 0u;
+
+            // Choose a child in proportion to its importance
+            Float i0 = importance(child, p, n, active),
+                  i1 = importance(child + 1u, p, n, active),
+                  p0 = dr::select(i0 + i1 > 0.f, i0 / (i0 + i1), 0.f);
+
+            Mask first = sample < p0;
+            Float prob = dr::select(first, p0, 1.f - p0);
+
+            dr::masked(sample, active) = dr::minimum(
+                dr::select(first, sample, sample - p0) / prob,
+                dr::OneMinusEpsilon<Float>);
+            dr::masked(node, active) = child + dr::select(first, 0u, 1u);
+            dr::masked(pmf, active) *= prob;
+
+            // Stop if none of the emitters can contribute
+            active &= prob > 0.f;
+        });
+
+    // Emitters below a node with zero importance are never chosen
+    UInt32 leaf = dr::gather<UInt32>(m_node_child, node, tree);
+    Mask valid = tree && (leaf & light_tree_leaf) != 0u;
+    dr::masked(index, valid) = leaf & ~light_tree_leaf;
+    dr::masked(sample, tree) = sample_tree;
+    dr::masked(pmf, tree) = dr::select(valid, pmf_tree, 0.f);
+
+    return { index, sample, pmf };
+}
+
+MI_VARIANT Float LightTree<Float, Spectrum>::pdf_emitter(const Interaction3f &ref,
+                                                         UInt32 index,
+                                                         Mask active) const {
+    MI_MASK_ARGUMENT(active);
+
+    Float pmf = 0.f;
+    if (m_infinite_prob > 0.f)
+        pmf = dr::gather<Float>(m_infinite_pmf, index, active);
+
+    if (m_node_count == 0)
+        return pmf;
+
+    UInt32 node = dr::gather<UInt32>(m_emitter_leaf, index, active);
+    Mask tree = active && node != light_tree_invalid;
+
+    Point3f p = dr::detach(ref.p);
+    Normal3f n = dr::detach(ref.n);
+
+    // Walk up from the leaf and account for the choice made at every node
+    Float pmf_tree = 1.f - m_infinite_prob;
+    Mask loop_active = tree && node != 0u;
+
+    std::tie(node, pmf_tree, loop_active) = dr::while_loop(
+        std::make_tuple(node, pmf_tree, loop_active),
+        [](const UInt32 &, const Float &, const Mask &active) {
+            return active;
+        },
+        [this, &p, &n](UInt32 &node, Float &pmf, Mask &active) {
+            UInt32 parent = dr::gather<UInt32>(m_node_parent, node, active),
+                   child  = dr::gather<UInt32>(m_node_child, parent, active);
+
+            Float i0 = importance(child, p, n, active),
+                  i1 = importance(child + 1u, p, n, active),
+                  p0 = dr::select(i0 + i1 > 0.f, i0 / (i0 + i1), 0.f);
+
+            dr::masked(pmf, active) *= dr::select(node == child, p0, 1.f - p0);
+            dr::masked(node, active) = parent;
+            active &= node != 0u && pmf > 0.f;
+        });
+
+    return dr::select(tree, pmf_tree, pmf);
+}
+
+MI_VARIANT std::string LightTree<Float, Spectrum>::to_string() const {
+    std::ostringstream oss;
+    oss << "LightTree[" << std::endl
+        << "  emitter_count = " << m_emitter_count << "," << std::endl
+        << "  infinite_emitter_count = " << dr::width(m_infinite_index) << "," << std::endl
+        << "  node_count = " << m_node_count << "," << std::endl
+        << "  depth = " << m_depth << std::endl
+        << "]";
+    return oss.str();
+}
+
+MI_IMPLEMENT_CLASS_VARIANT(LightTree, Object)
+MI_INSTANTIATE_CLASS(LightTree)
+
+NAMESPACE_END(mitsuba)
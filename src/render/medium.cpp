@@ -4,6 +4,8 @@
 #include <mitsuba/render/phase.h>
 #include <mitsuba/render/scene.h>
 #include <mitsuba/render/texture.h>
+#include <mitsuba/render/volume.h>
+#include <drjit/while_loop.h>
 
 NAMESPACE_BEGIN(mitsuba)
 
@@ -68,16 +70,30 @@ Medium<Float, Spectrum>::sample_interaction(const Ray3f &ray, Float sample,
     mint = dr::maximum(0.f, mint);
     maxt = dr::minimum(ray.maxt, maxt);
 
-    auto combined_extinction = get_majorant(mei, active);
-    Float m                  = combined_extinction[0];
-    if constexpr (is_rgb_v<Spectrum>) { // Handle RGB rendering
-        dr::masked(m, channel == 1u) = combined_extinction[1];
-        dr::masked(m, channel == 2u) = combined_extinction[2];
-    } else {
+    bool use_grid = m_majorant_resolution.x() > 0;
+    UnpolarizedSpectrum combined_extinction;
+    Float sampled_t;
+
+    if (use_grid) {
+        // The supergrid majorant is gray, the channel does not matter
         DRJIT_MARK_USED(channel);
+        Float m;
+        std::tie(sampled_t, m) =
+            sample_majorant_grid(ray, sample, mint, maxt, active);
+        combined_extinction = m;
+    } else {
+        combined_extinction = get_majorant(mei, active);
+        Float m             = combined_extinction[0];
+        if constexpr (is_rgb_v<Spectrum>) { // Handle RGB rendering
+            dr::masked(m, channel == 1u) = combined_extinction[1];
+            dr::masked(m, channel == 2u) = combined_extinction[2];
+        } else {
+            DRJIT_MARK_USED(channel);
+        }
+
+        sampled_t = mint + (-dr::log(1 - sample) / m);
     }
 
-    Float sampled_t = mint + (-dr::log(1 - sample) / m);
     Mask valid_mi   = active && (sampled_t <= maxt);
     mei.t           = dr::select(valid_mi, sampled_t, dr::Infinity<Float>);
     mei.p           = ray(sampled_t);
@@ -86,6 +102,13 @@ Medium<Float, Spectrum>::sample_interaction(const Ray3f &ray, Float sample,
 
     std::tie(mei.sigma_s, mei.sigma_n, mei.sigma_t) =
         get_scattering_coefficients(mei, valid_mi);
+
+    /* Null-collision coefficient with respect to the majorant of the cell
+       that the distance was sampled in (a lookup at 'mei.p' could pick a
+       neighboring cell due to roundoff) */
+    if (use_grid)
+        mei.sigma_n = combined_extinction - mei.sigma_t;
+
     mei.combined_extinction = combined_extinction;
     return mei;
 }
@@ -104,6 +127,116 @@ Medium<Float, Spectrum>::transmittance_eval_pdf(const MediumInteraction3f &mi,
     return { tr, pdf };
 }
 
+MI_VARIANT void
+Medium<Float, Spectrum>::update_majorant_grid(const Volume *volume,
+                                              ScalarFloat scale) {
+    if (m_majorant_resolution.x() <= 0)
+        return;
+
+    size_t cell_count = dr::prod(ScalarVector3u(m_majorant_resolution));
+    std::unique_ptr<ScalarFloat[]> values(new ScalarFloat[cell_count]);
+    volume->max_per_cell(m_majorant_resolution, values.get());
+
+    ScalarFloat mean = 0.f, max = 0.f;
+    for (size_t i = 0; i < cell_count; ++i) {
+        values[i] *= scale;
+        mean += values[i];
+        max = dr::maximum(max, values[i]);
+    }
+    mean /= (ScalarFloat) cell_count;
+
+    m_majorant_grid = dr::load<DynamicBuffer<Float>>(values.get(), cell_count);
+    m_majorant_bbox = volume->bbox();
+
+    /* The expected number of null collisions along a ray is proportional to
+       the integral of the majorant, hence the ratio below estimates the
+       reduction compared to a single global majorant */
+    Log(Debug, "Majorant supergrid (%s cells): mean majorant is %.2f%% of "
+        "the global majorant (%g)", m_majorant_resolution,
+        max > 0.f ? mean / max * 100.f : 100.f, max);
+}
+
+MI_VARIANT Float
+Medium<Float, Spectrum>::eval_majorant_grid(const Point3f &p,
+                                            Mask active) const {
+    ScalarVector3f scale = ScalarVector3f(m_majorant_resolution) /
+                           m_majorant_bbox.extents();
+    Vector3i cell = dr::clip(Vector3i(dr::floor((p - m_majorant_bbox.min) * scale)),
+                             0, Vector3i(m_majorant_resolution - 1));
+    UInt32 index = UInt32((cell.z() * m_majorant_resolution.y() + cell.y()) *
+                              m_majorant_resolution.x() + cell.x());
+    return dr::gather<Float>(m_majorant_grid, index, active);
+}
+
+MI_VARIANT std::pair<Float, Float>
+Medium<Float, Spectrum>::sample_majorant_grid(const Ray3f &ray, Float sample,
+                                              Float mint, Float maxt,
+                                              Mask active) const {
+    ScalarVector3i res = m_majorant_resolution;
+    ScalarVector3f scale = ScalarVector3f(res) / m_majorant_bbox.extents();
+
+    // Ray in grid coordinates (the parameterization of the ray is unchanged)
+    Point3f o  = (ray.o - m_majorant_bbox.min) * scale;
+    Vector3f d = ray.d * scale;
+
+    Vector3i cell = dr::clip(Vector3i(dr::floor(o + d * mint)), 0,
+                             Vector3i(res - 1));
+    Vector3i step = dr::select(d >= 0.f, Vector3i(1), Vector3i(-1));
+    Vector3f d_rcp = dr::rcp(d),
+             delta_t = dr::select(d != 0.f, dr::abs(d_rcp), dr::Infinity<Float>),
+             next_t  = dr::select(
+                 d != 0.f,
+                 (Vector3f(cell) + dr::select(d >= 0.f, 1.f, 0.f) - o) * d_rcp,
+                 dr::Infinity<Float>);
+
+    // Optical depth (w.r.t. the majorant) until the next collision
+    Float tau = -dr::log(1.f - sample),
+          t = mint,
+          sampled_t = dr::Infinity<Float>,
+          majorant = 0.f;
+
+    std::tie(t, tau, cell, next_t, sampled_t, majorant, active) = dr::while_loop(
+        std::make_tuple(t, tau, cell, next_t, sampled_t, majorant, active),
+        [](const Float &, const Float &, const Vector3i &, const Vector3f &,
+           const Float &, const Float &, const Mask &active) {
+            return active;
+        },
+        [this, res, step, delta_t, maxt](Float &t, Float &tau, Vector3i &cell,
+                                         Vector3f &next_t, Float &sampled_t,
+                                         Float &majorant, Mask &active) {
+            Float t_exit = dr::minimum(dr::min(next_t), maxt);
+
+            UInt32 index = UInt32((cell.z() * res.y() + cell.y()) * res.x() + cell.x());
+            Float m = dr::gather<Float>(m_majorant_grid, index, active),
+                  optical_depth = m * (t_exit - t);
+
+            // Does the collision happen within the current cell?
+            Mask hit = active && (m > 0.f) && (optical_depth >= tau);
+            dr::masked(sampled_t, hit) = dr::minimum(t + tau / m, t_exit);
+            dr::masked(majorant, hit) = m;
+
+            tau -= optical_depth;
+            t = t_exit;
+
+            // Advance to the neighboring cell along the closest crossing
+            Mask step_x = next_t.x() <= next_t.y() && next_t.x() <= next_t.z(),
+                 step_y = !step_x && next_t.y() <= next_t.z(),
+                 step_z = !step_x && !step_y;
+            dr::masked(cell.x(), step_x) += step.x();
+            dr::masked(cell.y(), step_y) += step.y();
+            dr::masked(cell.z(), step_z) += step.z();
+            dr::masked(next_t.x(), step_x) += delta_t.x();
+            dr::masked(next_t.y(), step_y) += delta_t.y();
+            dr::masked(next_t.z(), step_z) += delta_t.z();
+
+            active &= !hit && (t < maxt) &&
+                      dr::all(cell >= 0 && cell < Vector3i(res));
+        },
+        "Majorant supergrid traversal");
+
+    return { sampled_t, majorant };
+}
+
 MI_IMPLEMENT_CLASS_VARIANT(Medium, Object, "medium")
 MI_INSTANTIATE_CLASS(Medium)
 NAMESPACE_END(mitsuba)
@@ -1,4 +1,5 @@
 #include <mitsuba/core/fstream.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/core/timer.h>
 #include <mitsuba/core/transform.h>
 #include <mitsuba/core/util.h>
@@ -89,15 +90,18 @@ MI_VARIANT void Mesh<Float, Spectrum>::traverse(TraversalCallback *callback) {
 
 MI_VARIANT void Mesh<Float, Spectrum>::parameters_changed(const std::vector<std::string> &keys) {
     bool mesh_attributes_changed = false;
+    bool topology_changed = keys.empty() || string::contains(keys, "faces");
 
     if (m_vertex_positions.size() != m_vertex_count * 3) {
         Log(Debug, "parameters_changed(): Vertex count changed, updating it.");
         mesh_attributes_changed = true;
+        topology_changed = true;
         m_vertex_count = (uint32_t) m_vertex_positions.size() / 3;
     }
     if (m_faces.size() != m_face_count * 3) {
         Log(Debug, "parameters_changed(): Face count changed, updating it.");
         mesh_attributes_changed = true;
+        topology_changed = true;
         m_face_count = (uint32_t) m_faces.size() / 3;
     }
     if (has_vertex_normals() && m_vertex_normals.size() != m_vertex_count * 3) {
@@ -120,7 +124,12 @@ MI_VARIANT void Mesh<Float, Spectrum>::parameters_changed(const std::vector<std:
         }
     }
 
-    if (keys.empty() || string::contains(keys, "faces")) { // Topology changed
+#if defined(MI_ENABLE_EMBREE)
+    if (topology_changed)
+        m_embree_topology_dirty = true;
+#endif
+
+    if (topology_changed) {
         m_E2E_outdated = true;
         if (parameters_grad_enabled())
             build_directed_edges();
@@ -315,6 +324,119 @@ MI_VARIANT void Mesh<Float, Spectrum>::write_ply(Stream *stream) const {
     }
 }
 
+MI_VARIANT void Mesh<Float, Spectrum>::write_mmesh(const std::string &filename) const {
+    ref<FileStream> stream =
+        new FileStream(filename, FileStream::ETruncReadWrite);
+
+    Timer timer;
+    Log(Info, "Writing mesh to \"%s\" ..", filename);
+    write_mmesh(stream);
+    Log(Info, "\"%s\": wrote %i faces, %i vertices (%s in %s)", filename,
+        m_face_count, m_vertex_count,
+        util::mem_string(m_face_count * face_data_bytes() +
+                         m_vertex_count * vertex_data_bytes()),
+        util::time_string((float) timer.value()));
+}
+
+MI_VARIANT void Mesh<Float, Spectrum>::write_mmesh(Stream *stream) const {
+    /* The arrays are stored in little endian byte order so that they can be
+       mapped into memory as-is (see src/shapes/mmesh.cpp) */
+    if (Struct::host_byte_order() != Struct::ByteOrder::LittleEndian)
+        Throw("write_mmesh(): this format is only supported on little endian "
+              "machines!");
+
+    auto&& vertex_positions = dr::migrate(m_vertex_positions, AllocType::Host);
+    auto&& vertex_normals   = dr::migrate(m_vertex_normals, AllocType::Host);
+    auto&& vertex_texcoords = dr::migrate(m_vertex_texcoords, AllocType::Host);
+    auto&& faces = dr::migrate(m_faces, AllocType::Host);
+
+    std::vector<std::pair<std::string, MeshAttribute>> attributes;
+    for (const auto&[name, attribute]: m_mesh_attributes)
+        attributes.push_back({ name, attribute.migrate(AllocType::Host) });
+
+    // Evaluate buffers if necessary
+    if constexpr (dr::is_jit_v<Float>)
+        dr::sync_thread();
+
+    struct Section {
+        std::string name;
+        const void *data;
+        size_t size;
+        uint32_t dim;
+    };
+
+    std::vector<Section> sections;
+    sections.push_back({ "vertex_positions", vertex_positions.data(),
+                         m_vertex_count * 3 * sizeof(InputFloat), 3 });
+    if (has_vertex_normals() && !m_face_normals)
+        sections.push_back({ "vertex_normals", vertex_normals.data(),
+                             m_vertex_count * 3 * sizeof(InputFloat), 3 });
+    if (has_vertex_texcoords())
+        sections.push_back({ "vertex_texcoords", vertex_texcoords.data(),
+                             m_vertex_count * 2 * sizeof(InputFloat), 2 });
+    sections.push_back({ "faces", faces.data(),
+                         m_face_count * 3 * sizeof(ScalarIndex), 3 });
+
+    for (const auto&[name, attribute]: attributes) {
+        size_t count = attribute.type == MeshAttributeType::Vertex
+                           ? m_vertex_count : m_face_count;
+        sections.push_back({ name, attribute.buf.data(),
+                             count * attribute.size * sizeof(InputFloat),
+                             (uint32_t) attribute.size });
+    }
+
+    // All arrays start at a multiple of 64 bytes
+    constexpr size_t alignment = 64;
+    const uint8_t padding[alignment] = { };
+    auto align = [&](size_t offset) {
+        return (offset + alignment - 1) / alignment * alignment;
+    };
+
+    // Header
+    const char identifier[8] = { 'M', 'M', 'E', 'S', 'H', 0, 0, 0 };
+    stream->write(identifier, sizeof(identifier));
+    stream->write((uint32_t) 1); // version
+    uint32_t flags = m_face_normals ? 0x0010 : 0;
+    // Color attributes already hold spectral model coefficients
+    if constexpr (is_spectral_v<Spectrum>)
+        flags |= 0x0020;
+    stream->write(flags);
+    stream->write((uint64_t) m_vertex_count);
+    stream->write((uint64_t) m_face_count);
+    for (size_t i = 0; i < 3; ++i)
+        stream->write((float) m_bbox.min[i]);
+    for (size_t i = 0; i < 3; ++i)
+        stream->write((float) m_bbox.max[i]);
+    stream->write((uint32_t) sections.size());
+    stream->write(padding, 4);
+
+    // Section table
+    size_t offset = align(alignment * (1 + sections.size()));
+    for (const Section &section : sections) {
+        char name[40] = { };
+        if (section.name.size() >= sizeof(name))
+            Throw("write_mmesh(): attribute name \"%s\" is too long!",
+                  section.name);
+        memcpy(name, section.name.c_str(), section.name.size());
+
+        stream->write(name, sizeof(name));
+        stream->write((uint64_t) offset);
+        stream->write((uint64_t) section.size);
+        stream->write(section.dim);
+        stream->write(padding, 4);
+        offset = align(offset + section.size);
+    }
+
+    // Array data
+    offset = alignment * (1 + sections.size());
+    for (const Section &section : sections) {
+        stream->write(padding, align(offset) - offset);
+        stream->write(section.data, section.size);
+        offset = align(offset) + section.size;
+    }
+    stream->write(padding, align(offset) - offset);
+}
+
 MI_VARIANT void Mesh<Float, Spectrum>::recompute_vertex_normals() {
     if (!has_vertex_normals())
         Throw("Storing new normals in a Mesh that didn't have normals at "
@@ -428,6 +550,104 @@ MI_VARIANT void Mesh<Float, Spectrum>::recompute_bbox() {
             ScalarPoint3f(ptr[3 * i + 0], ptr[3 * i + 1], ptr[3 * i + 2]));
 }
 
+MI_VARIANT struct Mesh<Float, Spectrum>::CachedGeometry : public Object {
+    ScalarTransform4f to_world;
+    ScalarBoundingBox3f bbox;
+    ScalarSize vertex_count;
+    ScalarSize face_count;
+    FloatStorage vertex_positions;
+    FloatStorage vertex_normals;
+    FloatStorage vertex_texcoords;
+    DynamicBuffer<UInt32> faces;
+    std::unordered_map<std::string, MeshAttribute> mesh_attributes;
+    /// Name of the mesh (e.g. read from the file)
+    std::string name;
+    /// Were the vertex normals computed from the geometry?
+    bool normals_computed;
+};
+
+MI_VARIANT void
+Mesh<Float, Spectrum>::load_cached(const fs::path &path,
+                                   const std::string &options,
+                                   const std::function<bool()> &load) {
+    std::string key = ResourceCache::key(
+        path, tfm::format("%s|%s|face_normals=%i|%s", class_()->name(),
+                          class_()->variant(), (int) m_face_normals, options));
+
+    bool loaded = false;
+    ref<Object> object = ResourceCache::get(key, [&]() {
+        ref<CachedGeometry> geometry = new CachedGeometry();
+        geometry->normals_computed = load();
+        geometry->name             = m_name;
+        geometry->to_world         = m_to_world.scalar();
+        geometry->bbox             = m_bbox;
+        geometry->vertex_count     = m_vertex_count;
+        geometry->face_count       = m_face_count;
+        geometry->vertex_positions = m_vertex_positions;
+        geometry->vertex_normals   = m_vertex_normals;
+        geometry->vertex_texcoords = m_vertex_texcoords;
+        geometry->faces            = m_faces;
+        geometry->mesh_attributes  = m_mesh_attributes;
+        loaded = true;
+
+        size_t size = vertex_data_bytes() * m_vertex_count +
+                      face_data_bytes() * m_face_count;
+        return std::make_pair(ref<Object>(geometry), size);
+    });
+
+    if (loaded)
+        return;
+
+    // JIT variants share the buffers, scalar variants copy them
+    const CachedGeometry *geometry = (const CachedGeometry *) object.get();
+    m_name             = geometry->name;
+    m_bbox             = geometry->bbox;
+    m_vertex_count     = geometry->vertex_count;
+    m_face_count       = geometry->face_count;
+    m_vertex_positions = geometry->vertex_positions;
+    m_vertex_normals   = geometry->vertex_normals;
+    m_vertex_texcoords = geometry->vertex_texcoords;
+    m_faces            = geometry->faces;
+    m_mesh_attributes  = geometry->mesh_attributes;
+
+    ScalarTransform4f to_world = m_to_world.scalar();
+    if (to_world == geometry->to_world)
+        return;
+
+    // Map the cached world space geometry into the world space of this mesh
+    ScalarTransform4f transform = to_world * geometry->to_world.inverse();
+    bool transform_normals = has_vertex_normals() && !geometry->normals_computed;
+
+    auto&& vertex_positions = dr::migrate(m_vertex_positions, AllocType::Host);
+    auto&& vertex_normals   = dr::migrate(m_vertex_normals, AllocType::Host);
+    if constexpr (dr::is_jit_v<Float>)
+        dr::sync_thread();
+
+    std::unique_ptr<InputFloat[]> positions(new InputFloat[m_vertex_count * 3]);
+    std::unique_ptr<InputFloat[]> normals(
+        new InputFloat[transform_normals ? m_vertex_count * 3 : 0]);
+
+    m_bbox.reset();
+    for (ScalarSize i = 0; i < m_vertex_count; ++i) {
+        InputPoint3f p = dr::load<InputPoint3f>(vertex_positions.data() + 3 * i);
+        p = transform.transform_affine(p);
+        m_bbox.expand(p);
+        dr::store(positions.get() + 3 * i, p);
+
+        if (transform_normals) {
+            InputNormal3f n = dr::load<InputNormal3f>(vertex_normals.data() + 3 * i);
+            n = dr::normalize(transform.transform_affine(n));
+            dr::store(normals.get() + 3 * i, n);
+        }
+    }
+
+    m_vertex_positions = dr::load<FloatStorage>(positions.get(), m_vertex_count * 3);
+    if (transform_normals)
+        m_vertex_normals = dr::load<FloatStorage>(normals.get(), m_vertex_count * 3);
+    else if (has_vertex_normals()) // Angle weights change under non-rigid transformations
+        recompute_vertex_normals();
+}
+
 MI_VARIANT void Mesh<Float, Spectrum>::build_pmf() {
     std::lock_guard<std::mutex> lock(m_mutex);
     dr::scoped_symbolic_independence<Float> guard{};
@@ -1831,8 +2051,26 @@ MI_VARIANT RTCGeometry Mesh<Float, Spectrum>::embree_geometry(RTCDevice device)
                                m_face_count);
 
     rtcCommitGeometry(geom);
+    m_embree_topology_dirty = false;
     return geom;
 }
+
+MI_VARIANT bool Mesh<Float, Spectrum>::embree_update_geometry(RTCGeometry geom) {
+    /* Refitting requires the faces and the vertex count of the committed
+       geometry. The face buffer may be reallocated at the same address, hence
+       the flag set by parameters_changed() is checked as well. */
+    if (m_embree_topology_dirty ||
+        rtcGetGeometryBufferData(geom, RTC_BUFFER_TYPE_INDEX, 0) != m_faces.data())
+        return false;
+
+    rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3,
+                               m_vertex_positions.data(), 0, 3 * sizeof(InputFloat),
+                               m_vertex_count);
+    rtcUpdateGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0);
+    rtcSetGeometryBuildQuality(geom, RTC_BUILD_QUALITY_REFIT);
+    rtcCommitGeometry(geom);
+    return true;
+}
 #endif
 
 #if defined(MI_ENABLE_CUDA)
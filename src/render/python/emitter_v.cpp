@@ -144,6 +144,7 @@ template <typename Ptr, typename Cls> void bind_emitter_generic(Cls &cls) {
     .def("get_shape", [](Ptr ptr) -> RetShape { return ptr->shape(); }, D(Endpoint, shape))
     .def("get_medium", [](Ptr ptr) -> RetMedium { return ptr->medium(); }, D(Endpoint, medium))
     .def("sampling_weight", [](Ptr ptr) { return ptr->sampling_weight(); }, D(Emitter, sampling_weight))
+    .def("scene_index", [](Ptr ptr) { return ptr->scene_index(); }, D(Emitter, scene_index))
     .def("is_environment", [](Ptr ptr) { return ptr->is_environment(); }, D(Emitter, is_environment));
 }
 
@@ -159,6 +160,7 @@ MI_PY_EXPORT(Emitter) {
         .def(nb::init<const Properties&>(), "props"_a)
         .def_method(Emitter, is_environment)
         .def_method(Emitter, sampling_weight)
+        .def_method(Emitter, scene_index)
         .def_method(Emitter, flags, "active"_a = true)
         .def_field(PyEmitter, m_needs_sample_2, D(Endpoint, m_needs_sample_2))
         .def_field(PyEmitter, m_needs_sample_3, D(Endpoint, m_needs_sample_3))
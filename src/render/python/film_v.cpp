@@ -16,7 +16,7 @@
 MI_VARIANT class PyFilm : public Film<Float, Spectrum> {
 public:
     MI_IMPORT_TYPES(Film, ImageBlock)
-    NB_TRAMPOLINE(Film, 11);
+    NB_TRAMPOLINE(Film, 12);
 
     PyFilm(const Properties &props) : Film(props) { }
 
@@ -48,6 +48,10 @@ public:
         NB_OVERRIDE_PURE(write, path);
     }
 
+    fs::path output_path(const fs::path &path) const override {
+        NB_OVERRIDE(output_path, path);
+    }
+
     void schedule_storage() override {
         NB_OVERRIDE_PURE(schedule_storage);
     }
@@ -94,6 +98,7 @@ MI_PY_EXPORT(Film) {
         .def_method(Film, develop, "raw"_a = false)
         .def_method(Film, bitmap, "raw"_a = false)
         .def_method(Film, write, "path"_a)
+        .def_method(Film, output_path, "path"_a)
         .def_method(Film, sample_border)
         .def_method(Film, base_channels_count)
         // Make sure to return a copy of those members as they might also be
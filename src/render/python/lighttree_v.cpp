@@ -0,0 +1,22 @@
+#include <mitsuba/render/lighttree.h>
+#include <mitsuba/render/emitter.h>
+#include <mitsuba/python/python.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/vector.h>
+
+MI_PY_EXPORT(LightTree) {
+    MI_PY_IMPORT_TYPES(LightTree, Emitter)
+
+    MI_PY_CLASS(LightTree, Object)
+        .def(nb::init<const std::vector<ref<Emitter>> &>(), "emitters"_a,
+            D(LightTree, LightTree))
+        .def("sample_emitter", &LightTree::sample_emitter,
+            "ref"_a, "sample"_a, "active"_a = true,
+            D(LightTree, sample_emitter))
+        .def("pdf_emitter", &LightTree::pdf_emitter,
+            "ref"_a, "index"_a, "active"_a = true,
+            D(LightTree, pdf_emitter))
+        .def_method(LightTree, emitter_count)
+        .def_method(LightTree, node_count)
+        .def_method(LightTree, depth);
+}
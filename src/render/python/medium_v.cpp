@@ -101,6 +101,7 @@ MI_PY_EXPORT(Medium) {
         .def(nb::init<const Properties &>(), "props"_a)
         .def_method(Medium, id)
         .def_method(Medium, set_id)
+        .def_method(Medium, majorant_resolution)
         .def_field(PyMedium, m_sample_emitters, D(Medium, m_sample_emitters))
         .def_field(PyMedium, m_is_homogeneous, D(Medium, m_is_homogeneous))
         .def_field(PyMedium, m_has_spectral_extinction, D(Medium, m_has_spectral_extinction))
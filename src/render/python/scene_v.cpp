@@ -109,6 +109,7 @@ MI_PY_EXPORT(Scene) {
         .def("emitters", nb::overload_cast<>(&Scene::emitters), D(Scene, emitters))
         .def("emitters_dr", &Scene::emitters_dr, D(Scene, emitters_dr))
         .def_method(Scene, environment)
+        .def_method(Scene, light_tree)
         .def("shapes",
              [](const Scene &scene) {
                  nb::list result;
@@ -331,6 +331,12 @@ MI_PY_EXPORT(Shape) {
         .def("write_ply",
              nb::overload_cast<Stream *>(&Mesh::write_ply, nb::const_),
              "stream"_a, D(Mesh, write_ply, 2))
+        .def("write_mmesh",
+             nb::overload_cast<const std::string &>(&Mesh::write_mmesh, nb::const_),
+             "filename"_a, D(Mesh, write_mmesh))
+        .def("write_mmesh",
+             nb::overload_cast<Stream *>(&Mesh::write_mmesh, nb::const_),
+             "stream"_a, D(Mesh, write_mmesh, 2))
         .def("merge", &Mesh::merge, "other"_a,
              D(Mesh, merge))
 
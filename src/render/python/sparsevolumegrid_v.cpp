@@ -0,0 +1,50 @@
+#include <mitsuba/render/sparsevolumegrid.h>
+#include <mitsuba/render/volumegrid.h>
+#include <mitsuba/core/filesystem.h>
+#include <mitsuba/core/stream.h>
+#include <mitsuba/python/python.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
+
+MI_PY_EXPORT(SparseVolumeGrid) {
+    MI_PY_IMPORT_TYPES(SparseVolumeGrid, VolumeGrid)
+
+    MI_PY_CLASS(SparseVolumeGrid, Object)
+        .def(nb::init<const fs::path &>(), "path"_a,
+            nb::call_guard<nb::gil_scoped_release>())
+        .def(nb::init<Stream *>(), "stream"_a,
+            nb::call_guard<nb::gil_scoped_release>())
+        .def(nb::init<const VolumeGrid *, ScalarFloat, uint32_t>(),
+            "grid"_a, "threshold"_a = 0.f, "brick_size"_a = 8,
+            D(SparseVolumeGrid, SparseVolumeGrid, 3),
+            nb::call_guard<nb::gil_scoped_release>())
+        .def_method(SparseVolumeGrid, size)
+        .def_method(SparseVolumeGrid, channel_count)
+        .def_method(SparseVolumeGrid, brick_size)
+        .def_method(SparseVolumeGrid, tile_count)
+        .def_method(SparseVolumeGrid, brick_count)
+        .def_method(SparseVolumeGrid, bbox)
+        .def_method(SparseVolumeGrid, max)
+        .def("max_per_channel",
+            [] (const SparseVolumeGrid *grid) {
+                std::vector<ScalarFloat> max_values(grid->channel_count());
+                grid->max_per_channel(max_values.data());
+                return max_values;
+            },
+            D(SparseVolumeGrid, max_per_channel))
+        .def("brick_max",
+            [] (const SparseVolumeGrid *grid) {
+                return std::vector<ScalarFloat>(
+                    grid->brick_max(), grid->brick_max() + grid->brick_count());
+            },
+            D(SparseVolumeGrid, brick_max))
+        .def_method(SparseVolumeGrid, tile_max)
+        .def_method(SparseVolumeGrid, buffer_size)
+        .def_method(SparseVolumeGrid, to_dense,
+            nb::call_guard<nb::gil_scoped_release>())
+        .def("write", nb::overload_cast<Stream *>(&SparseVolumeGrid::write, nb::const_),
+            "stream"_a, D(SparseVolumeGrid, write, 2), nb::call_guard<nb::gil_scoped_release>())
+        .def("write", nb::overload_cast<const fs::path &>(
+                &SparseVolumeGrid::write, nb::const_), "path"_a, D(SparseVolumeGrid, write),
+                nb::call_guard<nb::gil_scoped_release>());
+}
@@ -77,6 +77,10 @@ public:
         NB_OVERRIDE(is_spatially_varying);
     }
 
+    bool needs_differentials() const override {
+        NB_OVERRIDE(needs_differentials);
+    }
+
     std::string to_string() const override {
         NB_OVERRIDE(to_string);
     }
@@ -93,6 +97,7 @@ MI_PY_EXPORT(Texture) {
         .def_method(Texture, mean, D(Texture, mean))
         .def_method(Texture, max, D(Texture, max))
         .def_method(Texture, is_spatially_varying)
+        .def_method(Texture, needs_differentials)
         .def_method(Texture, eval, "si"_a, "active"_a = true)
         .def_method(Texture, eval_1, "si"_a, "active"_a = true)
         .def_method(Texture, eval_1_grad, "si"_a, "active"_a = true)
@@ -74,6 +74,14 @@ MI_PY_EXPORT(Volume) {
                 return max_values;
             },
             D(Volume, max_per_channel))
+        .def("max_per_cell",
+            [] (const Volume *volume, const ScalarVector3i &resolution) {
+                std::vector<ScalarFloat> max_values(
+                    dr::prod(ScalarVector3u(resolution)));
+                volume->max_per_cell(resolution, max_values.data());
+                return max_values;
+            },
+            "resolution"_a, D(Volume, max_per_cell))
         .def_method(Volume, eval, "it"_a, "active"_a = true)
         .def_method(Volume, eval_1, "it"_a, "active"_a = true)
         .def_method(Volume, eval_3, "it"_a, "active"_a = true)
@@ -1,5 +1,6 @@
 #include <mitsuba/core/properties.h>
 #include <mitsuba/core/plugin.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/render/bsdf.h>
 #include <mitsuba/render/medium.h>
 #include <mitsuba/render/mesh.h>
@@ -10,6 +11,7 @@
 #  include "scene_embree.inl"
 #else
 #  include <mitsuba/render/kdtree.h>
+#  include <mitsuba/render/bvh.h>
 #  include "scene_native.inl"
 #endif
 
@@ -78,6 +80,15 @@ MI_VARIANT Scene<Float, Spectrum>::Scene(const Properties &props) {
             emitter->set_scene(this);
     }
 
+    for (size_t i = 0; i < m_emitters.size(); ++i)
+        m_emitters[i]->set_scene_index((uint32_t) i);
+
+    m_emitter_sampling = props.string("emitter_sampling", "flat");
+    if (m_emitter_sampling != "auto" && m_emitter_sampling != "flat" &&
+        m_emitter_sampling != "light_tree")
+        Throw("Invalid emitter sampling strategy \"%s\", must be one of: "
+              "\"auto\", \"flat\", or \"light_tree\"!", m_emitter_sampling);
+
     m_shapes_dr = dr::load<DynamicBuffer<ShapePtr>>(
         m_shapes.data(), m_shapes.size());
 
@@ -117,6 +128,20 @@ void Scene<Float, Spectrum>::update_emitter_sampling_distribution() {
         m_emitter_pmf = m_emitters.empty() ? 0.f : (1.f / n_emitters);
         m_emitter_distr = nullptr;
     }
+
+    /* Choose emitters for direct illumination with a light tree if requested,
+       or with "auto" when there are many emitters with finite extent */
+    size_t n_finite = 0;
+    for (auto &e : m_emitters)
+        n_finite += has_flag(e->flags(), EmitterFlags::Infinite) ? 0 : 1;
+
+    bool light_tree = m_emitter_sampling == "light_tree" ||
+                      (m_emitter_sampling == "auto" && n_finite >= 16);
+    if (light_tree && n_emitters > 1)
+        m_light_tree = new LightTree(m_emitters);
+    else
+        m_light_tree = nullptr;
+
     // Clear emitter's dirty flag
     for (auto &e : m_emitters)
         e->set_dirty(false);
@@ -169,6 +194,9 @@ MI_VARIANT Scene<Float, Spectrum>::~Scene() {
     m_children.clear();
     m_integrator = nullptr;
     m_environment = nullptr;
+
+    // Release the cached resources that were only used by this scene
+    ResourceCache::prune();
 }
 
 // -----------------------------------------------------------------------
@@ -308,15 +336,31 @@ Scene<Float, Spectrum>::sample_emitter_direction(const Interaction3f &ref, const
     size_t emitter_count = m_emitters.size();
     if (emitter_count > 1 || (emitter_count == 1 && !vcall_inline)) {
         // Randomly pick an emitter
-        auto [index, emitter_weight, sample_x_re] = sample_emitter(sample.x(), active);
-        sample.x() = sample_x_re;
+        UInt32 index;
+        Float emitter_weight, emitter_pmf;
+        if (m_light_tree) {
+            std::tie(index, sample.x(), emitter_pmf) =
+                m_light_tree->sample_emitter(ref, sample.x(), active);
+
+            // No emitter can illuminate the reference point
+            active &= emitter_pmf > 0.f;
+            if constexpr (!dr::is_array_v<Float>) {
+                if (!active)
+                    return { dr::zeros<DirectionSample3f>(), 0.f };
+            }
+            emitter_weight = dr::select(active, dr::rcp(emitter_pmf), 0.f);
+        } else {
+            std::tie(index, emitter_weight, sample.x()) =
+                sample_emitter(sample.x(), active);
+            emitter_pmf = pdf_emitter(index, active);
+        }
 
         // Sample a direction towards the emitter
         EmitterPtr emitter = dr::gather<EmitterPtr>(m_emitters_dr, index, active);
         std::tie(ds, spec) = emitter->sample_direction(ref, sample, active);
 
         // Account for the discrete probability of sampling this emitter
-        ds.pdf *= pdf_emitter(index, active);
+        ds.pdf *= emitter_pmf;
         spec *= emitter_weight;
 
         active &= (ds.pdf != 0.f);
@@ -353,7 +397,9 @@ Scene<Float, Spectrum>::pdf_emitter_direction(const Interaction3f &ref,
                                               Mask active) const {
     MI_MASK_ARGUMENT(active);
     Float emitter_pmf;
-    if (m_emitter_distr == nullptr)
+    if (m_light_tree)
+        emitter_pmf = m_light_tree->pdf_emitter(ref, ds.emitter->scene_index(), active);
+    else if (m_emitter_distr == nullptr)
         emitter_pmf = m_emitter_pmf;
     else
         emitter_pmf = ds.emitter->sampling_weight() * m_emitter_distr->normalization();
@@ -484,6 +530,15 @@ MI_VARIANT void Scene<Float, Spectrum>::parameters_changed(const std::vector<std
         }
     }
 
+    // The light tree must be rebuilt when area emitters have moved
+    bool emitters_dirty = false;
+    for (auto &e : m_emitters) {
+        if (e->dirty() || (m_light_tree && e->shape() && e->shape()->dirty())) {
+            emitters_dirty = true;
+            break;
+        }
+    }
+
     for (auto &s : m_shapegroups) {
         if (s->dirty()) {
             accel_is_dirty = true;
@@ -514,12 +569,8 @@ MI_VARIANT void Scene<Float, Spectrum>::parameters_changed(const std::vector<std
 
     // Check if emitters were modified and we potentially need to update
     // the emitter sampling distribution.
-    for (auto &e : m_emitters) {
-        if (e->dirty()) {
-            update_emitter_sampling_distribution();
-            break;
-        }
-    }
+    if (emitters_dirty)
+        update_emitter_sampling_distribution();
 }
 
 MI_VARIANT std::string Scene<Float, Spectrum>::to_string() const {
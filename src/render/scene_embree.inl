@@ -13,11 +13,21 @@ template <typename Float>
 struct EmbreeState {
     MI_IMPORT_CORE_TYPES()
     RTCScene accel;
-    std::vector<int> geometries;
+    /// Geometry of every shape, attached to the scene under the shape index
+    std::vector<RTCGeometry> geometries;
     DynamicBuffer<UInt32> shapes_registry_ids;
+    RTCSceneFlags scene_flags = RTC_SCENE_FLAG_NONE;
     bool is_nested_scene = false;
 };
 
+/// Release the Embree scene and all geometries referenced by \c s
+template <typename Float> void embree_state_release(EmbreeState<Float> *s) {
+    for (RTCGeometry geom : s->geometries)
+        rtcReleaseGeometry(geom);
+    rtcReleaseScene(s->accel);
+    delete s;
+}
+
 static void embree_error_callback(void * /*user_ptr */, RTCError code, const char *str) {
     Log(Warn, "Embree device error %i: %s.", (int) code, str);
 }
@@ -111,9 +121,16 @@ Scene<Float, Spectrum>::accel_init_cpu(const Properties &props) {
     }
 
     s.accel = rtcNewScene(embree_device);
-    rtcSetSceneBuildQuality(s.accel, RTC_BUILD_QUALITY_HIGH);
+    RTCBuildQuality quality;
+    switch (parse_accel_quality(props.string("accel_quality", "high"))) {
+        case AccelQuality::Low:    quality = RTC_BUILD_QUALITY_LOW;    break;
+        case AccelQuality::Medium: quality = RTC_BUILD_QUALITY_MEDIUM; break;
+        default:                   quality = RTC_BUILD_QUALITY_HIGH;   break;
+    }
+    rtcSetSceneBuildQuality(s.accel, quality);
     bool use_robust = props.get<bool>("embree_use_robust_intersections", false);
-    rtcSetSceneFlags(s.accel, use_robust ? RTC_SCENE_FLAG_ROBUST : RTC_SCENE_FLAG_NONE);
+    s.scene_flags = use_robust ? RTC_SCENE_FLAG_ROBUST : RTC_SCENE_FLAG_NONE;
+    rtcSetSceneFlags(s.accel, s.scene_flags);
 
     ScopedPhase phase(ProfilerPhase::InitAccel);
     accel_parameters_changed_cpu();
@@ -141,16 +158,51 @@ MI_VARIANT void Scene<Float, Spectrum>::accel_parameters_changed_cpu() {
 
     EmbreeState<Float> &s = *(EmbreeState<Float> *) m_accel;
 
-    for (int geo : s.geometries)
-        rtcDetachGeometry(s.accel, geo);
-    s.geometries.clear();
+    // Instances must be recreated when the shape group they refer to changed
+    bool shapegroups_dirty = false;
+    for (auto &shapegroup : m_shapegroups)
+        shapegroups_dirty |= shapegroup->dirty();
+
+    /* Only process shapes that changed since the last update. Meshes whose
+       vertices moved refit their BVH in place, all other shapes are replaced
+       by a new geometry. Geometry IDs match the shape indices. */
+    s.geometries.resize(m_shapes.size(), nullptr);
+    size_t refit_count = 0, rebuild_count = 0;
+    for (size_t i = 0; i < m_shapes.size(); ++i) {
+        Shape *shape = m_shapes[i];
+        RTCGeometry &geom = s.geometries[i];
+
+        if (geom && !shape->dirty() && !(shapegroups_dirty && shape->is_instance()))
+            continue;
+
+        if (geom && shape->embree_update_geometry(geom)) {
+            refit_count++;
+            continue;
+        }
 
-    for (Shape *shape : m_shapes) {
-        RTCGeometry geom = shape->embree_geometry(embree_device);
-        s.geometries.push_back(rtcAttachGeometry(s.accel, geom));
-        rtcReleaseGeometry(geom);
+        if (geom) {
+            rtcDetachGeometry(s.accel, (uint32_t) i);
+            rtcReleaseGeometry(geom);
+        }
+
+        geom = shape->embree_geometry(embree_device);
+        rtcAttachGeometryByID(s.accel, geom, (uint32_t) i);
+        rebuild_count++;
+    }
+
+    /* In a dynamic scene, Embree keeps a separate BVH per geometry and only
+       rebuilds the ones that changed, along with a cheap top-level BVH. Switch
+       to this mode once geometry starts deforming. The build quality
+       configured through 'accel_quality' is kept. */
+    if (refit_count > 0 && !(s.scene_flags & RTC_SCENE_FLAG_DYNAMIC)) {
+        s.scene_flags = (RTCSceneFlags) (s.scene_flags | RTC_SCENE_FLAG_DYNAMIC);
+        rtcSetSceneFlags(s.accel, s.scene_flags);
+        Log(Debug, "Embree: switching to a dynamic scene.");
     }
 
+    Log(Debug, "Embree: refitted %zu and rebuilt %zu of %zu geometries.",
+        refit_count, rebuild_count, m_shapes.size());
+
     // Ensure shape data pointers are fully evaluated before building the BVH
     if constexpr (dr::is_llvm_v<Float>)
         dr::sync_thread();
@@ -190,9 +242,7 @@ MI_VARIANT void Scene<Float, Spectrum>::accel_parameters_changed_cpu() {
                     jit_enqueue_host_func(
                         JitBackend::LLVM,
                         [](void *p) {
-                            EmbreeState<Float> *s = (EmbreeState<Float> *) p;
-                            rtcReleaseScene(s->accel);
-                            delete s;
+                            embree_state_release((EmbreeState<Float> *) p);
                         },
                         payload
                     );
@@ -215,6 +265,9 @@ MI_VARIANT void Scene<Float, Spectrum>::accel_release_cpu() {
            ray tracing calls are pending. */
         m_accel_handle = 0;
         m_accel = nullptr;
+    } else {
+        embree_state_release((EmbreeState<Float> *) m_accel);
+        m_accel = nullptr;
     }
 }
 
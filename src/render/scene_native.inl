@@ -3,31 +3,90 @@ NAMESPACE_BEGIN(mitsuba)
 template <typename Float, typename Spectrum>
 struct NativeState {
     MI_IMPORT_CORE_TYPES()
+    /// kd-tree (default acceleration data structure), or \c nullptr
     ShapeKDTree<Float, Spectrum> *accel;
+    /// Wide BVH selected via <tt>accel_type="bvh"</tt>, or \c nullptr
+    ShapeBVH<Float, Spectrum> *bvh;
+    /**
+     * Top-level BVH over the instances of the scene, or \c nullptr. It is
+     * refit (rather than rebuilt) when only instances or shape groups changed.
+     */
+    ShapeBVH<Float, Spectrum> *instances;
+    /// Registry ids of the shapes of \c accel / \c bvh, followed by the instances
     DynamicBuffer<UInt32> shapes_registry_ids;
+    /// Offset of the instances in \c shapes_registry_ids
+    uint32_t instance_offset;
+    /// Trace SIMD packets through the kd-tree instead of one ray per lane?
+    bool packet_traversal;
 };
 
+/// Release the acceleration data structure and the state that refers to it
+template <typename Float, typename Spectrum>
+void native_state_release(NativeState<Float, Spectrum> *s) {
+    if (s->bvh) {
+        s->bvh->clear();
+        s->bvh->dec_ref();
+    } else {
+        s->accel->clear();
+        s->accel->dec_ref();
+    }
+    if (s->instances) {
+        s->instances->clear();
+        s->instances->dec_ref();
+    }
+    delete s;
+}
+
 MI_VARIANT void Scene<Float, Spectrum>::accel_init_cpu(const Properties &props) {
-    ShapeKDTree *kdtree = new ShapeKDTree(props);
-    kdtree->inc_ref();
+    m_accel = new NativeState<Float, Spectrum>();
+    NativeState<Float, Spectrum> &s = *(NativeState<Float, Spectrum> *) m_accel;
+    s.accel = nullptr;
+    s.bvh = nullptr;
+    s.instances = nullptr;
+
+    std::string accel_type = props.string("accel_type", "kdtree");
+    if (accel_type == "kdtree") {
+        s.accel = new ShapeKDTree(props);
+        s.accel->inc_ref();
+    } else if (accel_type == "bvh") {
+        s.bvh = new ShapeBVH(props);
+        s.bvh->inc_ref();
+    } else {
+        Throw("Unsupported acceleration data structure \"%s\" (must be "
+              "\"kdtree\" or \"bvh\")", accel_type);
+    }
 
-    if constexpr (dr::is_llvm_v<Float>) {
-        m_accel = new NativeState<Float, Spectrum>();
-        NativeState<Float, Spectrum> &s = *(NativeState<Float, Spectrum> *) m_accel;
-        s.accel = kdtree;
+    /* Trace the ray packets handed over by Dr.Jit through the kd-tree as a
+       whole (default) or one lane at a time. Only relevant in LLVM mode. */
+    s.packet_traversal = props.get<bool>("kd_packet_traversal", true) && s.accel;
 
-        // Get shapes registry ids
+    /* Instances are kept in a separate top-level BVH, so that moving them
+       does not require rebuilding the acceleration data structure over the
+       remaining shapes (the shape groups have their own kd-trees) */
+    size_t instance_count = 0;
+    for (Shape *shape : m_shapes)
+        instance_count += shape->is_instance();
+    s.instance_offset = (uint32_t) (m_shapes.size() - instance_count);
+
+    if (instance_count > 0) {
+        Properties inst_props;
+        inst_props.set_int("bvh_max_prims", 2);
+        s.instances = new ShapeBVH(inst_props);
+        s.instances->inc_ref();
+    }
+
+    if constexpr (dr::is_llvm_v<Float>) {
+        // Get shapes registry ids (instances come last)
         if (!m_shapes.empty()) {
             std::unique_ptr<uint32_t[]> data(new uint32_t[m_shapes.size()]);
-            for (size_t i = 0; i < m_shapes.size(); i++)
-                data[i] = jit_registry_id(m_shapes[i]);
+            size_t offset[2] = { 0, s.instance_offset };
+            for (Shape *shape : m_shapes)
+                data[offset[shape->is_instance()]++] = jit_registry_id(shape);
             s.shapes_registry_ids
                 = dr::load<DynamicBuffer<UInt32>>(data.get(), m_shapes.size());
         } else {
             s.shapes_registry_ids = dr::zeros<DynamicBuffer<UInt32>>();
         }
-    } else {
-        m_accel = kdtree;
     }
 
     accel_parameters_changed_cpu();
@@ -38,17 +97,48 @@ MI_VARIANT void Scene<Float, Spectrum>::accel_parameters_changed_cpu() {
     if constexpr (dr::is_llvm_v<Float>)
         dr::sync_thread();
 
-    ShapeKDTree *kdtree;
-    if constexpr (dr::is_llvm_v<Float>)
-        kdtree = ((NativeState<Float, Spectrum> *) m_accel)->accel;
-    else
-        kdtree = (ShapeKDTree *) m_accel;
+    NativeState<Float, Spectrum> *s = (NativeState<Float, Spectrum> *) m_accel;
 
-    kdtree->clear();
-    for (Shape *shape : m_shapes)
-        kdtree->add_shape(shape);
     ScopedPhase phase(ProfilerPhase::InitAccel);
-    kdtree->build();
+
+    /* When only instances (i.e. their transforms) or the shape groups they
+       refer to have changed, refitting the top-level BVH suffices */
+    bool refit = s->instances && s->instances->ready();
+    for (Shape *shape : m_shapes)
+        refit &= shape->is_instance() || !shape->dirty();
+
+    if (refit) {
+        Timer timer;
+        s->instances->refit();
+        Log(Debug, "Refit the top-level BVH over %u instances (took %s)",
+            s->instances->shape_count(),
+            util::time_string((float) timer.value()));
+    } else {
+        if (s->bvh) {
+            s->bvh->clear();
+            for (Shape *shape : m_shapes) {
+                if (!s->instances || !shape->is_instance())
+                    s->bvh->add_shape(shape);
+            }
+            s->bvh->build();
+        } else {
+            s->accel->clear();
+            for (Shape *shape : m_shapes) {
+                if (!s->instances || !shape->is_instance())
+                    s->accel->add_shape(shape);
+            }
+            s->accel->build();
+        }
+
+        if (s->instances) {
+            s->instances->clear();
+            for (Shape *shape : m_shapes) {
+                if (shape->is_instance())
+                    s->instances->add_shape(shape);
+            }
+            s->instances->build();
+        }
+    }
 
     /* Set up a callback on the handle variable to release the Embree
        acceleration data structure (IAS) when this variable is freed. This
@@ -59,19 +149,15 @@ MI_VARIANT void Scene<Float, Spectrum>::accel_parameters_changed_cpu() {
         // Prevents the IAS to be released when updating the scene parameters
         if (m_accel_handle.index())
             jit_var_set_callback(m_accel_handle.index(), nullptr, nullptr);
-        m_accel_handle = dr::opaque<UInt64>(kdtree);
+        m_accel_handle = dr::opaque<UInt64>(m_accel);
         jit_var_set_callback(
             m_accel_handle.index(),
             [](uint32_t /* index */, int free, void *payload) {
                 if (free) {
                     // Free KDTree on another thread to avoid deadlock with Dr.Jit mutex
                     Task *task = dr::do_async([payload](){
-                        Log(Debug, "Free KDTree..");
-                        NativeState<Float, Spectrum> *s =
-                            (NativeState<Float, Spectrum> *) payload;
-                        s->accel->clear();
-                        s->accel->dec_ref();
-                        delete s;
+                        Log(Debug, "Free native acceleration data structure..");
+                        native_state_release((NativeState<Float, Spectrum> *) payload);
                     });
                     Thread::register_task(task);
                 }
@@ -93,7 +179,7 @@ MI_VARIANT void Scene<Float, Spectrum>::accel_release_cpu() {
            ray tracing calls are pending. */
         m_accel_handle = 0;
     } else {
-        ((ShapeKDTree *) m_accel)->dec_ref();
+        native_state_release((NativeState<Float, Spectrum> *) m_accel);
     }
 
     m_accel = nullptr;
@@ -116,6 +202,39 @@ template <typename ScalarFloat> struct RayHitT {
 #  pragma pack(pop)
 #endif
 
+/**
+ * \brief Trace a ray through the shapes of the scene and then through the
+ * top-level BVH over its instances (if any)
+ *
+ * Instance hits store an index in place of the shape pointer (see \ref
+ * ShapeBVH::intersect_prim()), which is offset here to refer to \ref
+ * NativeState::shapes_registry_ids.
+ */
+template <bool ShadowRay, typename Float, typename Spectrum>
+MI_INLINE PreliminaryIntersection<dr::scalar_t<Float>, Shape<Float, Spectrum>>
+native_ray_intersect_scalar(const NativeState<Float, Spectrum> *s,
+                            Ray<Point<dr::scalar_t<Float>, 3>, Spectrum> ray) {
+    auto pi = s->bvh ? s->bvh->template ray_intersect_scalar<ShadowRay>(ray)
+                     : s->accel->template ray_intersect_scalar<ShadowRay>(ray);
+
+    if (!s->instances || (ShadowRay && pi.is_valid()))
+        return pi;
+
+    if (pi.is_valid())
+        ray.maxt = pi.t;
+
+    auto pi_inst = s->instances->template ray_intersect_scalar<ShadowRay>(ray);
+    if (!pi_inst.is_valid())
+        return pi;
+
+    if constexpr (!ShadowRay) {
+        using ShapePtr = decltype(pi_inst.shape);
+        pi_inst.shape = (ShapePtr) ((size_t) pi_inst.shape + s->instance_offset);
+    }
+
+    return pi_inst;
+}
+
 template <typename Float, typename Spectrum, bool ShadowRay, size_t Width>
 void kdtree_trace_func_wrapper(const int *valid, void *ptr,
                                void* /* context */, uint8_t *args) {
@@ -124,7 +243,6 @@ void kdtree_trace_func_wrapper(const int *valid, void *ptr,
     using ShapeKDTree = ShapeKDTree<Float, Spectrum>;
 
     NativeState<Float, Spectrum> *s = (NativeState<Float, Spectrum> *) ptr;
-    const ShapeKDTree *kdtree = s->accel;
     using RayHit = RayHitT<ScalarFloat>;
 
     for (size_t i = 0; i < Width; i++) {
@@ -147,11 +265,11 @@ void kdtree_trace_func_wrapper(const int *valid, void *ptr,
         ScalarRay3f ray = ScalarRay3f(ray_o, ray_d, ray_maxt, ray_time, wavelength_t<Spectrum>());
 
         if constexpr (ShadowRay) {
-            bool hit = kdtree->template ray_intersect_scalar<true>(ray).is_valid();
+            bool hit = native_ray_intersect_scalar<true>(s, ray).is_valid();
             if (hit)
                 ray_maxt = 0.f;
         } else {
-            auto pi = kdtree->template ray_intersect_scalar<false>(ray);
+            auto pi = native_ray_intersect_scalar<false>(s, ray);
             if (pi.is_valid()) {
                 ScalarFloat& prim_u = ((ScalarFloat*) &args[offsetof(RayHit, u) * Width])[i];
                 ScalarFloat& prim_v = ((ScalarFloat*) &args[offsetof(RayHit, v) * Width])[i];
@@ -172,31 +290,134 @@ void kdtree_trace_func_wrapper(const int *valid, void *ptr,
     }
 }
 
+template <typename Float, typename Spectrum, bool ShadowRay, size_t Width>
+void kdtree_trace_packet_func_wrapper(const int *valid, void *ptr,
+                                      void* /* context */, uint8_t *args) {
+    MI_IMPORT_TYPES()
+    using FloatP   = dr::Packet<ScalarFloat, Width>;
+    using MaskP    = dr::mask_t<FloatP>;
+    using UInt32P  = dr::uint32_array_t<FloatP>;
+    using Int32P   = dr::int32_array_t<FloatP>;
+    using Ray3fP   = Ray<Point<FloatP, 3>, Spectrum>;
+    using RayHit   = RayHitT<ScalarFloat>;
+    using ScalarRay3f = Ray<ScalarPoint3f, Spectrum>;
+    using ShapeKDTree = ShapeKDTree<Float, Spectrum>;
+
+    NativeState<Float, Spectrum> *s = (NativeState<Float, Spectrum> *) ptr;
+    const ShapeKDTree *kdtree = s->accel;
+
+    auto field = [&](size_t offset) { return args + offset * Width; };
+
+    MaskP active = dr::load<Int32P>(valid) != 0;
+    if (dr::none(active))
+        return;
+
+    Ray3fP ray;
+    ray.o.x() = dr::load<FloatP>(field(offsetof(RayHit, o_x)));
+    ray.o.y() = dr::load<FloatP>(field(offsetof(RayHit, o_y)));
+    ray.o.z() = dr::load<FloatP>(field(offsetof(RayHit, o_z)));
+    ray.d.x() = dr::load<FloatP>(field(offsetof(RayHit, d_x)));
+    ray.d.y() = dr::load<FloatP>(field(offsetof(RayHit, d_y)));
+    ray.d.z() = dr::load<FloatP>(field(offsetof(RayHit, d_z)));
+    ray.time  = dr::load<FloatP>(field(offsetof(RayHit, time)));
+    ray.maxt  = dr::load<FloatP>(field(offsetof(RayHit, tfar)));
+
+    auto pi = kdtree->template ray_intersect_packet<ShadowRay, Width>(ray, active);
+
+    // Instances are traced one lane at a time through the top-level BVH
+    if (s->instances) {
+        for (size_t j = 0; j < Width; ++j) {
+            ScalarFloat t_j = pi.t.entry(j);
+            if (!active.entry(j) || (ShadowRay && t_j != dr::Infinity<ScalarFloat>))
+                continue;
+
+            ScalarRay3f ray_j(
+                ScalarPoint3f(ray.o.x().entry(j), ray.o.y().entry(j), ray.o.z().entry(j)),
+                ScalarVector3f(ray.d.x().entry(j), ray.d.y().entry(j), ray.d.z().entry(j)),
+                std::min(ray.maxt.entry(j), t_j), ray.time.entry(j),
+                wavelength_t<Spectrum>());
+
+            auto pi_j = s->instances->template ray_intersect_scalar<ShadowRay>(ray_j);
+            if (!pi_j.is_valid())
+                continue;
+
+            pi.t.entry(j)           = ShadowRay ? 0.f : pi_j.t;
+            pi.prim_uv.x().entry(j) = pi_j.prim_uv.x();
+            pi.prim_uv.y().entry(j) = pi_j.prim_uv.y();
+            pi.prim_index.entry(j)  = pi_j.prim_index;
+            pi.shape_index.entry(j) = pi_j.shape_index;
+            pi.inst_index.entry(j)  =
+                (uint32_t) (size_t) pi_j.shape + s->instance_offset;
+        }
+    }
+
+    MaskP hit = active && pi.is_valid();
+
+    if (dr::none(hit))
+        return;
+
+    auto store = [&](size_t offset, const auto &value) {
+        using Value = std::decay_t<decltype(value)>;
+        uint8_t *target = field(offset);
+        dr::store(target, dr::select(hit, value, dr::load<Value>(target)));
+    };
+
+    if constexpr (ShadowRay) {
+        store(offsetof(RayHit, tfar), FloatP(0.f));
+    } else {
+        store(offsetof(RayHit, tfar), pi.t);
+        store(offsetof(RayHit, u), pi.prim_uv.x());
+        store(offsetof(RayHit, v), pi.prim_uv.y());
+        store(offsetof(RayHit, prim_id), UInt32P(pi.prim_index));
+        store(offsetof(RayHit, geom_id), UInt32P(pi.shape_index));
+        store(offsetof(RayHit, inst_id), UInt32P(pi.inst_index));
+    }
+}
+
+/// Select the kd-tree ray tracing callback matching the Dr.Jit vector width
+template <typename Float, typename Spectrum, bool ShadowRay>
+void *kdtree_trace_func(const NativeState<Float, Spectrum> *s, const char *name) {
+    int jit_width = jit_llvm_vector_width();
+
+    if constexpr (dr::is_llvm_v<Float>) {
+        if (s->packet_traversal) {
+            switch (jit_width) {
+                case 4:  return (void *) kdtree_trace_packet_func_wrapper<Float, Spectrum, ShadowRay, 4>;
+                case 8:  return (void *) kdtree_trace_packet_func_wrapper<Float, Spectrum, ShadowRay, 8>;
+                case 16: return (void *) kdtree_trace_packet_func_wrapper<Float, Spectrum, ShadowRay, 16>;
+                default: break;
+            }
+        }
+    }
+
+    switch (jit_width) {
+        case 1:  return (void *) kdtree_trace_func_wrapper<Float, Spectrum, ShadowRay, 1>;
+        case 4:  return (void *) kdtree_trace_func_wrapper<Float, Spectrum, ShadowRay, 4>;
+        case 8:  return (void *) kdtree_trace_func_wrapper<Float, Spectrum, ShadowRay, 8>;
+        case 16: return (void *) kdtree_trace_func_wrapper<Float, Spectrum, ShadowRay, 16>;
+        default:
+            Throw("%s(): Dr.Jit is configured for vectors of width %u, which "
+                  "is not supported by the kd-tree ray tracing backend!",
+                  name, jit_width);
+    }
+}
+
 MI_VARIANT typename Scene<Float, Spectrum>::PreliminaryIntersection3f
 Scene<Float, Spectrum>::ray_intersect_preliminary_cpu(const Ray3f &ray,
                                                       Mask coherent,
                                                       Mask active) const {
     if constexpr (!dr::is_array_v<Float>) {
         DRJIT_MARK_USED(coherent);
-        const ShapeKDTree *kdtree = (const ShapeKDTree *) m_accel;
-        return kdtree->template ray_intersect_preliminary<false>(ray, active);
+        DRJIT_MARK_USED(active);
+        const NativeState<Float, Spectrum> *s =
+            (const NativeState<Float, Spectrum> *) m_accel;
+        return native_ray_intersect_scalar<false>(s, ray);
     } else {
         NativeState<Float, Spectrum> *s = (NativeState<Float, Spectrum> *) m_accel;
-        void *func_ptr = nullptr,
+        void *func_ptr = kdtree_trace_func<Float, Spectrum, false>(
+                 s, "ray_intersect_preliminary_cpu"),
              *scene_ptr = m_accel;
 
-        int jit_width = jit_llvm_vector_width();
-        switch (jit_width) {
-            case 1:  func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, false, 1>; break;
-            case 4:  func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, false, 4>; break;
-            case 8:  func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, false, 8>; break;
-            case 16: func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, false, 16>; break;
-            default:
-                Throw("ray_intersect_preliminary_cpu(): Dr.Jit is "
-                      "configured for vectors of width %u, which is not "
-                      "supported by the kd-tree ray tracing backend!", jit_width);
-        }
-
         UInt64 func_v = UInt64::steal(
                    jit_var_pointer(JitBackend::LLVM, func_ptr, m_accel_handle.index(), 0)),
                scene_v = UInt64::steal(
@@ -266,22 +487,13 @@ Scene<Float, Spectrum>::ray_test_cpu(const Ray3f &ray,
                                      Mask coherent, Mask active) const {
     if constexpr (!dr::is_jit_v<Float>) {
         DRJIT_MARK_USED(coherent);
-        const ShapeKDTree *kdtree = (const ShapeKDTree *) m_accel;
-        return kdtree->template ray_intersect_preliminary<true>(ray, active).is_valid();
+        const NativeState<Float, Spectrum> *s =
+            (const NativeState<Float, Spectrum> *) m_accel;
+        return active && native_ray_intersect_scalar<true>(s, ray).is_valid();
     } else {
-        void *func_ptr = nullptr, *scene_ptr = m_accel;
-
-        int jit_width = jit_llvm_vector_width();
-        switch (jit_width) {
-            case 1:  func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, true, 1>; break;
-            case 4:  func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, true, 4>; break;
-            case 8:  func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, true, 8>; break;
-            case 16: func_ptr = (void *) kdtree_trace_func_wrapper<Float, Spectrum, true, 16>; break;
-            default:
-                Throw("ray_test_cpu(): Dr.Jit is configured for vectors of "
-                      "width %u, which is not supported by the kd-tree ray "
-                      "tracing backend!", jit_width);
-        }
+        NativeState<Float, Spectrum> *s = (NativeState<Float, Spectrum> *) m_accel;
+        void *func_ptr = kdtree_trace_func<Float, Spectrum, true>(s, "ray_test_cpu"),
+             *scene_ptr = m_accel;
 
         UInt64 func_v = UInt64::steal(
                    jit_var_pointer(JitBackend::LLVM, func_ptr, m_accel_handle.index(), 0)),
@@ -308,14 +520,24 @@ Scene<Float, Spectrum>::ray_test_cpu(const Ray3f &ray,
 
 MI_VARIANT typename Scene<Float, Spectrum>::SurfaceInteraction3f
 Scene<Float, Spectrum>::ray_intersect_naive_cpu(const Ray3f &ray, Mask active) const {
-    const ShapeKDTree *kdtree;
-    if constexpr (dr::is_llvm_v<Float>)
-        kdtree = ((NativeState<Float, Spectrum> *) m_accel)->accel;
-    else
-        kdtree = (const ShapeKDTree *) m_accel;
+    const NativeState<Float, Spectrum> *s =
+        (const NativeState<Float, Spectrum> *) m_accel;
 
     PreliminaryIntersection3f pi =
-        kdtree->template ray_intersect_naive<false>(ray, active);
+        s->bvh ? s->bvh->template ray_intersect_naive<false>(ray, active)
+               : s->accel->template ray_intersect_naive<false>(ray, active);
+
+    if constexpr (!dr::is_array_v<Float>) {
+        if (s->instances) {
+            Ray3f ray_inst(ray);
+            if (pi.is_valid())
+                ray_inst.maxt = pi.t;
+            PreliminaryIntersection3f pi_inst =
+                s->instances->template ray_intersect_naive<false>(ray_inst, active);
+            if (pi_inst.is_valid())
+                pi = pi_inst;
+        }
+    }
 
     return pi.compute_surface_interaction(ray, +RayFlags::All, active);
 }
@@ -18,6 +18,18 @@
 
 NAMESPACE_BEGIN(mitsuba)
 
+AccelQuality parse_accel_quality(const std::string &name) {
+    if (name == "low")
+        return AccelQuality::Low;
+    else if (name == "medium")
+        return AccelQuality::Medium;
+    else if (name == "high")
+        return AccelQuality::High;
+    else
+        Throw("Invalid acceleration data structure quality \"%s\" (must be "
+              "\"low\", \"medium\" or \"high\")", name);
+}
+
 MI_VARIANT Shape<Float, Spectrum>::Shape(const Properties &props) : m_id(props.id()) {
     m_to_world =
         (ScalarTransform4f) props.get<ScalarTransform4f>("to_world", ScalarTransform4f());
@@ -69,6 +81,9 @@ MI_VARIANT Shape<Float, Spectrum>::Shape(const Properties &props) : m_id(props.i
         m_bsdf = PluginManager::instance()->create_object<BSDF>(props2);
     }
 
+    // Filtered texture lookups need UV partials at the surface interaction
+    m_bsdf->update_differentials_flag();
+
     m_silhouette_sampling_weight = props.get<ScalarFloat>("silhouette_sampling_weight", 1.0f);
 
     if constexpr (dr::is_jit_v<Float>)
@@ -309,6 +324,10 @@ MI_VARIANT RTCGeometry Shape<Float, Spectrum>::embree_geometry(RTCDevice device)
         Throw("embree_geometry() should only be called in CPU mode.");
     }
 }
+
+MI_VARIANT bool Shape<Float, Spectrum>::embree_update_geometry(RTCGeometry /* geom */) {
+    return false;
+}
 #endif
 
 #if defined(MI_ENABLE_CUDA)
@@ -0,0 +1,376 @@
+#include <mitsuba/render/sparsevolumegrid.h>
+#include <mitsuba/render/volumegrid.h>
+#include <mitsuba/core/fstream.h>
+#include <mitsuba/core/logger.h>
+#include <mitsuba/core/stream.h>
+#include <mitsuba/core/timer.h>
+#include <mitsuba/core/util.h>
+#include <nanothread/nanothread.h>
+#include <cstring>
+#include <mutex>
+
+NAMESPACE_BEGIN(mitsuba)
+
+MI_VARIANT
+SparseVolumeGrid<Float, Spectrum>::SparseVolumeGrid(const fs::path &path) {
+    ref<FileStream> fs = new FileStream(path);
+
+    char header[3];
+    fs->read(header, 3);
+    fs->seek(0);
+
+    if (header[0] == 'V' && header[1] == 'O' && header[2] == 'L') {
+        // Dense volume file: load and convert
+        Timer timer;
+        ref<VolumeGrid> grid = new VolumeGrid(fs.get());
+        build(grid.get(), 0.f, 8);
+        Log(Info, "Converted \"%s\" to sparse storage (%s -> %s, took %s)",
+            path.filename().string(), util::mem_string(grid->buffer_size()),
+            util::mem_string(buffer_size()),
+            util::time_string((float) timer.value()));
+    } else {
+        read(fs);
+    }
+}
+
+MI_VARIANT
+SparseVolumeGrid<Float, Spectrum>::SparseVolumeGrid(Stream *stream) {
+    read(stream);
+}
+
+MI_VARIANT
+SparseVolumeGrid<Float, Spectrum>::SparseVolumeGrid(const VolumeGrid *grid,
+                                                    ScalarFloat threshold,
+                                                    uint32_t brick_size) {
+    build(grid, threshold, brick_size);
+}
+
+MI_VARIANT
+void SparseVolumeGrid<Float, Spectrum>::build(const VolumeGrid *grid,
+                                              ScalarFloat threshold,
+                                              uint32_t brick_size) {
+    if (brick_size == 0)
+        Throw("SparseVolumeGrid: the brick size must be positive!");
+
+    m_size          = grid->size();
+    m_brick_size    = brick_size;
+    m_channel_count = (uint32_t) grid->channel_count();
+    m_bbox          = grid->bbox();
+
+    const uint32_t B = m_brick_size, C = m_channel_count;
+    m_tile_count = (m_size + (B - 1)) / B;
+    size_t tile_count  = dr::prod(m_tile_count),
+           brick_values = (size_t) B * B * B * C;
+    const ScalarFloat *data = grid->data();
+
+    // Determine which tiles contain values above the threshold
+    std::unique_ptr<uint32_t[]> tiles(new uint32_t[tile_count]);
+    dr::parallel_for(
+        dr::blocked_range<size_t>(0, tile_count, 16),
+        [&](const dr::blocked_range<size_t> &range) {
+            for (size_t t = range.begin(); t != range.end(); ++t) {
+                ScalarVector3u tile(
+                    uint32_t(t % m_tile_count.x()),
+                    uint32_t((t / m_tile_count.x()) % m_tile_count.y()),
+                    uint32_t(t / ((size_t) m_tile_count.x() * m_tile_count.y())));
+                ScalarVector3u lo = tile * B,
+                               hi = dr::minimum(lo + B, m_size);
+
+                bool occupied = false;
+                for (uint32_t z = lo.z(); z < hi.z() && !occupied; ++z) {
+                    for (uint32_t y = lo.y(); y < hi.y() && !occupied; ++y) {
+                        const ScalarFloat *row =
+                            data + (((size_t) z * m_size.y() + y) * m_size.x() + lo.x()) * C;
+                        for (size_t i = 0; i < (hi.x() - lo.x()) * C; ++i) {
+                            if (dr::abs(row[i]) > threshold) {
+                                occupied = true;
+                                break;
+                            }
+                        }
+                    }
+                }
+                tiles[t] = occupied ? 1u : 0u;
+            }
+        }
+    );
+
+    // Assign brick indices (brick 0 is the reserved empty brick)
+    uint32_t brick_count = 1;
+    for (size_t t = 0; t < tile_count; ++t)
+        tiles[t] = tiles[t] ? brick_count++ : 0u;
+
+    m_tiles = std::move(tiles);
+    m_bricks = std::unique_ptr<ScalarFloat[]>(new ScalarFloat[brick_count * brick_values]);
+    memset(m_bricks.get(), 0, brick_count * brick_values * sizeof(ScalarFloat));
+    m_brick_max.resize(brick_count);
+
+    // Copy the data of occupied tiles into the brick pool
+    dr::parallel_for(
+        dr::blocked_range<size_t>(0, tile_count, 16),
+        [&](const dr::blocked_range<size_t> &range) {
+            for (size_t t = range.begin(); t != range.end(); ++t) {
+                uint32_t brick = m_tiles[t];
+                if (brick == 0)
+                    continue;
+                ScalarVector3u tile(
+                    uint32_t(t % m_tile_count.x()),
+                    uint32_t((t / m_tile_count.x()) % m_tile_count.y()),
+                    uint32_t(t / ((size_t) m_tile_count.x() * m_tile_count.y())));
+                ScalarVector3u lo = tile * B,
+                               hi = dr::minimum(lo + B, m_size);
+
+                for (uint32_t z = lo.z(); z < hi.z(); ++z) {
+                    for (uint32_t y = lo.y(); y < hi.y(); ++y) {
+                        const ScalarFloat *src =
+                            data + (((size_t) z * m_size.y() + y) * m_size.x() + lo.x()) * C;
+                        ScalarFloat *dst =
+                            m_bricks.get() +
+                            ((((size_t) brick * B + (z - lo.z())) * B + (y - lo.y())) * B) * C;
+                        memcpy(dst, src, (hi.x() - lo.x()) * C * sizeof(ScalarFloat));
+                    }
+                }
+            }
+        }
+    );
+
+    update_max();
+
+    Log(Debug, "Built sparse volume grid: %u of %u bricks occupied (%.1f%%), %s",
+        brick_count - 1, (uint32_t) tile_count,
+        100.f * (brick_count - 1) / dr::maximum((size_t) 1, tile_count),
+        util::mem_string(buffer_size()));
+}
+
+MI_VARIANT
+void SparseVolumeGrid<Float, Spectrum>::update_max() {
+    const uint32_t B = m_brick_size, C = m_channel_count;
+    size_t brick_values = (size_t) B * B * B * C,
+           brick_count  = m_brick_max.size();
+
+    // The reserved empty brick only contributes if some tile refers to it
+    bool has_empty = false;
+    for (size_t t = 0, n = dr::prod(m_tile_count); t < n && !has_empty; ++t)
+        has_empty = m_tiles[t] == 0;
+
+    m_max_per_channel.assign(C, -dr::Infinity<ScalarFloat>);
+    std::mutex mutex;
+
+    dr::parallel_for(
+        dr::blocked_range<size_t>(0, brick_count, 4),
+        [&](const dr::blocked_range<size_t> &range) {
+            std::vector<ScalarFloat> local(C, -dr::Infinity<ScalarFloat>);
+            for (size_t b = range.begin(); b != range.end(); ++b) {
+                const ScalarFloat *ptr = m_bricks.get() + b * brick_values;
+                ScalarFloat value = -dr::Infinity<ScalarFloat>;
+                for (size_t i = 0; i < brick_values; i += C) {
+                    for (uint32_t c = 0; c < C; ++c) {
+                        value = dr::maximum(value, ptr[i + c]);
+                        local[c] = dr::maximum(local[c], ptr[i + c]);
+                    }
+                }
+                m_brick_max[b] = value;
+                if (b == 0 && !has_empty)
+                    local.assign(C, -dr::Infinity<ScalarFloat>);
+            }
+
+            std::lock_guard<std::mutex> guard(mutex);
+            for (uint32_t c = 0; c < C; ++c)
+                m_max_per_channel[c] = dr::maximum(m_max_per_channel[c], local[c]);
+        }
+    );
+
+    m_max = -dr::Infinity<ScalarFloat>;
+    for (ScalarFloat value : m_max_per_channel)
+        m_max = dr::maximum(m_max, value);
+}
+
+MI_VARIANT
+std::vector<typename SparseVolumeGrid<Float, Spectrum>::ScalarFloat>
+SparseVolumeGrid<Float, Spectrum>::tile_max() const {
+    std::vector<ScalarFloat> result(dr::prod(m_tile_count));
+    for (size_t t = 0; t < result.size(); ++t)
+        result[t] = m_brick_max[m_tiles[t]];
+    return result;
+}
+
+MI_VARIANT
+void SparseVolumeGrid<Float, Spectrum>::max_per_channel(ScalarFloat *out) const {
+    for (size_t i = 0; i < m_channel_count; ++i)
+        out[i] = m_max_per_channel[i];
+}
+
+MI_VARIANT
+size_t SparseVolumeGrid<Float, Spectrum>::buffer_size() const {
+    return dr::prod(m_tile_count) * sizeof(uint32_t) +
+           m_brick_max.size() * (size_t) m_brick_size * m_brick_size *
+               m_brick_size * m_channel_count * sizeof(ScalarFloat);
+}
+
+MI_VARIANT
+ref<typename SparseVolumeGrid<Float, Spectrum>::VolumeGrid>
+SparseVolumeGrid<Float, Spectrum>::to_dense() const {
+    const uint32_t B = m_brick_size, C = m_channel_count;
+    ref<VolumeGrid> grid = new VolumeGrid(m_size, C);
+    grid->set_bbox(m_bbox);
+    ScalarFloat *data = grid->data();
+
+    dr::parallel_for(
+        dr::blocked_range<uint32_t>(0, m_size.z(), 1),
+        [&](const dr::blocked_range<uint32_t> &range) {
+            for (uint32_t z = range.begin(); z != range.end(); ++z) {
+                for (uint32_t y = 0; y < m_size.y(); ++y) {
+                    for (uint32_t x = 0; x < m_size.x(); ++x) {
+                        size_t tile = ((size_t) (z / B) * m_tile_count.y() + y / B) *
+                                          m_tile_count.x() + x / B;
+                        const ScalarFloat *src =
+                            m_bricks.get() +
+                            ((((size_t) m_tiles[tile] * B + z % B) * B + y % B) * B + x % B) * C;
+                        memcpy(data + (((size_t) z * m_size.y() + y) * m_size.x() + x) * C,
+                               src, C * sizeof(ScalarFloat));
+                    }
+                }
+            }
+        }
+    );
+
+    std::vector<ScalarFloat> max_per_channel(m_max_per_channel);
+    grid->set_max(m_max);
+    grid->set_max_per_channel(max_per_channel.data());
+    return grid;
+}
+
+MI_VARIANT
+void SparseVolumeGrid<Float, Spectrum>::read(Stream *stream) {
+    char header[3];
+    stream->read(header, 3);
+    if (header[0] != 'S' || header[1] != 'V' || header[2] != 'L')
+        Throw("Invalid sparse volume file!");
+
+    uint8_t version;
+    stream->read(version);
+    if (version != 1)
+        Throw("Invalid version, currently only version 1 is supported (found %d)", version);
+
+    int32_t data_type;
+    stream->read(data_type);
+    if (data_type != 1)
+        Throw("Wrong type, currently only type == 1 (Float32) data is "
+              "supported (found type = %d)", data_type);
+
+    int32_t size[3], channel_count, brick_size, brick_count;
+    stream->read_array(size, 3);
+    stream->read(channel_count);
+    m_size = ScalarVector3u((uint32_t) size[0], (uint32_t) size[1], (uint32_t) size[2]);
+    m_channel_count = (uint32_t) channel_count;
+
+    float dims[6];
+    stream->read_array(dims, 6);
+    m_bbox = ScalarBoundingBox3f(ScalarPoint3f(dims[0], dims[1], dims[2]),
+                                 ScalarPoint3f(dims[3], dims[4], dims[5]));
+
+    stream->read(brick_size);
+    stream->read(brick_count);
+    if (brick_size <= 0 || brick_count < 0)
+        Throw("Invalid sparse volume file (brick size %d, brick count %d)!",
+              brick_size, brick_count);
+    m_brick_size = (uint32_t) brick_size;
+
+    const uint32_t B = m_brick_size;
+    m_tile_count = (m_size + (B - 1)) / B;
+    size_t tile_count   = dr::prod(m_tile_count),
+           brick_values = (size_t) B * B * B * m_channel_count;
+
+    m_tiles = std::unique_ptr<uint32_t[]>(new uint32_t[tile_count]);
+    stream->read_array(m_tiles.get(), tile_count);
+    for (size_t t = 0; t < tile_count; ++t) {
+        if (m_tiles[t] > (uint32_t) brick_count)
+            Throw("Invalid sparse volume file (tile %zu refers to brick %u)!",
+                  t, m_tiles[t]);
+    }
+
+    // Brick 0 is not stored in the file and always evaluates to zero
+    m_brick_max.resize((size_t) brick_count + 1);
+    m_bricks = std::unique_ptr<ScalarFloat[]>(
+        new ScalarFloat[((size_t) brick_count + 1) * brick_values]);
+    memset(m_bricks.get(), 0, brick_values * sizeof(ScalarFloat));
+
+    ScalarFloat *payload = m_bricks.get() + brick_values;
+    size_t payload_count = (size_t) brick_count * brick_values;
+    if constexpr (std::is_same_v<ScalarFloat, float>) {
+        stream->read_array(payload, payload_count);
+    } else {
+        std::unique_ptr<float[]> tmp(new float[payload_count]);
+        stream->read_array(tmp.get(), payload_count);
+        for (size_t i = 0; i < payload_count; ++i)
+            payload[i] = (ScalarFloat) tmp[i];
+    }
+
+    update_max();
+
+    Log(Debug, "Loaded sparse grid volume data: dimensions %s, %i bricks, max value %f",
+        m_size, brick_count, m_max);
+}
+
+MI_VARIANT
+void SparseVolumeGrid<Float, Spectrum>::write(const fs::path &path) const {
+    ref<FileStream> fs = new FileStream(path, FileStream::ETruncReadWrite);
+    write(fs);
+}
+
+MI_VARIANT
+void SparseVolumeGrid<Float, Spectrum>::write(Stream *stream) const {
+    const uint32_t B = m_brick_size;
+    size_t brick_values = (size_t) B * B * B * m_channel_count,
+           brick_count  = m_brick_max.size() - 1;
+
+    stream->write("SVL", 3);
+    stream->write(uint8_t(1)); // file format version
+    stream->write(int32_t(1)); // data_type
+    stream->write(int32_t(m_size.x()));
+    stream->write(int32_t(m_size.y()));
+    stream->write(int32_t(m_size.z()));
+    stream->write(int32_t(m_channel_count));
+
+    stream->write(float(m_bbox.min.x()));
+    stream->write(float(m_bbox.min.y()));
+    stream->write(float(m_bbox.min.z()));
+    stream->write(float(m_bbox.max.x()));
+    stream->write(float(m_bbox.max.y()));
+    stream->write(float(m_bbox.max.z()));
+
+    stream->write(int32_t(B));
+    stream->write(int32_t(brick_count));
+    stream->write_array(m_tiles.get(), dr::prod(m_tile_count));
+
+    const ScalarFloat *payload = m_bricks.get() + brick_values;
+    if constexpr (std::is_same_v<ScalarFloat, float>) {
+        stream->write_array(payload, brick_count * brick_values);
+    } else {
+        // Need to convert data to single precision before writing to disk
+        std::vector<float> output(brick_count * brick_values);
+        for (size_t i = 0; i < output.size(); ++i)
+            output[i] = (float) payload[i];
+        stream->write_array(output.data(), output.size());
+    }
+}
+
+MI_VARIANT
+std::string SparseVolumeGrid<Float, Spectrum>::to_string() const {
+    size_t tile_count = dr::prod(m_tile_count);
+    std::ostringstream oss;
+    oss << "SparseVolumeGrid[" << std::endl
+        << "  size = " << m_size << "," << std::endl
+        << "  channels = " << m_channel_count << "," << std::endl
+        << "  brick_size = " << m_brick_size << "," << std::endl
+        << "  bricks = " << brick_count() - 1 << " / " << tile_count << "," << std::endl
+        << "  max = " << m_max << "," << std::endl
+        << "  data = [ " << util::mem_string(buffer_size())
+        << " of volume data ]" << std::endl
+        << "]";
+    return oss.str();
+}
+
+MI_IMPLEMENT_CLASS_VARIANT(SparseVolumeGrid, Object)
+MI_INSTANTIATE_CLASS(SparseVolumeGrid)
+
+NAMESPACE_END(mitsuba)
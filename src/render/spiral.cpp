@@ -6,67 +6,85 @@ NAMESPACE_BEGIN(mitsuba)
 
 Spiral::Spiral(const Vector2u &size, const Vector2u &offset,
                uint32_t block_size, uint32_t passes)
-    : m_size(size), m_offset(offset), m_passes_left(passes),
-      m_block_size(block_size) {
+    : m_block_counter(0), m_size(size), m_offset(offset),
+      m_passes(std::max(passes, 1u)), m_block_size(block_size) {
 
     m_blocks = (size + (block_size - 1)) / block_size;
     m_block_count = dr::prod(m_blocks);
 
-    reset();
-}
-
-void Spiral::reset() {
-    m_block_counter = 0;
-    direction = Direction::Right;
-    m_position = Vector2u(m_blocks / 2);
-    m_steps_left = 1;
-    m_spiral_size = 1;
-}
-
-std::tuple<Spiral::Vector2i, Spiral::Vector2u, uint32_t> Spiral::next_block() {
-    // Reimplementation of the spiraling block generator by Adam Arbree.
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    if (m_block_counter == m_block_count) {
-        if (m_passes_left > 1) {
-            --m_passes_left;
-            reset();
-        } else {
-            return { 0, 0, (uint32_t) -1 };
-        }
-    }
+    /* Reimplementation of the spiraling block generator by Adam Arbree. The
+       traversal order is precomputed here so that next_block() reduces to an
+       atomic increment followed by a table lookup. */
+    m_order.reserve(m_block_count);
 
-    // Calculate a unique identifier per block
-    uint32_t block_id =
-        m_block_counter + (m_passes_left - 1) * m_block_count;
-
-    Vector2u offset = m_position * m_block_size,
-             size   = dr::minimum(m_block_size, m_size - offset);
+    Direction direction = Direction::Right;
+    Point2i position = Vector2u(m_blocks / 2);
+    uint32_t steps_left = 1, spiral_size = 1;
 
-    Assert(dr::all(offset <= m_size));
+    while (m_order.size() != m_block_count) {
+        m_order.push_back((uint32_t) position.x() +
+                          (uint32_t) position.y() * m_blocks.x());
 
-    ++m_block_counter;
+        if (m_order.size() == m_block_count)
+            break;
 
-    if (m_block_counter != m_block_count) {
         // Prepare the next block's position along the spiral.
         do {
             switch (direction) {
-                case Direction::Right: ++m_position.x(); break;
-                case Direction::Down:  ++m_position.y(); break;
-                case Direction::Left:  --m_position.x(); break;
-                case Direction::Up:    --m_position.y(); break;
+                case Direction::Right: ++position.x(); break;
+                case Direction::Down:  ++position.y(); break;
+                case Direction::Left:  --position.x(); break;
+                case Direction::Up:    --position.y(); break;
             }
 
-            if (--m_steps_left == 0) {
+            if (--steps_left == 0) {
                 direction = Direction(((int) direction + 1) % 4);
                 if (direction == Direction::Left ||
                     direction == Direction::Right)
-                    ++m_spiral_size;
-                m_steps_left = m_spiral_size;
+                    ++spiral_size;
+                steps_left = spiral_size;
             }
-        } while (dr::any(m_position < 0 || m_position >= m_blocks));
+        } while (dr::any(position < 0 || position >= m_blocks));
+    }
+}
+
+void Spiral::reset() {
+    // Rewind to the beginning of the pass that is currently in progress
+    uint32_t total   = m_block_count * m_passes,
+             counter = std::min(m_block_counter.load(std::memory_order_relaxed),
+                                total > 0 ? total - 1 : 0u);
+
+    m_block_counter.store(m_block_count > 0
+                              ? (counter / m_block_count) * m_block_count
+                              : 0u,
+                          std::memory_order_relaxed);
+}
+
+std::tuple<Spiral::Vector2i, Spiral::Vector2u, uint32_t> Spiral::next_block() {
+    uint32_t index = m_block_counter.fetch_add(1, std::memory_order_relaxed);
+
+    if (index >= m_block_count * m_passes) {
+        /* Saturate the counter so that heavy oversubscription cannot wrap
+           it around. Concurrent callers may race here, which is harmless. */
+        m_block_counter.store(m_block_count * m_passes,
+                              std::memory_order_relaxed);
+        return { 0, 0, (uint32_t) -1 };
     }
 
+    uint32_t pass    = index / m_block_count,
+             counter = index - pass * m_block_count,
+             linear  = m_order[counter];
+
+    // Calculate a unique identifier per block
+    uint32_t block_id = counter + (m_passes - pass - 1) * m_block_count;
+
+    Vector2u position(linear % m_blocks.x(), linear / m_blocks.x());
+
+    Vector2u offset = position * m_block_size,
+             size   = dr::minimum(m_block_size, m_size - offset);
+
+    Assert(dr::all(offset <= m_size));
+
     return { offset + m_offset, size, block_id };
 }
 
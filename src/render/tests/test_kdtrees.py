@@ -113,3 +113,472 @@ def test02_depth_scalar_bunny(variant_scalar_rgb):
             res_shadow = scene.ray_test(r)
             assert dr.all(res_shadow == res_naive.is_valid())
             compare_results(res_naive, res)
+
+
+def kdtree_packet_rays(scene, kind, n=64):
+    b = scene.bbox()
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0, n * n)
+
+    if kind == 'primary':
+        # Coherent rays: orthographic grid looking down the Z axis
+        idx = dr.arange(mi.UInt32, n * n)
+        u = (mi.Float(idx % n) + .5) / n
+        v = (mi.Float(idx // n) + .5) / n
+        o = mi.Point3f(dr.lerp(b.min.x, b.max.x, u),
+                       dr.lerp(b.min.y, b.max.y, v),
+                       b.min.z - 1)
+        return mi.Ray3f(o, mi.Vector3f(0, 0, 1))
+    else:
+        # Incoherent rays: cosine-weighted bounces off the first hit
+        si = scene.ray_intersect(kdtree_packet_rays(scene, 'primary', n))
+        d = si.to_world(mi.warp.square_to_cosine_hemisphere(sampler.next_2d()))
+        o = dr.select(si.is_valid(), si.p, b.center())
+        return mi.Ray3f(o + d * 1e-4, d)
+
+
+@fresolver_append_path
+@pytest.mark.parametrize('kind', ['primary', 'diffuse'])
+def test03_packet_traversal_llvm(variant_llvm_ad_rgb, kind):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    def load(packet):
+        return mi.load_dict({
+            'type': 'scene',
+            'kd_packet_traversal': packet,
+            'shape': {
+                "type" : "ply",
+                "filename" : "resources/data/common/meshes/bunny_lowres.ply",
+            }
+        })
+
+    # Packet traversal must match the traversal of individual rays
+    results = []
+    for packet in [False, True]:
+        scene = load(packet)
+        ray = kdtree_packet_rays(scene, kind)
+        pi = scene.ray_intersect_preliminary(ray)
+        hit = scene.ray_test(ray)
+        dr.eval(pi, hit)
+        results.append((pi, hit))
+
+    (pi_ref, hit_ref), (pi, hit) = results
+
+    assert dr.all(hit == hit_ref)
+    assert dr.all(pi.is_valid() == pi_ref.is_valid())
+    valid = pi_ref.is_valid()
+    assert dr.allclose(dr.select(valid, pi.t, 0), dr.select(valid, pi_ref.t, 0))
+    assert dr.all(dr.select(valid, pi.prim_index == pi_ref.prim_index, True))
+
+
+def test04_kdtree_cache(variant_scalar_rgb, tmp_path):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    def load(cache):
+        props = mi.Properties("scene")
+        props["_unnamed_0"] = create_stairs(20)
+        if cache:
+            props["kd_cache_dir"] = str(tmp_path)
+        return mi.Scene(props)
+
+    def trace(scene):
+        results = []
+        for i in range(64):
+            o = mi.Vector3f(i / 63.0, 0.5, 2.0)
+            d = mi.Vector3f(0.1, 0.3, -1.0)
+            results.append(scene.ray_intersect_preliminary(mi.Ray3f(o, dr.normalize(d))))
+        return results
+
+    reference = trace(load(cache=False))
+
+    # The first load builds and writes the tree, the second one maps it
+    for i in range(2):
+        scene = load(cache=True)
+        assert len(list(tmp_path.glob('kdtree_*.bin'))) == 1
+        for a, b in zip(reference, trace(scene)):
+            compare_results(a, b)
+
+    # Changing the geometry must result in a different cache entry
+    props = mi.Properties("scene")
+    props["_unnamed_0"] = create_stairs(21)
+    props["kd_cache_dir"] = str(tmp_path)
+    mi.Scene(props)
+    assert len(list(tmp_path.glob('kdtree_*.bin'))) == 2
+
+
+def create_triangle_soup(n_triangles, seed=0):
+    # Randomly placed and oriented small triangles inside the unit cube
+    import numpy as np
+    rng = np.random.default_rng(seed)
+    size = 2.0 / n_triangles ** (1.0 / 3.0)
+    centers = rng.random((n_triangles, 1, 3), dtype=np.float32)
+    offsets = (rng.random((n_triangles, 3, 3), dtype=np.float32) - 0.5) * size
+
+    m = mi.Mesh("soup", 3 * n_triangles, n_triangles)
+    params = mi.traverse(m)
+    params['vertex_positions'] = mi.TensorXf((centers + offsets).ravel()).array
+    params['faces'] = mi.TensorXf(
+        np.arange(3 * n_triangles, dtype=np.float32)).array
+    params.update()
+    return m
+
+
+def build_triangle_soup(n_triangles, clip=True, accel_type='kdtree'):
+    props = mi.Properties("scene")
+    props["_unnamed_0"] = create_triangle_soup(n_triangles)
+    props["accel_type"] = accel_type
+    if accel_type == 'kdtree':
+        props["kd_clip"] = clip
+    return mi.Scene(props)
+
+
+@pytest.mark.parametrize('clip', [False, True])
+def test05_kdtree_parallel_nlogn(variant_scalar_rgb, clip):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    # Large enough for the O(n log n) builder to process its upper
+    # levels in parallel (see MI_KD_PARALLEL_EVENTS)
+    scene = build_triangle_soup(200000, clip)
+
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0)
+    for i in range(64):
+        o = mi.Point3f(sampler.next_1d(), sampler.next_1d(), -0.5)
+        d = dr.normalize(mi.Vector3f(sampler.next_1d() - 0.5,
+                                     sampler.next_1d() - 0.5, 1))
+        r = mi.Ray3f(o, d)
+        compare_results(scene.ray_intersect_naive(r), scene.ray_intersect(r))
+        assert scene.ray_test(r) == scene.ray_intersect_naive(r).is_valid()
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('n_triangles', [1000000, 10000000])
+def test06_kdtree_build_large(variant_scalar_rgb, n_triangles):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    # Set the log level to 'Debug' to see the per-phase timings and the
+    # thread utilization of the build
+    scene = build_triangle_soup(n_triangles)
+    assert scene.bbox().valid()
+
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0)
+    for i in range(16):
+        o = mi.Point3f(sampler.next_1d(), sampler.next_1d(), -0.5)
+        d = dr.normalize(mi.Vector3f(sampler.next_1d() - 0.5,
+                                     sampler.next_1d() - 0.5, 1))
+        r = mi.Ray3f(o, d)
+        compare_results(scene.ray_intersect_naive(r), scene.ray_intersect(r))
+
+
+@pytest.mark.parametrize('n_triangles', [1, 100, 50000])
+def test07_bvh_intersection(variant_scalar_rgb, n_triangles):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    # 50K triangles exercise the parallel binning and partitioning
+    scene = build_triangle_soup(n_triangles, accel_type='bvh')
+
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0)
+    for i in range(64):
+        o = mi.Point3f(sampler.next_1d(), sampler.next_1d(), -0.5)
+        d = dr.normalize(mi.Vector3f(sampler.next_1d() - 0.5,
+                                     sampler.next_1d() - 0.5, 1))
+        r = mi.Ray3f(o, d)
+        compare_results(scene.ray_intersect_naive(r), scene.ray_intersect(r))
+        assert scene.ray_test(r) == scene.ray_intersect_naive(r).is_valid()
+
+    # Axis-aligned rays (zero direction components)
+    for i in range(16):
+        r = mi.Ray3f(mi.Point3f(i / 15.0, 0.5, -0.5), mi.Vector3f(0, 0, 1))
+        compare_results(scene.ray_intersect_naive(r), scene.ray_intersect(r))
+
+
+@fresolver_append_path
+@pytest.mark.parametrize('kind', ['primary', 'diffuse'])
+def test08_bvh_vs_kdtree_llvm(variant_llvm_ad_rgb, kind):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    def load(accel_type):
+        return mi.load_dict({
+            'type': 'scene',
+            'accel_type': accel_type,
+            'shape': {
+                "type" : "ply",
+                "filename" : "resources/data/common/meshes/bunny_lowres.ply",
+            }
+        })
+
+    results = []
+    for accel_type in ['kdtree', 'bvh']:
+        scene = load(accel_type)
+        ray = kdtree_packet_rays(scene, kind)
+        pi = scene.ray_intersect_preliminary(ray)
+        hit = scene.ray_test(ray)
+        dr.eval(pi, hit)
+        results.append((pi, hit))
+
+    (pi_ref, hit_ref), (pi, hit) = results
+    assert dr.all(hit == hit_ref)
+    assert dr.all(pi.is_valid() == pi_ref.is_valid())
+    valid = pi_ref.is_valid()
+    assert dr.allclose(dr.select(valid, pi.t, 0), dr.select(valid, pi_ref.t, 0))
+
+
+def test09_invalid_accel_type(variant_scalar_rgb):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    with pytest.raises(RuntimeError, match='Unsupported acceleration'):
+        mi.load_dict({'type': 'scene', 'accel_type': 'octree'})
+
+
+def make_instance_grid(n, accel_type='kdtree'):
+    # Grid of n x n instanced rectangles facing +Z, above a static floor
+    from mitsuba import ScalarTransform4f as T
+
+    scene = {
+        'type': 'scene',
+        'accel_type': accel_type,
+        'group': {
+            'type': 'shapegroup',
+            'shape': { 'type': 'rectangle' }
+        },
+        'floor': {
+            'type': 'rectangle',
+            'to_world': T().translate([n, n, -1]) @ T().scale(2 * n)
+        }
+    }
+
+    for i in range(n):
+        for j in range(n):
+            scene[f'inst_{i}_{j}'] = {
+                'type': 'instance',
+                'group': { 'type': 'ref', 'id': 'group' },
+                'to_world': T().translate([2 * i + 1, 2 * j + 1, 0]) @ T().scale(0.5)
+            }
+
+    return mi.load_dict(scene)
+
+
+@pytest.mark.parametrize('accel_type', ['kdtree', 'bvh'])
+def test10_instance_refit(variants_all_backends_once, accel_type):
+    if mi.MI_ENABLE_EMBREE or mi.variant().startswith('cuda'):
+        pytest.skip("Native CPU backend only")
+
+    n = 4
+    scene = make_instance_grid(n, accel_type)
+    params = mi.traverse(scene)
+
+    # Move every other instance up, according to its index
+    from mitsuba import ScalarTransform4f as T
+    heights = {}
+    for i in range(n):
+        for j in range(n):
+            h = 0.25 * (i + n * j) if (i + j) % 2 == 0 else 0.0
+            params[f'inst_{i}_{j}.to_world'] = \
+                T().translate([2 * i + 1, 2 * j + 1, h]) @ T().scale(0.5)
+            heights[i, j] = h
+    params.update()
+
+    # Rays hitting the instance centers, and rays between them hitting the floor
+    o_x, o_y, t_ref = [], [], []
+    for i in range(n):
+        for j in range(n):
+            o_x += [2 * i + 1, 2 * i + 2]
+            o_y += [2 * j + 1, 2 * j + 2]
+            t_ref += [10 - heights[i, j], 11]
+
+    def trace(x, y):
+        ray = mi.Ray3f(mi.Point3f(x, y, 10), mi.Vector3f(0, 0, -1))
+        return scene.ray_intersect(ray).t, scene.ray_test(ray)
+
+    if mi.variant().startswith('scalar'):
+        results = [trace(x, y) for x, y in zip(o_x, o_y)]
+        t = [r[0] for r in results]
+        hit = all(r[1] for r in results)
+    else:
+        t, hit = trace(mi.Float(o_x), mi.Float(o_y))
+
+    assert dr.allclose(t, t_ref)
+    assert dr.all(hit)
+
+    bbox = scene.bbox()
+    assert dr.allclose(bbox.max, [3 * n, 3 * n, max(heights.values())])
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('n', [10, 100])
+def test11_instance_refit_large(variant_scalar_rgb, n):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    # Repeatedly moving n x n instances of a large mesh must give the same
+    # intersections as a scene created with the final transforms
+    from mitsuba import ScalarTransform4f as T
+
+    def load(frame):
+        scene = {
+            'type': 'scene',
+            'group': {
+                'type': 'shapegroup',
+                'shape': create_triangle_soup(100000)
+            },
+            'static': create_triangle_soup(1000000, seed=1)
+        }
+        for i in range(n * n):
+            scene[f'inst_{i}'] = {
+                'type': 'instance',
+                'group': { 'type': 'ref', 'id': 'group' },
+                'to_world': T().translate([i % n, i // n, 0.1 * frame])
+            }
+        return mi.load_dict(scene)
+
+    frames = 10
+    scene = load(0)
+    params = mi.traverse(scene)
+    for frame in range(1, frames):
+        for i in range(n * n):
+            params[f'inst_{i}.to_world'] = \
+                T().translate([i % n, i // n, 0.1 * frame])
+        params.update()
+
+    reference = load(frames - 1)
+    assert dr.allclose(scene.bbox().min, reference.bbox().min)
+    assert dr.allclose(scene.bbox().max, reference.bbox().max)
+
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0)
+    for i in range(64):
+        o = mi.Point3f(sampler.next_1d() * n, sampler.next_1d() * n, 5)
+        d = dr.normalize(mi.Vector3f(sampler.next_1d() - 0.5,
+                                     sampler.next_1d() - 0.5, -4))
+        r = mi.Ray3f(o, d)
+        compare_results(reference.ray_intersect(r), scene.ray_intersect(r))
+        assert scene.ray_test(r) == reference.ray_test(r)
+
+
+def build_quality_scene(n_triangles, quality, accel_type='kdtree'):
+    props = mi.Properties("scene")
+    props["_unnamed_0"] = create_triangle_soup(n_triangles)
+    props["accel_quality"] = quality
+    if not mi.MI_ENABLE_EMBREE:
+        props["accel_type"] = accel_type
+    return mi.Scene(props)
+
+
+@pytest.mark.parametrize('quality', ['low', 'medium', 'high'])
+@pytest.mark.parametrize('accel_type', ['kdtree', 'bvh'])
+def test12_accel_quality(variant_scalar_rgb, quality, accel_type):
+    # Lower quality profiles must not affect the intersection results
+    scene = build_quality_scene(50000, quality, accel_type)
+
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0)
+    for i in range(64):
+        o = mi.Point3f(sampler.next_1d(), sampler.next_1d(), -0.5)
+        d = dr.normalize(mi.Vector3f(sampler.next_1d() - 0.5,
+                                     sampler.next_1d() - 0.5, 1))
+        r = mi.Ray3f(o, d)
+        compare_results(scene.ray_intersect_naive(r), scene.ray_intersect(r))
+        assert scene.ray_test(r) == scene.ray_intersect_naive(r).is_valid()
+
+
+def test13_invalid_accel_quality(variant_scalar_rgb):
+    with pytest.raises(RuntimeError, match='acceleration data structure quality'):
+        mi.load_dict({'type': 'scene', 'accel_quality': 'ultra'})
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('n_triangles', [1000000, 10000000])
+def test14_accel_quality_large(variant_llvm_ad_rgb, n_triangles):
+    # The quality profiles must find the same intersections on large meshes
+    n_rays = 1024 * 1024
+    rng = mi.PCG32(size=n_rays)
+    o = mi.Point3f(rng.next_float32(), rng.next_float32(), -0.5)
+    d = dr.normalize(mi.Vector3f(rng.next_float32() - 0.5,
+                                 rng.next_float32() - 0.5, 1))
+    ray = mi.Ray3f(o, d)
+
+    results = []
+    for quality in ['low', 'medium', 'high']:
+        scene = build_quality_scene(n_triangles, quality)
+        pi = scene.ray_intersect_preliminary(ray)
+        dr.eval(pi)
+        results.append(pi)
+
+    for pi in results[1:]:
+        assert dr.all(pi.is_valid() == results[0].is_valid())
+        assert dr.allclose(dr.select(pi.is_valid(), pi.t, 0),
+                           dr.select(results[0].is_valid(), results[0].t, 0))
+
+
+def build_records_scene(n_triangles, records, packet=True):
+    props = mi.Properties("scene")
+    props["_unnamed_0"] = create_triangle_soup(n_triangles)
+    props["_unnamed_1"] = mi.load_dict({'type': 'sphere', 'center': [0.5, 0.5, 0.5],
+                                        'radius': 0.1})
+    props["kd_triangle_records"] = records
+    if dr.is_jit_v(mi.Float):
+        props["kd_packet_traversal"] = packet
+    return mi.Scene(props)
+
+
+@pytest.mark.parametrize('n_triangles', [1, 7, 5000])
+def test15_triangle_records(variant_scalar_rgb, n_triangles):
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    # Triangle records (mixed with a sphere) must not affect the results
+    reference = build_records_scene(n_triangles, False)
+    scene = build_records_scene(n_triangles, True)
+
+    sampler = mi.load_dict({'type': 'independent'})
+    sampler.seed(0)
+    for i in range(256):
+        o = mi.Point3f(sampler.next_1d(), sampler.next_1d(), -0.5)
+        d = dr.normalize(mi.Vector3f(sampler.next_1d() - 0.5,
+                                     sampler.next_1d() - 0.5, 1))
+        r = mi.Ray3f(o, d)
+
+        pi_ref, pi = reference.ray_intersect_preliminary(r), scene.ray_intersect_preliminary(r)
+        compare_results(pi_ref, pi)
+        if pi_ref.is_valid():
+            assert pi.prim_index == pi_ref.prim_index
+            assert pi.shape_index == pi_ref.shape_index
+            assert dr.allclose(pi.prim_uv, pi_ref.prim_uv)
+        assert scene.ray_test(r) == pi_ref.is_valid()
+        compare_results(scene.ray_intersect_naive(r), scene.ray_intersect(r))
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('n_triangles', [100000, 1000000])
+def test16_triangle_records_large(variant_llvm_ad_rgb, n_triangles):
+    # The scalar kd-tree traversal must find the same intersections with and
+    # without triangle records on large meshes
+    if mi.MI_ENABLE_EMBREE:
+        pytest.skip("EMBREE enabled")
+
+    n_rays = 1024 * 1024
+    rng = mi.PCG32(size=n_rays)
+    o = mi.Point3f(rng.next_float32(), rng.next_float32(), -0.5)
+    d = dr.normalize(mi.Vector3f(rng.next_float32() - 0.5,
+                                 rng.next_float32() - 0.5, 1))
+    ray = mi.Ray3f(o, d)
+
+    results = []
+    for records in [False, True]:
+        scene = build_records_scene(n_triangles, records, packet=False)
+        pi = scene.ray_intersect_preliminary(ray)
+        dr.eval(pi)
+        results.append(pi)
+
+    assert dr.all(results[0].is_valid() == results[1].is_valid())
+    assert dr.allclose(dr.select(results[0].is_valid(), results[0].t, 0),
+                       dr.select(results[1].is_valid(), results[1].t, 0))
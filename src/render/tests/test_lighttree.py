@@ -0,0 +1,124 @@
+import pytest
+import drjit as dr
+import mitsuba as mi
+
+
+def make_scene(emitter_sampling='light_tree', environment=False):
+    from mitsuba import ScalarTransform4f as T
+
+    scene = {
+        'type': 'scene',
+        'floor': {
+            'type': 'rectangle',
+            'to_world': T().scale(10),
+        }
+    }
+
+    # Grid of small area lights facing down onto the floor
+    for i in range(4):
+        for j in range(4):
+            scene[f'light_{i}_{j}'] = {
+                'type': 'rectangle',
+                'to_world': T().translate([3 * i - 4.5, 3 * j - 4.5, 2]) @
+                            T().rotate([1, 0, 0], 180) @ T().scale(0.25),
+                'emitter': {
+                    'type': 'area',
+                    'radiance': { 'type': 'rgb', 'value': 1.0 + i + 2 * j }
+                }
+            }
+
+    scene['point'] = { 'type': 'point', 'position': [1, 1, 1],
+                       'intensity': { 'type': 'rgb', 'value': 5.0 } }
+    scene['sphere'] = { 'type': 'sphere', 'center': [-1, 2, 1], 'radius': 0.2,
+                        'emitter': { 'type': 'area' } }
+
+    if environment:
+        scene['environment'] = { 'type': 'constant' }
+    if emitter_sampling is not None:
+        scene['emitter_sampling'] = emitter_sampling
+
+    return mi.load_dict(scene)
+
+
+def make_references(n):
+    # Points on the floor (with normal) and in free space (without normal)
+    rng = mi.PCG32(size=n)
+    si = dr.zeros(mi.SurfaceInteraction3f, n)
+    si.p = mi.Point3f(rng.next_float32() * 10 - 5, rng.next_float32() * 10 - 5, 0)
+    si.n = dr.select(rng.next_float32() < 0.5, mi.Normal3f(0, 0, 1), mi.Normal3f(0))
+    si.p.z = dr.select(dr.all(si.n == 0), rng.next_float32() * 2, 0)
+    si.wavelengths = dr.zeros(mi.Color0f, n)
+    return si, rng
+
+
+@pytest.mark.parametrize('environment', [False, True])
+def test01_pmf_normalized(variants_vec_rgb, environment):
+    scene = make_scene(environment=environment)
+    tree = scene.light_tree()
+    assert tree is not None
+    assert tree.emitter_count() == 18
+    assert tree.node_count() == 2 * 18 - 1
+
+    si, _ = make_references(64)
+    total = dr.zeros(mi.Float, 64)
+    for emitter in scene.emitters():
+        index = mi.UInt32(emitter.scene_index())
+        total += tree.pdf_emitter(si, index)
+
+    assert dr.allclose(total, 1.0)
+
+
+def test02_sample_matches_pdf(variants_vec_rgb):
+    scene = make_scene(environment=True)
+    tree = scene.light_tree()
+
+    si, rng = make_references(1024)
+    index, reused, pmf = tree.sample_emitter(si, rng.next_float32())
+    assert dr.all((reused >= 0) & (reused < 1))
+    assert dr.allclose(pmf, tree.pdf_emitter(si, index))
+
+
+def test03_direction_pdf_consistent(variants_vec_rgb):
+    # MIS requires that pdf_emitter_direction() matches sampling
+    scene = make_scene()
+
+    si, rng = make_references(1024)
+    ds, spec = scene.sample_emitter_direction(
+        si, mi.Point2f(rng.next_float32(), rng.next_float32()), False)
+
+    valid = (ds.pdf > 0) & ~ds.delta
+    pdf = scene.pdf_emitter_direction(si, ds, valid)
+    assert dr.allclose(dr.select(valid, ds.pdf, 0), pdf, rtol=1e-3)
+
+
+def test04_direct_illumination_unbiased(variants_vec_rgb):
+    # Light tree and flat emitter selection estimate the same irradiance
+    n, spp = 64, 4096
+    results = []
+    for strategy in ['flat', 'light_tree']:
+        scene = make_scene(strategy, environment=True)
+        rng = mi.PCG32(size=n * spp)
+        si = dr.zeros(mi.SurfaceInteraction3f, n * spp)
+        idx = dr.arange(mi.UInt32, n * spp) // spp
+        si.p = mi.Point3f(mi.Float(idx % 8) - 3.5, mi.Float(idx // 8) - 3.5, 0)
+        si.n = mi.Normal3f(0, 0, 1)
+        si.wavelengths = dr.zeros(mi.Color0f, n * spp)
+
+        ds, spec = scene.sample_emitter_direction(
+            si, mi.Point2f(rng.next_float32(), rng.next_float32()), False)
+        value = dr.maximum(dr.dot(ds.d, si.n), 0) * spec.x
+        results.append(dr.block_sum(value, spp) / spp)
+
+    assert dr.allclose(results[0], results[1], rtol=0.05)
+
+
+def test05_invalid_strategy(variant_scalar_rgb):
+    with pytest.raises(RuntimeError, match='emitter sampling strategy'):
+        mi.load_dict({ 'type': 'scene', 'emitter_sampling': 'foo' })
+
+    # Only scenes with many emitters use a light tree with 'auto'
+    assert make_scene('auto').light_tree() is not None
+    assert make_scene('flat').light_tree() is None
+
+    # Scenes keep the flat distribution unless they opt in
+    assert make_scene(None).light_tree() is None
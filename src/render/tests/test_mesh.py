@@ -1331,3 +1331,347 @@ def test35_mesh_vcalls(variants_vec_rgb):
                       == sh.face_normal(idx_i))
         assert dr.all(dr.gather(type(opposite), opposite, i)
                       == sh.opposite_dedge(idx_i))
+
+
+def test36_obj_parallel_parse(variant_scalar_rgb, tmp_path):
+    # Large enough to be split into several chunks that are parsed in parallel
+    import numpy as np
+    n = 300
+    rng = np.random.default_rng(seed=0)
+    coords = rng.random((n * n, 3), dtype=np.float32)
+
+    lines, positions, texcoords = [], [], []
+    faces, index = [], {}
+
+    for i in range(n * n):
+        lines.append('v %.6f %.6f %.6f' % tuple(coords[i]))
+        lines.append('vt %.6f %.6f\r' % tuple(coords[i, :2]))
+        x, y = i % n, i // n
+        if x == 0 or y == 0:
+            continue
+        # Quad referencing vertices from (potentially) earlier chunks
+        quad = [(i - n - 1, i - n), (i - n, i - n), (i, i), (i - 1, i - 1)]
+        lines.append('f ' + ' '.join('%i/%i' % (a + 1, b + 1) for a, b in quad))
+        ids = []
+        for key in quad:
+            if key not in index:
+                index[key] = len(index)
+                positions.append([float('%.6f' % v) for v in coords[key[0]]])
+                uv = [float('%.6f' % v) for v in coords[key[1], :2]]
+                texcoords.append([uv[0], 1.0 - uv[1]])
+            ids.append(index[key])
+        faces.append([ids[0], ids[1], ids[2]])
+        faces.append([ids[0], ids[2], ids[3]])
+
+    filename = str(tmp_path / 'test_mesh-test36_obj_parallel_parse.obj')
+    with open(filename, 'w', newline='\n') as f:
+        f.write('# parallel parsing test\n' + '\n'.join(lines) + '\n')
+
+    m = mi.load_dict({'type': 'obj', 'filename': filename, 'face_normals': True})
+    params = mi.traverse(m)
+
+    assert m.vertex_count() == len(positions)
+    assert m.face_count() == len(faces)
+    assert np.all(np.array(params['faces']) == np.array(faces, dtype=np.uint32).ravel())
+    assert np.allclose(np.array(params['vertex_positions']),
+                       np.array(positions, dtype=np.float32).ravel())
+    assert np.allclose(np.array(params['vertex_texcoords']),
+                       np.array(texcoords, dtype=np.float32).ravel())
+
+
+@fresolver_append_path
+@pytest.mark.parametrize('face_normals', [True, False])
+def test37_mmesh_roundtrip(variants_all_rgb, tmp_path, face_normals):
+    filepath = str(tmp_path / 'test_mesh-test37_mmesh_roundtrip.mmesh')
+    m = mi.load_dict({
+        'type': 'ply',
+        'filename': 'resources/data/tests/ply/rectangle_normals_uv.ply',
+        'face_normals': face_normals
+    })
+    m.add_attribute('vertex_color', 3, [0.5, 0.2, 0.1] * m.vertex_count())
+    m.add_attribute('face_weight', 1, [0.25] * m.face_count())
+    m.write_mmesh(filepath)
+
+    m2 = mi.load_dict({ 'type': 'mmesh', 'filename': filepath })
+    assert m2.vertex_count() == m.vertex_count()
+    assert m2.face_count() == m.face_count()
+    assert m2.has_vertex_normals() == (not face_normals)
+    assert dr.allclose(m2.bbox().min, m.bbox().min)
+    assert dr.allclose(m2.bbox().max, m.bbox().max)
+
+    params, params2 = mi.traverse(m), mi.traverse(m2)
+    for key in ['vertex_positions', 'vertex_texcoords', 'faces',
+                'vertex_color', 'face_weight']:
+        assert dr.all(params[key] == params2[key])
+    if not face_normals:
+        assert dr.allclose(params['vertex_normals'], params2['vertex_normals'])
+
+    # Modifying the mesh must not affect the file
+    params2['vertex_positions'] = dr.zeros(type(params2['vertex_positions']),
+                                           3 * m2.vertex_count())
+    params2.update()
+    m3 = mi.load_dict({ 'type': 'mmesh', 'filename': filepath })
+    assert dr.all(mi.traverse(m3)['vertex_positions'] == params['vertex_positions'])
+
+
+@fresolver_append_path
+def test38_mmesh_to_world(variants_all_rgb, tmp_path):
+    filepath = str(tmp_path / 'test_mesh-test38_mmesh_to_world.mmesh')
+    m = mi.load_dict({
+        'type': 'obj',
+        'filename': 'resources/data/tests/obj/cbox_smallbox.obj'
+    })
+    m.write_mmesh(filepath)
+
+    to_world = mi.ScalarTransform4f().translate([1, 2, 3]) @ \
+               mi.ScalarTransform4f().rotate([0, 1, 0], 30)
+    for mesh_format, filename in [('obj', 'resources/data/tests/obj/cbox_smallbox.obj'),
+                                  ('mmesh', filepath)]:
+        shape = mi.load_dict({ 'type': mesh_format, 'filename': filename,
+                               'to_world': to_world })
+        params = mi.traverse(shape)
+        if mesh_format == 'obj':
+            reference, bbox = params, shape.bbox()
+        else:
+            for key in ['vertex_positions', 'vertex_normals']:
+                assert dr.allclose(params[key], reference[key], atol=1e-4)
+            assert dr.allclose(shape.bbox().min, bbox.min, atol=1e-4)
+            assert dr.allclose(shape.bbox().max, bbox.max, atol=1e-4)
+
+
+@fresolver_append_path
+def test39_mmesh_invalid(variant_scalar_rgb, tmp_path):
+    filepath = str(tmp_path / 'test_mesh-test39_mmesh_invalid.mmesh')
+    with open(filepath, 'wb') as f:
+        f.write(b'MMESH\0\0\0' + b'\0' * 56)
+
+    with pytest.raises(RuntimeError, match='incompatible file version'):
+        mi.load_dict({ 'type': 'mmesh', 'filename': filepath })
+
+    m = mi.load_dict({
+        'type': 'ply',
+        'filename': 'resources/data/tests/ply/rectangle_uv.ply'
+    })
+    m.write_mmesh(filepath)
+    with open(filepath, 'rb') as f:
+        data = f.read()
+    with open(filepath, 'wb') as f:
+        f.write(data[:-16])
+
+    with pytest.raises(RuntimeError, match='is invalid'):
+        mi.load_dict({ 'type': 'mmesh', 'filename': filepath })
+
+    # Corrupt section headers must not wrap around the bounds checks
+    import struct
+    offset = 64 + 40 # Offset, size and dimension of the first section
+    for field, fmt, value in [(0, '<Q', 2**64 - 64), # offset + size wraps around
+                              (8, '<Q', 2**64 - 8),  # size wraps around
+                              (16, '<I', 2**31)]:    # count * dim overflows
+        corrupt = bytearray(data)
+        struct.pack_into(fmt, corrupt, offset + field, value)
+        with open(filepath, 'wb') as f:
+            f.write(corrupt)
+
+        with pytest.raises(RuntimeError, match='is invalid'):
+            mi.load_dict({ 'type': 'mmesh', 'filename': filepath })
+
+
+@pytest.mark.slow
+def test40_mmesh_load_large(variant_scalar_rgb, tmp_path):
+    import numpy as np
+
+    # Regular grid with ~2M triangles
+    n = 1024
+    x, y = np.meshgrid(np.linspace(0, 1, n, dtype=np.float32),
+                       np.linspace(0, 1, n, dtype=np.float32))
+    positions = np.stack([x.ravel(), y.ravel(), np.zeros(n * n, np.float32)], axis=1)
+    i = np.arange(n * n, dtype=np.uint32).reshape(n, n)[:-1, :-1].ravel()
+    faces = np.concatenate([np.stack([i, i + 1, i + n], axis=1),
+                            np.stack([i + 1, i + n + 1, i + n], axis=1)])
+
+    m = mi.Mesh('grid', n * n, len(faces))
+    params = mi.traverse(m)
+    params['vertex_positions'] = positions.ravel()
+    params['faces'] = faces.ravel()
+    params.update()
+    m.recompute_vertex_normals()
+
+    filenames = { 'ply': str(tmp_path / 'grid.ply'),
+                  'mmesh': str(tmp_path / 'grid.mmesh') }
+    m.write_ply(filenames['ply'])
+    m.write_mmesh(filenames['mmesh'])
+
+    # Both formats must reproduce the source mesh
+    for mesh_format, filename in filenames.items():
+        shape = mi.load_dict({ 'type': mesh_format, 'filename': filename })
+        assert shape.vertex_count() == m.vertex_count()
+        assert shape.face_count() == m.face_count()
+        params_shape = mi.traverse(shape)
+        assert dr.all(params_shape['faces'] == params['faces'])
+        for key in ['vertex_positions', 'vertex_normals']:
+            assert dr.allclose(params_shape[key], params[key])
+
+
+@fresolver_append_path
+@pytest.mark.parametrize('mesh_format, filename', [
+    ('ply', 'resources/data/common/meshes/bunny_lowres.ply'),
+    ('obj', 'resources/data/common/meshes/sphere.obj'),
+    ('ply', 'resources/data/tests/ply/rectangle_normals_uv.ply'),
+])
+def test41_resource_cache(variants_all_rgb, mesh_format, filename):
+    T = mi.ScalarTransform4f
+    to_worlds = [
+        T(),
+        T().translate([1, 2, 3]) @ T().rotate([0, 1, 0], 30),
+        T().scale([1, 2, 0.5])
+    ]
+
+    def load():
+        scene = { 'type': 'scene' }
+        for i, to_world in enumerate(to_worlds):
+            scene[f'shape_{i}'] = { 'type': mesh_format, 'filename': filename,
+                                    'to_world': to_world }
+        return mi.load_dict(scene, parallel=False)
+
+    mi.ResourceCache.clear()
+    mi.ResourceCache.reset_statistics()
+    shapes = load().shapes()
+    stats = mi.ResourceCache.statistics()
+    assert stats['misses'] == 1 and stats['hits'] == 2
+
+    # Compare against meshes that were loaded independently
+    enabled = mi.ResourceCache.enabled()
+    mi.ResourceCache.set_enabled(False)
+    try:
+        references = load().shapes()
+    finally:
+        mi.ResourceCache.set_enabled(enabled)
+
+    for shape, reference in zip(shapes, references):
+        assert shape.face_count() == reference.face_count()
+        params, params_ref = mi.traverse(shape), mi.traverse(reference)
+        for key in ['vertex_positions', 'vertex_normals', 'vertex_texcoords', 'faces']:
+            if key in params_ref:
+                assert dr.allclose(params[key], params_ref[key], atol=1e-4)
+        assert dr.allclose(shape.bbox().min, reference.bbox().min, atol=1e-4)
+        assert dr.allclose(shape.bbox().max, reference.bbox().max, atol=1e-4)
+
+
+@pytest.mark.slow
+def test42_resource_cache_large(variant_scalar_rgb, tmp_path):
+    import numpy as np
+
+    # Regular grid with ~500K triangles, placed 32 times
+    n = 512
+    x, y = np.meshgrid(np.linspace(0, 1, n, dtype=np.float32),
+                       np.linspace(0, 1, n, dtype=np.float32))
+    positions = np.stack([x.ravel(), y.ravel(), np.zeros(n * n, np.float32)], axis=1)
+    i = np.arange(n * n, dtype=np.uint32).reshape(n, n)[:-1, :-1].ravel()
+    faces = np.concatenate([np.stack([i, i + 1, i + n], axis=1),
+                            np.stack([i + 1, i + n + 1, i + n], axis=1)])
+
+    m = mi.Mesh('grid', n * n, len(faces))
+    params = mi.traverse(m)
+    params['vertex_positions'] = positions.ravel()
+    params['faces'] = faces.ravel()
+    params.update()
+    filename = str(tmp_path / 'grid.ply')
+    m.write_ply(filename)
+
+    scene = { 'type': 'scene' }
+    for k in range(32):
+        scene[f'grid_{k}'] = {
+            'type': 'ply', 'filename': filename,
+            'to_world': mi.ScalarTransform4f().translate([k, 0, 0])
+        }
+
+    # With the cache, the file must be read once and shared by all shapes
+    # without changing the geometry
+    enabled = mi.ResourceCache.enabled()
+    try:
+        shapes = []
+        for value in [False, True]:
+            mi.ResourceCache.set_enabled(value)
+            mi.ResourceCache.clear()
+            mi.ResourceCache.reset_statistics()
+            shapes.append(mi.load_dict(scene, parallel=False).shapes())
+        stats = mi.ResourceCache.statistics()
+        assert stats['misses'] == 1 and stats['hits'] == 31
+    finally:
+        mi.ResourceCache.set_enabled(enabled)
+
+    for shape, reference in zip(shapes[1], shapes[0]):
+        assert shape.face_count() == reference.face_count()
+        params, params_ref = mi.traverse(shape), mi.traverse(reference)
+        assert dr.all(params['faces'] == params_ref['faces'])
+        assert dr.allclose(params['vertex_positions'], params_ref['vertex_positions'])
+        assert dr.allclose(shape.bbox().min, reference.bbox().min)
+        assert dr.allclose(shape.bbox().max, reference.bbox().max)
+
+
+@fresolver_append_path
+def test43_resource_cache_serialized_name(variant_scalar_rgb):
+    # Names read from the file must not depend on whether the cache was hit
+    def load():
+        scene = { 'type': 'scene' }
+        for i in range(2):
+            scene[f'shape_{i}'] = {
+                'type': 'serialized',
+                'filename': 'resources/data/tests/serialized/rectangle_normals.serialized'
+            }
+        return mi.load_dict(scene, parallel=False).shapes()
+
+    def name(shape):
+        return [l for l in str(shape).splitlines() if 'name = ' in l][0]
+
+    mi.ResourceCache.clear()
+    shapes = load()
+    enabled = mi.ResourceCache.enabled()
+    mi.ResourceCache.set_enabled(False)
+    try:
+        reference = load()[0]
+    finally:
+        mi.ResourceCache.set_enabled(enabled)
+
+    assert name(shapes[0]) == name(shapes[1]) == name(reference)
+
+
+@pytest.mark.parametrize('thread_count', [2, 3])
+def test44_resource_cache_parallel_obj(variant_scalar_rgb, tmp_path, thread_count):
+    # Shapes that share an OBJ file, which is large enough to be parsed in
+    # parallel, are instantiated in parallel by a small thread pool
+    import numpy as np
+    n = 400
+    rng = np.random.default_rng(seed=0)
+    lines = ['v %.6f %.6f %.6f' % tuple(p) for p in rng.random((n * n, 3))]
+    lines += ['f %i %i %i' % (i + 1, i + 2, i + n + 1)
+              for i in range(n * (n - 1) - 1)]
+    filename = str(tmp_path / 'test_mesh-test44_resource_cache_parallel_obj.obj')
+    with open(filename, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+    scene = { 'type': 'scene' }
+    for k in range(8):
+        scene[f'shape_{k}'] = {
+            'type': 'obj', 'filename': filename,
+            'to_world': mi.ScalarTransform4f().translate([k, 0, 0])
+        }
+
+    old_thread_count = mi.Thread.thread_count()
+    mi.Thread.set_thread_count(thread_count)
+    try:
+        mi.ResourceCache.clear()
+        shapes = mi.load_dict(scene).shapes()
+    finally:
+        mi.Thread.set_thread_count(old_thread_count)
+
+    reference = mi.load_dict(scene['shape_0'])
+    params_ref = mi.traverse(reference)
+    positions = np.array(params_ref['vertex_positions']).reshape(-1, 3)
+    assert len(shapes) == 8
+    for shape in shapes:
+        params = mi.traverse(shape)
+        offset = np.array(params['vertex_positions']).reshape(-1, 3) - positions
+        assert np.all(np.array(params['faces']) == np.array(params_ref['faces']))
+        assert np.allclose(offset[:, 1:], 0, atol=1e-5)
+        assert np.allclose(offset[:, 0], offset[0, 0], atol=1e-5)
@@ -344,3 +344,80 @@ def test_enable_embree_robust_flag(variants_any_llvm):
     scene = mi.load_dict({'type': 'scene', 'mesh': mesh,
                           'embree_use_robust_intersections': True})
     assert dr.all(scene.ray_intersect(ray).is_valid())
+
+
+def make_cube_row(n):
+    from mitsuba import ScalarTransform4f as T
+    scene = { 'type': 'scene' }
+    for i in range(n):
+        scene[f'cube_{i}'] = {
+            'type': 'cube',
+            'to_world': T().translate([3 * i, 0, 0])
+        }
+    return mi.load_dict(scene)
+
+
+def test12_update_single_mesh(variants_all_backends_once):
+    # Only one of several meshes deforms: the other ones must remain intact
+    import numpy as np
+    n = 4
+    scene = make_cube_row(n)
+    params = mi.traverse(scene)
+
+    def trace():
+        if mi.variant().startswith('scalar'):
+            return [scene.ray_intersect(mi.Ray3f([3 * i, 0, 10], [0, 0, -1])).t
+                    for i in range(n)]
+        x = dr.arange(mi.Float, n) * 3
+        ray = mi.Ray3f(mi.Point3f(x, 0, 10), mi.Vector3f(0, 0, -1))
+        return scene.ray_intersect(ray).t
+
+    assert dr.allclose(trace(), [9, 9, 9, 9])
+
+    for frame in range(1, 3):
+        positions = np.array(params['cube_1.vertex_positions']).reshape(-1, 3)
+        positions[:, 2] += 0.5
+        params['cube_1.vertex_positions'] = positions.ravel()
+        params.update()
+        assert dr.allclose(trace(), [9, 9 - 0.5 * frame, 9, 9])
+
+    # Topology change: remove the top of the third cube
+    positions = np.array(params['cube_2.vertex_positions']).reshape(-1, 3)
+    faces = np.array(params['cube_2.faces']).reshape(-1, 3)
+    top = np.all(np.abs(positions[faces, 2] - 1) < 1e-6, axis=1)
+    params['cube_2.faces'] = faces[~top].ravel()
+    params.update()
+    assert dr.allclose(trace(), [9, 8, 11, 9])
+
+
+@pytest.mark.slow
+@pytest.mark.parametrize('n', [10, 100, 1000])
+def test13_update_single_mesh_large(variant_scalar_rgb, n):
+    # Updating one of n meshes, or all of them, must give the same
+    # intersections as a scene that is built from the deformed meshes
+    import numpy as np
+    scene = make_cube_row(n)
+    params = mi.traverse(scene)
+
+    def check():
+        reference = mi.load_dict({ 'type': 'scene',
+                                   **{ f'cube_{i}': shape for i, shape in
+                                       enumerate(scene.shapes()) } })
+        assert dr.allclose(scene.bbox().min, reference.bbox().min)
+        assert dr.allclose(scene.bbox().max, reference.bbox().max)
+        for i in range(n):
+            for dx in [-0.5, 0, 0.5]:
+                ray = mi.Ray3f([3 * i + dx, 0.25, 10], [0, 0, -1])
+                si, si_ref = scene.ray_intersect(ray), reference.ray_intersect(ray)
+                assert si.is_valid() == si_ref.is_valid()
+                assert dr.allclose(si.t, si_ref.t)
+
+    frames = 10
+    for deforming in [[0], range(n)]:
+        for frame in range(frames):
+            for i in deforming:
+                positions = np.array(params[f'cube_{i}.vertex_positions']).reshape(-1, 3)
+                positions[:, 2] += 0.01
+                params[f'cube_{i}.vertex_positions'] = positions.ravel()
+            params.update()
+        check()
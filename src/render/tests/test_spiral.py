@@ -77,3 +77,49 @@ def test03_normal_film(variant_scalar_rgb):
     # Resetting and re-querying the blocks should yield the exact same results.
     s.reset()
     check_first_blocks(extract_blocks(s), expected, n_total=110)
+
+
+def test04_multiple_passes(variant_scalar_rgb):
+    f = make_film(318, 322)
+    s = mi.Spiral(f.size(), f.crop_offset(), 32, 3)
+    n = s.block_count()
+    assert n == 110
+
+    blocks = extract_blocks(s)
+    assert len(blocks) == 3 * n
+
+    # Every pass visits the blocks in the same spiral order
+    for p in range(1, 3):
+        for i in range(n):
+            assert dr.all(blocks[i][0] == blocks[p * n + i][0])
+            assert dr.all(blocks[i][1] == blocks[p * n + i][1])
+
+    # Block identifiers are unique across passes
+    ids = sorted(int(b[2]) for b in blocks)
+    assert ids == list(range(3 * n))
+
+
+def test05_concurrent_next_block(variant_scalar_rgb):
+    from threading import Thread
+
+    f = make_film(318, 322)
+    s = mi.Spiral(f.size(), f.crop_offset(), 8, 2)
+    n = s.block_count()
+
+    results = [[] for _ in range(4)]
+
+    def worker(out):
+        b = s.next_block()
+        while np.prod(b[1]) > 0:
+            out.append(int(b[2]))
+            b = s.next_block()
+
+    threads = [Thread(target=worker, args=(r, )) for r in results]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    # Each block of each pass must be handed out exactly once
+    ids = sorted(i for r in results for i in r)
+    assert ids == list(range(2 * n))
@@ -46,3 +46,63 @@ def test03_max_per_channel(variants_all_scalar, tmpdir, np_rng):
     grid = mi.VolumeGrid(tmp_file)
     mi_max_per_channel = grid.max_per_channel()
     assert dr.allclose(np_max_per_channel, mi_max_per_channel)
+
+
+@pytest.mark.parametrize('channels', [1, 3, 6])
+def test04_bulk_read(variants_all_scalar, tmpdir, np_rng, channels):
+    # Large enough to span several parallel work units, with a ragged tail
+    tmp_file = os.path.join(str(tmpdir), "out.vol")
+    data = np_rng.random((37, 61, 83, channels))
+    mi.VolumeGrid(data).write(tmp_file)
+    np_max_per_channel = np.max(data, axis=(0, 1, 2))
+
+    # Memory-mapped loading from a path
+    grid = mi.VolumeGrid(tmp_file)
+    assert dr.allclose(np.array(grid), data)
+    assert dr.allclose(grid.max_per_channel(), np_max_per_channel)
+    assert dr.allclose(grid.max(), np.max(data))
+
+    # Bulk loading from a stream
+    stream = mi.FileStream(tmp_file)
+    grid = mi.VolumeGrid(stream)
+    stream.close()
+    assert dr.allclose(np.array(grid), data)
+    assert dr.allclose(grid.max_per_channel(), np_max_per_channel)
+    assert dr.allclose(grid.max(), np.max(data))
+
+
+def test05_truncated_file(variants_all_scalar, tmpdir, np_rng):
+    tmp_file = os.path.join(str(tmpdir), "out.vol")
+    mi.VolumeGrid(np_rng.random((4, 8, 16, 3))).write(tmp_file)
+    with open(tmp_file, 'r+b') as f:
+        f.truncate(os.path.getsize(tmp_file) - 4)
+
+    with pytest.raises(RuntimeError):
+        mi.VolumeGrid(tmp_file)
+
+
+@pytest.mark.slow
+def test06_load_large(variants_all_scalar, tmpdir):
+    # A 4 GiB grid, loaded in many parallel work units
+    res = 1024
+    tmp_file = os.path.join(str(tmpdir), "large.vol")
+    data = np.zeros((res, res, res, 1), dtype=np.float32)
+    data[res // 2, res // 3, res // 4, 0] = 2.5
+    data[-1, -1, -1, 0] = 1.5
+    mi.VolumeGrid(data).write(tmp_file)
+    del data
+
+    for source in ['path', 'stream']:
+        if source == 'path':
+            grid = mi.VolumeGrid(tmp_file)
+        else:
+            stream = mi.FileStream(tmp_file)
+            grid = mi.VolumeGrid(stream)
+            stream.close()
+
+        assert dr.allclose(grid.max(), 2.5)
+        loaded = np.asarray(grid)
+        assert loaded[res // 2, res // 3, res // 4, 0] == 2.5
+        assert loaded[-1, -1, -1, 0] == 1.5
+        assert np.count_nonzero(loaded) == 2
+        del grid, loaded
@@ -56,6 +56,12 @@ Volume<Float, Spectrum>::max_per_channel(ScalarFloat * /*out*/) const {
     NotImplementedError("max_per_channel");
 }
 
+MI_VARIANT void
+Volume<Float, Spectrum>::max_per_cell(const ScalarVector3i &resolution,
+                                      ScalarFloat *out) const {
+    std::fill(out, out + dr::prod(ScalarVector3u(resolution)), max());
+}
+
 MI_VARIANT typename Volume<Float, Spectrum>::ScalarVector3i
 Volume<Float, Spectrum>::resolution() const {
     return ScalarVector3i(1, 1, 1);
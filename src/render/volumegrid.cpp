@@ -2,16 +2,114 @@
 #include <mitsuba/core/stream.h>
 #include <mitsuba/core/logger.h>
 #include <mitsuba/core/fstream.h>
+#include <mitsuba/core/mmap.h>
+#include <mitsuba/core/timer.h>
 #include <mitsuba/core/util.h>
+#include <nanothread/nanothread.h>
+#include <drjit/packet.h>
+#include <cstring>
+#include <mutex>
+#include <numeric>
 
 NAMESPACE_BEGIN(mitsuba)
 
+/// Number of values per parallel work unit when processing the voxel data
+static constexpr size_t volume_grid_grain_size = 1 << 18;
+
+/**
+ * \brief Compute the per-channel maxima of interleaved voxel data in
+ * parallel, optionally copying it from \c src to \c dst on the way
+ *
+ * Each work unit handles a range of values whose length is a multiple of
+ * both the SIMD width and the channel count, so that every SIMD lane always
+ * sees values of the same channel.
+ */
+template <typename Value>
+static void volume_grid_max(const Value *src, Value *dst, size_t count,
+                            size_t channels, Value *max_per_channel) {
+    using Packet = dr::Packet<Value, 16>;
+    constexpr size_t Lanes = Packet::Size;
+
+    size_t period = channels * Lanes / std::gcd(channels, Lanes),
+           grain  = std::max(period, volume_grid_grain_size / period * period),
+           block_count = (count + grain - 1) / grain;
+
+    for (size_t ch = 0; ch < channels; ++ch)
+        max_per_channel[ch] = -dr::Infinity<Value>;
+
+    std::mutex mutex;
+    dr::parallel_for(
+        dr::blocked_range<size_t>(0, block_count, 1),
+        [&](const dr::blocked_range<size_t> &range) {
+            std::vector<Packet> acc(period / Lanes, Packet(-dr::Infinity<Value>));
+            std::vector<Value> local(channels, -dr::Infinity<Value>);
+
+            for (size_t block = range.begin(); block != range.end(); ++block) {
+                size_t start = block * grain,
+                       end   = std::min(count, start + grain),
+                       i     = start;
+
+                const Value *data = src;
+                if (dst) {
+                    memcpy(dst + start, src + start, (end - start) * sizeof(Value));
+                    data = dst;
+                }
+
+                for (; i + period <= end; i += period) {
+                    for (size_t k = 0; k < acc.size(); ++k)
+                        acc[k] = dr::maximum(acc[k], dr::load<Packet>(data + i + k * Lanes));
+                }
+
+                for (; i < end; ++i)
+                    local[i % channels] = dr::maximum(local[i % channels], data[i]);
+            }
+
+            for (size_t k = 0; k < acc.size(); ++k) {
+                for (size_t l = 0; l < Lanes; ++l) {
+                    size_t ch = (k * Lanes + l) % channels;
+                    local[ch] = dr::maximum(local[ch], acc[k].entry(l));
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(mutex);
+            for (size_t ch = 0; ch < channels; ++ch)
+                max_per_channel[ch] = dr::maximum(max_per_channel[ch], local[ch]);
+        }
+    );
+}
+
 MI_VARIANT
 VolumeGrid<Float, Spectrum>::VolumeGrid(Stream *stream) { read(stream); }
 
 MI_VARIANT
 VolumeGrid<Float, Spectrum>::VolumeGrid(const fs::path &filename) {
     ref<FileStream> fs = new FileStream(filename);
+
+    /* Memory-map the file if the payload can be used as-is, i.e. in single
+       precision variants and if no endianness conversion is needed */
+    if constexpr (std::is_same_v<ScalarFloat, float>) {
+        if (!fs->needs_endianness_swap()) {
+            Timer timer;
+            read_header(fs);
+            size_t offset = fs->tell(),
+                   count  = dr::prod(m_size) * (size_t) m_channel_count;
+            fs->close();
+
+            ref<MemoryMappedFile> mmap = new MemoryMappedFile(filename);
+            if (mmap->size() < offset + count * sizeof(float))
+                Throw("Volume file \"%s\" is truncated (expected %s of "
+                      "volume data)!", filename.string(),
+                      util::mem_string(count * sizeof(float)));
+
+            m_data = std::unique_ptr<ScalarFloat[]>(new ScalarFloat[count]);
+            volume_grid_max((const float *) ((const uint8_t *) mmap->data() + offset),
+                            m_data.get(), count, m_channel_count,
+                            m_max_per_channel.data());
+            finish_read(timer.value());
+            return;
+        }
+    }
+
     read(fs);
 }
 
@@ -26,7 +124,7 @@ VolumeGrid<Float, Spectrum>::VolumeGrid(ScalarVector3u size,
 }
 
 MI_VARIANT
-void VolumeGrid<Float, Spectrum>::read(Stream *stream) {
+void VolumeGrid<Float, Spectrum>::read_header(Stream *stream) {
     char header[3];
     stream->read(header, 3);
 
@@ -52,7 +150,6 @@ void VolumeGrid<Float, Spectrum>::read(Stream *stream) {
     m_size.y() = uint32_t(size_y);
     m_size.z() = uint32_t(size_z);
 
-    size_t size = dr::prod(m_size);
     int32_t channel_count;
     stream->read(channel_count);
     m_channel_count = channel_count;
@@ -63,23 +160,46 @@ void VolumeGrid<Float, Spectrum>::read(Stream *stream) {
     m_bbox = ScalarBoundingBox3f(ScalarPoint3f(dims[0], dims[1], dims[2]),
                                  ScalarPoint3f(dims[3], dims[4], dims[5]));
 
-    m_max = -dr::Infinity<ScalarFloat>;
-    m_max_per_channel.resize(m_channel_count, -dr::Infinity<ScalarFloat>);
-
-    m_data = std::unique_ptr<ScalarFloat[]>(new ScalarFloat[size * m_channel_count]);
-    size_t k = 0;
-    for (size_t i = 0; i < size; ++i) {
-        for (size_t j = 0; j < m_channel_count; ++j) {
-            float val;
-            stream->read(val);
-            m_data[k] = val;
-            m_max     = dr::maximum(m_max, val);
-            m_max_per_channel[j] = dr::maximum(m_max_per_channel[j], val);
-            ++k;
-        }
+    m_max_per_channel.resize(m_channel_count);
+}
+
+MI_VARIANT
+void VolumeGrid<Float, Spectrum>::read(Stream *stream) {
+    Timer timer;
+    read_header(stream);
+
+    size_t count = dr::prod(m_size) * (size_t) m_channel_count;
+    m_data = std::unique_ptr<ScalarFloat[]>(new ScalarFloat[count]);
+
+    // Read the entire payload at once (the file stores single precision data)
+    if constexpr (std::is_same_v<ScalarFloat, float>) {
+        stream->read_array(m_data.get(), count);
+    } else {
+        std::unique_ptr<float[]> data(new float[count]);
+        stream->read_array(data.get(), count);
+        dr::parallel_for(
+            dr::blocked_range<size_t>(0, count, volume_grid_grain_size),
+            [&](const dr::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    m_data[i] = (ScalarFloat) data[i];
+            }
+        );
     }
-    Log(Debug, "Loaded grid volume data from file: dimensions %s, max value %f",
-        m_size, m_max);
+
+    volume_grid_max<ScalarFloat>(m_data.get(), nullptr, count, m_channel_count,
+                                 m_max_per_channel.data());
+    finish_read(timer.value());
+}
+
+MI_VARIANT
+void VolumeGrid<Float, Spectrum>::finish_read(size_t time_ms) {
+    m_max = -dr::Infinity<ScalarFloat>;
+    for (ScalarFloat value : m_max_per_channel)
+        m_max = dr::maximum(m_max, value);
+
+    Log(Debug, "Loaded grid volume data (dimensions %s, max value %f, %s, took %s)",
+        m_size, m_max, util::mem_string(buffer_size()),
+        util::time_string((float) time_ms));
 }
 
 MI_VARIANT
@@ -0,0 +1,425 @@
+#include <mitsuba/render/mesh.h>
+#include <mitsuba/core/fresolver.h>
+#include <mitsuba/core/mmap.h>
+#include <mitsuba/core/properties.h>
+#include <mitsuba/core/timer.h>
+#include <mitsuba/core/profiler.h>
+#include <nanothread/nanothread.h>
+#include <cstring>
+#include <mutex>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**!
+
+.. _shape-mmesh:
+
+Memory-mapped mesh loader (:monosp:`mmesh`)
+-------------------------------------------
+
+.. pluginparameters::
+ :extra-rows: 5
+
+ * - filename
+   - |string|
+   - Filename of the :monosp:`.mmesh` file that should be loaded
+
+ * - face_normals
+   - |bool|
+   - When set to |true|, any existing or computed vertex normals are
+     discarded and *face normals* will instead be used during rendering.
+     This gives the rendered object a faceted appearance. (Default: |false|)
+
+ * - flip_normals
+   - |bool|
+   - Is the mesh inverted, i.e. should the normal vectors be flipped? (Default:|false|, i.e.
+     the normals point outside)
+
+ * - to_world
+   - |transform|
+   - Specifies an optional linear object-to-world transformation.
+     (Default: none, i.e. object space = world space)
+
+ * - vertex_count
+   - |int|
+   - Total number of vertices
+   - |exposed|
+
+ * - face_count
+   - |int|
+   - Total number of faces
+   - |exposed|
+
+ * - faces
+   - :paramtype:`uint32[]`
+   - Face indices buffer (flatten)
+   - |exposed|
+
+ * - vertex_positions
+   - :paramtype:`float[]`
+   - Vertex positions buffer (flatten) pre-multiplied by the object-to-world transformation.
+   - |exposed|, |differentiable|, |discontinuous|
+
+ * - vertex_normals
+   - :paramtype:`float[]`
+   - Vertex normals buffer (flatten)  pre-multiplied by the object-to-world transformation.
+   - |exposed|, |differentiable|, |discontinuous|
+
+ * - vertex_texcoords
+   - :paramtype:`float[]`
+   - Vertex texcoords buffer (flatten)
+   - |exposed|, |differentiable|
+
+ * - (Mesh attribute)
+   - :paramtype:`float[]`
+   - Mesh attribute buffer (flatten)
+   - |exposed|, |differentiable|
+
+The :monosp:`mmesh` format stores an indexed triangle mesh as uncompressed
+arrays that exactly match the internally used data structures. Instead of
+being parsed or decompressed, the file is mapped into memory and its arrays
+are directly used as the buffers of the mesh on the CPU. Loading is therefore
+essentially free, and the operating system only reads the parts of the file
+that are actually accessed. The mapping is private: modifying the mesh (e.g.
+via :monosp:`mi.traverse()`) never changes the file.
+
+When a :monosp:`to_world` transformation is specified, the vertex positions
+and normals are transformed in parallel while loading. In CUDA variants, the
+arrays are copied to the GPU.
+
+Meshes loaded from any other format can be converted using
+:monosp:`Mesh.write_mmesh()`:
+
+.. code-block:: python
+
+    mesh = mi.load_dict({ 'type': 'serialized', 'filename': 'shape.serialized' })
+    mesh.write_mmesh('shape.mmesh')
+
+Format description
+******************
+
+All fields use the little endian encoding. The file starts with a 64 byte
+header:
+
+.. figtable::
+    :label: table-mmesh-header
+
+    .. list-table::
+        :widths: 20 80
+        :header-rows: 1
+
+        * - Type
+          - Content
+        * - :monosp:`char[8]`
+          - File format identifier: :code:`MMESH` followed by three zero bytes
+        * - :monosp:`uint32`
+          - File version identifier. Currently set to :code:`1`
+        * - :monosp:`uint32`
+          - Flags. :code:`0x0010`: use face normals instead of smoothly
+            interpolated vertex normals. :code:`0x0020`: color attributes
+            store spectral model coefficients instead of RGB values
+        * - :monosp:`uint64`
+          - Number of vertices in the mesh
+        * - :monosp:`uint64`
+          - Number of triangles in the mesh
+        * - :monosp:`float32[6]`
+          - Bounding box of the vertex positions (minimum, then maximum)
+        * - :monosp:`uint32`
+          - Number of sections
+        * - :monosp:`uint32`
+          - Reserved (zero)
+
+It is followed by a table with a 64 byte entry per section:
+
+.. figtable::
+    :label: table-mmesh-section
+
+    .. list-table::
+        :widths: 20 80
+        :header-rows: 1
+
+        * - Type
+          - Content
+        * - :monosp:`char[40]`
+          - Null-terminated name: :code:`vertex_positions`, :code:`vertex_normals`,
+            :code:`vertex_texcoords`, :code:`faces`, or the name of a mesh attribute
+            (starting with :code:`vertex_` or :code:`face_`)
+        * - :monosp:`uint64`
+          - File offset of the section data (a multiple of 64 bytes)
+        * - :monosp:`uint64`
+          - Size of the section data in bytes
+        * - :monosp:`uint32`
+          - Number of components per vertex or face
+        * - :monosp:`uint32`
+          - Reserved (zero)
+
+The data of each section is an array of :monosp:`float32` values, except for
+:code:`faces`, which contains :monosp:`uint32` vertex indices.
+
+.. tabs::
+    .. code-tab:: xml
+        :name: mmesh
+
+        <shape type="mmesh">
+            <string name="filename" value="shape.mmesh"/>
+            <bsdf type='diffuse'/>
+        </shape>
+
+    .. code-tab:: python
+
+        'type': 'mmesh',
+        'filename': 'shape.mmesh',
+        'material': {
+            'type': 'diffuse',
+        }
+ */
+
+#define MI_MMESH_VERSION   1
+#define MI_MMESH_ALIGNMENT 64
+
+template <typename Float, typename Spectrum>
+class MappedMesh final : public Mesh<Float, Spectrum> {
+public:
+    MI_IMPORT_BASE(Mesh, m_name, m_bbox, m_to_world, m_vertex_count,
+                   m_face_count, m_vertex_positions, m_vertex_normals,
+                   m_vertex_texcoords, m_faces, m_face_normals,
+                   m_mesh_attributes, recompute_vertex_normals, initialize)
+    MI_IMPORT_TYPES()
+
+    using typename Base::ScalarSize;
+    using typename Base::ScalarIndex;
+    using typename Base::InputFloat;
+    using typename Base::FloatStorage;
+    using typename Base::InputPoint3f;
+    using typename Base::InputNormal3f;
+    using typename Base::MeshAttributeType;
+
+    struct Header {
+        char identifier[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t vertex_count;
+        uint64_t face_count;
+        float bbox_min[3];
+        float bbox_max[3];
+        uint32_t section_count;
+        uint32_t reserved;
+    };
+
+    struct Section {
+        char name[40];
+        uint64_t offset;
+        uint64_t size;
+        uint32_t dim;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 64 && sizeof(Section) == 64,
+                  "Unexpected layout of the mmesh header!");
+
+    MappedMesh(const Properties &props) : Base(props) {
+        auto fail = [&](const std::string &descr) {
+            Throw("Error while loading mmesh file \"%s\": %s!", m_name, descr);
+        };
+
+        auto fs = Thread::thread()->file_resolver();
+        fs::path file_path = fs->resolve(props.string("filename"));
+        m_name = file_path.filename().string();
+
+        Log(Debug, "Loading mesh from \"%s\" ..", m_name);
+        if (!fs::exists(file_path))
+            fail("file not found");
+
+        if (Struct::host_byte_order() != Struct::ByteOrder::LittleEndian)
+            fail("this format is only supported on little endian machines");
+
+        ScopedPhase phase(ProfilerPhase::LoadGeometry);
+        Timer timer;
+
+        /* Map the file privately: the mesh may later modify its buffers in
+           place (e.g. when recomputing normals) without touching the file */
+        m_mmap = MemoryMappedFile::map_private(file_path);
+        uint8_t *data = (uint8_t *) m_mmap->data();
+        size_t file_size = m_mmap->size();
+
+        if (file_size < sizeof(Header))
+            fail("file is truncated");
+
+        const Header &header = *(const Header *) data;
+        if (memcmp(header.identifier, "MMESH\0\0\0", 8) != 0)
+            fail("encountered an invalid file format");
+        if (header.version != MI_MMESH_VERSION)
+            fail("encountered an incompatible file version");
+        if (header.vertex_count > 0xFFFFFFFFull || header.face_count > 0xFFFFFFFFull)
+            fail("the mesh has too many vertices or faces");
+        if (sizeof(Header) + header.section_count * sizeof(Section) > file_size)
+            fail("file is truncated");
+
+        m_vertex_count = (ScalarSize) header.vertex_count;
+        m_face_count   = (ScalarSize) header.face_count;
+        if (header.flags & 0x0010)
+            m_face_normals = true;
+
+        InputFloat *positions = nullptr, *normals = nullptr;
+        bool has_faces = false;
+
+        const Section *sections = (const Section *) (data + sizeof(Header));
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            const Section &section = sections[i];
+            std::string name(section.name, strnlen(section.name, sizeof(section.name)));
+
+            bool is_vertex = name.rfind("vertex_", 0) == 0,
+                 is_face   = name == "faces" || name.rfind("face_", 0) == 0;
+            if (!is_vertex && !is_face) {
+                Log(Warn, "\"%s\": skipping unknown section \"%s\"", m_name, name);
+                continue;
+            }
+
+            /* Validate the section without risking overflows: the dimension
+               is capped by the file size before computing the section size */
+            size_t elements = is_vertex ? m_vertex_count : m_face_count;
+            if (section.dim == 0 ||
+                section.dim > file_size / sizeof(InputFloat) / std::max(elements, (size_t) 1))
+                fail(tfm::format("section \"%s\" is invalid", name));
+
+            size_t count = elements * section.dim;
+            if (section.size != count * sizeof(InputFloat) ||
+                section.offset % MI_MMESH_ALIGNMENT != 0 ||
+                section.offset > file_size ||
+                section.size > file_size - section.offset)
+                fail(tfm::format("section \"%s\" is invalid", name));
+
+            uint32_t expected_dim = 0;
+            if (name == "vertex_positions" || name == "vertex_normals" || name == "faces")
+                expected_dim = 3;
+            else if (name == "vertex_texcoords")
+                expected_dim = 2;
+            if (expected_dim != 0 && section.dim != expected_dim)
+                fail(tfm::format("section \"%s\" has an invalid dimension", name));
+
+            void *ptr = data + section.offset;
+            if (name == "vertex_positions") {
+                positions = (InputFloat *) ptr;
+            } else if (name == "vertex_normals") {
+                normals = (InputFloat *) ptr;
+            } else if (name == "vertex_texcoords") {
+                m_vertex_texcoords = map_buffer<FloatStorage>(ptr, count);
+            } else if (name == "faces") {
+                m_faces = map_buffer<DynamicBuffer<UInt32>>(ptr, count);
+                has_faces = true;
+            } else {
+                // In spectral modes, convert RGB colors to srgb model coefficients
+                if constexpr (is_spectral_v<Spectrum>) {
+                    if (section.dim == 3 && name.find("color") != std::string::npos &&
+                        !(header.flags & 0x0020)) {
+                        InputFloat *value = (InputFloat *) ptr;
+                        for (size_t j = 0; j < count; j += 3)
+                            dr::store(value + j, srgb_model_fetch(
+                                dr::load<Color<InputFloat, 3>>(value + j)));
+                    }
+                }
+
+                m_mesh_attributes.insert(
+                    { name, { section.dim,
+                              is_vertex ? MeshAttributeType::Vertex
+                                        : MeshAttributeType::Face,
+                              map_buffer<FloatStorage>(ptr, count) } });
+            }
+        }
+
+        if (!positions || !has_faces)
+            fail("vertex positions or faces are missing");
+
+        if (m_face_normals)
+            normals = nullptr;
+
+        if (m_to_world.scalar() == ScalarTransform4f()) {
+            // The bounding box was computed when writing the file
+            m_bbox = ScalarBoundingBox3f(
+                ScalarPoint3f(header.bbox_min[0], header.bbox_min[1], header.bbox_min[2]),
+                ScalarPoint3f(header.bbox_max[0], header.bbox_max[1], header.bbox_max[2]));
+        } else {
+            transform(positions, normals);
+        }
+
+        m_vertex_positions = map_buffer<FloatStorage>(positions, m_vertex_count * 3);
+        if (normals)
+            m_vertex_normals = map_buffer<FloatStorage>(normals, m_vertex_count * 3);
+
+        Log(Debug, "\"%s\": mapped %i faces, %i vertices (%s in %s)",
+            m_name, m_face_count, m_vertex_count, util::mem_string(file_size),
+            util::time_string((float) timer.value()));
+
+        if (!m_face_normals && !normals) {
+            Timer timer2;
+            m_vertex_normals = dr::zeros<FloatStorage>(m_vertex_count * 3);
+            recompute_vertex_normals();
+            Log(Debug, "\"%s\": computed vertex normals (took %s)", m_name,
+                util::time_string((float) timer2.value()));
+        }
+
+        initialize();
+    }
+
+    /**
+     * \brief Wrap an array of the mapped file into a buffer without copying it
+     *
+     * In JIT variants, the file remains mapped until the buffer is released,
+     * even if this outlives the mesh. CUDA variants copy the data to the GPU.
+     */
+    template <typename Buffer> Buffer map_buffer(void *ptr, size_t count) {
+        if constexpr (dr::is_cuda_v<Float>) {
+            return dr::load<Buffer>(ptr, count);
+        } else {
+            Buffer result = dr::map<Buffer>(ptr, count, false);
+            if constexpr (dr::is_jit_v<Float>) {
+                m_mmap->inc_ref();
+                jit_var_set_callback(
+                    result.index(),
+                    [](uint32_t /* index */, int free, void *payload) {
+                        if (free)
+                            ((MemoryMappedFile *) payload)->dec_ref();
+                    },
+                    (void *) m_mmap.get());
+            }
+            return result;
+        }
+    }
+
+    /// Apply the object-to-world transformation in place and compute the bounding box
+    void transform(InputFloat *positions, InputFloat *normals) {
+        ScalarTransform4f to_world = m_to_world.scalar();
+        std::mutex mutex;
+
+        dr::parallel_for(
+            dr::blocked_range<ScalarSize>(0, m_vertex_count, 1 << 16),
+            [&](const dr::blocked_range<ScalarSize> &range) {
+                ScalarBoundingBox3f bbox;
+                for (ScalarSize i = range.begin(); i != range.end(); ++i) {
+                    InputPoint3f p = to_world.transform_affine(
+                        dr::load<InputPoint3f>(positions + 3 * i));
+                    dr::store(positions + 3 * i, p);
+                    bbox.expand(p);
+
+                    if (normals) {
+                        InputNormal3f n = dr::normalize(to_world.transform_affine(
+                            dr::load<InputNormal3f>(normals + 3 * i)));
+                        dr::store(normals + 3 * i, n);
+                    }
+                }
+
+                std::lock_guard<std::mutex> guard(mutex);
+                m_bbox.expand(bbox);
+            }
+        );
+    }
+
+    MI_DECLARE_CLASS()
+private:
+    /// Private mapping of the file (the mesh buffers point into it)
+    ref<MemoryMappedFile> m_mmap;
+};
+
+MI_IMPLEMENT_CLASS_VARIANT(MappedMesh, Mesh)
+MI_EXPORT_PLUGIN(MappedMesh, "Memory-mapped mesh file")
+NAMESPACE_END(mitsuba)
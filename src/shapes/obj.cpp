@@ -6,6 +6,8 @@
 #include <mitsuba/core/util.h>
 #include <mitsuba/core/timer.h>
 #include <mitsuba/core/profiler.h>
+#include <mitsuba/core/thread.h>
+#include <nanothread/nanothread.h>
 
 #include <array>
 
@@ -114,12 +116,13 @@ template <bool Negate, size_t N>
 void advance(const char **start_, const char *end, const char (&delim)[N]) {
     const char *start = *start_;
 
-    while (true) {
+    // Never dereference 'end', which may lie past the memory-mapped region
+    while (start != end) {
         bool is_delim = false;
         for (size_t i = 0; i < N; ++i)
             if (*start == delim[i])
                 is_delim = true;
-        if ((is_delim ^ Negate) || start == end)
+        if (is_delim ^ Negate)
             break;
         ++start;
     }
@@ -133,7 +136,8 @@ public:
     MI_IMPORT_BASE(Mesh, m_name, m_bbox, m_to_world, m_vertex_count,
                     m_face_count, m_vertex_positions, m_vertex_normals,
                     m_vertex_texcoords, m_faces, m_face_normals,
-                    recompute_vertex_normals, has_vertex_normals, initialize)
+                    recompute_vertex_normals, has_vertex_normals, load_cached,
+                    initialize)
     MI_IMPORT_TYPES()
 
     using typename Base::ScalarSize;
@@ -164,246 +168,472 @@ public:
         if (!fs::exists(file_path))
             fail("file not found");
 
-        ScopedPhase phase(ProfilerPhase::LoadGeometry);
+        // Instances of the same file share the parsed geometry
+        std::string options = tfm::format("flip_tex_coords=%i", (int) flip_tex_coords);
+        load_cached(file_path, options, [&]() {
+            ScopedPhase phase(ProfilerPhase::LoadGeometry);
 
-        using ScalarIndex3 = std::array<ScalarIndex, 3>;
+            using ScalarIndex3 = std::array<ScalarIndex, 3>;
 
-        struct VertexBinding {
-            ScalarIndex3 key {{ 0, 0, 0 }};
-            ScalarIndex value { 0 };
-            VertexBinding *next { nullptr };
-        };
-
-        /// Temporary buffers for vertices, normals, and texture coordinates
-        std::vector<InputVector3f> vertices;
-        std::vector<InputNormal3f> normals;
-        std::vector<InputVector2f> texcoords;
-        std::vector<ScalarIndex3> triangles;
-        std::vector<VertexBinding> vertex_map;
-
- #if !defined(_WIN32)
-        ref<MemoryMappedFile> mmap = new MemoryMappedFile(file_path);
-        size_t file_size           = mmap->size();
-        const char *ptr            = (const char *) mmap->data();
+#if !defined(_WIN32)
+            ref<MemoryMappedFile> mmap = new MemoryMappedFile(file_path);
+            size_t file_size           = mmap->size();
+            const char *data           = (const char *) mmap->data();
 #else
-        // Memory-mapped IO performs surprisingly poorly on Windows
-        ref<FileStream> fs = new FileStream(file_path);
-        size_t file_size = fs->size();
-        std::unique_ptr<char[]> tmp(new char[file_size]);
-        fs->read(tmp.get(), file_size);
-        const char *ptr = tmp.get();
+            // Memory-mapped IO performs surprisingly poorly on Windows
+            ref<FileStream> fs = new FileStream(file_path);
+            size_t file_size = fs->size();
+            std::unique_ptr<char[]> tmp(new char[file_size]);
+            fs->read(tmp.get(), file_size);
+            const char *data = tmp.get();
 #endif
 
-        size_t vertex_guess = file_size / 100;
-        const char *eof     = ptr + file_size;
-        char buf[1025];
-
-        vertices.reserve(vertex_guess);
-        normals.reserve(vertex_guess);
-        texcoords.reserve(vertex_guess);
-        triangles.reserve(vertex_guess * 2);
-        vertex_map.resize(vertex_guess);
-
-        ScalarIndex vertex_ctr = 0;
-
-        Timer timer;
-
-        while (ptr < eof) {
-            // Determine the offset of the next newline
-            const char *next = ptr;
-            advance<false>(&next, eof, "\n");
-
-            // Copy buf into a 0-terminated buffer
-            size_t size = next - ptr;
-            if (size >= sizeof(buf) - 1)
-                fail("file contains an excessively long line! (%i characters)", size);
-            memcpy(buf, ptr, size);
-            buf[size] = '\0';
-
-            // Skip whitespace
-            const char *cur = buf, *eol = buf + size;
-            advance<true>(&cur, eol, " \t\r");
-
-            bool parse_error = false;
-            if (cur[0] == 'v' && (cur[1] == ' ' || cur[1] == '\t')) {
-                // Vertex position
-                InputPoint3f p;
-                cur += 2;
-                for (size_t i = 0; i < 3; ++i) {
-                    const char *orig = cur;
-                    p[i] = string::strtof<InputFloat>(cur, (char **) &cur);
-                    parse_error |= cur == orig;
-                }
-                p = m_to_world.scalar().transform_affine(p);
-                if (unlikely(!all(dr::isfinite(p))))
-                    fail("mesh contains invalid vertex position data");
-                m_bbox.expand(p);
-                vertices.push_back(p);
-            } else if (cur[0] == 'v' && cur[1] == 'n' && (cur[2] == ' ' || cur[2] == '\t')) {
-                if (!m_face_normals) {
-                    cur += 3;
-                    // Vertex normal
-                    InputNormal3f n;
-                    for (size_t i = 0; i < 3; ++i) {
-                        const char *orig = cur;
-                        n[i] = string::strtof<InputFloat>(cur, (char **) &cur);
-                        parse_error |= cur == orig;
-                    }
-                    n = dr::normalize(m_to_world.scalar().transform_affine(n));
-                    if (unlikely(!all(dr::isfinite(n))))
-                        fail("mesh contains invalid vertex normal data");
-                    normals.push_back(n);
-                }
-            } else if (cur[0] == 'v' && cur[1] == 't' && (cur[2] == ' ' || cur[2] == '\t')) {
-                // Texture coordinate
-                InputVector2f uv;
-                cur += 3;
-                for (size_t i = 0; i < 2; ++i) {
-                    const char *orig = cur;
-                    uv[i] = string::strtof<InputFloat>(cur, (char **) &cur);
-                    parse_error |= cur == orig;
-                }
-                if (flip_tex_coords)
-                    uv.y() = 1.f - uv.y();
-
-                texcoords.push_back(uv);
-            } else if (cur[0] == 'f' && (cur[1] == ' ' || cur[1] == '\t')) {
-                // Face specification
-                cur += 2;
-                size_t vertex_index = 0;
-                size_t type_index = 0;
-                ScalarIndex3 key {{ (ScalarIndex) 0, (ScalarIndex) 0, (ScalarIndex) 0 }};
-                ScalarIndex3 tri;
-
-                while (true) {
-                    const char *next2;
-                    ScalarIndex value = (ScalarIndex) strtoul(cur, (char **) &next2, 10);
-                    if (cur == next2)
-                        break;
-
-                    if (type_index < 3) {
-                        key[type_index] = value;
-                    } else {
-                        parse_error = true;
-                        break;
-                    }
+            const char *eof = data + file_size;
+
+            Timer timer;
+
+            /* The file is loaded in three parallel steps that reproduce the
+               output of a sequential parser exactly:
+
+               1. Split the file at newlines into chunks and parse them
+                  concurrently into chunk-local attribute and face lists.
+               2. Deduplicate the (position, texcoord, normal) index triplets of
+                  all face corners. Vertex IDs are assigned in order of first
+                  occurrence within the file (via a prefix sum).
+               3. Write the vertex attributes and triangles of each chunk into
+                  the final mesh buffers. */
+
+            struct Chunk {
+                const char *start, *end;
+                std::vector<InputPoint3f> vertices;
+                std::vector<InputNormal3f> normals;
+                std::vector<InputVector2f> texcoords;
+                /// Index triplet of each face corner
+                std::vector<ScalarIndex3> corners;
+                /// Number of chunk-local vertex positions preceding each corner
+                std::vector<ScalarIndex> corner_limit;
+                /// Triangles referencing entries of 'corners'
+                std::vector<ScalarIndex3> triangles;
+                /// Local corner indices, partitioned by hash value
+                std::vector<std::vector<ScalarIndex>> shards;
+                ScalarBoundingBox3f bbox;
+                size_t vertex_offset = 0, normal_offset = 0, texcoord_offset = 0,
+                       corner_offset = 0, triangle_offset = 0;
+            };
+
+            size_t thread_count = std::max((size_t) Thread::thread_count(), (size_t) 1),
+                   chunk_size   = std::max(file_size / (4 * thread_count), (size_t) 1 << 20);
+
+            std::vector<Chunk> chunks;
+            for (const char *ptr = data; ptr < eof;) {
+                const char *next = ptr + std::min(chunk_size, (size_t) (eof - ptr));
+                advance<false>(&next, eof, "\n");
+                if (next < eof)
+                    ++next;
+                chunks.emplace_back();
+                chunks.back().start = ptr;
+                chunks.back().end = next;
+                ptr = next;
+            }
 
-                    while (*next2 == '/') {
-                        type_index++;
-                        next2++;
-                    }
+            auto parse_float = [&](const char *&cur, const char *eol) {
+                advance<true>(&cur, eol, " \t");
+                if (unlikely(cur == eol))
+                    fail("unexpected end of line");
+                return string::parse_float<InputFloat>(cur, eol, (char **) &cur);
+            };
+
+            auto parse_chunk = [&](Chunk &c) {
+                size_t guess = (size_t) (c.end - c.start) / 100;
+                c.vertices.reserve(guess);
+                c.corners.reserve(guess * 3);
+                c.corner_limit.reserve(guess * 3);
+                c.triangles.reserve(guess * 2);
+
+                const char *ptr = c.start;
+                while (ptr < c.end) {
+                    // Determine the offset of the next newline
+                    const char *eol = ptr;
+                    advance<false>(&eol, c.end, "\n");
+
+                    // Skip whitespace
+                    const char *cur = ptr;
+                    advance<true>(&cur, eol, " \t\r");
+
+                    auto at = [&](size_t i) { return cur + i < eol ? cur[i] : '\0'; };
+
+                    bool parse_error = false;
+                    if (at(0) == 'v' && (at(1) == ' ' || at(1) == '\t')) {
+                        // Vertex position
+                        InputPoint3f p;
+                        cur += 2;
+                        for (size_t i = 0; i < 3; ++i)
+                            p[i] = parse_float(cur, eol);
+                        p = m_to_world.scalar().transform_affine(p);
+                        if (unlikely(!all(dr::isfinite(p))))
+                            fail("mesh contains invalid vertex position data");
+                        c.bbox.expand(p);
+                        c.vertices.push_back(p);
+                    } else if (at(0) == 'v' && at(1) == 'n' && (at(2) == ' ' || at(2) == '\t')) {
+                        if (!m_face_normals) {
+                            cur += 3;
+                            // Vertex normal
+                            InputNormal3f n;
+                            for (size_t i = 0; i < 3; ++i)
+                                n[i] = parse_float(cur, eol);
+                            n = dr::normalize(m_to_world.scalar().transform_affine(n));
+                            if (unlikely(!all(dr::isfinite(n))))
+                                fail("mesh contains invalid vertex normal data");
+                            c.normals.push_back(n);
+                        }
+                    } else if (at(0) == 'v' && at(1) == 't' && (at(2) == ' ' || at(2) == '\t')) {
+                        // Texture coordinate
+                        InputVector2f uv;
+                        cur += 3;
+                        for (size_t i = 0; i < 2; ++i)
+                            uv[i] = parse_float(cur, eol);
+                        if (flip_tex_coords)
+                            uv.y() = 1.f - uv.y();
+
+                        c.texcoords.push_back(uv);
+                    } else if (at(0) == 'f' && (at(1) == ' ' || at(1) == '\t')) {
+                        // Face specification
+                        cur += 2;
+                        size_t vertex_index = 0;
+                        size_t type_index = 0;
+                        ScalarIndex3 key {{ (ScalarIndex) 0, (ScalarIndex) 0, (ScalarIndex) 0 }};
+                        ScalarIndex3 tri {{ (ScalarIndex) 0, (ScalarIndex) 0, (ScalarIndex) 0 }};
+
+                        while (true) {
+                            const char *next = cur;
+                            advance<true>(&next, eol, " \t");
+
+                            bool negative = next < eol && *next == '-';
+                            if (negative || (next < eol && *next == '+'))
+                                ++next;
+
+                            const char *digits = next;
+                            ScalarIndex value = 0;
+                            while (next < eol && *next >= '0' && *next <= '9')
+                                value = value * 10 + (ScalarIndex) (*next++ - '0');
+
+                            if (next == digits)
+                                break;
+
+                            // Relative indices are not supported (flagged as invalid below)
+                            if (negative)
+                                value = (ScalarIndex) 0 - value;
+
+                            if (type_index < 3) {
+                                key[type_index] = value;
+                            } else {
+                                parse_error = true;
+                                break;
+                            }
 
-                    if (*next2 == ' ' || *next2 == '\t' || *next2 == '\0' || *next2 == '\r') {
-                        type_index = 0;
-                        size_t map_index = key[0] - 1;
-
-                        if (unlikely(map_index >= vertices.size()))
-                            fail("reference to invalid vertex %i!", key[0]);
-                        if (unlikely(vertex_map.size() < vertices.size()))
-                            vertex_map.resize(vertices.size());
-
-                        // Hash table lookup
-                        VertexBinding *entry = &vertex_map[map_index];
-                        while (entry->key != key && entry->next != nullptr)
-                            entry = entry->next;
-
-                        ScalarIndex id;
-                        if (entry->key == key) {
-                            // Hit
-                            id = entry->value;
-                        } else {
-                            // Miss
-                            if (entry->key != ScalarIndex3{{0, 0, 0}}) {
-                                entry->next = new VertexBinding();
-                                entry = entry->next;
+                            while (next < eol && *next == '/') {
+                                type_index++;
+                                next++;
                             }
-                            entry->key = key;
-                            id = entry->value = vertex_ctr++;
-                        }
 
-                        if (vertex_index < 3) {
-                            tri[vertex_index] = id;
-                        } else {
-                            tri[1] = tri[2];
-                            tri[2] = id;
-                        }
-                        vertex_index++;
+                            char delim = next < eol ? *next : '\0';
+                            if (delim == ' ' || delim == '\t' || delim == '\0' || delim == '\r') {
+                                type_index = 0;
+
+                                // Vertices are deduplicated later on, just record the corner
+                                ScalarIndex corner = (ScalarIndex) c.corners.size();
+                                c.corners.push_back(key);
+                                c.corner_limit.push_back((ScalarIndex) c.vertices.size());
+
+                                if (vertex_index < 3) {
+                                    tri[vertex_index] = corner;
+                                } else {
+                                    tri[1] = tri[2];
+                                    tri[2] = corner;
+                                }
+                                vertex_index++;
+
+                                if (vertex_index >= 3)
+                                    c.triangles.push_back(tri);
+                            }
 
-                        if (vertex_index >= 3)
-                            triangles.push_back(tri);
+                            cur = next;
+                        }
                     }
 
-                    cur = next2;
+                    if (unlikely(parse_error))
+                        fail("could not parse line \"%s\"", std::string(ptr, eol));
+                    ptr = eol + 1;
                 }
-            }
+            };
 
-            if (unlikely(parse_error))
-                fail("could not parse line \"%s\"", buf);
-            ptr = next + 1;
-        }
-
-        m_vertex_count = vertex_ctr;
-        m_face_count = (ScalarSize) triangles.size();
-
-        std::unique_ptr<float[]> vertex_positions(new float[m_vertex_count * 3]);
-        std::unique_ptr<float[]> vertex_normals(new float[m_vertex_count * 3]);
-        std::unique_ptr<float[]> vertex_texcoords(new float[m_vertex_count * 2]);
-
-        for (const auto& v_ : vertex_map) {
-            const VertexBinding *v = &v_;
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, chunks.size(), 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i)
+                        parse_chunk(chunks[i]);
+                }
+            );
+
+            // Compute the global offsets of the chunk-local data
+            size_t vertex_total = 0, normal_total = 0, texcoord_total = 0,
+                   corner_total = 0, triangle_total = 0;
+
+            for (Chunk &c : chunks) {
+                c.vertex_offset   = vertex_total;
+                c.normal_offset   = normal_total;
+                c.texcoord_offset = texcoord_total;
+                c.corner_offset   = corner_total;
+                c.triangle_offset = triangle_total;
+
+                vertex_total   += c.vertices.size();
+                normal_total   += c.normals.size();
+                texcoord_total += c.texcoords.size();
+                corner_total   += c.corners.size();
+                triangle_total += c.triangles.size();
+
+                if (c.bbox.valid())
+                    m_bbox.expand(c.bbox);
+            }
 
-            while (v && v->key != ScalarIndex3{{0, 0, 0}}) {
-                InputFloat* position_ptr = vertex_positions.get() + v->value * 3;
-                InputFloat* normal_ptr   = vertex_normals.get() + v->value * 3;
-                InputFloat* texcoord_ptr = vertex_texcoords.get() + v->value * 2;
-                auto key = v->key;
+            if (corner_total > (size_t) std::numeric_limits<ScalarIndex>::max())
+                fail("mesh contains too many face vertices (%zu)", corner_total);
+
+            std::vector<InputPoint3f> vertices(vertex_total);
+            std::vector<InputNormal3f> normals(normal_total);
+            std::vector<InputVector2f> texcoords(texcoord_total);
+
+            auto corner_hash = [](const ScalarIndex3 &key) {
+                uint64_t h = (uint64_t) key[0] * 0x9E3779B97F4A7C15ull;
+                h ^= ((uint64_t) key[1] + 0x7F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+                h ^= ((uint64_t) key[2] + 0x165667B1ull) * 0x165667B19E3779F9ull;
+                return h ^ (h >> 29);
+            };
+
+            size_t shard_count = chunks.size();
+
+            /* Gather the attributes into contiguous arrays, validate vertex
+               references and partition the face corners by hash value */
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, chunks.size(), 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        Chunk &c = chunks[i];
+
+                        std::copy(c.vertices.begin(), c.vertices.end(),
+                                  vertices.begin() + c.vertex_offset);
+                        std::copy(c.normals.begin(), c.normals.end(),
+                                  normals.begin() + c.normal_offset);
+                        std::copy(c.texcoords.begin(), c.texcoords.end(),
+                                  texcoords.begin() + c.texcoord_offset);
+                        c.vertices = { };
+                        c.normals = { };
+                        c.texcoords = { };
+
+                        c.shards.resize(shard_count);
+                        for (size_t j = 0; j < c.corners.size(); ++j) {
+                            const ScalarIndex3 &key = c.corners[j];
+                            size_t map_index = (size_t) key[0] - 1;
+
+                            if (unlikely(map_index >= c.vertex_offset + c.corner_limit[j]))
+                                fail("reference to invalid vertex %i!", key[0]);
+
+                            c.shards[corner_hash(key) % shard_count].push_back((ScalarIndex) j);
+                        }
+                        c.corner_limit = { };
+                    }
+                }
+            );
+
+            /* For every corner, find the first corner in the file with the same
+               index triplet. 'first_flag' marks these first occurrences. */
+            std::unique_ptr<ScalarIndex[]> first_of(new ScalarIndex[corner_total]),
+                                           vertex_id(new ScalarIndex[corner_total]);
+
+            struct VertexBinding {
+                ScalarIndex3 key {{ 0, 0, 0 }};
+                ScalarIndex first { 0 };
+            };
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, shard_count, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t s = range.begin(); s != range.end(); ++s) {
+                        size_t count = 0;
+                        for (const Chunk &c : chunks)
+                            count += c.shards[s].size();
+
+                        // Open addressing hash table (key[0] == 0 marks empty slots)
+                        std::vector<VertexBinding> table(
+                            math::round_to_power_of_two(std::max(count / 2, (size_t) 64)));
+                        size_t used = 0;
+
+                        auto insert = [&](std::vector<VertexBinding> &t,
+                                          const ScalarIndex3 &key) -> VertexBinding & {
+                            size_t mask = t.size() - 1,
+                                   index = (size_t) (corner_hash(key) >> 20) & mask;
+                            while (t[index].key[0] != 0 && t[index].key != key)
+                                index = (index + 1) & mask;
+                            return t[index];
+                        };
+
+                        for (const Chunk &c : chunks) {
+                            for (ScalarIndex j : c.shards[s]) {
+                                const ScalarIndex3 &key = c.corners[j];
+                                ScalarIndex g = (ScalarIndex) (c.corner_offset + j);
+
+                                VertexBinding &entry = insert(table, key);
+                                if (entry.key[0] == 0) {
+                                    // Miss
+                                    entry.key = key;
+                                    entry.first = g;
+                                    vertex_id[g] = 1;
+
+                                    if (++used * 2 > table.size()) {
+                                        std::vector<VertexBinding> table2(table.size() * 2);
+                                        for (const VertexBinding &e : table) {
+                                            if (e.key[0] != 0)
+                                                insert(table2, e.key) = e;
+                                        }
+                                        table.swap(table2);
+                                    }
+                                } else {
+                                    // Hit
+                                    vertex_id[g] = 0;
+                                }
+                                first_of[g] = insert(table, key).first;
+                            }
+                        }
+                    }
+                }
+            );
+
+            for (Chunk &c : chunks)
+                c.shards = { };
+
+            // Exclusive prefix sum over the first-occurrence flags yields vertex IDs
+            size_t scan_block = 1 << 20,
+                   scan_blocks = (corner_total + scan_block - 1) / scan_block;
+            std::vector<ScalarIndex> block_sum(scan_blocks);
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, scan_blocks, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t b = range.begin(); b != range.end(); ++b) {
+                        ScalarIndex sum = 0;
+                        size_t end = std::min((b + 1) * scan_block, corner_total);
+                        for (size_t g = b * scan_block; g < end; ++g)
+                            sum += vertex_id[g];
+                        block_sum[b] = sum;
+                    }
+                }
+            );
 
-                dr::store(position_ptr, vertices[key[0] - 1]);
+            ScalarIndex vertex_ctr = 0;
+            for (size_t b = 0; b < scan_blocks; ++b) {
+                ScalarIndex sum = block_sum[b];
+                block_sum[b] = vertex_ctr;
+                vertex_ctr += sum;
+            }
 
-                if (key[1]) {
-                    size_t map_index = key[1] - 1;
-                    if (unlikely(map_index >= texcoords.size()))
-                        fail("reference to invalid texture coordinate %i!", key[1]);
-                    dr::store(texcoord_ptr, texcoords[map_index]);
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, scan_blocks, 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t b = range.begin(); b != range.end(); ++b) {
+                        ScalarIndex sum = block_sum[b];
+                        size_t end = std::min((b + 1) * scan_block, corner_total);
+                        for (size_t g = b * scan_block; g < end; ++g) {
+                            ScalarIndex flag = vertex_id[g];
+                            vertex_id[g] = sum;
+                            sum += flag;
+                        }
+                    }
                 }
+            );
+
+            m_vertex_count = vertex_ctr;
+            m_face_count = (ScalarSize) triangle_total;
+
+            std::unique_ptr<float[]> vertex_positions(new float[m_vertex_count * 3]);
+            std::unique_ptr<float[]> vertex_normals(new float[m_vertex_count * 3]);
+            std::unique_ptr<float[]> vertex_texcoords(new float[m_vertex_count * 2]);
+            std::unique_ptr<ScalarIndex3[]> triangles(new ScalarIndex3[triangle_total]);
+
+            // Write the attributes of each vertex (at its first occurrence) and the faces
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, chunks.size(), 1),
+                [&](const dr::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        const Chunk &c = chunks[i];
+
+                        for (size_t j = 0; j < c.corners.size(); ++j) {
+                            size_t g = c.corner_offset + j;
+                            if (first_of[g] != g)
+                                continue;
+
+                            ScalarIndex id = vertex_id[g];
+                            InputFloat* position_ptr = vertex_positions.get() + id * 3;
+                            InputFloat* normal_ptr   = vertex_normals.get() + id * 3;
+                            InputFloat* texcoord_ptr = vertex_texcoords.get() + id * 2;
+                            const ScalarIndex3 &key = c.corners[j];
+
+                            dr::store(position_ptr, vertices[key[0] - 1]);
+
+                            if (key[1]) {
+                                size_t map_index = key[1] - 1;
+                                if (unlikely(map_index >= texcoords.size()))
+                                    fail("reference to invalid texture coordinate %i!", key[1]);
+                                dr::store(texcoord_ptr, texcoords[map_index]);
+                            }
 
-                if (!m_face_normals && key[2]) {
-                    size_t map_index = key[2] - 1;
-                    if (unlikely(map_index >= normals.size()))
-                        fail("reference to invalid normal %i!", key[2]);
-                    dr::store(normal_ptr, normals[key[2] - 1]);
-                }
+                            if (!m_face_normals && key[2]) {
+                                size_t map_index = key[2] - 1;
+                                if (unlikely(map_index >= normals.size()))
+                                    fail("reference to invalid normal %i!", key[2]);
+                                dr::store(normal_ptr, normals[key[2] - 1]);
+                            }
+                        }
 
-                v = v->next;
+                        for (size_t j = 0; j < c.triangles.size(); ++j) {
+                            const ScalarIndex3 &tri = c.triangles[j];
+                            ScalarIndex3 &out = triangles[c.triangle_offset + j];
+                            for (size_t k = 0; k < 3; ++k)
+                                out[k] = vertex_id[first_of[c.corner_offset + tri[k]]];
+                        }
+                    }
+                }
+            );
+
+            m_faces = dr::load<DynamicBuffer<UInt32>>(triangles.get(), m_face_count * 3);
+            m_vertex_positions = dr::load<FloatStorage>(vertex_positions.get(), m_vertex_count * 3);
+            if (!m_face_normals)
+                m_vertex_normals   = dr::load<FloatStorage>(vertex_normals.get(), m_vertex_count * 3);
+            if (!texcoords.empty())
+                m_vertex_texcoords = dr::load<FloatStorage>(vertex_texcoords.get(), m_vertex_count * 2);
+
+            size_t vertex_data_bytes = 3 * sizeof(InputFloat);
+            if (!m_face_normals)
+                vertex_data_bytes += 3 * sizeof(InputFloat);
+            if (!texcoords.empty())
+                vertex_data_bytes += 2 * sizeof(InputFloat);
+
+            Log(Debug, "\"%s\": read %i faces, %i vertices (%s in %s)",
+                m_name, m_face_count, m_vertex_count,
+                util::mem_string(m_face_count * 3 * sizeof(ScalarIndex) +
+                                 m_vertex_count * vertex_data_bytes),
+                util::time_string((float) timer.value())
+            );
+
+            bool compute_normals = !m_face_normals && normals.empty();
+            if (compute_normals) {
+                Timer timer2;
+                recompute_vertex_normals();
+                Log(Debug, "\"%s\": computed vertex normals (took %s)", m_name,
+                    util::time_string((float) timer2.value()));
             }
-        }
-
-        m_faces = dr::load<DynamicBuffer<UInt32>>(triangles.data(), m_face_count * 3);
-        m_vertex_positions = dr::load<FloatStorage>(vertex_positions.get(), m_vertex_count * 3);
-        if (!m_face_normals)
-            m_vertex_normals   = dr::load<FloatStorage>(vertex_normals.get(), m_vertex_count * 3);
-        if (!texcoords.empty())
-            m_vertex_texcoords = dr::load<FloatStorage>(vertex_texcoords.get(), m_vertex_count * 2);
-
-        size_t vertex_data_bytes = 3 * sizeof(InputFloat);
-        if (!m_face_normals)
-            vertex_data_bytes += 3 * sizeof(InputFloat);
-        if (!texcoords.empty())
-            vertex_data_bytes += 2 * sizeof(InputFloat);
-
-        Log(Debug, "\"%s\": read %i faces, %i vertices (%s in %s)",
-            m_name, m_face_count, m_vertex_count,
-            util::mem_string(m_face_count * 3 * sizeof(ScalarIndex) +
-                             m_vertex_count * vertex_data_bytes),
-            util::time_string((float) timer.value())
-        );
-
-        if (!m_face_normals && normals.empty()) {
-            Timer timer2;
-            recompute_vertex_normals();
-            Log(Debug, "\"%s\": computed vertex normals (took %s)", m_name,
-                util::time_string((float) timer2.value()));
-        }
+
+            return compute_normals;
+        });
 
         initialize();
     }
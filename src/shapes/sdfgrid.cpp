@@ -13,6 +13,7 @@
 
 #include <drjit/tensor.h>
 #include <drjit/texture.h>
+#include <nanothread/nanothread.h>
 
 #if defined(MI_ENABLE_EMBREE)
 #include <embree3/rtcore.h>
@@ -51,6 +52,15 @@ SDF Grid (:monosp:`sdfgrid`)
    - Specifies the method for computing shading normals. The options are
      :monosp:`analytic` or :monosp:`smooth`. (Default: :monosp:`smooth`)
 
+ * - brick_size
+   - |int|
+   - Number of voxels along each side of the bricks that are handed to the
+     acceleration data structure as primitives (between 1 and 4). Larger
+     bricks reduce the number of primitives and the memory usage of the
+     acceleration data structure, at the cost of testing more voxels per
+     primitive. This parameter is ignored in CUDA variants, which always use
+     one primitive per voxel. (Default: 4)
+
  * - to_world
    - |transform|
    - Specifies a linear object-to-world transformation. (Default: none (i.e. object space = world space))
@@ -71,6 +81,15 @@ The grid object-space is mapped over the range :math:`[0,1]^3`.
 A smooth method for computing normals :cite:`Hansson-Soderlund2022SDF` is
 selected as the default approach to ensure continuity across grid cells.
 
+Only the voxels that contain a part of the surface (the narrow band around
+the zero level set) are intersected. In CPU variants, these voxels are
+grouped into bricks of :math:`4^3` voxels: every non-empty brick becomes a
+single primitive of the acceleration data structure, whose bounding box is the
+union of the tight bounding boxes of its surface voxels. A brick stores a mask
+of its non-empty voxels, so that the voxel intersection routine only runs on
+those. The SDF values themselves are only stored once, in the dense grid that
+is also used for shading and differentiation.
+
 .. warning::
     Compared with the other available shape plugins, the SDF grid has a few
     important limitations. Namely:
@@ -140,6 +159,12 @@ public:
                   "or \"smooth\"!",
                   normals_mode_str);
 
+        int brick_size = props.get<int>("brick_size", 4);
+        if (brick_size < 1 || brick_size > 4)
+            Throw("The brick size must be between 1 and 4 (got %i)!", brick_size);
+        // The OptiX intersection program operates on individual voxels
+        m_brick_size = dr::is_cuda_v<Float> ? 1u : (uint32_t) brick_size;
+
         if (props.has_property("filename")) {
             FileResolver *fs   = Thread::thread()->file_resolver();
             fs::path file_path = fs->resolve(props.string("filename"));
@@ -178,7 +203,7 @@ public:
     }
 
     ~SDFGrid() {
-        if constexpr (!dr::is_jit_v<Float>) {
+        if constexpr (!dr::is_cuda_v<Float>) {
             jit_free(m_bboxes_ptr);
             jit_free(m_voxel_indices_ptr);
         }
@@ -209,13 +234,19 @@ public:
             m_host_grid_data = m_grid_texture.tensor().data();
         }
 
-        if constexpr (!dr::is_jit_v<Float>){
+        if constexpr (!dr::is_cuda_v<Float>){
             jit_free(m_bboxes_ptr);
             jit_free(m_voxel_indices_ptr);
+            m_bboxes_ptr = nullptr;
+            m_voxel_indices_ptr = nullptr;
         }
-        std::tie(m_bboxes_ptr,
-                 m_voxel_indices_ptr,
-                 m_filled_voxel_count) = build_bboxes();
+
+        if constexpr (dr::is_cuda_v<Float>)
+            std::tie(m_bboxes_ptr,
+                     m_voxel_indices_ptr,
+                     m_filled_voxel_count) = build_bboxes();
+        else
+            m_filled_voxel_count = build_bricks();
         if (m_filled_voxel_count == 0)
             Throw("SDFGrid should at least have one non-empty voxel!");
 
@@ -590,6 +621,8 @@ public:
         oss << "SDFgrid[" << std::endl
             << "  to_world = " << string::indent(m_to_world, 13) << ","
             << std::endl
+            << "  brick_size = " << m_brick_size << "," << std::endl
+            << "  primitive_count = " << m_filled_voxel_count << "," << std::endl
             << "  " << string::indent(get_children_string()) << std::endl
             << "]";
         return oss.str();
@@ -617,9 +650,53 @@ private:
         Ray3fP ray = to_object.transform_affine(ray_);
 
         auto shape = m_grid_texture.tensor().shape();
+        const size_t res_x = shape[2], res_y = shape[1];
+
+        const uint32_t B = m_brick_size;
+        ScalarVector3u brick_pos = to_brick_position(m_voxel_indices_ptr[prim_index]);
+        uint64_t mask = m_brick_masks[prim_index];
+
+        MaskP hit = false;
+        FloatP t = dr::Infinity<FloatP>;
+
+        // Only intersect the voxels of the brick that contain the surface
+        for (uint32_t i = 0; i < B * B * B; ++i) {
+            if (!((mask >> i) & 1))
+                continue;
+
+            ScalarVector3u voxel_pos =
+                brick_pos * B + ScalarVector3u(i % B, (i / B) % B, i / (B * B));
+            float s[8];
+            for (uint32_t k = 0; k < 8; ++k)
+                s[k] = m_host_grid_data[
+                    ((size_t) (voxel_pos.z() + ((k >> 2) & 1)) * res_y +
+                     voxel_pos.y() + ((k >> 1) & 1)) * res_x +
+                    voxel_pos.x() + (k & 1)];
+
+            auto [voxel_hit, voxel_t] =
+                intersect_voxel<FloatP>(ray, voxel_pos, s, active);
+
+            // Subsequent voxels can only yield closer intersections
+            hit |= voxel_hit;
+            dr::masked(t, voxel_hit) = voxel_t;
+            dr::masked(ray.maxt, voxel_hit) = voxel_t;
+        }
+
+        return { hit, t, Point<FloatP, 2>(0.f, 0.f), ((uint32_t) -1), prim_index };
+    }
+
+    /**
+     * \brief Intersect a ray (in object space) with the surface inside a
+     * single voxel, given the SDF values \c s at its corners (with the x
+     * coordinate in the least significant bit of the corner index)
+     */
+    template <typename FloatP, typename Ray3fP>
+    MI_INLINE std::tuple<dr::mask_t<FloatP>, FloatP>
+    intersect_voxel(Ray3fP ray, const ScalarVector3u &voxel_pos,
+                    const float s[8], dr::mask_t<FloatP> active) const {
+        using MaskP = dr::mask_t<FloatP>;
 
-        uint32_t voxel_index     = m_voxel_indices_ptr[prim_index];
-        ScalarVector3u voxel_pos = to_voxel_position(voxel_index);
+        auto shape = m_grid_texture.tensor().shape();
 
         // Find voxel AABB in object space
         ScalarBoundingBox3f bbox_local;
@@ -683,23 +760,8 @@ private:
         FloatP c2;
         FloatP c3;
         {
-            ScalarVector3u v000 = voxel_pos;
-            ScalarVector3u v100 = v000 + ScalarVector3u(1, 0, 0);
-            ScalarVector3u v010 = v000 + ScalarVector3u(0, 1, 0);
-            ScalarVector3u v110 = v000 + ScalarVector3u(1, 1, 0);
-            ScalarVector3u v001 = v000 + ScalarVector3u(0, 0, 1);
-            ScalarVector3u v101 = v000 + ScalarVector3u(1, 0, 1);
-            ScalarVector3u v011 = v000 + ScalarVector3u(0, 1, 1);
-            ScalarVector3u v111 = v000 + ScalarVector3u(1, 1, 1);
-
-            float s000 = m_host_grid_data[to_voxel_index(v000)];
-            float s100 = m_host_grid_data[to_voxel_index(v100)];
-            float s010 = m_host_grid_data[to_voxel_index(v010)];
-            float s110 = m_host_grid_data[to_voxel_index(v110)];
-            float s001 = m_host_grid_data[to_voxel_index(v001)];
-            float s101 = m_host_grid_data[to_voxel_index(v101)];
-            float s011 = m_host_grid_data[to_voxel_index(v011)];
-            float s111 = m_host_grid_data[to_voxel_index(v111)];
+            float s000 = s[0], s100 = s[1], s010 = s[2], s110 = s[3],
+                  s001 = s[4], s101 = s[5], s011 = s[6], s111 = s[7];
 
             Vector<FloatP, 3> ray_p_in_voxel = ray(t_bbox_beg);
             FloatP o_x = ray_p_in_voxel.x();
@@ -747,8 +809,7 @@ private:
                  t_bbox_beg + t >= 0.f &&
                  t_bbox_beg + t <= ray.maxt;
 
-        return { active, dr::select(active, t_bbox_beg + t, dr::Infinity<FloatP>),
-                 Point<FloatP, 2>(0.f, 0.f), ((uint32_t) -1), prim_index };
+        return { active, dr::select(active, t_bbox_beg + t, dr::Infinity<FloatP>) };
     }
 
     /* \brief Solve cubic polynomial that gives solution to voxel intersection
@@ -829,37 +890,11 @@ private:
         return { active, t };
     }
 
-    /* \brief Given an index of the flat SDFGrid data (voxel corners), return
-     * the associated voxel position
-     */
-    MI_INLINE ScalarVector3u to_voxel_position(uint32_t index) const {
-        auto shape = m_grid_texture.tensor().shape();
-        // Data is packed [Z, Y, X, C]
-        uint32_t shape_v[3] = { (uint32_t) shape[2], (uint32_t) shape[1],
-                                (uint32_t) shape[0] };
-
-        uint32_t resolution_x = shape_v[2] - 1;
-        uint32_t resolution_y = shape_v[1] - 1;
-
-        uint32_t x = index % resolution_x;
-        uint32_t y = ((index - x) / resolution_y) % resolution_y;
-        uint32_t z =
-            (index - x - y * resolution_x) / (resolution_x * resolution_y);
-
-        return { x, y, z };
-    }
-
-    /* \brief Given a voxel position, returns the corresponding voxel index
-     * relative to the flat array of SDFGrid data. In particular, the returned
-     * index maps to the bottom-left corner of the associated voxel
-     */
-    MI_INLINE ScalarIndex to_voxel_index(const ScalarVector3u &v) const {
-        auto shape = m_grid_texture.tensor().shape();
-        // Data is packed [Z, Y, X, C]
-        uint32_t shape_v[3] = { (uint32_t) shape[2], (uint32_t) shape[1],
-                                (uint32_t) shape[0] };
-
-        return v.z() * shape_v[1] * shape_v[0] + v.y() * shape_v[0] + v.x();
+    /// Given the index of a brick, return its position in the grid of bricks
+    MI_INLINE ScalarVector3u to_brick_position(uint32_t index) const {
+        return { index % m_brick_res.x(),
+                 (index / m_brick_res.x()) % m_brick_res.y(),
+                 index / (m_brick_res.x() * m_brick_res.y()) };
     }
 
     /* \brief Offsets and rescales an point in [0, 1] x [0, 1] x [0, 1] to
@@ -879,54 +914,40 @@ private:
                             InputFloat(rescaled.z()));
     }
 
-    /* \brief Given the voxel position, returns tight bounding box around the
-     * surface.
+    /* \brief Given the SDF values at the corners of a voxel, returns a tight
+     * bounding box around the surface in local voxel coordinates ([0, 1]^3).
+     * The x coordinate of a corner is stored in the least significant bit of
+     * its index.
      *
      *  Tight Bounding Boxes for Voxels and Bricks in a Signed Distance Field
      *  Ray Tracer. HANSSON-SÖDERLUND, H., AND AKENINE-MÖLLER, T. 2023.
      */
-    std::tuple<Mask, InputBoundingBox3f>
-    compute_tight_bbox(const FloatStorage& grid,
-                       const uint32_t shape[3],
-                       const Vector3f& voxel_size,
-                       const ScalarTransform4f& to_world,
-                       UInt32 x,
-                       UInt32 y,
-                       UInt32 z) {
-        auto value_index = [&](UInt32 x_off,
-                               UInt32 y_off,
-                               UInt32 z_off) {
-            return (x + x_off) + (y + y_off) * shape[0] +
-                   (z + z_off) * shape[0] * shape[1];
-        };
+    template <typename Value>
+    static std::tuple<dr::mask_t<Value>, BoundingBox<Point<Value, 3>>>
+    tight_voxel_bbox(const Value f[8]) {
+        using MaskV   = dr::mask_t<Value>;
+        using Point3v = Point<Value, 3>;
 
         auto voxel_corner_enc = [&](uint32_t x, uint32_t y, uint32_t z) {
             return x + (y << 1) + (z << 2);
         };
 
         auto voxel_corner_dec = [&](uint32_t i) {
-            return Point3u(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+            return Point3v(Value((float) (i & 1)), Value((float) ((i >> 1) & 1)),
+                           Value((float) ((i >> 2) & 1)));
         };
 
-        UInt32 v[8];
-        for (size_t i = 0; i < 8; i++)
-            v[i] = value_index(i & 1, (i >> 1) & 1, (i >> 2) & 1);
-
-        InputFloat f[8];
-        for (size_t i = 0; i < 8; i++)
-            f[i] = dr::gather<InputFloat>(grid, v[i]);
-
-        Mask occupied_mask = !((f[0] > 0 && f[1] > 0 && f[2] > 0 && f[3] > 0 &&
-                                f[4] > 0 && f[5] > 0 && f[6] > 0 && f[7] > 0) ||
-                               (f[0] < 0 && f[1] < 0 && f[2] < 0 && f[3] < 0 &&
-                                f[4] < 0 && f[5] < 0 && f[6] < 0 && f[7] < 0));
+        MaskV occupied_mask = !((f[0] > 0 && f[1] > 0 && f[2] > 0 && f[3] > 0 &&
+                                 f[4] > 0 && f[5] > 0 && f[6] > 0 && f[7] > 0) ||
+                                (f[0] < 0 && f[1] < 0 && f[2] < 0 && f[3] < 0 &&
+                                 f[4] < 0 && f[5] < 0 && f[6] < 0 && f[7] < 0));
 
-        InputBoundingBox3f bbox = dr::zeros<InputBoundingBox3f>();
-        if constexpr (!dr::is_jit_v<Float>)
+        BoundingBox<Point3v> bbox = dr::zeros<BoundingBox<Point3v>>();
+        if constexpr (!dr::is_jit_v<Value>)
             if (!occupied_mask)
                 return { false, bbox };
 
-        Mask f_Z[8];
+        MaskV f_Z[8];
         for (size_t i = 0; i < 8; i++)
             f_Z[i] = f[i] == 0;
 
@@ -943,17 +964,17 @@ private:
                 if (!(corner_1 & (1u << shift))) {
                     uint32_t corner_2 = corner_1 | (1u << shift);
 
-                    Mask intersection_mask = f[corner_1] * f[corner_2] <= 0 && f[corner_1] != f[corner_2];
+                    MaskV intersection_mask = f[corner_1] * f[corner_2] <= 0 && f[corner_1] != f[corner_2];
 
-                    if constexpr (!dr::is_jit_v<Float>) {
+                    if constexpr (!dr::is_jit_v<Value>) {
                         if (!intersection_mask)
                             continue;
                     }
 
-                    Point3u corner_1_pos = voxel_corner_dec(corner_1);
-                    Point3u corner_2_pos = voxel_corner_dec(corner_2);
+                    Point3v corner_1_pos = voxel_corner_dec(corner_1);
+                    Point3v corner_2_pos = voxel_corner_dec(corner_2);
 
-                    auto intersection_pos = corner_1_pos + f[corner_1] / (f[corner_1] - f[corner_2]) * (corner_2_pos - corner_1_pos);
+                    Point3v intersection_pos = corner_1_pos + f[corner_1] / (f[corner_1] - f[corner_2]) * (corner_2_pos - corner_1_pos);
 
                     bbox.min = dr::select(intersection_mask, dr::minimum(bbox.min, intersection_pos), bbox.min);
                     bbox.max = dr::select(intersection_mask, dr::maximum(bbox.max, intersection_pos), bbox.max);
@@ -961,6 +982,34 @@ private:
             }
         }
 
+        return { occupied_mask, bbox };
+    }
+
+    /* \brief Given the voxel position, returns tight bounding box around the
+     * surface in world space.
+     */
+    std::tuple<Mask, InputBoundingBox3f>
+    compute_tight_bbox(const FloatStorage& grid,
+                       const uint32_t shape[3],
+                       const Vector3f& voxel_size,
+                       const ScalarTransform4f& to_world,
+                       UInt32 x,
+                       UInt32 y,
+                       UInt32 z) {
+        auto value_index = [&](UInt32 x_off,
+                               UInt32 y_off,
+                               UInt32 z_off) {
+            return (x + x_off) + (y + y_off) * shape[0] +
+                   (z + z_off) * shape[0] * shape[1];
+        };
+
+        InputFloat f[8];
+        for (size_t i = 0; i < 8; i++)
+            f[i] = dr::gather<InputFloat>(
+                grid, value_index(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+
+        auto [occupied_mask, bbox] = tight_voxel_bbox<InputFloat>(f);
+
         bbox.min += Vector3f(Float(x), Float(y), Float(z));
         bbox.max += Vector3f(Float(x), Float(y), Float(z));
 
@@ -974,26 +1023,22 @@ private:
      * Returns a pointer to the array of AABBs, a pointer to an array of voxel
      * indices of the former AABBs and the count of voxels with surface in them.
      *
-     * Depending on the variant used, the pointer returned is either host or
-     * device visible
+     * This is only used in CUDA variants, where the returned pointers are
+     * device visible. CPU variants group the voxels into bricks (see
+     * \ref build_bricks()).
      */
     std::tuple<void *, uint32_t *, uint32_t> build_bboxes() {
-        auto shape = m_grid_texture.tensor().shape();
-        uint32_t shape_v[3]  = { static_cast<uint32_t>(shape[2]),
-                                 static_cast<uint32_t>(shape[1]),
-                                 static_cast<uint32_t>(shape[0]) };
-        uint32_t max_voxel_count =
-            (uint32_t)((shape[0] - 1) * (shape[1] - 1) * (shape[2] - 1));
-        ScalarTransform4f to_world = m_to_world.scalar();
-
-        dr::eval(m_grid_texture.value()); // Make sure the SDF data is evaluated
-
-        void *aabbs_ptr = nullptr;
-        uint32_t *voxel_indices_ptr = nullptr;
+        if constexpr (dr::is_cuda_v<Float>) {
+            auto shape = m_grid_texture.tensor().shape();
+            uint32_t shape_v[3]  = { static_cast<uint32_t>(shape[2]),
+                                     static_cast<uint32_t>(shape[1]),
+                                     static_cast<uint32_t>(shape[0]) };
+            uint32_t max_voxel_count =
+                (uint32_t)((shape[0] - 1) * (shape[1] - 1) * (shape[2] - 1));
+            ScalarTransform4f to_world = m_to_world.scalar();
 
-        uint32_t count = 0;
+            dr::eval(m_grid_texture.value()); // Make sure the SDF data is evaluated
 
-        if constexpr (dr::is_jit_v<Float>) {
             InputFloat grid = m_grid_texture.tensor().array();
 
             auto [z, y, x] = dr::meshgrid(dr::arange<UInt32>(shape[0] - 1),
@@ -1014,9 +1059,6 @@ private:
             m_jit_voxel_indices = dr::zeros<UInt32>(max_voxel_count);
 
             uint32_t stride = 3; // BBobx's Point3f stride
-            if constexpr (dr::is_llvm_v<Float>)
-                stride = sizeof(InputScalarBoundingBox3f) / sizeof(float) / 2u; // Typically 4-wide
-
             m_jit_bboxes = dr::zeros<InputFloat>(stride * max_voxel_count);
             dr::scatter(m_jit_bboxes, bbox.min.x(), stride * (2 * slot + 0) + 0, occupied);
             dr::scatter(m_jit_bboxes, bbox.min.y(), stride * (2 * slot + 0) + 1, occupied);
@@ -1027,42 +1069,116 @@ private:
             dr::scatter(m_jit_voxel_indices, voxel_idx, slot, occupied);
             dr::eval(m_jit_voxel_indices, m_jit_bboxes);
 
-            aabbs_ptr = (void *) m_jit_bboxes.data();
-            voxel_indices_ptr = (uint32_t*) m_jit_voxel_indices.data();
-
-            count = counter[0];
+            return { (void *) m_jit_bboxes.data(),
+                     (uint32_t *) m_jit_voxel_indices.data(), counter[0] };
         } else {
-            aabbs_ptr = (ScalarBoundingBox3f*) jit_malloc(
-                AllocType::Host, sizeof(ScalarBoundingBox3f) * max_voxel_count);
-            voxel_indices_ptr = (uint32_t *) jit_malloc(
-                AllocType::Host, sizeof(uint32_t) * max_voxel_count);
+            NotImplementedError("build_bboxes");
+        }
+    }
 
-            FloatStorage grid = m_grid_texture.tensor().array();
-            ScalarVector3f voxel_size = m_voxel_size.scalar();
+    /* \brief Groups the voxels that contain a part of the surface into bricks
+     * of <tt>m_brick_size^3</tt> voxels, which become the primitives of the
+     * shape (CPU variants). Returns the number of non-empty bricks.
+     *
+     * For every non-empty brick, this function stores its index in
+     * \ref m_voxel_indices_ptr, the union of the tight bounding boxes of its
+     * voxels in \ref m_bboxes_ptr, and a mask of its non-empty voxels. The
+     * intersection routine reads the SDF values of these voxels from the
+     * dense grid, which is also needed for shading and differentiation.
+     */
+    uint32_t build_bricks() {
+        auto shape = m_grid_texture.tensor().shape();
+        ScalarVector3u grid_res((uint32_t) shape[2], (uint32_t) shape[1],
+                                (uint32_t) shape[0]),
+                       voxel_res = grid_res - 1u;
 
-            for (uint32_t z = 0; z < shape[0] - 1; ++z) {
-                for (uint32_t y = 0; y < shape[1] - 1; ++y) {
-                    for (uint32_t x = 0; x < shape[2] - 1; ++x) {
-                        auto [occupied, bbox] = compute_tight_bbox(
-                            grid, shape_v, voxel_size, to_world, x, y, z);
+        const uint32_t B = m_brick_size;
+        m_brick_res = (voxel_res + (B - 1)) / B;
+        size_t brick_count = dr::prod(m_brick_res);
 
-                        if (!occupied)
-                            continue;
+        const float *grid = m_host_grid_data;
+        ScalarVector3f voxel_size = m_voxel_size.scalar();
+        ScalarTransform4f to_world = m_to_world.scalar();
 
-                        uint32_t voxel_idx = x +
-                                             y * (shape_v[0] - 1) +
-                                             z * (shape_v[0] - 1) * (shape_v[1] - 1);
+        auto value_index = [&](uint32_t x, uint32_t y, uint32_t z) {
+            return ((size_t) z * grid_res.y() + y) * grid_res.x() + x;
+        };
 
-                        voxel_indices_ptr[count] = voxel_idx;
-                        ScalarBoundingBox3f *ptr = (ScalarBoundingBox3f *) aabbs_ptr;
-                        ptr[count] = ScalarBoundingBox3f(bbox);
-                        count++;
+        std::unique_ptr<uint64_t[]> masks(new uint64_t[brick_count]);
+        std::unique_ptr<ScalarBoundingBox3f[]> bboxes(new ScalarBoundingBox3f[brick_count]);
+
+        dr::parallel_for(
+            dr::blocked_range<uint32_t>(0, m_brick_res.z(), 1),
+            [&](const dr::blocked_range<uint32_t> &range) {
+                for (uint32_t bz = range.begin(); bz != range.end(); ++bz) {
+                    for (uint32_t by = 0; by < m_brick_res.y(); ++by) {
+                        for (uint32_t bx = 0; bx < m_brick_res.x(); ++bx) {
+                            ScalarVector3u lo = ScalarVector3u(bx, by, bz) * B,
+                                           hi = dr::minimum(lo + B, voxel_res);
+                            uint64_t mask = 0;
+                            ScalarBoundingBox3f bbox;
+
+                            for (uint32_t z = lo.z(); z < hi.z(); ++z) {
+                                for (uint32_t y = lo.y(); y < hi.y(); ++y) {
+                                    for (uint32_t x = lo.x(); x < hi.x(); ++x) {
+                                        float f[8];
+                                        for (uint32_t k = 0; k < 8; ++k)
+                                            f[k] = grid[value_index(x + (k & 1),
+                                                                    y + ((k >> 1) & 1),
+                                                                    z + ((k >> 2) & 1))];
+
+                                        auto [occupied, voxel_bbox] = tight_voxel_bbox<float>(f);
+                                        if (!occupied)
+                                            continue;
+
+                                        mask |= (uint64_t) 1
+                                                << (((z - lo.z()) * B + (y - lo.y())) * B + (x - lo.x()));
+
+                                        ScalarPoint3f offset((ScalarFloat) x, (ScalarFloat) y,
+                                                             (ScalarFloat) z);
+                                        bbox.expand(to_world.transform_affine(
+                                            (ScalarPoint3f(voxel_bbox.min) + offset) * voxel_size));
+                                        bbox.expand(to_world.transform_affine(
+                                            (ScalarPoint3f(voxel_bbox.max) + offset) * voxel_size));
+                                    }
+                                }
+                            }
+
+                            size_t brick = ((size_t) bz * m_brick_res.y() + by) * m_brick_res.x() + bx;
+                            masks[brick] = mask;
+                            bboxes[brick] = bbox;
+                        }
                     }
                 }
             }
+        );
+
+        uint32_t count = 0;
+        for (size_t i = 0; i < brick_count; ++i)
+            count += masks[i] != 0;
+
+        m_bboxes_ptr = jit_malloc(AllocType::Host,
+                                  sizeof(InputScalarBoundingBox3f) * count);
+        m_voxel_indices_ptr = (uint32_t *) jit_malloc(
+            AllocType::Host, sizeof(uint32_t) * count);
+        m_brick_masks = std::unique_ptr<uint64_t[]>(new uint64_t[count]);
+
+        InputScalarBoundingBox3f *bboxes_out = (InputScalarBoundingBox3f *) m_bboxes_ptr;
+        uint32_t slot = 0;
+        for (uint32_t brick = 0; brick < brick_count; ++brick) {
+            if (!masks[brick])
+                continue;
+
+            m_voxel_indices_ptr[slot] = brick;
+            m_brick_masks[slot] = masks[brick];
+            bboxes_out[slot] = InputScalarBoundingBox3f(bboxes[brick]);
+            slot++;
         }
 
-        return { aabbs_ptr, voxel_indices_ptr, count };
+        Log(Debug, "SDFGrid: %u of %zu bricks (%u^3 voxels each) contain the surface.",
+            count, brick_count, B);
+
+        return count;
     }
 
     /// Computes the SDF gradient for a given point and its containing voxel
@@ -1132,12 +1248,22 @@ private:
     UInt32 m_jit_voxel_indices;
 
     // Pointers to non-empty bounding boxes and corresponding indices
-    // (These are just the data pointer to the JIT variables aboves.
-    // In scalar variants, these are allocated  using `jit_malloc`)
+    // (In CUDA variants, these are just the data pointer to the JIT variables
+    // aboves and index voxels. In CPU variants, they index bricks and are
+    // allocated using `jit_malloc`)
     void *m_bboxes_ptr = nullptr;
     uint32_t *m_voxel_indices_ptr = nullptr;
 
+    /// Number of primitives (non-empty voxels or bricks)
     uint32_t m_filled_voxel_count = 0;
+
+    /// Number of voxels along each side of a brick (always 1 in CUDA variants)
+    uint32_t m_brick_size = 1;
+    /// Number of bricks along each axis
+    ScalarVector3u m_brick_res;
+    /// Mask of the voxels that contain the surface, for every non-empty brick
+    std::unique_ptr<uint64_t[]> m_brick_masks;
+
     NormalMethod m_normal_method;
 };
 
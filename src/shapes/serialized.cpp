@@ -207,7 +207,7 @@ public:
                     m_vertex_texcoords, m_faces, m_face_normals,
                     has_vertex_normals, has_vertex_texcoords,
                     recompute_vertex_normals, vertex_position, vertex_normal,
-                    initialize)
+                    load_cached, initialize)
     MI_IMPORT_TYPES()
 
     using typename Base::ScalarSize;
@@ -254,151 +254,158 @@ public:
 
         m_name = tfm::format("%s@%i", file_path.filename(), shape_index);
 
-        ref<Stream> stream = new FileStream(file_path);
-        ScopedPhase phase(ProfilerPhase::LoadGeometry);
-        Timer timer;
-        stream->set_byte_order(Stream::ELittleEndian);
-
-        short format = 0, version = 0;
-        stream->read(format);
-        stream->read(version);
-
-        if (format != MI_FILEFORMAT_HEADER)
-            fail("encountered an invalid file format!");
-
-        if (version != MI_FILEFORMAT_VERSION_V3 &&
-            version != MI_FILEFORMAT_VERSION_V4)
-            fail("encountered an incompatible file version!");
-
-        if (shape_index != 0) {
-            size_t file_size = stream->size();
-
-            /* Determine the position of the requested substream. This
-               is stored at the end of the file */
-            stream->seek(file_size - sizeof(uint32_t));
-
-            uint32_t count = 0;
-            stream->read(count);
+        // Instances of the same file share the parsed geometry
+        std::string options = tfm::format("shape_index=%i", shape_index);
+        load_cached(file_path, options, [&]() {
+            ref<Stream> stream = new FileStream(file_path);
+            ScopedPhase phase(ProfilerPhase::LoadGeometry);
+            Timer timer;
+            stream->set_byte_order(Stream::ELittleEndian);
+
+            short format = 0, version = 0;
+            stream->read(format);
+            stream->read(version);
+
+            if (format != MI_FILEFORMAT_HEADER)
+                fail("encountered an invalid file format!");
+
+            if (version != MI_FILEFORMAT_VERSION_V3 &&
+                version != MI_FILEFORMAT_VERSION_V4)
+                fail("encountered an incompatible file version!");
+
+            if (shape_index != 0) {
+                size_t file_size = stream->size();
+
+                /* Determine the position of the requested substream. This
+                   is stored at the end of the file */
+                stream->seek(file_size - sizeof(uint32_t));
+
+                uint32_t count = 0;
+                stream->read(count);
+
+                if (shape_index > (int) count)
+                    fail(tfm::format("Unable to unserialize mesh, shape index is "
+                                     "out of range! (requested %i out of 0..%i)",
+                                     shape_index, count - 1));
+
+                // Seek to the correct position
+                if (version == MI_FILEFORMAT_VERSION_V4) {
+                    stream->seek(file_size -
+                                 sizeof(uint64_t) * (count - shape_index) -
+                                 sizeof(uint32_t));
+                    size_t offset = 0;
+                    stream->read(offset);
+                    stream->seek(offset);
+                } else {
+                    Assert(version == MI_FILEFORMAT_VERSION_V3);
+                    stream->seek(file_size -
+                                 sizeof(uint32_t) * (count - shape_index + 1));
+                    uint32_t offset = 0;
+                    stream->read(offset);
+                    stream->seek(offset);
+                }
+                stream->skip(sizeof(short) * 2); // Skip the header
+            }
 
-            if (shape_index > (int) count)
-                fail(tfm::format("Unable to unserialize mesh, shape index is "
-                                 "out of range! (requested %i out of 0..%i)",
-                                 shape_index, count - 1));
+            stream = new ZStream(stream);
+            stream->set_byte_order(Stream::ELittleEndian);
 
-            // Seek to the correct position
+            uint32_t flags = 0;
+            stream->read(flags);
             if (version == MI_FILEFORMAT_VERSION_V4) {
-                stream->seek(file_size -
-                             sizeof(uint64_t) * (count - shape_index) -
-                             sizeof(uint32_t));
-                size_t offset = 0;
-                stream->read(offset);
-                stream->seek(offset);
-            } else {
-                Assert(version == MI_FILEFORMAT_VERSION_V3);
-                stream->seek(file_size -
-                             sizeof(uint32_t) * (count - shape_index + 1));
-                uint32_t offset = 0;
-                stream->read(offset);
-                stream->seek(offset);
+                char ch = 0;
+                m_name = "";
+                do {
+                    stream->read(ch);
+                    if (ch == 0)
+                        break;
+                    m_name += ch;
+                } while (true);
             }
-            stream->skip(sizeof(short) * 2); // Skip the header
-        }
-
-        stream = new ZStream(stream);
-        stream->set_byte_order(Stream::ELittleEndian);
-
-        uint32_t flags = 0;
-        stream->read(flags);
-        if (version == MI_FILEFORMAT_VERSION_V4) {
-            char ch = 0;
-            m_name = "";
-            do {
-                stream->read(ch);
-                if (ch == 0)
-                    break;
-                m_name += ch;
-            } while (true);
-        }
 
-        size_t vertex_count, face_count;
-        stream->read(vertex_count);
-        stream->read(face_count);
+            size_t vertex_count, face_count;
+            stream->read(vertex_count);
+            stream->read(face_count);
 
-        m_vertex_count = (ScalarSize) vertex_count;
-        m_face_count   = (ScalarSize) face_count;
+            m_vertex_count = (ScalarSize) vertex_count;
+            m_face_count   = (ScalarSize) face_count;
 
-        std::unique_ptr<uint32_t[]> faces(new uint32_t[m_face_count * 3]);
-        std::unique_ptr<float[]> vertex_positions(new float[m_vertex_count * 3]);
-        std::unique_ptr<float[]> vertex_normals(new float[m_vertex_count * 3]);
-        std::unique_ptr<float[]> vertex_texcoords(new float[m_vertex_count * 2]);
+            std::unique_ptr<uint32_t[]> faces(new uint32_t[m_face_count * 3]);
+            std::unique_ptr<float[]> vertex_positions(new float[m_vertex_count * 3]);
+            std::unique_ptr<float[]> vertex_normals(new float[m_vertex_count * 3]);
+            std::unique_ptr<float[]> vertex_texcoords(new float[m_vertex_count * 2]);
 
-        bool double_precision = has_flag(flags, TriMeshFlags::DoublePrecision);
-        bool has_normals      = has_flag(flags, TriMeshFlags::HasNormals);
-        bool has_texcoords    = has_flag(flags, TriMeshFlags::HasTexcoords);
-        bool has_colors       = has_flag(flags, TriMeshFlags::HasColors);
+            bool double_precision = has_flag(flags, TriMeshFlags::DoublePrecision);
+            bool has_normals      = has_flag(flags, TriMeshFlags::HasNormals);
+            bool has_texcoords    = has_flag(flags, TriMeshFlags::HasTexcoords);
+            bool has_colors       = has_flag(flags, TriMeshFlags::HasColors);
 
-        read_helper(stream, double_precision, vertex_positions.get(), 3);
+            read_helper(stream, double_precision, vertex_positions.get(), 3);
 
-        if (has_normals) {
-            if (m_face_normals)
-                // Skip over vertex normals provided in the file.
-                advance_helper(stream, double_precision, 3);
-            else
-                read_helper(stream, double_precision, vertex_normals.get(), 3);
-        }
-
-        if (has_texcoords)
-            read_helper(stream, double_precision, vertex_texcoords.get(), 2);
-
-        if (has_colors)
-            advance_helper(stream, double_precision, 3); // TODO
-
-        stream->read(faces.get(), m_face_count * sizeof(ScalarIndex) * 3);
+            if (has_normals) {
+                if (m_face_normals)
+                    // Skip over vertex normals provided in the file.
+                    advance_helper(stream, double_precision, 3);
+                else
+                    read_helper(stream, double_precision, vertex_normals.get(), 3);
+            }
 
-        // Post-processing
-        InputFloat* position_ptr = vertex_positions.get();
-        InputFloat* normal_ptr   = vertex_normals.get();
-        for (ScalarSize i = 0; i < m_vertex_count; ++i) {
-            InputPoint3f p = m_to_world.scalar().transform_affine(
-                dr::load<InputPoint3f>(position_ptr));
-            dr::store(position_ptr, p);
-            position_ptr += 3;
-            m_bbox.expand(p);
+            if (has_texcoords)
+                read_helper(stream, double_precision, vertex_texcoords.get(), 2);
+
+            if (has_colors)
+                advance_helper(stream, double_precision, 3); // TODO
+
+            stream->read(faces.get(), m_face_count * sizeof(ScalarIndex) * 3);
+
+            // Post-processing
+            InputFloat* position_ptr = vertex_positions.get();
+            InputFloat* normal_ptr   = vertex_normals.get();
+            for (ScalarSize i = 0; i < m_vertex_count; ++i) {
+                InputPoint3f p = m_to_world.scalar().transform_affine(
+                    dr::load<InputPoint3f>(position_ptr));
+                dr::store(position_ptr, p);
+                position_ptr += 3;
+                m_bbox.expand(p);
+
+                if (has_normals) {
+                    InputNormal3f n = dr::load<InputNormal3f>(normal_ptr);
+                    n = dr::normalize(m_to_world.scalar().transform_affine(n));
+                    dr::store(normal_ptr, n);
+                    normal_ptr += 3;
+                }
+            }
 
-            if (has_normals) {
-                InputNormal3f n = dr::load<InputNormal3f>(normal_ptr);
-                n = dr::normalize(m_to_world.scalar().transform_affine(n));
-                dr::store(normal_ptr, n);
-                normal_ptr += 3;
+            m_faces = dr::load<DynamicBuffer<UInt32>>(faces.get(), m_face_count * 3);
+            m_vertex_positions = dr::load<FloatStorage>(vertex_positions.get(), m_vertex_count * 3);
+            if (!m_face_normals)
+                m_vertex_normals = dr::load<FloatStorage>(vertex_normals.get(), m_vertex_count * 3);
+            if (has_texcoords)
+                m_vertex_texcoords = dr::load<FloatStorage>(vertex_texcoords.get(), m_vertex_count * 2);
+
+            size_t vertex_data_bytes = 3 * sizeof(InputFloat);
+            if (!m_face_normals)
+                vertex_data_bytes += 3 * sizeof(InputFloat);
+            if (has_texcoords)
+                vertex_data_bytes += 2 * sizeof(InputFloat);
+
+            Log(Debug, "\"%s\": read %i faces, %i vertices (%s in %s)",
+                m_name, m_face_count, m_vertex_count,
+                util::mem_string(m_face_count * 3 * sizeof(ScalarIndex) +
+                                 m_vertex_count * vertex_data_bytes),
+                util::time_string((float) timer.value())
+            );
+
+            bool compute_normals = !m_face_normals && !has_normals;
+            if (compute_normals) {
+                Timer timer2;
+                recompute_vertex_normals();
+                Log(Debug, "\"%s\": computed vertex normals (took %s)", m_name,
+                    util::time_string((float) timer2.value()));
             }
-        }
 
-        m_faces = dr::load<DynamicBuffer<UInt32>>(faces.get(), m_face_count * 3);
-        m_vertex_positions = dr::load<FloatStorage>(vertex_positions.get(), m_vertex_count * 3);
-        if (!m_face_normals)
-            m_vertex_normals = dr::load<FloatStorage>(vertex_normals.get(), m_vertex_count * 3);
-        if (has_texcoords)
-            m_vertex_texcoords = dr::load<FloatStorage>(vertex_texcoords.get(), m_vertex_count * 2);
-
-        size_t vertex_data_bytes = 3 * sizeof(InputFloat);
-        if (!m_face_normals)
-            vertex_data_bytes += 3 * sizeof(InputFloat);
-        if (has_texcoords)
-            vertex_data_bytes += 2 * sizeof(InputFloat);
-
-        Log(Debug, "\"%s\": read %i faces, %i vertices (%s in %s)",
-            m_name, m_face_count, m_vertex_count,
-            util::mem_string(m_face_count * 3 * sizeof(ScalarIndex) +
-                             m_vertex_count * vertex_data_bytes),
-            util::time_string((float) timer.value())
-        );
-
-        if (!m_face_normals && !has_normals) {
-            Timer timer2;
-            recompute_vertex_normals();
-            Log(Debug, "\"%s\": computed vertex normals (took %s)", m_name,
-                util::time_string((float) timer2.value()));
-        }
+            return compute_normals;
+        });
 
         initialize();
     }
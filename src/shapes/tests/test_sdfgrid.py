@@ -368,3 +368,43 @@ def test09_shape_type(variant_scalar_rgb):
     sdf = mi.load_dict({ "type" : "sdfgrid",
                          "grid" : default_sdf_grid()})
     assert sdf.shape_type() == mi.ShapeType.SDFGrid.value
+
+
+def test10_brick_size(variants_all_ad_rgb):
+    pytest.importorskip("numpy")
+    import numpy as np
+
+    # Sphere of radius 0.3 centered in the grid
+    res = 17
+    p = np.linspace(0, 1, res)
+    z, y, x = np.meshgrid(p, p, p, indexing='ij')
+    sdf_grid = np.sqrt((x - 0.5)**2 + (y - 0.5)**2 + (z - 0.5)**2) - 0.3
+    sdf_grid = mi.TensorXf(sdf_grid.reshape((res, res, res, 1)).astype(np.float32))
+
+    n = 32
+    x, y = dr.meshgrid(dr.linspace(mi.Float, 0.05, 0.95, n),
+                       dr.linspace(mi.Float, 0.05, 0.95, n))
+    ray = mi.Ray3f(o=mi.Point3f(x, y, 2), d=mi.Vector3f(0, 0, -1))
+
+    results = []
+    for brick_size in [1, 4]:
+        scene = mi.load_dict({
+            "type" : "scene",
+            "sdf": {
+                "type" : "sdfgrid",
+                "brick_size" : brick_size,
+                "grid": sdf_grid
+            }
+        })
+        shape = scene.shapes()[0]
+        si = scene.ray_intersect(ray)
+        results.append((shape.primitive_count(), si.is_valid(), si.t))
+
+    count_1, valid_1, t_1 = results[0]
+    count_4, valid_4, t_4 = results[1]
+
+    if not mi.variant().startswith('cuda'):
+        assert count_4 < count_1
+    assert dr.all(valid_1 == valid_4)
+    assert dr.count(valid_1) > 0
+    assert dr.allclose(dr.select(valid_1, t_1, 0), dr.select(valid_4, t_4, 0))
@@ -2,6 +2,7 @@
 #include <mitsuba/core/fresolver.h>
 #include <mitsuba/core/plugin.h>
 #include <mitsuba/core/properties.h>
+#include <mitsuba/core/resourcecache.h>
 #include <mitsuba/core/spectrum.h>
 #include <mitsuba/core/distr_2d.h>
 #include <mitsuba/render/interaction.h>
@@ -9,6 +10,7 @@
 #include <mitsuba/render/srgb.h>
 #include <drjit/tensor.h>
 #include <drjit/texture.h>
+#include <nanothread/nanothread.h>
 #include <mutex>
 
 NAMESPACE_BEGIN(mitsuba)
@@ -49,6 +51,21 @@ Bitmap texture (:monosp:`bitmap`)
      - ``nearest``: disable filtering and interpolation. In this mode, the plugin
        performs nearest neighbor lookups of texture values.
 
+     - ``trilinear``: perform trilinear interpolation within a MIP pyramid. The
+       pyramid level is chosen based on the texture-space footprint of the ray
+       differentials.
+
+     - ``ewa``: anisotropic filtering within a MIP pyramid. The footprint of
+       the ray differentials is approximated by a number of Gaussian-weighted
+       trilinear lookups along the major axis of its ellipse.
+
+ * - max_anisotropy
+   - |float|
+   - Maximum ratio between the major and minor axis of the filter footprint in
+     :monosp:`ewa` mode. Larger values produce sharper results at grazing
+     angles, at the cost of more lookups (one per unit of anisotropy).
+     (Default: 8)
+
  * - wrap_mode
    - |string|
    - Controls the behavior of texture evaluations that fall outside of the
@@ -111,6 +128,15 @@ These conversions can alternatively be disabled with the :paramtype:`raw` flag,
 e.g. when textured data is already in linear space or does not represent colors
 at all.
 
+The :monosp:`trilinear` and :monosp:`ewa` filters build a MIP pyramid of the
+texture when it is loaded (and whenever its data is updated). They use the UV
+partials of the surface interaction, which integrators compute from the ray
+differentials of camera rays. Lookups that do not provide differentials (e.g.
+following a scattering event) fall back to bilinear interpolation of the full
+resolution texture. Spectrally upsampled textures (i.e. 3-channel textures in
+:monosp:`spectral` modes without the :paramtype:`raw` flag) do not support MIP
+filtering.
+
 .. tabs::
     .. code-tab:: xml
         :name: bitmap-texture
@@ -128,6 +154,18 @@ at all.
 
 */
 
+/// Filters that make use of a MIP pyramid
+enum class MIPFilterType {
+    /// No pyramid, only look up the full resolution texture
+    None,
+
+    /// Trilinear interpolation within the pyramid
+    Trilinear,
+
+    /// Anisotropic (elliptically weighted average) filtering
+    EWA
+};
+
 // Forward declaration of specialized bitmap texture
 template <typename Float, typename Spectrum, typename StoredType>
 class BitmapTextureImpl;
@@ -148,13 +186,25 @@ public:
         // Filter mode
         {
             std::string filter_mode_str = props.string("filter_type", "bilinear");
+            m_mip_filter = MIPFilterType::None;
             if (filter_mode_str == "nearest")
                 m_filter_mode = dr::FilterMode::Nearest;
             else if (filter_mode_str == "bilinear")
                 m_filter_mode = dr::FilterMode::Linear;
-            else
-                Throw("Invalid filter type \"%s\", must be one of: \"nearest\", or "
-                      "\"bilinear\"!", filter_mode_str);
+            else if (filter_mode_str == "trilinear") {
+                m_filter_mode = dr::FilterMode::Linear;
+                m_mip_filter = MIPFilterType::Trilinear;
+            } else if (filter_mode_str == "ewa") {
+                m_filter_mode = dr::FilterMode::Linear;
+                m_mip_filter = MIPFilterType::EWA;
+            } else
+                Throw("Invalid filter type \"%s\", must be one of: \"nearest\", "
+                      "\"bilinear\", \"trilinear\", or \"ewa\"!", filter_mode_str);
+
+            m_max_anisotropy = props.get<ScalarFloat>("max_anisotropy", 8.f);
+            if (m_max_anisotropy < 1.f)
+                Throw("The maximum anisotropy must be at least 1 (got %f)!",
+                      m_max_anisotropy);
         }
 
         // Wrap mode
@@ -201,10 +251,16 @@ public:
             } else if (props.has_property("filename")) {
                 // Creates a Bitmap texture by loading an image from the filesystem
                 FileResolver* fs = Thread::thread()->file_resolver();
-                fs::path file_path = fs->resolve(props.string("filename"));
-                m_name = file_path.filename().string();
+                m_file_path = fs->resolve(props.string("filename"));
+                m_name = m_file_path.filename().string();
                 Log(Debug, "Loading bitmap texture from \"%s\" ..", m_name);
-                m_bitmap = new Bitmap(file_path);
+                // Textures referencing the same file share the decoded image
+                m_bitmap = (Bitmap *) ResourceCache::get(
+                    ResourceCache::key(m_file_path, "Bitmap"), [&]() {
+                        ref<Bitmap> bitmap = new Bitmap(m_file_path);
+                        return std::make_pair(ref<Object>(bitmap),
+                                              bitmap->buffer_size());
+                    }).get();
             } else if (props.has_property("data")) {
                 m_tensor = props.tensor<TensorXf>("data");
                 if (m_tensor->ndim() != 3)
@@ -254,6 +310,8 @@ protected:
             m_transform,
             m_filter_mode,
             m_wrap_mode,
+            m_mip_filter,
+            m_max_anisotropy,
             m_raw,
             m_accel,
             tensor);
@@ -263,6 +321,51 @@ protected:
         using StoredScalar           = dr::scalar_t<StoredType>;
         using StoredTensorXf         = dr::replace_scalar_t<TensorXf, StoredScalar>;
 
+        ref<Bitmap> bitmap;
+        if (m_file_path.empty()) {
+            bitmap = convert_bitmap<StoredScalar>();
+        } else {
+            /* The converted image only depends on the options below, textures
+               loaded from the same file can hence share it as well */
+            std::string options = tfm::format(
+                "BitmapTexture|type=%i|raw=%i|spectral=%i",
+                (int) struct_type_v<StoredScalar>, (int) m_raw,
+                (int) is_spectral_v<Spectrum>);
+            bitmap = (Bitmap *) ResourceCache::get(
+                ResourceCache::key(m_file_path, options), [&]() {
+                    ref<Bitmap> result = convert_bitmap<StoredScalar>();
+                    return std::make_pair(ref<Object>(result),
+                                          result->buffer_size());
+                }).get();
+        }
+
+        size_t channels = bitmap->channel_count();
+        ScalarVector2i res = ScalarVector2i(bitmap->size());
+        size_t shape[3] = { (size_t) res.y(), (size_t) res.x(), channels };
+        StoredTensorXf tensor = StoredTensorXf(bitmap->data(), 3, shape);
+
+        Properties props;
+        return new BitmapTextureImpl<Float, Spectrum, StoredType>(
+            props,
+            m_name,
+            m_transform,
+            m_filter_mode,
+            m_wrap_mode,
+            m_mip_filter,
+            m_max_anisotropy,
+            m_raw,
+            m_accel,
+            tensor);
+    }
+
+private:
+    /**
+     * \brief Convert the bitmap into the stored representation of the texture
+     *
+     * Returns a new bitmap, \c m_bitmap is left unchanged since it may be
+     * shared with other textures through the \ref ResourceCache.
+     */
+    template <typename StoredScalar> ref<Bitmap> convert_bitmap() const {
         /* Convert to linear RGB float bitmap, will be converted
            into spectral profile coefficients below (in place) */
         Bitmap::PixelFormat pixel_format = m_bitmap->pixel_format();
@@ -284,54 +387,37 @@ protected:
                       "format (Y[A], RGB[A], XYZ[A] are supported).");
         }
 
-        if (m_raw) {
-            /* Don't undo gamma correction in the conversion below.
-               This is needed, e.g., for normal maps. */
-            m_bitmap->set_srgb_gamma(false);
-        }
-
-        // Convert the image into the working floating point representation
-        m_bitmap =
-            m_bitmap->convert(pixel_format, struct_type_v<StoredScalar>, false);
+        /* Convert the image into the working floating point representation.
+           In raw mode, don't undo gamma correction (needed, e.g., for normal
+           maps). */
+        ref<Bitmap> bitmap =
+            m_bitmap->convert(pixel_format, struct_type_v<StoredScalar>,
+                              m_raw && m_bitmap->srgb_gamma());
+        bitmap->set_srgb_gamma(false);
 
-        if (dr::any(m_bitmap->size() < 2)) {
+        if (dr::any(bitmap->size() < 2)) {
             Log(Warn,
                 "Image must be at least 2x2 pixels in size, up-sampling..");
             using ReconstructionFilter = Bitmap::ReconstructionFilter;
             ref<ReconstructionFilter> rfilter =
                 PluginManager::instance()->create_object<ReconstructionFilter>(
                     Properties("tent"));
-            m_bitmap =
-                m_bitmap->resample(dr::maximum(m_bitmap->size(), 2), rfilter);
+            bitmap =
+                bitmap->resample(dr::maximum(bitmap->size(), 2), rfilter);
         }
 
         if (is_spectral_v<Spectrum> && !m_raw)
-            convert_spectral<StoredScalar>();
+            convert_spectral<StoredScalar>(bitmap);
 
-        size_t channels = m_bitmap->channel_count();
-        ScalarVector2i res = ScalarVector2i(m_bitmap->size());
-        size_t shape[3] = { (size_t) res.y(), (size_t) res.x(), channels };
-        StoredTensorXf tensor = StoredTensorXf(m_bitmap->data(), 3, shape);
-
-        Properties props;
-        return new BitmapTextureImpl<Float, Spectrum, StoredType>(
-            props,
-            m_name,
-            m_transform,
-            m_filter_mode,
-            m_wrap_mode,
-            m_raw,
-            m_accel,
-            tensor);
+        return bitmap;
     }
 
-private:
     /// Convert RGB values to spectral coefficients and store them
-    template <typename StoredScalar> void convert_spectral() const {
-        StoredScalar *ptr = (StoredScalar*) m_bitmap->data();
-        size_t pixel_count = m_bitmap->pixel_count();
+    template <typename StoredScalar> void convert_spectral(Bitmap *bitmap) const {
+        StoredScalar *ptr = (StoredScalar*) bitmap->data();
+        size_t pixel_count = bitmap->pixel_count();
 
-        if (m_bitmap->channel_count() == 3) {
+        if (bitmap->channel_count() == 3) {
             for (size_t i = 0; i < pixel_count; ++i) {
                 ScalarColor3f value = dr::load<ScalarColor3f>(ptr);
                 value = srgb_model_fetch(value);
@@ -351,9 +437,12 @@ private:
     bool m_raw;
     ScalarTransform3f m_transform;
     std::string m_name;
+    fs::path m_file_path;
     dr::FilterMode m_filter_mode;
     dr::WrapMode m_wrap_mode;
-    mutable ref<Bitmap> m_bitmap;
+    MIPFilterType m_mip_filter;
+    ScalarFloat m_max_anisotropy;
+    ref<Bitmap> m_bitmap;
     TensorXf* m_tensor;
 };
 
@@ -366,12 +455,15 @@ public:
     using StoredColor3f          = Color<StoredType, 3>;
     using StoredTensorXf         = dr::replace_scalar_t<TensorXf, StoredScalar>;
     using StoredTexture2f        = dr::Texture<StoredType, 2>;
+    using FloatStorage           = DynamicBuffer<Float>;
 
     BitmapTextureImpl(const Properties &props,
             const std::string& name,
             const ScalarTransform3f& transform,
             dr::FilterMode filter_mode,
             dr::WrapMode wrap_mode,
+            MIPFilterType mip_filter,
+            ScalarFloat max_anisotropy,
             bool raw,
             bool accel,
             StoredTensorXf& tensor) :
@@ -380,13 +472,26 @@ public:
         m_transform(transform),
         m_accel(accel),
         m_raw(raw),
-        m_texture(tensor, accel, accel, filter_mode, wrap_mode) {
+        m_texture(tensor, accel, accel, filter_mode, wrap_mode),
+        m_mip_filter(mip_filter),
+        m_max_anisotropy(max_anisotropy) {
+
+        if (m_mip_filter != MIPFilterType::None && is_spectral_v<Spectrum> &&
+            !m_raw && m_texture.shape()[2] == 3) {
+            Log(Warn, "BitmapTexture: MIP filtering of spectrally upsampled "
+                      "textures is not supported, texture \"%s\" will use "
+                      "bilinear interpolation instead.", m_name);
+            m_mip_filter = MIPFilterType::None;
+        }
 
         /* Compute mean without migrating texture data
            i.e. Avoid call to m_texture.tensor() that triggers migration.
            For CUDA-variants, ideally want to solely keep data as CUDA texture
         */
         rebuild_internals(tensor, true, false);
+
+        if (m_mip_filter != MIPFilterType::None)
+            build_pyramid(tensor);
     }
 
     void traverse(TraversalCallback *callback) override {
@@ -410,6 +515,9 @@ public:
 
             m_texture.set_tensor(m_texture.tensor());
             rebuild_internals(m_texture.tensor(), true, m_distr2d != nullptr);
+
+            if (m_mip_filter != MIPFilterType::None)
+                build_pyramid(m_texture.tensor());
         }
     }
 
@@ -684,11 +792,16 @@ public:
 
     bool is_spatially_varying() const override { return true; }
 
+    bool needs_differentials() const override {
+        return m_mip_filter != MIPFilterType::None;
+    }
+
     std::string to_string() const override {
         std::ostringstream oss;
         oss << "BitmapTexture[" << std::endl
             << "  name = \"" << m_name << "\"," << std::endl
             << "  resolution = \"" << resolution() << "\"," << std::endl
+            << "  mip_levels = " << m_level_count << "," << std::endl
             << "  raw = " << (int) m_raw << "," << std::endl
             << "  mean = " << m_mean << "," << std::endl
             << "  transform = " << string::indent(m_transform) << std::endl
@@ -761,6 +874,12 @@ protected:
         if constexpr (!dr::is_array_v<Mask>)
             active = true;
 
+        if (m_mip_filter != MIPFilterType::None) {
+            Float out;
+            eval_filtered(si, &out, active);
+            return out;
+        }
+
         Point2f uv = m_transform.transform_affine(si.uv);
 
         Float out;
@@ -782,6 +901,12 @@ protected:
         if constexpr (!dr::is_array_v<Mask>)
             active = true;
 
+        if (m_mip_filter != MIPFilterType::None) {
+            Color3f out;
+            eval_filtered(si, out.data(), active);
+            return out;
+        }
+
         Point2f uv = m_transform.transform_affine(si.uv);
 
         Color3f out;
@@ -793,6 +918,249 @@ protected:
         return out;
     }
 
+    /**
+     * \brief Evaluates the texture using the MIP pyramid, based on the UV
+     * partials of the surface interaction
+     */
+    void eval_filtered(const SurfaceInteraction3f &si, Float *out,
+                       Mask active) const {
+        const size_t channels = m_texture.shape()[2];
+        ScalarVector2f res = ScalarVector2f(resolution());
+
+        // Footprint of the ray differentials in texels of the finest level
+        Point2f uv = m_transform.transform_affine(si.uv);
+        Vector2f du = m_transform.transform_affine(si.duv_dx) * res,
+                 dv = m_transform.transform_affine(si.duv_dy) * res;
+        Float len_u = dr::norm(du), len_v = dr::norm(dv);
+
+        if (m_mip_filter == MIPFilterType::Trilinear) {
+            Float width = dr::maximum(len_u, len_v);
+            eval_trilinear(uv, dr::log2(dr::maximum(width, 1e-8f)), out, active);
+            return;
+        }
+
+        /* EWA: select the level based on the minor axis of the footprint
+           ellipse, and average lookups along its major axis using Gaussian
+           weights. The eccentricity is limited by enlarging the minor axis. */
+        Vector2f major = dr::select(len_u >= len_v, du, dv);
+        Float major_len = dr::maximum(len_u, len_v),
+              minor_len = dr::maximum(dr::minimum(len_u, len_v),
+                                      major_len / m_max_anisotropy);
+        Float level = dr::log2(dr::maximum(minor_len, 1e-8f));
+        Vector2f step = major / res;
+
+        uint32_t probe_count = (uint32_t) dr::ceil(m_max_anisotropy);
+        ScalarFloat weight_sum = 0.f;
+        for (size_t c = 0; c < channels; ++c)
+            out[c] = 0.f;
+
+        for (uint32_t i = 0; i < probe_count; ++i) {
+            // Probe offset along the major axis in [-1/2, 1/2]
+            ScalarFloat x = (i + .5f) / probe_count - .5f,
+                        weight = dr::exp(-8.f * x * x);
+
+            Float value[3];
+            eval_trilinear(dr::fmadd(step, x, uv), level, value, active);
+            for (size_t c = 0; c < channels; ++c)
+                out[c] = dr::fmadd(value[c], weight, out[c]);
+            weight_sum += weight;
+        }
+
+        for (size_t c = 0; c < channels; ++c)
+            out[c] *= dr::rcp(weight_sum);
+    }
+
+    /// Trilinearly interpolated lookup at a continuous MIP level
+    void eval_trilinear(const Point2f &uv, const Float &level, Float *out,
+                        Mask active) const {
+        const size_t channels = m_texture.shape()[2];
+
+        Float level_c = dr::clip(level, 0.f, (ScalarFloat) (m_level_count - 1));
+        UInt32 level_0 = dr::floor2int<UInt32>(level_c),
+               level_1 = dr::minimum(level_0 + 1u, m_level_count - 1);
+        Float w1 = level_c - Float(level_0),
+              w0 = 1.f - w1;
+
+        Float v0[3], v1[3];
+        eval_level(uv, level_0, v0, active);
+        eval_level(uv, level_1, v1, active && w1 > 0.f);
+
+        for (size_t c = 0; c < channels; ++c)
+            out[c] = dr::fmadd(w0, v0[c], w1 * v1[c]);
+    }
+
+    /**
+     * \brief Bilinearly interpolated lookup into a given MIP level (per lane).
+     * Lanes that are inactive evaluate to zero.
+     *
+     * Level 0 is the full resolution texture itself.
+     */
+    void eval_level(const Point2f &uv, const UInt32 &level, Float *out,
+                    Mask active) const {
+        const size_t channels = m_texture.shape()[2];
+
+        Mask active_0 = active && level == 0u,
+             active_n = active && level > 0u;
+
+        for (size_t c = 0; c < channels; ++c)
+            out[c] = 0.f;
+
+        if (dr::any_or<true>(active_0)) {
+            Float value[3];
+            if (m_accel)
+                m_texture.template eval<Float>(uv, value, active_0);
+            else
+                m_texture.template eval_nonaccel<Float>(uv, value, active_0);
+
+            for (size_t c = 0; c < channels; ++c)
+                dr::masked(out[c], active_0) = value[c];
+        }
+
+        if (m_level_count == 1 || !dr::any_or<true>(active_n))
+            return;
+
+        UInt32 offset = dr::gather<UInt32>(m_level_offset, level, active_n);
+        Vector2i res(dr::gather<Int32>(m_level_width, level, active_n),
+                     dr::gather<Int32>(m_level_height, level, active_n));
+
+        // Same conventions as the bilinear interpolation of dr::Texture
+        Point2f pos = dr::fmadd(uv, Vector2f(res), -.5f);
+        Vector2i pos_i = dr::floor2int<Vector2i>(pos);
+        Point2f w1 = pos - Point2f(pos_i),
+                w0 = 1.f - w1;
+
+        Vector2i p0 = wrap_level(pos_i, res),
+                 p1 = wrap_level(pos_i + 1, res);
+
+        UInt32 i00 = offset + UInt32(p0.y() * res.x() + p0.x()) * (uint32_t) channels,
+               i10 = offset + UInt32(p0.y() * res.x() + p1.x()) * (uint32_t) channels,
+               i01 = offset + UInt32(p1.y() * res.x() + p0.x()) * (uint32_t) channels,
+               i11 = offset + UInt32(p1.y() * res.x() + p1.x()) * (uint32_t) channels;
+
+        for (uint32_t c = 0; c < (uint32_t) channels; ++c) {
+            Float v00 = dr::gather<Float>(m_pyramid, i00 + c, active_n),
+                  v10 = dr::gather<Float>(m_pyramid, i10 + c, active_n),
+                  v01 = dr::gather<Float>(m_pyramid, i01 + c, active_n),
+                  v11 = dr::gather<Float>(m_pyramid, i11 + c, active_n);
+
+            Float v0 = dr::fmadd(w0.x(), v00, w1.x() * v10),
+                  v1 = dr::fmadd(w0.x(), v01, w1.x() * v11);
+
+            dr::masked(out[c], active_n) = dr::fmadd(w0.y(), v0, w1.y() * v1);
+        }
+    }
+
+    /// Apply the wrap mode to integer texel coordinates of a MIP level
+    Vector2i wrap_level(const Vector2i &p, const Vector2i &res) const {
+        switch (m_texture.wrap_mode()) {
+            case dr::WrapMode::Clamp:
+                return dr::clip(p, 0, res - 1);
+
+            case dr::WrapMode::Mirror: {
+                Vector2i q = p % (2 * res);
+                q = dr::select(q < 0, q + 2 * res, q);
+                return dr::select(q >= res, 2 * res - 1 - q, q);
+            }
+
+            default: {
+                Vector2i q = p % res;
+                return dr::select(q < 0, q + res, q);
+            }
+        }
+    }
+
+    /**
+     * \brief Build the MIP pyramid used by the trilinear and EWA filters
+     *
+     * Each level halves the resolution of the previous one (rounding up)
+     * using a box filter. Levels are stored contiguously in \ref m_pyramid,
+     * except for the full resolution level, which is provided by the texture.
+     */
+    void build_pyramid(const StoredTensorXf &tensor) {
+        const uint32_t channels = (uint32_t) m_texture.shape()[2];
+        ScalarVector2u res = ScalarVector2u(resolution());
+
+        std::vector<uint32_t> offset = { 0 },
+                              width  = { res.x() },
+                              height = { res.y() };
+        size_t size = 0;
+        while (dr::any(res > 1u)) {
+            res = (res + 1u) / 2u;
+            offset.push_back((uint32_t) size);
+            width.push_back(res.x());
+            height.push_back(res.y());
+            size += (size_t) dr::prod(res) * channels;
+        }
+
+        m_level_count = (uint32_t) width.size();
+        m_level_offset = dr::load<DynamicBuffer<UInt32>>(offset.data(), m_level_count);
+        m_level_width = dr::load<DynamicBuffer<Int32>>(width.data(), m_level_count);
+        m_level_height = dr::load<DynamicBuffer<Int32>>(height.data(), m_level_count);
+
+        if constexpr (dr::is_jit_v<Float>) {
+            // Downsample with gathers, which keeps the pyramid differentiable
+            m_pyramid = dr::zeros<FloatStorage>(size);
+            FloatStorage prev = FloatStorage(tensor.array());
+
+            for (uint32_t l = 1; l < m_level_count; ++l) {
+                uint32_t pw = width[l - 1], ph = height[l - 1];
+                UInt32 index = dr::arange<UInt32>(width[l] * height[l]),
+                       y     = index / width[l],
+                       x     = index - y * width[l];
+
+                UInt32 x0 = 2u * x, x1 = dr::minimum(x0 + 1u, pw - 1),
+                       y0 = 2u * y, y1 = dr::minimum(y0 + 1u, ph - 1);
+
+                FloatStorage level = dr::zeros<FloatStorage>(width[l] * height[l] * channels);
+                for (uint32_t c = 0; c < channels; ++c) {
+                    Float value =
+                        .25f * (dr::gather<Float>(prev, (y0 * pw + x0) * channels + c) +
+                                dr::gather<Float>(prev, (y0 * pw + x1) * channels + c) +
+                                dr::gather<Float>(prev, (y1 * pw + x0) * channels + c) +
+                                dr::gather<Float>(prev, (y1 * pw + x1) * channels + c));
+                    dr::scatter(level, value, index * channels + c);
+                    dr::scatter(m_pyramid, value, offset[l] + index * channels + c);
+                }
+
+                dr::eval(level, m_pyramid);
+                prev = level;
+            }
+        } else {
+            m_pyramid = dr::zeros<FloatStorage>(size);
+            ScalarFloat *pyramid = m_pyramid.data();
+
+            auto downsample = [&](const auto *src, uint32_t l) {
+                uint32_t pw = width[l - 1], ph = height[l - 1];
+                ScalarFloat *dst = pyramid + offset[l];
+
+                dr::parallel_for(
+                    dr::blocked_range<uint32_t>(0, height[l], 16),
+                    [&](const dr::blocked_range<uint32_t> &range) {
+                        for (uint32_t y = range.begin(); y != range.end(); ++y) {
+                            uint32_t y0 = 2 * y, y1 = std::min(y0 + 1, ph - 1);
+                            for (uint32_t x = 0; x < width[l]; ++x) {
+                                uint32_t x0 = 2 * x, x1 = std::min(x0 + 1, pw - 1);
+                                for (uint32_t c = 0; c < channels; ++c)
+                                    dst[(y * width[l] + x) * channels + c] = .25f * (
+                                        (ScalarFloat) src[(y0 * pw + x0) * channels + c] +
+                                        (ScalarFloat) src[(y0 * pw + x1) * channels + c] +
+                                        (ScalarFloat) src[(y1 * pw + x0) * channels + c] +
+                                        (ScalarFloat) src[(y1 * pw + x1) * channels + c]);
+                            }
+                        }
+                    }
+                );
+            };
+
+            for (uint32_t l = 1; l < m_level_count; ++l) {
+                if (l == 1)
+                    downsample((const StoredScalar *) tensor.data(), l);
+                else
+                    downsample((const ScalarFloat *) pyramid + offset[l - 1], l);
+            }
+        }
+    }
+
     /**
      * \brief Recompute mean and 2D sampling distribution (if requested)
      * following an update
@@ -884,6 +1252,15 @@ protected:
     Float m_mean;
     StoredTexture2f m_texture;
 
+    // Optional: MIP pyramid for filtered lookups (excluding the full
+    // resolution level) and per-level offsets and resolutions
+    MIPFilterType m_mip_filter;
+    ScalarFloat m_max_anisotropy;
+    uint32_t m_level_count = 1;
+    FloatStorage m_pyramid;
+    DynamicBuffer<UInt32> m_level_offset;
+    DynamicBuffer<Int32> m_level_width, m_level_height;
+
     // Optional: distribution for importance sampling
     mutable std::mutex m_mutex;
     std::unique_ptr<DiscreteDistribution2D<Float>> m_distr2d;
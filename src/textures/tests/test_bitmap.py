@@ -248,4 +248,107 @@ def test06_tensor_load(variants_all_rgb):
         'raw' : True
     })
 
-    assert dr.allclose(bitmap.mean(), 3.0);
\ No newline at end of file
+    assert dr.allclose(bitmap.mean(), 3.0);
+
+@pytest.mark.parametrize('filter_type', ['trilinear', 'ewa'])
+def test07_mip_filter(variants_all_rgb, filter_type):
+    import numpy as np
+
+    # 64x64 checkerboard of 1x1 texels
+    res = 64
+    y, x = np.meshgrid(np.arange(res), np.arange(res), indexing='ij')
+    data = ((x + y) % 2).astype(np.float32).reshape(res, res, 1)
+
+    bilinear = mi.load_dict({
+        'type' : 'bitmap',
+        'data' : mi.TensorXf(data),
+        'raw' : True
+    })
+    filtered = mi.load_dict({
+        'type' : 'bitmap',
+        'data' : mi.TensorXf(data),
+        'filter_type' : filter_type,
+        'raw' : True
+    })
+
+    assert not bilinear.needs_differentials()
+    assert filtered.needs_differentials()
+
+    si = dr.zeros(mi.SurfaceInteraction3f)
+    si.uv = [(3 + 0.5) / res, (7 + 0.25) / res]
+
+    # Without differentials, lookups match bilinear interpolation
+    assert dr.allclose(filtered.eval_1(si), bilinear.eval_1(si))
+
+    # Footprints covering many texels average the checkerboard
+    si.duv_dx = [16 / res, 0]
+    si.duv_dy = [0, 16 / res]
+    assert dr.allclose(filtered.eval_1(si), 0.5, atol=1e-3)
+
+    # BSDFs referencing the texture request UV partials
+    shape = mi.load_dict({
+        'type' : 'sphere',
+        'bsdf' : {
+            'type' : 'diffuse',
+            'reflectance' : {
+                'type' : 'bitmap',
+                'data' : mi.TensorXf(data),
+                'filter_type' : filter_type,
+                'raw' : True
+            }
+        }
+    })
+    assert shape.bsdf().needs_differentials()
+
+
+@fresolver_append_path
+def test08_resource_cache(variants_all_rgb):
+    def load(count, raw=False):
+        scene = { 'type': 'scene' }
+        for i in range(count):
+            scene[f'shape_{i}'] = {
+                'type': 'sphere',
+                'center': [3 * i, 0, 0],
+                'bsdf': {
+                    'type': 'diffuse',
+                    'reflectance': {
+                        'type': 'bitmap',
+                        'filename': 'resources/data/common/textures/carrot.png',
+                        'raw': raw
+                    }
+                }
+            }
+        return mi.load_dict(scene)
+
+    def data(scene):
+        return [mi.traverse(s.bsdf())['reflectance.data'] for s in scene.shapes()]
+
+    mi.ResourceCache.clear()
+    mi.ResourceCache.reset_statistics()
+
+    # The image is decoded and converted once, and then shared
+    scene = load(3)
+    stats = mi.ResourceCache.statistics()
+    assert stats['misses'] == 2 and stats['hits'] == 4
+    assert stats['bytes_saved'] > 0
+
+    # Nothing is held by the cache once the scene is loaded
+    assert stats['entries'] == 0
+
+    # Conversion options are part of the key
+    mi.ResourceCache.reset_statistics()
+    load(1, raw=True)
+    stats = mi.ResourceCache.statistics()
+    assert stats['misses'] == 2 and stats['hits'] == 0
+
+    enabled = mi.ResourceCache.enabled()
+    mi.ResourceCache.set_enabled(False)
+    try:
+        mi.ResourceCache.reset_statistics()
+        reference = load(1)
+        assert mi.ResourceCache.statistics()['misses'] == 0
+    finally:
+        mi.ResourceCache.set_enabled(enabled)
+
+    for values in data(scene):
+        assert dr.allclose(values, data(reference)[0])
@@ -0,0 +1,93 @@
+import numpy as np
+import os
+
+import pytest
+import drjit as dr
+import mitsuba as mi
+
+
+@pytest.mark.parametrize('filter_type', ['nearest', 'bilinear'])
+@pytest.mark.parametrize('wrap_mode', ['repeat', 'clamp', 'mirror'])
+def test01_matches_bitmap(variant_scalar_rgb, tmpdir, filter_type, wrap_mode):
+    rng = np.random.default_rng(seed=0)
+    data = rng.random((19, 27, 3)).astype(np.float32)
+    path = os.path.join(str(tmpdir), "image.exr")
+    mi.Bitmap(data, mi.Bitmap.PixelFormat.RGB).write(path)
+
+    params = {
+        'filename': path,
+        'filter_type': filter_type,
+        'wrap_mode': wrap_mode,
+        'raw': True
+    }
+    reference = mi.load_dict(dict(params, type='bitmap'))
+    tiled = mi.load_dict(dict(params, type='tiledbitmap', tile_size=8))
+
+    # The tiled cache file is created next to the source image
+    assert os.path.exists(path + ".raw.mtc")
+    assert tiled.resolution() == [27, 19]
+    assert dr.allclose(tiled.mean(), reference.mean(), rtol=1e-4)
+
+    si = dr.zeros(mi.SurfaceInteraction3f)
+    for uv in rng.uniform(-1.5, 2.5, size=(200, 2)):
+        si.uv = uv
+        assert dr.allclose(tiled.eval(si), reference.eval(si), atol=1e-5)
+        assert dr.allclose(tiled.eval_1(si), reference.eval_1(si), atol=1e-5)
+
+    # Reloading the texture reuses the existing cache file
+    mtime = os.path.getmtime(path + ".raw.mtc")
+    tiled = mi.load_dict(dict(params, type='tiledbitmap', tile_size=8))
+    assert os.path.getmtime(path + ".raw.mtc") == mtime
+
+
+@pytest.mark.parametrize('record', [False, True])
+def test02_llvm(variant_llvm_ad_rgb, tmpdir, record):
+    rng = np.random.default_rng(seed=0)
+    data = rng.random((40, 30, 1)).astype(np.float32)
+    path = os.path.join(str(tmpdir), "image.exr")
+    mi.Bitmap(data, mi.Bitmap.PixelFormat.Y).write(path)
+
+    reference = mi.load_dict({'type': 'bitmap', 'filename': path, 'raw': True})
+
+    # Tiles are loaded on demand in wavefront mode. Otherwise, the texture
+    # falls back to loading the full image.
+    flags = [dr.JitFlag.LoopRecord, dr.JitFlag.VCallRecord]
+    old_values = [dr.flag(f) for f in flags]
+    try:
+        for f in flags:
+            dr.set_flag(f, record)
+        tiled = mi.load_dict({'type': 'tiledbitmap', 'filename': path,
+                              'raw': True, 'tile_size': 8})
+
+        si = dr.zeros(mi.SurfaceInteraction3f, 1000)
+        si.uv = mi.Point2f(rng.random(1000), rng.random(1000))
+        assert dr.allclose(tiled.eval_1(si), reference.eval_1(si), atol=1e-5)
+    finally:
+        for f, value in zip(flags, old_values):
+            dr.set_flag(f, value)
+
+
+def test03_stale_cache(variant_scalar_rgb, tmpdir):
+    rng = np.random.default_rng(seed=0)
+    path = os.path.join(str(tmpdir), "image.png")
+    cache_path = os.path.join(str(tmpdir), "cache.mtc")
+
+    def load(raw):
+        return mi.load_dict({'type': 'tiledbitmap', 'filename': path,
+                             'cache_file': cache_path, 'raw': raw})
+
+    def check(raw):
+        reference = mi.load_dict({'type': 'bitmap', 'filename': path, 'raw': raw})
+        assert dr.allclose(load(raw).mean(), reference.mean(), rtol=1e-4)
+
+    # An image of the same size and layout replacing the source file
+    for i in range(2):
+        data = rng.integers(0, 256, (16, 16, 3)).astype(np.uint8)
+        mi.Bitmap(data, mi.Bitmap.PixelFormat.RGB).write(path)
+        os.utime(path, ns=(0, (i + 1) * 10**9))
+        check(raw=True)
+
+    # The same cache file must not be shared between raw and non-raw mode
+    # (the latter undoes the sRGB gamma correction of the PNG file)
+    check(raw=False)
+    check(raw=True)
@@ -0,0 +1,573 @@
+#include <mitsuba/core/bitmap.h>
+#include <mitsuba/core/fresolver.h>
+#include <mitsuba/core/plugin.h>
+#include <mitsuba/core/properties.h>
+#include <mitsuba/core/tilecache.h>
+#include <mitsuba/core/timer.h>
+#include <mitsuba/core/util.h>
+#include <mitsuba/render/interaction.h>
+#include <mitsuba/render/srgb.h>
+#include <mitsuba/render/texture.h>
+#include <nanothread/nanothread.h>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**!
+
+.. _texture-tiledbitmap:
+
+Tiled bitmap texture (:monosp:`tiledbitmap`)
+--------------------------------------------
+
+.. pluginparameters::
+
+ * - filename
+   - |string|
+   - Filename of the bitmap to be loaded. This can either be an image in any
+     format supported by the :ref:`bitmap <texture-bitmap>` plugin, or a tiled
+     texture cache file (extension :monosp:`.mtc`).
+
+ * - cache_file
+   - |string|
+   - Path of the tiled texture cache file that is created when
+     :paramtype:`filename` refers to a regular image. (Default: the image
+     filename with an additional :monosp:`.mtc` extension, or
+     :monosp:`.raw.mtc` when :paramtype:`raw` is set)
+
+ * - tile_size
+   - |int|
+   - Number of pixels along each side of a tile of the cache file.
+     (Default: 64)
+
+ * - filter_type
+   - |string|
+   - Specifies how pixel values are interpolated. The following options are
+     currently available:
+
+     - ``bilinear`` (default): perform bilinear interpolation.
+
+     - ``nearest``: perform nearest neighbor lookups.
+
+ * - wrap_mode
+   - |string|
+   - Controls the behavior of texture evaluations that fall outside of the
+     :math:`[0, 1]` range. The following options are currently available:
+
+     - ``repeat`` (default): tile the texture infinitely.
+
+     - ``mirror``: mirror the texture along its boundaries.
+
+     - ``clamp``: clamp coordinates to the edge of the texture.
+
+ * - raw
+   - |bool|
+   - Should the transformation to the stored color data (e.g. sRGB to linear)
+     be disabled? (Default: false)
+
+ * - to_uv
+   - |transform|
+   - Specifies an optional 3x3 transformation matrix that will be applied to UV
+     values. A 4x4 matrix can also be provided, in which case the extra row and
+     column are ignored.
+   - |exposed|
+
+This plugin provides a bitmap texture whose data is not kept in memory.
+Instead, the image is stored on disk as a grid of tiles, which are loaded on
+demand through a global least-recently-used cache that is shared by all tiled
+textures. This makes it possible to render scenes that reference much more
+texture data than fits into memory. The memory budget of the cache (2 GiB by
+default) and its hit/miss statistics are accessible through the
+:monosp:`TileCache` class, e.g. :monosp:`mi.TileCache.set_budget(8 << 30)` and
+:monosp:`mi.TileCache.statistics()` in Python.
+
+The first time an image is used, it is decoded once and converted into a tiled
+cache file (storing linear single precision values), which is reused by
+subsequent renders. The cache file is recreated when the size of the source
+image changes. Cache files can also be created ahead of time using
+:monosp:`mi.TiledImage.write()`.
+
+This plugin is only available in scalar and LLVM variants. In LLVM variants,
+lookups are resolved on the host between kernel launches, which requires the
+wavefront (evaluated) mode for loops and virtual function calls, i.e.
+:monosp:`dr.JitFlag.LoopRecord` and :monosp:`dr.JitFlag.VCallRecord` must be
+disabled when the texture is loaded. Otherwise (the default), a warning is
+printed and the full image is loaded into memory like in the
+:ref:`bitmap <texture-bitmap>` plugin. The texture is not differentiable, and
+spectral upsampling of RGB data is not supported (use :monosp:`raw` data or an
+RGB variant).
+
+.. tabs::
+    .. code-tab:: xml
+        :name: tiledbitmap-texture
+
+        <texture type="tiledbitmap">
+            <string name="filename" value="texture_8k.exr"/>
+        </texture>
+
+    .. code-tab:: python
+
+        'type': 'tiledbitmap',
+        'filename': 'texture_8k.exr'
+
+*/
+
+template <typename Float, typename Spectrum>
+class TiledBitmapTexture final : public Texture<Float, Spectrum> {
+public:
+    MI_IMPORT_TYPES(Texture)
+
+    TiledBitmapTexture(const Properties &props) : Texture(props) {
+        if constexpr (dr::is_cuda_v<Float>)
+            Throw("The tiledbitmap texture is only supported by scalar and "
+                  "LLVM variants!");
+
+        m_transform = props.get<ScalarTransform3f>("to_uv", ScalarTransform3f());
+        m_raw = props.get<bool>("raw", false);
+
+        // Filter mode
+        {
+            std::string filter_mode_str = props.string("filter_type", "bilinear");
+            if (filter_mode_str == "nearest")
+                m_filter_mode = dr::FilterMode::Nearest;
+            else if (filter_mode_str == "bilinear")
+                m_filter_mode = dr::FilterMode::Linear;
+            else
+                Throw("Invalid filter type \"%s\", must be one of: \"nearest\", or "
+                      "\"bilinear\"!", filter_mode_str);
+        }
+
+        // Wrap mode
+        {
+            std::string wrap_mode_str = props.string("wrap_mode", "repeat");
+            if (wrap_mode_str == "repeat")
+                m_wrap_mode = dr::WrapMode::Repeat;
+            else if (wrap_mode_str == "mirror")
+                m_wrap_mode = dr::WrapMode::Mirror;
+            else if (wrap_mode_str == "clamp")
+                m_wrap_mode = dr::WrapMode::Clamp;
+            else
+                Throw("Invalid wrap mode \"%s\", must be one of: \"repeat\", "
+                      "\"mirror\", or \"clamp\"!", wrap_mode_str);
+        }
+
+        int tile_size = props.get<int>("tile_size", 64);
+        if (tile_size < 1)
+            Throw("The tile size must be positive (got %i)!", tile_size);
+
+        FileResolver *fs = Thread::thread()->file_resolver();
+        fs::path file_path = fs->resolve(props.string("filename"));
+        m_name = file_path.filename().string();
+        if (!fs::exists(file_path))
+            Throw("\"%s\": file does not exist!", file_path);
+
+        if (file_path.extension() == ".mtc") {
+            m_image = new TiledImage(file_path);
+        } else {
+            fs::path cache_path;
+            if (props.has_property("cache_file")) {
+                cache_path = props.string("cache_file");
+            } else {
+                cache_path = file_path;
+                cache_path.replace_extension(file_path.extension().string() +
+                                             (m_raw ? ".raw.mtc" : ".mtc"));
+            }
+
+            /* The cache file records the source file it was created from and
+               whether gamma correction was undone, since a user-specified
+               cache file name doesn't encode the latter */
+            uint64_t source_size = (uint64_t) fs::file_size(file_path),
+                     source_time = fs::last_write_time(file_path);
+            uint32_t source_flags = m_raw ? CacheFlagRaw : 0;
+            if (fs::exists(cache_path)) {
+                m_image = new TiledImage(cache_path);
+                if (m_image->source_size() != source_size ||
+                    m_image->source_time() != source_time ||
+                    m_image->source_flags() != source_flags ||
+                    m_image->tile_size() != (uint32_t) tile_size) {
+                    Log(Info, "Tiled texture cache \"%s\" is out of date.",
+                        cache_path);
+                    m_image = nullptr;
+                }
+            }
+
+            if (!m_image) {
+                create_cache(file_path, cache_path, (uint32_t) tile_size,
+                             source_size, source_time, source_flags);
+                m_image = new TiledImage(cache_path);
+            }
+        }
+
+        uint32_t channels = m_image->channel_count();
+        if (channels != 1 && channels != 3)
+            Throw("\"%s\": unsupported channel count %u (expected 1 or 3)!",
+                  m_name, channels);
+        if (is_spectral_v<Spectrum> && !m_raw && channels == 3)
+            Throw("\"%s\": the tiledbitmap texture does not support spectral "
+                  "upsampling, set \"raw\" to true or use an RGB variant.",
+                  m_name);
+
+        if (channels == 1)
+            m_mean = m_image->mean(0);
+        else
+            m_mean = luminance(ScalarColor3f(m_image->mean(0), m_image->mean(1),
+                                             m_image->mean(2)));
+
+        // Host lookups are impossible while recording loops or virtual calls
+        if constexpr (dr::is_jit_v<Float>) {
+            if (jit_flag(JitFlag::LoopRecord) || jit_flag(JitFlag::VCallRecord)) {
+                Log(Warn, "\"%s\": tiles can only be loaded on demand in "
+                    "wavefront mode, i.e. with the LoopRecord and VCallRecord "
+                    "flags disabled. Loading the full image (%s) instead.",
+                    m_name, util::mem_string((size_t) m_image->size().x() *
+                                             m_image->size().y() * channels *
+                                             sizeof(float)));
+                load_texture();
+            }
+        }
+    }
+
+    void traverse(TraversalCallback *callback) override {
+        callback->put_parameter("to_uv", m_transform, +ParamFlags::NonDifferentiable);
+    }
+
+    UnpolarizedSpectrum eval(const SurfaceInteraction3f &si,
+                             Mask active) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<UnpolarizedSpectrum>();
+
+        Color3f value = lookup(si, active);
+        if (m_image->channel_count() == 1)
+            return value.x();
+
+        if constexpr (is_monochromatic_v<Spectrum>)
+            return luminance(value);
+        else if constexpr (is_spectral_v<Spectrum>)
+            Throw("The tiledbitmap texture %s was queried for a spectrum, but "
+                  "texture conversion into spectra was explicitly disabled! "
+                  "(raw=true)", to_string());
+        else
+            return value;
+    }
+
+    Float eval_1(const SurfaceInteraction3f &si,
+                 Mask active = true) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<Float>();
+
+        Color3f value = lookup(si, active);
+        if (m_image->channel_count() == 1)
+            return value.x();
+        return luminance(value);
+    }
+
+    Color3f eval_3(const SurfaceInteraction3f &si,
+                   Mask active = true) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (m_image->channel_count() != 3)
+            Throw("eval_3(): The tiledbitmap texture %s was queried for a RGB "
+                  "value, but it is monochromatic!", to_string());
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<Color3f>();
+
+        return lookup(si, active);
+    }
+
+    ScalarVector2i resolution() const override {
+        return ScalarVector2i(m_image->size());
+    }
+
+    Float mean() const override { return m_mean; }
+
+    bool is_spatially_varying() const override { return true; }
+
+    std::string to_string() const override {
+        std::ostringstream oss;
+        oss << "TiledBitmapTexture[" << std::endl
+            << "  name = \"" << m_name << "\"," << std::endl
+            << "  resolution = \"" << resolution() << "\"," << std::endl
+            << "  tile_size = " << m_image->tile_size() << "," << std::endl
+            << "  cache_file = \"" << m_image->path() << "\"," << std::endl
+            << "  raw = " << (int) m_raw << "," << std::endl
+            << "  mean = " << m_mean << "," << std::endl
+            << "  transform = " << string::indent(m_transform) << std::endl
+            << "]";
+        return oss.str();
+    }
+
+    MI_DECLARE_CLASS()
+
+protected:
+    /// Flag of the tiled texture cache file: gamma correction was not undone
+    static constexpr uint32_t CacheFlagRaw = 1;
+
+    /// Decode an image and store it as a tiled texture cache file
+    void create_cache(const fs::path &source, const fs::path &target,
+                      uint32_t tile_size, uint64_t source_size,
+                      uint64_t source_time, uint32_t source_flags) const {
+        Log(Info, "Creating tiled texture cache \"%s\" ..", target);
+        Timer timer;
+
+        ref<Bitmap> bitmap = new Bitmap(source);
+
+        Bitmap::PixelFormat pixel_format = bitmap->pixel_format();
+        switch (pixel_format) {
+            case Bitmap::PixelFormat::Y:
+            case Bitmap::PixelFormat::YA:
+                pixel_format = Bitmap::PixelFormat::Y;
+                break;
+
+            case Bitmap::PixelFormat::RGB:
+            case Bitmap::PixelFormat::RGBA:
+            case Bitmap::PixelFormat::XYZ:
+            case Bitmap::PixelFormat::XYZA:
+                pixel_format = Bitmap::PixelFormat::RGB;
+                break;
+
+            default:
+                Throw("The texture needs to have a known pixel "
+                      "format (Y[A], RGB[A], XYZ[A] are supported).");
+        }
+
+        // Don't undo gamma correction in the conversion below
+        if (m_raw)
+            bitmap->set_srgb_gamma(false);
+
+        bitmap = bitmap->convert(pixel_format, Struct::Type::Float32, false);
+
+        // Write to a temporary file first to never leave a partial cache file
+        fs::path temp_path(target.string() + ".tmp");
+        TiledImage::write(bitmap, temp_path, tile_size, source_size,
+                          source_time, source_flags);
+        if (fs::exists(target))
+            fs::remove(target);
+        if (!fs::rename(temp_path, target))
+            Throw("Unable to move the tiled texture cache to \"%s\"!", target);
+
+        Log(Info, "Created tiled texture cache \"%s\" (%s, took %s)", target,
+            util::mem_string(fs::file_size(target)),
+            util::time_string((float) timer.value()));
+    }
+
+    /// Assemble the tiles into an in-memory texture (used by recorded JIT modes)
+    void load_texture() {
+        ScalarVector2u size = m_image->size(), tile_count = m_image->tile_count();
+        uint32_t channels = m_image->channel_count(),
+                 tile_size = m_image->tile_size();
+
+        std::unique_ptr<float[]> data(
+            new float[(size_t) size.x() * size.y() * channels]);
+
+        dr::parallel_for(
+            dr::blocked_range<uint32_t>(0, tile_count.y(), 1),
+            [&](const dr::blocked_range<uint32_t> &range) {
+                for (uint32_t ty = range.begin(); ty != range.end(); ++ty) {
+                    for (uint32_t tx = 0; tx < tile_count.x(); ++tx) {
+                        // Bypass the cache, every tile is only read once
+                        TiledImage::Tile tile =
+                            m_image->read_tile(ty * tile_count.x() + tx);
+                        uint32_t x0 = tx * tile_size, y0 = ty * tile_size,
+                                 width  = std::min(tile_size, size.x() - x0),
+                                 height = std::min(tile_size, size.y() - y0);
+                        for (uint32_t y = 0; y < height; ++y)
+                            std::memcpy(
+                                data.get() + ((size_t) (y0 + y) * size.x() + x0) * channels,
+                                tile.get() + (size_t) y * tile_size * channels,
+                                sizeof(float) * width * channels);
+                    }
+                }
+            }
+        );
+
+        size_t shape[3] = { (size_t) size.y(), (size_t) size.x(), channels };
+        m_texture = Texture2f(TensorXf(data.get(), 3, shape), true, false,
+                              m_filter_mode, m_wrap_mode);
+        m_in_memory = true;
+    }
+
+    /// Keeps the last accessed tile alive across nearby lookups
+    struct TileCursor {
+        uint32_t index = (uint32_t) -1;
+        TiledImage::Tile tile;
+    };
+
+    /// Return a pointer to the samples of a pixel, loading its tile if needed
+    MI_INLINE const float *pixel(TileCursor &cursor, uint32_t x, uint32_t y) const {
+        uint32_t tile_size = m_image->tile_size(),
+                 tx = x / tile_size, ty = y / tile_size,
+                 index = ty * m_image->tile_count().x() + tx;
+
+        if (index != cursor.index) {
+            cursor.tile = m_image->tile(tx, ty);
+            cursor.index = index;
+        }
+
+        return cursor.tile.get() +
+               ((y - ty * tile_size) * tile_size + (x - tx * tile_size)) *
+                   m_image->channel_count();
+    }
+
+    /// Apply the wrap mode to an integer pixel coordinate
+    MI_INLINE int32_t wrap(int32_t x, int32_t size) const {
+        auto mod = [](int32_t a, int32_t b) {
+            int32_t r = a % b;
+            return r < 0 ? r + b : r;
+        };
+
+        switch (m_wrap_mode) {
+            case dr::WrapMode::Clamp:
+                return std::clamp(x, 0, size - 1);
+
+            case dr::WrapMode::Mirror:
+                x = mod(x, 2 * size);
+                return x >= size ? 2 * size - 1 - x : x;
+
+            default:
+                return mod(x, size);
+        }
+    }
+
+    /// Look up a single UV coordinate on the host
+    void lookup_host(ScalarFloat u, ScalarFloat v, ScalarFloat *out,
+                     TileCursor &cursor) const {
+        const uint32_t channels = m_image->channel_count();
+        for (uint32_t c = 0; c < channels; ++c)
+            out[c] = 0.f;
+
+        if (!std::isfinite(u) || !std::isfinite(v))
+            return;
+
+        int32_t width  = (int32_t) m_image->size().x(),
+                height = (int32_t) m_image->size().y();
+
+        // Avoid integer overflow for huge texture coordinates
+        if (m_wrap_mode == dr::WrapMode::Repeat) {
+            u -= dr::floor(u);
+            v -= dr::floor(v);
+        } else if (m_wrap_mode == dr::WrapMode::Mirror) {
+            u -= 2 * dr::floor(u * .5f);
+            v -= 2 * dr::floor(v * .5f);
+        } else {
+            u = dr::clip(u, -1.f, 2.f);
+            v = dr::clip(v, -1.f, 2.f);
+        }
+
+        if (m_filter_mode == dr::FilterMode::Nearest) {
+            int32_t x = wrap((int32_t) dr::floor(u * width), width),
+                    y = wrap((int32_t) dr::floor(v * height), height);
+
+            const float *value = pixel(cursor, (uint32_t) x, (uint32_t) y);
+            for (uint32_t c = 0; c < channels; ++c)
+                out[c] = value[c];
+            return;
+        }
+
+        // Same conventions as the bilinear interpolation of dr::Texture
+        ScalarFloat px = dr::fmadd(u, (ScalarFloat) width, -.5f),
+                    py = dr::fmadd(v, (ScalarFloat) height, -.5f),
+                    fx = dr::floor(px), fy = dr::floor(py);
+        ScalarFloat w1x = px - fx, w1y = py - fy,
+                    w0x = 1.f - w1x, w0y = 1.f - w1y;
+
+        int32_t x0 = wrap((int32_t) fx, width),
+                x1 = wrap((int32_t) fx + 1, width),
+                y0 = wrap((int32_t) fy, height),
+                y1 = wrap((int32_t) fy + 1, height);
+
+        const int32_t xs[2] = { x0, x1 }, ys[2] = { y0, y1 };
+        const ScalarFloat wx[2] = { w0x, w1x }, wy[2] = { w0y, w1y };
+
+        for (int j = 0; j < 2; ++j) {
+            for (int i = 0; i < 2; ++i) {
+                const float *value = pixel(cursor, (uint32_t) xs[i], (uint32_t) ys[j]);
+                ScalarFloat weight = wx[i] * wy[j];
+                for (uint32_t c = 0; c < channels; ++c)
+                    out[c] = dr::fmadd((ScalarFloat) value[c], weight, out[c]);
+            }
+        }
+    }
+
+    /**
+     * \brief Evaluates all channels of the texture at the given surface
+     * interaction (the remaining entries of the result are zero)
+     */
+    Color3f lookup(const SurfaceInteraction3f &si, Mask active) const {
+        Point2f uv = m_transform.transform_affine(si.uv);
+
+        if constexpr (!dr::is_jit_v<Float>) {
+            DRJIT_MARK_USED(active);
+            Color3f result;
+            TileCursor cursor;
+            lookup_host(uv.x(), uv.y(), result.data(), cursor);
+            return result;
+        } else {
+            if (m_in_memory) {
+                Color3f result = dr::zeros<Color3f>();
+                m_texture.template eval<Float>(uv, result.data(), active);
+                return result;
+            }
+
+            if (jit_flag(JitFlag::LoopRecord) || jit_flag(JitFlag::VCallRecord))
+                Throw("The tiledbitmap texture %s was loaded in wavefront mode "
+                      "and can only be evaluated in this mode, please disable "
+                      "the LoopRecord and VCallRecord flags.", m_name);
+
+            Float u = uv.x(), v = uv.y();
+            Mask valid = active;
+            size_t n = std::max({ dr::width(u), dr::width(v), dr::width(valid) });
+
+            // Evaluate the coordinates and access them from the host
+            dr::make_opaque(u, v, valid);
+            dr::sync_thread();
+
+            const ScalarFloat *u_ptr = u.data(), *v_ptr = v.data();
+            const bool *valid_ptr = valid.data();
+            size_t u_step = dr::width(u) > 1, v_step = dr::width(v) > 1,
+                   valid_step = dr::width(valid) > 1;
+
+            std::unique_ptr<ScalarFloat[]> result(new ScalarFloat[3 * n]);
+
+            dr::parallel_for(
+                dr::blocked_range<size_t>(0, n, 1024),
+                [&](const dr::blocked_range<size_t> &range) {
+                    TileCursor cursor;
+                    ScalarFloat value[3];
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        value[0] = value[1] = value[2] = 0.f;
+                        if (valid_ptr[i * valid_step])
+                            lookup_host(u_ptr[i * u_step], v_ptr[i * v_step],
+                                        value, cursor);
+                        for (size_t c = 0; c < 3; ++c)
+                            result[c * n + i] = value[c];
+                    }
+                }
+            );
+
+            return Color3f(dr::load<Float>(result.get(), n),
+                           dr::load<Float>(result.get() + n, n),
+                           dr::load<Float>(result.get() + 2 * n, n));
+        }
+    }
+
+protected:
+    ref<TiledImage> m_image;
+    std::string m_name;
+    ScalarTransform3f m_transform;
+    dr::FilterMode m_filter_mode;
+    dr::WrapMode m_wrap_mode;
+    bool m_raw;
+    Float m_mean;
+
+    /// Full image, only loaded when tiles can't be loaded on demand
+    Texture2f m_texture;
+    bool m_in_memory = false;
+};
+
+MI_IMPLEMENT_CLASS_VARIANT(TiledBitmapTexture, Texture)
+MI_EXPORT_PLUGIN(TiledBitmapTexture, "Tiled bitmap texture")
+NAMESPACE_END(mitsuba)
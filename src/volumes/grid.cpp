@@ -184,6 +184,7 @@ public:
             Throw("Invalid wrap mode \"%s\", must be one of: \"repeat\", "
                   "\"mirror\", or \"clamp\"!",
                   wrap_mode_st);
+        m_wrap_mode = wrap_mode;
 
         m_raw = props.get<bool>("raw", false);
         m_accel = props.get<bool>("accel", true);
@@ -434,6 +435,85 @@ public:
             out[i] = m_max_per_channel[i];
     }
 
+    void max_per_cell(const ScalarVector3i &cell_res,
+                      ScalarFloat *out) const override {
+        if (m_fixed_max) {
+            Base::max_per_cell(cell_res, out);
+            return;
+        }
+
+        auto &&data = dr::migrate(m_texture.tensor().array(), AllocType::Host);
+
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+
+        const ScalarFloat *ptr = (const ScalarFloat *) data.data();
+        ScalarVector3i res = resolution();
+        size_t channels = m_texture.shape()[3],
+               voxel_count = dr::prod(ScalarVector3u(res));
+
+        /* Reduce the channels of every voxel to a single bound. Spectrally
+           upsampled data is bounded by the scale stored in the last
+           channel. */
+        bool upsampled = is_spectral_v<Spectrum> && channels == 4 && !m_raw;
+        std::unique_ptr<ScalarFloat[]> voxel_max(new ScalarFloat[voxel_count]);
+        for (size_t i = 0; i < voxel_count; ++i) {
+            const ScalarFloat *voxel = ptr + i * channels;
+            ScalarFloat value = voxel[channels - 1];
+            if (!upsampled) {
+                for (size_t j = 0; j + 1 < channels; ++j)
+                    value = dr::maximum(value, voxel[j]);
+            }
+            voxel_max[i] = value;
+        }
+
+        ScalarVector3f cell_size = m_bbox.extents() / ScalarVector3f(cell_res);
+
+        for (int z = 0; z < cell_res.z(); ++z) {
+            for (int y = 0; y < cell_res.y(); ++y) {
+                for (int x = 0; x < cell_res.x(); ++x) {
+                    // Local-space bounds of the cell
+                    ScalarPoint3f p_min =
+                        m_bbox.min + ScalarVector3f(x, y, z) * cell_size;
+                    ScalarBoundingBox3f local_bbox;
+                    for (int k = 0; k < 8; ++k) {
+                        ScalarVector3f corner((ScalarFloat) (k & 1),
+                                              (ScalarFloat) ((k >> 1) & 1),
+                                              (ScalarFloat) ((k >> 2) & 1));
+                        local_bbox.expand(m_to_local * (p_min + corner * cell_size));
+                    }
+
+                    /* Range of voxels that influence the cell (conservative
+                       for both nearest and trilinear interpolation) */
+                    ScalarVector3i lo, hi;
+                    for (int i = 0; i < 3; ++i) {
+                        lo[i] = (int) dr::floor(local_bbox.min[i] * res[i] - .5f);
+                        hi[i] = (int) dr::floor(local_bbox.max[i] * res[i] - .5f) + 1;
+                        if (m_wrap_mode == dr::WrapMode::Clamp ||
+                            (lo[i] >= 0 && hi[i] < res[i])) {
+                            lo[i] = dr::clip(lo[i], 0, res[i] - 1);
+                            hi[i] = dr::clip(hi[i], 0, res[i] - 1);
+                        } else {
+                            // Repeated/mirrored lookups: use the entire axis
+                            lo[i] = 0;
+                            hi[i] = res[i] - 1;
+                        }
+                    }
+
+                    ScalarFloat value = 0.f;
+                    for (int vz = lo.z(); vz <= hi.z(); ++vz)
+                        for (int vy = lo.y(); vy <= hi.y(); ++vy)
+                            for (int vx = lo.x(); vx <= hi.x(); ++vx)
+                                value = dr::maximum(
+                                    value,
+                                    voxel_max[((size_t) vz * res.y() + vy) * res.x() + vx]);
+
+                    out[((size_t) z * cell_res.y() + y) * cell_res.x() + x] = value;
+                }
+            }
+        }
+    }
+
     ScalarVector3i resolution() const override {
         const size_t *shape = m_texture.shape();
         return { (int) shape[2], (int) shape[1], (int) shape[0] };
@@ -622,6 +702,7 @@ protected:
     Texture3f m_texture;
     bool m_accel;
     bool m_raw;
+    dr::WrapMode m_wrap_mode;
     bool m_fixed_max = false;
     ScalarFloat m_max;
     std::vector<ScalarFloat> m_max_per_channel;
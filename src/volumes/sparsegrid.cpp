@@ -0,0 +1,571 @@
+#include <mitsuba/core/fresolver.h>
+#include <mitsuba/core/fstream.h>
+#include <mitsuba/core/properties.h>
+#include <mitsuba/core/spectrum.h>
+#include <mitsuba/core/string.h>
+#include <mitsuba/core/transform.h>
+#include <mitsuba/render/srgb.h>
+#include <mitsuba/render/volume.h>
+#include <mitsuba/render/volumegrid.h>
+#include <mitsuba/render/sparsevolumegrid.h>
+#include <drjit/dynamic.h>
+#include <algorithm>
+
+NAMESPACE_BEGIN(mitsuba)
+
+/**!
+.. _volume-sparsegridvolume:
+
+Sparse grid-based volume data source (:monosp:`sparsegridvolume`)
+-----------------------------------------------------------------
+
+.. pluginparameters::
+
+ * - filename
+   - |string|
+   - Filename of the volume to be loaded. Both the sparse volume format
+     described below and the dense format of the :ref:`gridvolume
+     <volume-gridvolume>` plugin (which is converted at load time) are
+     supported.
+
+ * - grid
+   - :monosp:`SparseVolumeGrid` or :monosp:`VolumeGrid object`
+   - When creating a sparse grid volume at runtime, e.g. from Python or C++,
+     an existing grid can be passed directly rather than loading it from the
+     filesystem with :paramtype:`filename`. Dense grids are converted.
+
+ * - threshold
+   - |float|
+   - Bricks of a dense grid in which no value has a magnitude larger than the
+     threshold are discarded when converting it to sparse storage.
+     (Default: 0)
+
+ * - brick_size
+   - |int|
+   - Number of voxels along each side of a brick when converting a dense
+     grid to sparse storage. (Default: 8)
+
+ * - use_grid_bbox
+   - |bool|
+   - When set to ``true``, the bounding box information contained in the
+     grid (or the file it was loaded from) will be used. (Default: false)
+
+ * - filter_type
+   - |string|
+   - Specifies how voxel values are interpolated: ``trilinear`` (default) or
+     ``nearest``.
+
+ * - wrap_mode
+   - |string|
+   - Controls the behavior of volume evaluations that fall outside of the
+     :math:`[0, 1]` range: ``clamp`` (default), ``repeat`` or ``mirror``.
+
+ * - to_world
+   - |transform|
+   - Specifies an optional 4x4 transformation matrix that will be applied to volume coordinates.
+
+ * - data
+   - |tensor|
+   - Brick pool of the sparse grid.
+   - |exposed|, |differentiable|
+
+This plugin provides the same lookups as :ref:`gridvolume <volume-gridvolume>`
+but stores the voxel data sparsely: the grid is partitioned into bricks of
+:math:`8^3` voxels, and only bricks containing nonzero values are kept in
+memory. A dense top-level index maps each brick-sized region ("tile") of the
+grid to its brick, or to a reserved brick of zeros. Lookups into empty tiles
+skip the brick data altogether. This is a large memory saving for explosion
+and smoke simulations, which are mostly empty. Unlike :ref:`gridvolume
+<volume-gridvolume>`, spectral upsampling is not supported: 3-channel data
+can only be evaluated as spectra in RGB and monochromatic variants, or
+queried with ``eval_3()``.
+
+The maximum of every brick is tracked, and used to compute tight local
+majorants. When the volume serves as the extinction coefficient of a
+:ref:`heterogeneous <medium-heterogeneous>` medium, setting its
+``majorant_resolution`` (ideally close to the number of bricks along each
+axis) lets delta tracking skip over empty regions.
+
+The sparse volume format is little endian, and is specified as follows:
+
+.. list-table:: Sparse volume file format
+   :widths: 8 30
+   :header-rows: 1
+
+   * - Position
+     - Content
+   * - Bytes 1-3
+     - ASCII Bytes ’S’, ’V’, and ’L’
+   * - Byte 4
+     - File format version number (currently 1)
+   * - Bytes 5-8
+     - Encoding identifier (32-bit integer). Currently, only a value of 1 is
+       supported (float32-based representation)
+   * - Bytes 9-20
+     - Number of voxels along the X, Y and Z axes (32 bit integers)
+   * - Bytes 21-24
+     - Number of channels (32 bit integer, supported values: 1, 3 or 6)
+   * - Bytes 25-48
+     - Axis-aligned bounding box of the data stored in single precision (order:
+       xmin, ymin, zmin, xmax, ymax, zmax)
+   * - Bytes 49-52
+     - Brick size :math:`B` (32 bit integer)
+   * - Bytes 53-56
+     - Number of stored bricks :math:`N` (32 bit integer)
+   * - Bytes 57-*
+     - Top-level index: one 32 bit unsigned integer per tile, ordered as
+       :code:`tiles[(tz*ty_res + ty)*tx_res + tx]`, where the tile resolution
+       is the voxel resolution divided by :math:`B` (rounded up). A value of 0
+       denotes an empty tile, and a value :math:`k > 0` refers to the
+       :math:`k`-th stored brick.
+   * - Followed by
+     - :math:`N` bricks of :math:`B^3` voxels in float32 encoding, each
+       ordered as :code:`brick[((z*B + y)*B + x)*channels + chan]`.
+
+.. tabs::
+    .. code-tab:: xml
+
+        <medium type="heterogeneous">
+            <volume type="sparsegridvolume" name="sigma_t">
+                <string name="filename" value="explosion.vol"/>
+            </volume>
+            <integer name="majorant_resolution" value="32"/>
+        </medium>
+
+    .. code-tab:: python
+
+        'type': 'heterogeneous',
+        'sigma_t': {
+            'type': 'sparsegridvolume',
+            'filename': 'explosion.vol'
+        },
+        'majorant_resolution': 32
+
+*/
+template <typename Float, typename Spectrum>
+class SparseGridVolume final : public Volume<Float, Spectrum> {
+public:
+    MI_IMPORT_BASE(Volume, update_bbox, m_to_local, m_bbox, m_channel_count)
+    MI_IMPORT_TYPES(VolumeGrid, SparseVolumeGrid)
+
+    SparseGridVolume(const Properties &props) : Base(props) {
+        std::string filter_type_str = props.string("filter_type", "trilinear");
+        if (filter_type_str == "nearest")
+            m_linear = false;
+        else if (filter_type_str == "trilinear")
+            m_linear = true;
+        else
+            Throw("Invalid filter type \"%s\", must be one of: \"nearest\" or "
+                  "\"trilinear\"!", filter_type_str);
+
+        std::string wrap_mode_st = props.string("wrap_mode", "clamp");
+        if (wrap_mode_st == "repeat")
+            m_wrap_mode = dr::WrapMode::Repeat;
+        else if (wrap_mode_st == "mirror")
+            m_wrap_mode = dr::WrapMode::Mirror;
+        else if (wrap_mode_st == "clamp")
+            m_wrap_mode = dr::WrapMode::Clamp;
+        else
+            Throw("Invalid wrap mode \"%s\", must be one of: \"repeat\", "
+                  "\"mirror\", or \"clamp\"!", wrap_mode_st);
+
+        ScalarFloat threshold = props.get<ScalarFloat>("threshold", 0.f);
+        int brick_size = props.get<int>("brick_size", 8);
+        if (brick_size <= 0)
+            Throw("The brick size must be positive!");
+
+        ref<SparseVolumeGrid> grid;
+        if (props.has_property("grid")) {
+            if (props.has_property("filename"))
+                Throw("Cannot specify both \"grid\" and \"filename\".");
+            ref<Object> other = props.object("grid");
+            if (auto *sparse = dynamic_cast<SparseVolumeGrid *>(other.get()))
+                grid = sparse;
+            else if (auto *dense = dynamic_cast<VolumeGrid *>(other.get()))
+                grid = new SparseVolumeGrid(dense, threshold, (uint32_t) brick_size);
+            else
+                Throw("Property \"grid\" must be a SparseVolumeGrid or "
+                      "VolumeGrid instance.");
+        } else {
+            FileResolver *fs = Thread::thread()->file_resolver();
+            fs::path file_path = fs->resolve(props.string("filename"));
+            if (!fs::exists(file_path))
+                Log(Error, "\"%s\": file does not exist!", file_path);
+
+            ref<FileStream> stream = new FileStream(file_path);
+            char header[3];
+            stream->read(header, 3);
+            stream->seek(0);
+
+            // Dense files are converted with the requested parameters
+            if (header[0] == 'V' && header[1] == 'O' && header[2] == 'L') {
+                ref<VolumeGrid> dense = new VolumeGrid(stream.get());
+                grid = new SparseVolumeGrid(dense.get(), threshold, (uint32_t) brick_size);
+            } else {
+                grid = new SparseVolumeGrid(stream.get());
+            }
+        }
+
+        m_channel_count = (uint32_t) grid->channel_count();
+        if (m_channel_count != 1 && m_channel_count != 3 && m_channel_count != 6)
+            Throw("Only sparse volumes with 1, 3 or 6 channels are supported "
+                  "(got %u)!", m_channel_count);
+
+        m_size       = grid->size();
+        m_tile_count = grid->tile_count();
+        m_brick_size = grid->brick_size();
+        m_tiles  = dr::load<DynamicBuffer<UInt32>>(grid->tiles(), dr::prod(m_tile_count));
+        m_bricks = dr::load<FloatStorage>(
+            grid->bricks(), grid->brick_count() * brick_voxels() * m_channel_count);
+        m_tile_max = grid->tile_max();
+        m_max = grid->max();
+        m_max_per_channel.resize(m_channel_count);
+        grid->max_per_channel(m_max_per_channel.data());
+
+        if (props.get<bool>("use_grid_bbox", false)) {
+            m_to_local = grid->bbox_transform() * m_to_local;
+            update_bbox();
+        }
+
+        if (props.has_property("max_value")) {
+            m_fixed_max = true;
+            m_max = props.get<ScalarFloat>("max_value");
+        }
+    }
+
+    void traverse(TraversalCallback *callback) override {
+        callback->put_parameter("data", m_bricks, +ParamFlags::Differentiable);
+        Base::traverse(callback);
+    }
+
+    void parameters_changed(const std::vector<std::string> &keys) override {
+        if (keys.empty() || string::contains(keys, "data")) {
+            std::vector<uint32_t> tiles = tiles_host();
+            size_t expected = (*std::max_element(tiles.begin(), tiles.end()) + 1) *
+                              brick_voxels() * m_channel_count;
+            if (m_bricks.size() != expected)
+                Throw("parameters_changed(): The brick pool of %s must contain "
+                      "%zu values (got %zu)!", to_string(), expected,
+                      m_bricks.size());
+            update_max();
+        }
+    }
+
+    UnpolarizedSpectrum eval(const Interaction3f &it,
+                             Mask active) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (m_channel_count == 3 && is_spectral_v<Spectrum>)
+            Throw("The SparseGridVolume texture %s was queried for a spectrum, "
+                  "but spectral upsampling of sparse volumes is not supported!",
+                  to_string());
+        else if (m_channel_count != 3 && m_channel_count != 1)
+            Throw("The SparseGridVolume texture %s was queried for a spectrum, "
+                  "but has a number of channels which is not 1 or 3",
+                  to_string());
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<UnpolarizedSpectrum>();
+
+        if (m_channel_count == 1) {
+            Float result;
+            interpolate(it, &result, active);
+            return result;
+        } else {
+            Color3f result;
+            interpolate(it, result.data(), active);
+            if constexpr (is_monochromatic_v<Spectrum>)
+                return luminance(result);
+            else
+                return result;
+        }
+    }
+
+    Float eval_1(const Interaction3f &it, Mask active = true) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<Float>();
+
+        if (m_channel_count == 1) {
+            Float result;
+            interpolate(it, &result, active);
+            return result;
+        } else if (m_channel_count == 3) {
+            Color3f result;
+            interpolate(it, result.data(), active);
+            return luminance(result);
+        } else {
+            dr::Array<Float, 6> result;
+            interpolate(it, result.data(), active);
+            return dr::mean(result);
+        }
+    }
+
+    Vector3f eval_3(const Interaction3f &it,
+                    Mask active = true) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (m_channel_count != 3)
+            Throw("eval_3(): The SparseGridVolume texture %s was queried for "
+                  "a 3D vector, but it has %s channel(s)", to_string(),
+                  m_channel_count);
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<Vector3f>();
+
+        Vector3f result;
+        interpolate(it, result.data(), active);
+        return result;
+    }
+
+    dr::Array<Float, 6> eval_6(const Interaction3f &it,
+                               Mask active = true) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+
+        if (m_channel_count != 6)
+            Throw("eval_6(): The SparseGridVolume texture %s was queried for "
+                  "a 6D vector, but it has %s channel(s)", to_string(),
+                  m_channel_count);
+
+        if (dr::none_or<false>(active))
+            return dr::zeros<dr::Array<Float, 6>>();
+
+        dr::Array<Float, 6> result;
+        interpolate(it, result.data(), active);
+        return result;
+    }
+
+    void eval_n(const Interaction3f &it, Float *out,
+                Mask active = true) const override {
+        MI_MASKED_FUNCTION(ProfilerPhase::TextureEvaluate, active);
+        interpolate(it, out, active);
+    }
+
+    ScalarFloat max() const override { return m_max; }
+
+    void max_per_channel(ScalarFloat *out) const override {
+        for (size_t i = 0; i < m_max_per_channel.size(); ++i)
+            out[i] = m_max_per_channel[i];
+    }
+
+    void max_per_cell(const ScalarVector3i &cell_res,
+                      ScalarFloat *out) const override {
+        if (m_fixed_max) {
+            Base::max_per_cell(cell_res, out);
+            return;
+        }
+
+        ScalarVector3i res(m_size), tiles(m_tile_count);
+        ScalarVector3f cell_size = m_bbox.extents() / ScalarVector3f(cell_res);
+        int B = (int) m_brick_size;
+
+        for (int z = 0; z < cell_res.z(); ++z) {
+            for (int y = 0; y < cell_res.y(); ++y) {
+                for (int x = 0; x < cell_res.x(); ++x) {
+                    // Local-space bounds of the cell
+                    ScalarPoint3f p_min =
+                        m_bbox.min + ScalarVector3f(x, y, z) * cell_size;
+                    ScalarBoundingBox3f local_bbox;
+                    for (int k = 0; k < 8; ++k) {
+                        ScalarVector3f corner((ScalarFloat) (k & 1),
+                                              (ScalarFloat) ((k >> 1) & 1),
+                                              (ScalarFloat) ((k >> 2) & 1));
+                        local_bbox.expand(m_to_local * (p_min + corner * cell_size));
+                    }
+
+                    // Range of tiles holding voxels that influence the cell
+                    ScalarVector3i lo, hi;
+                    for (int i = 0; i < 3; ++i) {
+                        lo[i] = (int) dr::floor(local_bbox.min[i] * res[i] - .5f);
+                        hi[i] = (int) dr::floor(local_bbox.max[i] * res[i] - .5f) + 1;
+                        if (m_wrap_mode == dr::WrapMode::Clamp ||
+                            (lo[i] >= 0 && hi[i] < res[i])) {
+                            lo[i] = dr::clip(lo[i], 0, res[i] - 1) / B;
+                            hi[i] = dr::clip(hi[i], 0, res[i] - 1) / B;
+                        } else {
+                            lo[i] = 0;
+                            hi[i] = tiles[i] - 1;
+                        }
+                    }
+
+                    ScalarFloat value = 0.f;
+                    for (int tz = lo.z(); tz <= hi.z(); ++tz)
+                        for (int ty = lo.y(); ty <= hi.y(); ++ty)
+                            for (int tx = lo.x(); tx <= hi.x(); ++tx)
+                                value = dr::maximum(
+                                    value,
+                                    m_tile_max[((size_t) tz * tiles.y() + ty) * tiles.x() + tx]);
+
+                    out[((size_t) z * cell_res.y() + y) * cell_res.x() + x] = value;
+                }
+            }
+        }
+    }
+
+    ScalarVector3i resolution() const override {
+        return ScalarVector3i(m_size);
+    }
+
+    std::string to_string() const override {
+        std::ostringstream oss;
+        oss << "SparseGridVolume[" << std::endl
+            << "  to_local = " << string::indent(m_to_local, 13) << "," << std::endl
+            << "  bbox = " << string::indent(m_bbox) << "," << std::endl
+            << "  dimensions = " << resolution() << "," << std::endl
+            << "  brick_size = " << m_brick_size << "," << std::endl
+            << "  bricks = " << m_bricks.size() / (brick_voxels() * m_channel_count) - 1
+            << " / " << dr::prod(m_tile_count) << "," << std::endl
+            << "  max = " << m_max << "," << std::endl
+            << "  channels = " << m_channel_count << std::endl
+            << "]";
+        return oss.str();
+    }
+
+    MI_DECLARE_CLASS()
+
+protected:
+    /// Map integer voxel coordinates into the grid according to the wrap mode
+    Vector3i wrap(const Vector3i &p) const {
+        Vector3i res(m_size);
+        if (m_wrap_mode == dr::WrapMode::Clamp) {
+            return dr::clip(p, 0, res - 1);
+        } else if (m_wrap_mode == dr::WrapMode::Repeat) {
+            Vector3i r = p % res;
+            return dr::select(r < 0, r + res, r);
+        } else {
+            Vector3i period = res * 2,
+                     r      = p % period;
+            r = dr::select(r < 0, r + period, r);
+            return dr::select(r >= res, period - 1 - r, r);
+        }
+    }
+
+    /**
+     * \brief Fetch all channels of the voxel at the given (wrapped) integer
+     * coordinates
+     *
+     * Voxels in empty tiles evaluate to zero without accessing the brick pool.
+     */
+    void fetch(const Vector3i &p, Float *out, Mask active) const {
+        UInt32 B = m_brick_size;
+        Vector3u pu(p), tile = pu / B, offs = pu - tile * B;
+
+        UInt32 tile_index = (tile.z() * m_tile_count.y() + tile.y()) * m_tile_count.x() + tile.x();
+        UInt32 brick = dr::gather<UInt32>(m_tiles, tile_index, active);
+        active &= brick != 0;
+
+        UInt32 index = (((brick * B + offs.z()) * B + offs.y()) * B + offs.x()) * m_channel_count;
+        for (uint32_t c = 0; c < m_channel_count; ++c)
+            out[c] = dr::gather<Float>(m_bricks, index + c, active);
+    }
+
+    /// Evaluate all channels of the volume at the given interaction
+    void interpolate(const Interaction3f &it, Float *out, Mask active) const {
+        MI_MASK_ARGUMENT(active);
+
+        Point3f p = m_to_local * it.p;
+        ScalarVector3f res(m_size);
+        uint32_t C = m_channel_count;
+
+        if (!m_linear) {
+            Vector3i p_i = wrap(dr::floor2int<Vector3i>(p * res));
+            fetch(p_i, out, active);
+            return;
+        }
+
+        p = dr::fmadd(p, res, -.5f);
+        Vector3i p_i = dr::floor2int<Vector3i>(p);
+
+        // Interpolation weights
+        Point3f w1 = p - Point3f(p_i),
+                w0 = 1.f - w1;
+
+        for (uint32_t c = 0; c < C; ++c)
+            out[c] = dr::zeros<Float>();
+
+        Float values[6];
+        for (int k = 0; k < 8; ++k) {
+            Vector3i offset(k & 1, (k >> 1) & 1, (k >> 2) & 1);
+            fetch(wrap(p_i + offset), values, active);
+
+            Float weight = ((k & 1) ? w1.x() : w0.x()) *
+                           (((k >> 1) & 1) ? w1.y() : w0.y()) *
+                           (((k >> 2) & 1) ? w1.z() : w0.z());
+            for (uint32_t c = 0; c < C; ++c)
+                out[c] = dr::fmadd(weight, values[c], out[c]);
+        }
+    }
+
+    /// Number of voxels per brick
+    size_t brick_voxels() const {
+        return (size_t) m_brick_size * m_brick_size * m_brick_size;
+    }
+
+    /// Copy the top-level index to the host
+    std::vector<uint32_t> tiles_host() const {
+        auto &&tiles = dr::migrate(m_tiles, AllocType::Host);
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+        const uint32_t *ptr = (const uint32_t *) tiles.data();
+        return std::vector<uint32_t>(ptr, ptr + tiles.size());
+    }
+
+    /// Recompute the per-tile and global maxima from the brick pool
+    void update_max() {
+        auto &&bricks = dr::migrate(dr::detach(m_bricks), AllocType::Host);
+        if constexpr (dr::is_jit_v<Float>)
+            dr::sync_thread();
+        const ScalarFloat *ptr = (const ScalarFloat *) bricks.data();
+
+        uint32_t C = m_channel_count;
+        size_t brick_values = brick_voxels() * C,
+               brick_count  = bricks.size() / brick_values;
+
+        std::vector<ScalarFloat> brick_max(brick_count, -dr::Infinity<ScalarFloat>);
+        std::vector<ScalarFloat> max_per_channel(C, -dr::Infinity<ScalarFloat>);
+        std::vector<uint32_t> tiles = tiles_host();
+        bool has_empty = std::find(tiles.begin(), tiles.end(), 0u) != tiles.end();
+
+        for (size_t b = 0; b < brick_count; ++b) {
+            for (size_t i = 0; i < brick_values; ++i) {
+                ScalarFloat value = ptr[b * brick_values + i];
+                brick_max[b] = dr::maximum(brick_max[b], value);
+                if (b > 0 || has_empty)
+                    max_per_channel[i % C] = dr::maximum(max_per_channel[i % C], value);
+            }
+        }
+
+        for (size_t t = 0; t < tiles.size(); ++t)
+            m_tile_max[t] = brick_max[tiles[t]];
+        m_max_per_channel = max_per_channel;
+
+        if (!m_fixed_max) {
+            m_max = -dr::Infinity<ScalarFloat>;
+            for (ScalarFloat value : max_per_channel)
+                m_max = dr::maximum(m_max, value);
+        }
+    }
+
+protected:
+    /// Top-level index mapping every tile to a brick (0: empty)
+    DynamicBuffer<UInt32> m_tiles;
+    /// Brick pool, whose first brick is reserved and stores zeros
+    FloatStorage m_bricks;
+    /// Maximum over all channels of every tile (used for majorants)
+    std::vector<ScalarFloat> m_tile_max;
+
+    ScalarVector3u m_size;
+    ScalarVector3u m_tile_count;
+    uint32_t m_brick_size;
+    bool m_linear;
+    dr::WrapMode m_wrap_mode;
+    bool m_fixed_max = false;
+    ScalarFloat m_max;
+    std::vector<ScalarFloat> m_max_per_channel;
+};
+
+MI_IMPLEMENT_CLASS_VARIANT(SparseGridVolume, Volume)
+MI_EXPORT_PLUGIN(SparseGridVolume, "SparseGridVolume texture")
+
+NAMESPACE_END(mitsuba)
@@ -0,0 +1,93 @@
+import pytest
+import drjit as dr
+import mitsuba as mi
+import numpy as np
+import os
+
+
+def make_sparse_data(np_rng, shape, channels=1):
+    # Mostly empty grid with two dense blobs
+    data = np.zeros(shape + (channels,), dtype=np.float32)
+    data[2:7, 3:9, 1:5] = np_rng.random((5, 6, 4, channels))
+    data[-4:, -3:, -6:] = np_rng.random((4, 3, 6, channels)) * 4
+    return data
+
+
+def test01_conversion_roundtrip(variants_all_scalar, tmpdir, np_rng):
+    data = make_sparse_data(np_rng, (21, 30, 26), 3)
+    sparse = mi.SparseVolumeGrid(mi.VolumeGrid(data), brick_size=8)
+
+    assert dr.allclose(sparse.size(), [26, 30, 21])
+    assert dr.allclose(sparse.tile_count(), [4, 4, 3])
+    # Two blobs touching a few bricks, plus the reserved empty brick
+    assert sparse.brick_count() < 12
+    assert np.allclose(np.array(sparse.to_dense()), data)
+    assert dr.allclose(sparse.max(), np.max(data))
+    assert dr.allclose(sparse.max_per_channel(), np.max(data, axis=(0, 1, 2)))
+
+    tmp_file = os.path.join(str(tmpdir), "out.svol")
+    sparse.write(tmp_file)
+    loaded = mi.SparseVolumeGrid(tmp_file)
+    assert loaded.brick_count() == sparse.brick_count()
+    assert np.allclose(np.array(loaded.to_dense()), data)
+    assert dr.allclose(loaded.tile_max(), sparse.tile_max())
+
+    # Dense files are converted when loaded
+    tmp_file = os.path.join(str(tmpdir), "out.vol")
+    mi.VolumeGrid(data).write(tmp_file)
+    loaded = mi.SparseVolumeGrid(tmp_file)
+    assert loaded.brick_count() == sparse.brick_count()
+    assert np.allclose(np.array(loaded.to_dense()), data)
+
+
+def test02_threshold(variants_all_scalar, np_rng):
+    data = np.full((16, 16, 16, 1), 1e-4, dtype=np.float32)
+    data[:8, :8, :8] = 1.0
+    assert mi.SparseVolumeGrid(mi.VolumeGrid(data)).brick_count() == 9
+    sparse = mi.SparseVolumeGrid(mi.VolumeGrid(data), threshold=1e-3)
+    assert sparse.brick_count() == 2
+    assert dr.allclose(sparse.tile_max(), [1, 0, 0, 0, 0, 0, 0, 0])
+
+
+@pytest.mark.parametrize('filter_type', ['trilinear', 'nearest'])
+@pytest.mark.parametrize('wrap_mode', ['clamp', 'repeat', 'mirror'])
+@pytest.mark.parametrize('channels', [1, 3])
+def test03_eval_matches_gridvolume(variants_vec_rgb, np_rng, filter_type,
+                                   wrap_mode, channels):
+    data = make_sparse_data(np_rng, (21, 30, 26), channels)
+    grid = mi.VolumeGrid(data)
+
+    params = {
+        'filter_type': filter_type,
+        'wrap_mode': wrap_mode,
+        'grid': grid
+    }
+    dense = mi.load_dict(dict(type='gridvolume', **params))
+    sparse = mi.load_dict(dict(type='sparsegridvolume', brick_size=4, **params))
+
+    it = dr.zeros(mi.Interaction3f, 4096)
+    it.p = mi.Point3f(np_rng.random((3, 4096)) * 1.4 - 0.2)
+
+    assert dr.allclose(sparse.eval(it), dense.eval(it), atol=1e-5)
+    assert dr.allclose(sparse.eval_1(it), dense.eval_1(it), atol=1e-5)
+    assert sparse.max() == dense.max()
+
+
+def test04_max_per_cell(variants_vec_rgb, np_rng):
+    data = make_sparse_data(np_rng, (32, 32, 32))
+    grid = mi.VolumeGrid(data)
+    sparse = mi.load_dict({
+        'type': 'sparsegridvolume',
+        'grid': grid
+    })
+
+    cell_max = np.array(sparse.max_per_cell([4, 4, 4])).reshape(4, 4, 4)
+    dense_max = np.array(mi.load_dict({
+        'type': 'gridvolume',
+        'grid': grid
+    }).max_per_cell([4, 4, 4])).reshape(4, 4, 4)
+
+    # Per-brick bounds are conservative, and empty space is detected
+    assert np.all(cell_max >= dense_max)
+    assert np.count_nonzero(cell_max == 0) > 32
+    assert np.isclose(np.max(cell_max), np.max(data))